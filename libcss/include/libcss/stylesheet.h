@@ -143,6 +143,11 @@ css_error css_stylesheet_append_data(css_stylesheet *sheet,
 		const uint8_t *data, size_t len);
 css_error css_stylesheet_data_done(css_stylesheet *sheet);
 
+css_error css_stylesheet_serialise(css_stylesheet *sheet,
+		uint8_t **data, size_t *len);
+css_error css_stylesheet_deserialise(css_stylesheet *sheet,
+		const uint8_t *data, size_t len);
+
 css_error css_stylesheet_next_pending_import(css_stylesheet *parent,
 		lwc_string **url);
 css_error css_stylesheet_register_import(css_stylesheet *parent,
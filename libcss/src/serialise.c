@@ -0,0 +1,1428 @@
+/*
+ * This file is part of LibCSS.
+ * Licensed under the MIT License,
+ *		  http://www.opensource.org/licenses/mit-license.php
+ * Copyright 2026 NetSurf Browser Project
+ */
+
+#include <string.h>
+
+#include "stylesheet.h"
+#include "bytecode/bytecode.h"
+#include "parse/mq.h"
+#include "select/font_face.h"
+#include "utils/utils.h"
+
+/*
+ * Compiled stylesheet serialisation
+ *
+ * A finished stylesheet is written out as its rule tree, selector chains
+ * and style bytecode, along with a table of the interned strings they
+ * refer to. Loading re-interns each string once and builds the rules
+ * directly, so no lexing or parsing takes place.
+ *
+ * The data is in host byte order and is only intended to be read back by
+ * the same build of the library. All integers are unsigned 32 bit unless
+ * noted otherwise. Strings are stored as an index into the string table,
+ * with STRING_NONE for NULL.
+ *
+ *   header:   magic, version, CSS_N_PROPERTIES, sizeof(css_code_t),
+ *             payload checksum, payload length
+ *   payload:  level, quirks allowed, inline style, quirks used and
+ *             uses revert flags (8 bit each)
+ *             sheet URL (length, bytes)
+ *             string count, bytecode string vector count
+ *             strings (length, bytes), bytecode vector entries first
+ *             top level rule count, rules
+ *
+ *   rule:     type (8 bit), followed by
+ *               selector:  selector count, selector chains, style
+ *               charset:   encoding
+ *               import:    url, media query list
+ *               media:     media query list, child count, child rules
+ *               font-face: present (8 bit), font-family, bits (8 bit),
+ *                          source count, sources (location, bits (8 bit))
+ *               page:      has selector (8 bit), selector chain, style
+ *
+ *   style:    present (8 bit), code count, bytecode
+ *   chain:    selector count, then for each selector starting with the
+ *             rightmost: specificity, detail count, details
+ *   detail:   namespace, name, type, combinator, value type and
+ *             negate (8 bit each), then string value or nth a and b
+ *   mq list:  query count, then for each query: negate type (8 bit),
+ *             type (64 bit), has condition (8 bit), condition
+ *   cond:     negate and op (8 bit each), part count, parts
+ *   part:     type (8 bit), then condition or feature
+ *   feature:  name, op, op2, value, value2
+ *   value:    type (8 bit), then number, dimension (length, unit),
+ *             identifier or ratio
+ */
+
+/** Serialised stylesheet magic number ("LCSS") */
+#define SERIALISE_MAGIC 0x4c435353
+/** Serialised stylesheet format version; bump when the format changes */
+#define SERIALISE_VERSION 1
+/** Size of the serialised header, in bytes */
+#define SERIALISE_HEADER_SIZE (6 * sizeof(uint32_t))
+/** String index representing a NULL string */
+#define STRING_NONE 0xffffffff
+/** Maximum depth of nested rules and media conditions */
+#define MAX_DEPTH 32
+
+/**
+ * Growable output buffer
+ */
+typedef struct serialise_buffer {
+	uint8_t *data;		/**< Buffer data */
+	size_t len;		/**< Length of data in buffer */
+	size_t alloc;		/**< Allocated size of buffer */
+} serialise_buffer;
+
+/**
+ * Serialisation context
+ */
+typedef struct serialise_ctx {
+	serialise_buffer strings;	/**< Serialised string table */
+	serialise_buffer body;		/**< Serialised rules */
+
+	lwc_string **table;		/**< Strings in the string table */
+	uint32_t n_table;		/**< Number of strings in table */
+	uint32_t alloc_table;		/**< Allocated size of table */
+
+	uint32_t *hash;			/**< Table index + 1, by pointer */
+	uint32_t hash_size;		/**< Number of hash slots */
+
+	bool nomem;			/**< Memory was exhausted */
+} serialise_ctx;
+
+/**
+ * Deserialised rule, before it is added to the sheet
+ */
+typedef struct deserialise_rule {
+	css_rule *rule;			/**< The rule */
+	uint32_t parent;		/**< Index of parent, or STRING_NONE */
+} deserialise_rule;
+
+/**
+ * Deserialisation context
+ */
+typedef struct deserialise_ctx {
+	css_stylesheet *sheet;		/**< Sheet being loaded into */
+
+	const uint8_t *data;		/**< Payload data */
+	size_t len;			/**< Length of payload */
+	size_t pos;			/**< Current read position */
+
+	lwc_string **strings;		/**< Interned string table */
+	uint32_t n_strings;		/**< Number of strings in table */
+
+	deserialise_rule *rules;	/**< Rules, in document order */
+	uint32_t n_rules;		/**< Number of rules */
+	uint32_t alloc_rules;		/**< Allocated size of rules */
+
+	css_error error;		/**< First error encountered */
+} deserialise_ctx;
+
+/**
+ * Compute the checksum of some serialised data (32 bit FNV-1a)
+ */
+static uint32_t serialise_checksum(const uint8_t *data, size_t len)
+{
+	uint32_t hash = 0x811c9dc5;
+
+	while (len-- > 0) {
+		hash ^= *data++;
+		hash *= 0x01000193;
+	}
+
+	return hash;
+}
+
+/******************************************************************************
+ * Serialisation                                                              *
+ ******************************************************************************/
+
+static void put_bytes(serialise_ctx *ctx, serialise_buffer *buf,
+		const void *data, size_t len)
+{
+	if (ctx->nomem)
+		return;
+
+	if (buf->len + len > buf->alloc) {
+		size_t alloc = buf->alloc == 0 ? 4096 : buf->alloc * 2;
+		uint8_t *temp;
+
+		while (alloc < buf->len + len)
+			alloc *= 2;
+
+		temp = realloc(buf->data, alloc);
+		if (temp == NULL) {
+			ctx->nomem = true;
+			return;
+		}
+
+		buf->data = temp;
+		buf->alloc = alloc;
+	}
+
+	memcpy(buf->data + buf->len, data, len);
+	buf->len += len;
+}
+
+static void put_u8(serialise_ctx *ctx, uint32_t value)
+{
+	uint8_t v = value;
+
+	put_bytes(ctx, &ctx->body, &v, sizeof(v));
+}
+
+static void put_u32(serialise_ctx *ctx, uint32_t value)
+{
+	put_bytes(ctx, &ctx->body, &value, sizeof(value));
+}
+
+static void put_u64(serialise_ctx *ctx, uint64_t value)
+{
+	put_bytes(ctx, &ctx->body, &value, sizeof(value));
+}
+
+/**
+ * Add a string to the string table
+ *
+ * \param ctx     Serialisation context
+ * \param string  String to add
+ * \param dedupe  Whether to reuse an existing entry for the string
+ * \return Index of string in table
+ */
+static uint32_t table_add(serialise_ctx *ctx, lwc_string *string, bool dedupe)
+{
+	uint32_t len = lwc_string_length(string);
+	uint32_t slot;
+
+	if (ctx->nomem)
+		return STRING_NONE;
+
+	/* Interned strings are equal iff they are the same object, so
+	 * the hash is keyed on the pointer. Keep it at most half full. */
+	if (ctx->n_table * 2 >= ctx->hash_size) {
+		uint32_t size = ctx->hash_size == 0 ? 256 : ctx->hash_size * 2;
+		uint32_t *hash;
+		uint32_t i;
+
+		hash = calloc(size, sizeof(uint32_t));
+		if (hash == NULL) {
+			ctx->nomem = true;
+			return STRING_NONE;
+		}
+
+		for (i = 0; i < ctx->n_table; i++) {
+			slot = ((uintptr_t) ctx->table[i] >> 4) & (size - 1);
+			while (hash[slot] != 0)
+				slot = (slot + 1) & (size - 1);
+			hash[slot] = i + 1;
+		}
+
+		free(ctx->hash);
+		ctx->hash = hash;
+		ctx->hash_size = size;
+	}
+
+	slot = ((uintptr_t) string >> 4) & (ctx->hash_size - 1);
+	while (ctx->hash[slot] != 0) {
+		if (ctx->table[ctx->hash[slot] - 1] == string) {
+			if (dedupe)
+				return ctx->hash[slot] - 1;
+			/* Leave the existing entry in the hash */
+			slot = STRING_NONE;
+			break;
+		}
+		slot = (slot + 1) & (ctx->hash_size - 1);
+	}
+
+	if (ctx->n_table == ctx->alloc_table) {
+		uint32_t alloc = ctx->alloc_table == 0 ? 256 :
+				ctx->alloc_table * 2;
+		lwc_string **table;
+
+		table = realloc(ctx->table, alloc * sizeof(lwc_string *));
+		if (table == NULL) {
+			ctx->nomem = true;
+			return STRING_NONE;
+		}
+
+		ctx->table = table;
+		ctx->alloc_table = alloc;
+	}
+
+	ctx->table[ctx->n_table] = string;
+	if (slot != STRING_NONE)
+		ctx->hash[slot] = ctx->n_table + 1;
+
+	put_bytes(ctx, &ctx->strings, &len, sizeof(len));
+	put_bytes(ctx, &ctx->strings, lwc_string_data(string), len);
+
+	return ctx->n_table++;
+}
+
+static void put_string(serialise_ctx *ctx, lwc_string *string)
+{
+	if (string == NULL)
+		put_u32(ctx, STRING_NONE);
+	else
+		put_u32(ctx, table_add(ctx, string, true));
+}
+
+static void put_style(serialise_ctx *ctx, const css_style *style)
+{
+	put_u8(ctx, style != NULL);
+
+	if (style != NULL) {
+		put_u32(ctx, style->used);
+		put_bytes(ctx, &ctx->body, style->bytecode,
+				style->used * sizeof(css_code_t));
+	}
+}
+
+static void put_selector_chain(serialise_ctx *ctx, const css_selector *selector)
+{
+	const css_selector *s;
+	uint32_t count = 0;
+
+	for (s = selector; s != NULL; s = s->combinator)
+		count++;
+
+	put_u32(ctx, count);
+
+	for (s = selector; s != NULL; s = s->combinator) {
+		const css_selector_detail *detail;
+		uint32_t details = 1;
+
+		for (detail = &s->data; detail->next; detail++)
+			details++;
+
+		/* Specificity is kept rather than recomputed, as it depends
+		 * on the sheet being inline when it was parsed */
+		put_u32(ctx, s->specificity);
+		put_u32(ctx, details);
+
+		for (detail = &s->data; details > 0; detail++, details--) {
+			put_string(ctx, detail->qname.ns);
+			put_string(ctx, detail->qname.name);
+			put_u8(ctx, detail->type);
+			put_u8(ctx, detail->comb);
+			put_u8(ctx, detail->value_type);
+			put_u8(ctx, detail->negate);
+
+			if (detail->value_type ==
+					CSS_SELECTOR_DETAIL_VALUE_STRING) {
+				put_string(ctx, detail->value.string);
+			} else {
+				put_u32(ctx, detail->value.nth.a);
+				put_u32(ctx, detail->value.nth.b);
+			}
+		}
+	}
+}
+
+static void put_mq_value(serialise_ctx *ctx, const css_mq_value *value)
+{
+	put_u8(ctx, value->type);
+
+	switch (value->type) {
+	case CSS_MQ_VALUE_TYPE_NUM:
+	case CSS_MQ_VALUE_TYPE_RATIO:
+		put_u32(ctx, value->data.num_or_ratio);
+		break;
+	case CSS_MQ_VALUE_TYPE_DIM:
+		put_u32(ctx, value->data.dim.len);
+		put_u32(ctx, value->data.dim.unit);
+		break;
+	case CSS_MQ_VALUE_TYPE_IDENT:
+		put_string(ctx, value->data.ident);
+		break;
+	}
+}
+
+static void put_mq_cond(serialise_ctx *ctx, const css_mq_cond *cond)
+{
+	uint32_t i;
+
+	put_u8(ctx, cond->negate);
+	put_u8(ctx, cond->op);
+	put_u32(ctx, cond->nparts);
+
+	for (i = 0; i < cond->nparts; i++) {
+		const css_mq_cond_or_feature *part = cond->parts[i];
+
+		put_u8(ctx, part->type);
+
+		if (part->type == CSS_MQ_COND) {
+			put_mq_cond(ctx, part->data.cond);
+		} else {
+			const css_mq_feature *feat = part->data.feat;
+
+			put_string(ctx, feat->name);
+			put_u32(ctx, feat->op);
+			put_u32(ctx, feat->op2);
+			put_mq_value(ctx, &feat->value);
+			put_mq_value(ctx, &feat->value2);
+		}
+	}
+}
+
+static void put_mq_list(serialise_ctx *ctx, const css_mq_query *media)
+{
+	const css_mq_query *m;
+	uint32_t count = 0;
+
+	for (m = media; m != NULL; m = m->next)
+		count++;
+
+	put_u32(ctx, count);
+
+	for (m = media; m != NULL; m = m->next) {
+		put_u8(ctx, m->negate_type);
+		put_u64(ctx, m->type);
+		put_u8(ctx, m->cond != NULL);
+		if (m->cond != NULL)
+			put_mq_cond(ctx, m->cond);
+	}
+}
+
+static void put_rule(serialise_ctx *ctx, const css_rule *rule)
+{
+	put_u8(ctx, rule->type);
+
+	switch (rule->type) {
+	case CSS_RULE_UNKNOWN:
+		break;
+	case CSS_RULE_SELECTOR:
+	{
+		const css_rule_selector *s = (const css_rule_selector *) rule;
+		uint32_t i;
+
+		put_u32(ctx, rule->items);
+		for (i = 0; i < rule->items; i++)
+			put_selector_chain(ctx, s->selectors[i]);
+		put_style(ctx, s->style);
+	}
+		break;
+	case CSS_RULE_CHARSET:
+		put_string(ctx, ((const css_rule_charset *) rule)->encoding);
+		break;
+	case CSS_RULE_IMPORT:
+	{
+		const css_rule_import *i = (const css_rule_import *) rule;
+
+		/* The imported sheet is owned by the client, which registers
+		 * it again once the sheet is loaded */
+		put_string(ctx, i->url);
+		put_mq_list(ctx, i->media);
+	}
+		break;
+	case CSS_RULE_MEDIA:
+	{
+		const css_rule_media *m = (const css_rule_media *) rule;
+		const css_rule *c;
+		uint32_t count = 0;
+
+		put_mq_list(ctx, m->media);
+
+		for (c = m->first_child; c != NULL; c = c->next)
+			count++;
+
+		put_u32(ctx, count);
+		for (c = m->first_child; c != NULL; c = c->next)
+			put_rule(ctx, c);
+	}
+		break;
+	case CSS_RULE_FONT_FACE:
+	{
+		const css_font_face *f =
+				((const css_rule_font_face *) rule)->font_face;
+		uint32_t i;
+
+		put_u8(ctx, f != NULL);
+		if (f == NULL)
+			break;
+
+		put_string(ctx, f->font_family);
+		put_u8(ctx, f->bits[0]);
+		put_u32(ctx, f->n_srcs);
+		for (i = 0; i < f->n_srcs; i++) {
+			put_string(ctx, f->srcs[i].location);
+			put_u8(ctx, f->srcs[i].bits[0]);
+		}
+	}
+		break;
+	case CSS_RULE_PAGE:
+	{
+		const css_rule_page *p = (const css_rule_page *) rule;
+
+		put_u8(ctx, p->selector != NULL);
+		if (p->selector != NULL)
+			put_selector_chain(ctx, p->selector);
+		put_style(ctx, p->style);
+	}
+		break;
+	}
+}
+
+/**
+ * Serialise a compiled stylesheet
+ *
+ * \param sheet  The stylesheet to serialise
+ * \param data   Pointer to location to receive serialised data
+ * \param len    Pointer to location to receive length of data
+ * \return CSS_OK on success,
+ *	   CSS_BADPARM on bad parameters,
+ *	   CSS_INVALID if the sheet has not been completely parsed,
+ *	   CSS_NOMEM on memory exhaustion
+ *
+ * The serialised data may be loaded into a new stylesheet with
+ * css_stylesheet_deserialise(), by the same build of the library, to avoid
+ * parsing the sheet's source again. Imported stylesheets are not included.
+ *
+ * \post On success, the client owns the data and must free() it.
+ */
+css_error css_stylesheet_serialise(css_stylesheet *sheet,
+		uint8_t **data, size_t *len)
+{
+	serialise_ctx ctx;
+	serialise_buffer out = { NULL, 0, 0 };
+	uint32_t header[6];
+	uint32_t url_len;
+	uint32_t count = 0;
+	const css_rule *r;
+	uint32_t i;
+
+	if (sheet == NULL || data == NULL || len == NULL)
+		return CSS_BADPARM;
+
+	if (sheet->parser != NULL)
+		return CSS_INVALID;
+
+	memset(&ctx, 0, sizeof(ctx));
+
+	/* The bytecode refers to strings by their position in the
+	 * sheet's vector, so that forms the start of the table */
+	for (i = 0; i < sheet->string_vector_c; i++)
+		table_add(&ctx, sheet->string_vector[i], false);
+
+	for (r = sheet->rule_list; r != NULL; r = r->next)
+		count++;
+
+	put_u32(&ctx, count);
+	for (r = sheet->rule_list; r != NULL; r = r->next)
+		put_rule(&ctx, r);
+
+	/* Assemble the header, sheet details, string table and rules */
+	url_len = strlen(sheet->url);
+
+	put_bytes(&ctx, &out, header, sizeof(header));
+	put_bytes(&ctx, &out, (uint8_t[]) { sheet->level,
+			sheet->quirks_allowed, sheet->inline_style,
+			sheet->quirks_used, sheet->uses_revert }, 5);
+	put_bytes(&ctx, &out, &url_len, sizeof(url_len));
+	put_bytes(&ctx, &out, sheet->url, url_len);
+	put_bytes(&ctx, &out, &ctx.n_table, sizeof(ctx.n_table));
+	put_bytes(&ctx, &out, &sheet->string_vector_c, sizeof(uint32_t));
+	put_bytes(&ctx, &out, ctx.strings.data, ctx.strings.len);
+	put_bytes(&ctx, &out, ctx.body.data, ctx.body.len);
+
+	free(ctx.strings.data);
+	free(ctx.body.data);
+	free(ctx.table);
+	free(ctx.hash);
+
+	if (ctx.nomem) {
+		free(out.data);
+		return CSS_NOMEM;
+	}
+
+	header[0] = SERIALISE_MAGIC;
+	header[1] = SERIALISE_VERSION;
+	header[2] = CSS_N_PROPERTIES;
+	header[3] = sizeof(css_code_t);
+	header[4] = serialise_checksum(out.data + SERIALISE_HEADER_SIZE,
+			out.len - SERIALISE_HEADER_SIZE);
+	header[5] = out.len - SERIALISE_HEADER_SIZE;
+	memcpy(out.data, header, sizeof(header));
+
+	*data = out.data;
+	*len = out.len;
+
+	return CSS_OK;
+}
+
+/******************************************************************************
+ * Deserialisation                                                            *
+ ******************************************************************************/
+
+/**
+ * Read bytes from the serialised data
+ *
+ * \param ctx   Deserialisation context
+ * \param dest  Location to receive data
+ * \param len   Number of bytes to read
+ * \return true on success, false if the data is truncated
+ *
+ * Running out of data flags the context as invalid, and fills \a dest
+ * with zeroes, so callers need only check the context's error at points
+ * where they would otherwise allocate memory based on what was read.
+ */
+static bool get_bytes(deserialise_ctx *ctx, void *dest, size_t len)
+{
+	if (ctx->len - ctx->pos < len) {
+		if (ctx->error == CSS_OK)
+			ctx->error = CSS_INVALID;
+		ctx->pos = ctx->len;
+		memset(dest, 0, len);
+		return false;
+	}
+
+	memcpy(dest, ctx->data + ctx->pos, len);
+	ctx->pos += len;
+
+	return true;
+}
+
+static uint8_t get_u8(deserialise_ctx *ctx)
+{
+	uint8_t value;
+
+	get_bytes(ctx, &value, sizeof(value));
+
+	return value;
+}
+
+static uint32_t get_u32(deserialise_ctx *ctx)
+{
+	uint32_t value;
+
+	get_bytes(ctx, &value, sizeof(value));
+
+	return value;
+}
+
+static uint64_t get_u64(deserialise_ctx *ctx)
+{
+	uint64_t value;
+
+	get_bytes(ctx, &value, sizeof(value));
+
+	return value;
+}
+
+/**
+ * Read a count of items, each at least \a size bytes long
+ *
+ * Counts which could not possibly fit in the remaining data are rejected,
+ * so that corrupt data cannot cause huge allocations.
+ */
+static uint32_t get_count(deserialise_ctx *ctx, size_t size)
+{
+	uint32_t count = get_u32(ctx);
+
+	if (count > (ctx->len - ctx->pos) / size) {
+		if (ctx->error == CSS_OK)
+			ctx->error = CSS_INVALID;
+		return 0;
+	}
+
+	return count;
+}
+
+/**
+ * Read a reference to a string table entry
+ *
+ * \return The string (not referenced), or NULL
+ */
+static lwc_string *get_string(deserialise_ctx *ctx)
+{
+	uint32_t index = get_u32(ctx);
+
+	if (index == STRING_NONE)
+		return NULL;
+
+	if (index >= ctx->n_strings) {
+		if (ctx->error == CSS_OK)
+			ctx->error = CSS_INVALID;
+		return NULL;
+	}
+
+	return ctx->strings[index];
+}
+
+/**
+ * Read a reference to a string which must be present
+ *
+ * \return The string, referenced, or NULL on error
+ */
+static lwc_string *get_required_string(deserialise_ctx *ctx)
+{
+	lwc_string *string = get_string(ctx);
+
+	if (string == NULL) {
+		if (ctx->error == CSS_OK)
+			ctx->error = CSS_INVALID;
+		return NULL;
+	}
+
+	return lwc_string_ref(string);
+}
+
+static lwc_string *get_optional_string(deserialise_ctx *ctx)
+{
+	lwc_string *string = get_string(ctx);
+
+	return string != NULL ? lwc_string_ref(string) : NULL;
+}
+
+static void fail(deserialise_ctx *ctx, css_error error)
+{
+	if (ctx->error == CSS_OK)
+		ctx->error = error;
+}
+
+static css_style *get_style(deserialise_ctx *ctx)
+{
+	css_style *style;
+	uint32_t used;
+
+	if (get_u8(ctx) == 0)
+		return NULL;
+
+	used = get_count(ctx, sizeof(css_code_t));
+	if (ctx->error != CSS_OK)
+		return NULL;
+
+	style = malloc(sizeof(css_style));
+	if (style == NULL) {
+		fail(ctx, CSS_NOMEM);
+		return NULL;
+	}
+
+	style->bytecode = malloc(max(used, 1) * sizeof(css_code_t));
+	if (style->bytecode == NULL) {
+		free(style);
+		fail(ctx, CSS_NOMEM);
+		return NULL;
+	}
+
+	get_bytes(ctx, style->bytecode, used * sizeof(css_code_t));
+	style->used = used;
+	style->allocated = max(used, 1);
+	style->sheet = ctx->sheet;
+
+	return style;
+}
+
+static void destroy_style(css_style *style)
+{
+	/* Not via css__stylesheet_style_destroy(), which would cache it */
+	if (style != NULL) {
+		free(style->bytecode);
+		free(style);
+	}
+}
+
+static css_selector *get_selector_chain(deserialise_ctx *ctx)
+{
+	css_selector *first = NULL, *last = NULL;
+	uint32_t count;
+
+	/* A selector is at least its specificity and detail count */
+	count = get_count(ctx, 2 * sizeof(uint32_t));
+	if (count == 0)
+		fail(ctx, CSS_INVALID);
+
+	while (ctx->error == CSS_OK && count-- > 0) {
+		css_selector_detail *detail;
+		css_selector *s;
+		uint32_t specificity, details, i;
+
+		specificity = get_u32(ctx);
+		/* A detail is at least two strings and four flags */
+		details = get_count(ctx, 2 * sizeof(uint32_t) + 4);
+		if (details == 0)
+			fail(ctx, CSS_INVALID);
+		if (ctx->error != CSS_OK)
+			break;
+
+		s = calloc(1, sizeof(css_selector) +
+				(details - 1) * sizeof(css_selector_detail));
+		if (s == NULL) {
+			fail(ctx, CSS_NOMEM);
+			break;
+		}
+
+		s->specificity = specificity;
+
+		for (i = 0, detail = &s->data; i < details; i++, detail++) {
+			css_selector_detail_value value;
+			lwc_string *ns, *name;
+			uint8_t type, comb, value_type, negate;
+
+			ns = get_optional_string(ctx);
+			name = get_optional_string(ctx);
+			type = get_u8(ctx);
+			comb = get_u8(ctx);
+			value_type = get_u8(ctx);
+			negate = get_u8(ctx);
+
+			if (value_type == CSS_SELECTOR_DETAIL_VALUE_STRING) {
+				value.string = get_optional_string(ctx);
+			} else {
+				value.nth.a = get_u32(ctx);
+				value.nth.b = get_u32(ctx);
+			}
+
+			if (name == NULL ||
+					type > CSS_SELECTOR_ATTRIBUTE_SUBSTRING ||
+					comb > CSS_COMBINATOR_GENERIC_SIBLING ||
+					value_type > 1 || negate > 1)
+				fail(ctx, CSS_INVALID);
+
+			/* Selection relies on element, class and id names
+			 * having their caseless version interned */
+			if (ctx->error == CSS_OK &&
+					(type == CSS_SELECTOR_ELEMENT ||
+					type == CSS_SELECTOR_CLASS ||
+					type == CSS_SELECTOR_ID) &&
+					name->insensitive == NULL &&
+					lwc__intern_caseless_string(name) !=
+							lwc_error_ok)
+				fail(ctx, CSS_NOMEM);
+
+			if (ctx->error != CSS_OK) {
+				if (ns != NULL)
+					lwc_string_unref(ns);
+				if (name != NULL)
+					lwc_string_unref(name);
+				if (value_type == 
+					CSS_SELECTOR_DETAIL_VALUE_STRING &&
+						value.string != NULL)
+					lwc_string_unref(value.string);
+				break;
+			}
+
+			detail->qname.ns = ns;
+			detail->qname.name = name;
+			detail->value = value;
+			detail->type = type;
+			detail->comb = comb;
+			detail->value_type = value_type;
+			detail->negate = negate;
+
+			if (i > 0) {
+				detail[-1].next = 1;
+			} else if (last == NULL) {
+				first = last = s;
+			} else {
+				last->combinator = s;
+				last = s;
+			}
+		}
+
+		if (i == 0) {
+			/* Nothing was read, so the selector is not linked */
+			free(s);
+			break;
+		}
+
+		/* Only a selector with a combinator may be followed */
+		if ((s->data.comb == CSS_COMBINATOR_NONE) != (count == 0))
+			fail(ctx, CSS_INVALID);
+	}
+
+	if (ctx->error != CSS_OK && first != NULL) {
+		css__stylesheet_selector_destroy(ctx->sheet, first);
+		first = NULL;
+	}
+
+	return first;
+}
+
+static void get_mq_value(deserialise_ctx *ctx, css_mq_value *value)
+{
+	value->type = get_u8(ctx);
+
+	switch (value->type) {
+	case CSS_MQ_VALUE_TYPE_NUM:
+	case CSS_MQ_VALUE_TYPE_RATIO:
+		value->data.num_or_ratio = get_u32(ctx);
+		break;
+	case CSS_MQ_VALUE_TYPE_DIM:
+		value->data.dim.len = get_u32(ctx);
+		value->data.dim.unit = get_u32(ctx);
+		break;
+	case CSS_MQ_VALUE_TYPE_IDENT:
+		value->data.ident = get_required_string(ctx);
+		if (value->data.ident == NULL)
+			value->type = CSS_MQ_VALUE_TYPE_NUM;
+		break;
+	default:
+		value->type = CSS_MQ_VALUE_TYPE_NUM;
+		fail(ctx, CSS_INVALID);
+		break;
+	}
+}
+
+static void release_mq_feature(css_mq_feature *feat)
+{
+	if (feat->name != NULL)
+		lwc_string_unref(feat->name);
+	if (feat->value.type == CSS_MQ_VALUE_TYPE_IDENT)
+		lwc_string_unref(feat->value.data.ident);
+	if (feat->value2.type == CSS_MQ_VALUE_TYPE_IDENT)
+		lwc_string_unref(feat->value2.data.ident);
+}
+
+/**
+ * Read a media condition
+ *
+ * Parts are linked into the condition as soon as they are allocated, and
+ * are always complete, so that a partially read condition may be
+ * destroyed along with the query containing it.
+ */
+static css_mq_cond *get_mq_cond(deserialise_ctx *ctx, int depth)
+{
+	css_mq_cond *cond;
+	uint8_t negate, op;
+	uint32_t nparts;
+
+	negate = get_u8(ctx);
+	op = get_u8(ctx);
+	/* A part is at least its type */
+	nparts = get_count(ctx, 1);
+	if (negate > 1 || op > 1 || depth > MAX_DEPTH)
+		fail(ctx, CSS_INVALID);
+	if (ctx->error != CSS_OK)
+		return NULL;
+
+	cond = malloc(sizeof(css_mq_cond));
+	if (cond == NULL) {
+		fail(ctx, CSS_NOMEM);
+		return NULL;
+	}
+
+	cond->negate = negate;
+	cond->op = op;
+	cond->nparts = 0;
+	cond->parts = malloc(max(nparts, 1) *
+			sizeof(css_mq_cond_or_feature *));
+	if (cond->parts == NULL) {
+		free(cond);
+		fail(ctx, CSS_NOMEM);
+		return NULL;
+	}
+
+	while (cond->nparts < nparts && ctx->error == CSS_OK) {
+		css_mq_cond_or_feature *part;
+		css_mq_feature feat;
+		uint8_t type = get_u8(ctx);
+
+		if (type == CSS_MQ_FEATURE) {
+			feat.name = get_required_string(ctx);
+			feat.op = get_u32(ctx);
+			feat.op2 = get_u32(ctx);
+			get_mq_value(ctx, &feat.value);
+			get_mq_value(ctx, &feat.value2);
+
+			if (ctx->error != CSS_OK) {
+				release_mq_feature(&feat);
+				break;
+			}
+		} else if (type != CSS_MQ_COND) {
+			fail(ctx, CSS_INVALID);
+			break;
+		}
+
+		part = malloc(sizeof(css_mq_cond_or_feature));
+		if (part == NULL) {
+			if (type == CSS_MQ_FEATURE)
+				release_mq_feature(&feat);
+			fail(ctx, CSS_NOMEM);
+			break;
+		}
+
+		part->type = type;
+
+		if (type == CSS_MQ_FEATURE) {
+			part->data.feat = malloc(sizeof(css_mq_feature));
+			if (part->data.feat == NULL) {
+				release_mq_feature(&feat);
+				free(part);
+				fail(ctx, CSS_NOMEM);
+				break;
+			}
+			*part->data.feat = feat;
+			cond->parts[cond->nparts++] = part;
+		} else {
+			part->data.cond = NULL;
+			cond->parts[cond->nparts++] = part;
+			part->data.cond = get_mq_cond(ctx, depth + 1);
+		}
+	}
+
+	return cond;
+}
+
+static css_mq_query *get_mq_list(deserialise_ctx *ctx)
+{
+	css_mq_query *first = NULL, *last = NULL;
+	uint32_t count;
+
+	/* A query is at least its flags and type */
+	count = get_count(ctx, 2 + sizeof(uint64_t));
+
+	while (ctx->error == CSS_OK && count-- > 0) {
+		css_mq_query *m;
+		uint8_t negate_type;
+
+		m = malloc(sizeof(css_mq_query));
+		if (m == NULL) {
+			fail(ctx, CSS_NOMEM);
+			break;
+		}
+
+		negate_type = get_u8(ctx);
+		if (negate_type > 1)
+			fail(ctx, CSS_INVALID);
+
+		m->next = NULL;
+		m->negate_type = negate_type;
+		m->type = get_u64(ctx);
+		m->cond = NULL;
+
+		if (last == NULL)
+			first = m;
+		else
+			last->next = m;
+		last = m;
+
+		if (get_u8(ctx) != 0)
+			m->cond = get_mq_cond(ctx, 0);
+	}
+
+	if (ctx->error != CSS_OK && first != NULL) {
+		css__mq_query_destroy(first);
+		first = NULL;
+	}
+
+	return first;
+}
+
+static css_font_face *get_font_face(deserialise_ctx *ctx)
+{
+	css_font_face *f;
+	lwc_string *family;
+	uint32_t n_srcs, i;
+
+	if (get_u8(ctx) == 0)
+		return NULL;
+
+	if (css__font_face_create(&f) != CSS_OK) {
+		fail(ctx, CSS_NOMEM);
+		return NULL;
+	}
+
+	family = get_string(ctx);
+	if (family != NULL)
+		css__font_face_set_font_family(f, family);
+
+	f->bits[0] = get_u8(ctx);
+
+	/* A source is at least its location and bits */
+	n_srcs = get_count(ctx, sizeof(uint32_t) + 1);
+	if (ctx->error == CSS_OK && n_srcs > 0) {
+		css_font_face_src *srcs;
+
+		srcs = calloc(n_srcs, sizeof(css_font_face_src));
+		if (srcs == NULL) {
+			fail(ctx, CSS_NOMEM);
+		} else {
+			css__font_face_set_srcs(f, srcs, n_srcs);
+
+			for (i = 0; i < n_srcs; i++) {
+				srcs[i].location = get_optional_string(ctx);
+				srcs[i].bits[0] = get_u8(ctx);
+			}
+		}
+	}
+
+	if (ctx->error != CSS_OK) {
+		css__font_face_destroy(f);
+		f = NULL;
+	}
+
+	return f;
+}
+
+/**
+ * Destroy a rule which has not been added to the sheet
+ */
+static void destroy_rule(deserialise_ctx *ctx, css_rule *rule)
+{
+	if (rule->type == CSS_RULE_SELECTOR) {
+		destroy_style(((css_rule_selector *) rule)->style);
+		((css_rule_selector *) rule)->style = NULL;
+	} else if (rule->type == CSS_RULE_PAGE) {
+		destroy_style(((css_rule_page *) rule)->style);
+		((css_rule_page *) rule)->style = NULL;
+	}
+
+	css__stylesheet_rule_destroy(ctx->sheet, rule);
+}
+
+/**
+ * Append a rule to the list of rules read
+ *
+ * \return true on success, false on memory exhaustion
+ */
+static bool add_rule(deserialise_ctx *ctx, css_rule *rule, uint32_t parent)
+{
+	if (ctx->n_rules == ctx->alloc_rules) {
+		uint32_t alloc = ctx->alloc_rules == 0 ? 64 :
+				ctx->alloc_rules * 2;
+		deserialise_rule *rules;
+
+		rules = realloc(ctx->rules, alloc * sizeof(deserialise_rule));
+		if (rules == NULL) {
+			destroy_rule(ctx, rule);
+			fail(ctx, CSS_NOMEM);
+			return false;
+		}
+
+		ctx->rules = rules;
+		ctx->alloc_rules = alloc;
+	}
+
+	ctx->rules[ctx->n_rules].rule = rule;
+	ctx->rules[ctx->n_rules].parent = parent;
+	ctx->n_rules++;
+
+	return true;
+}
+
+/**
+ * Read a rule, and any rules it contains
+ *
+ * \param ctx     Deserialisation context
+ * \param parent  Index of containing rule, or STRING_NONE
+ * \param depth   Nesting depth of rule
+ */
+static void get_rule(deserialise_ctx *ctx, uint32_t parent, int depth)
+{
+	css_rule *rule;
+	uint8_t type;
+
+	type = get_u8(ctx);
+	if (type > CSS_RULE_PAGE || depth > MAX_DEPTH)
+		fail(ctx, CSS_INVALID);
+	if (ctx->error != CSS_OK)
+		return;
+
+	if (css__stylesheet_rule_create(ctx->sheet, type, &rule) != CSS_OK) {
+		fail(ctx, CSS_NOMEM);
+		return;
+	}
+
+	/* Rules are only put in the list once complete enough to destroy */
+	switch (type) {
+	case CSS_RULE_UNKNOWN:
+		break;
+	case CSS_RULE_SELECTOR:
+	{
+		css_rule_selector *s = (css_rule_selector *) rule;
+		uint32_t count;
+
+		/* A chain is at least its length, specificity and count.
+		 * Rules whose selectors were all invalid have none. */
+		count = get_count(ctx, 3 * sizeof(uint32_t));
+		if (count > UINT16_MAX)
+			fail(ctx, CSS_INVALID);
+
+		if (ctx->error == CSS_OK && count > 0) {
+			s->selectors = malloc(count * sizeof(css_selector *));
+			if (s->selectors == NULL)
+				fail(ctx, CSS_NOMEM);
+		}
+
+		while (ctx->error == CSS_OK && rule->items < count) {
+			css_selector *sel = get_selector_chain(ctx);
+			if (sel == NULL)
+				break;
+
+			sel->rule = rule;
+			s->selectors[rule->items++] = sel;
+		}
+
+		if (ctx->error == CSS_OK)
+			s->style = get_style(ctx);
+	}
+		break;
+	case CSS_RULE_CHARSET:
+		((css_rule_charset *) rule)->encoding =
+				get_required_string(ctx);
+		if (ctx->error != CSS_OK) {
+			/* Can't destroy a charset rule with no encoding */
+			free(rule);
+			return;
+		}
+		break;
+	case CSS_RULE_IMPORT:
+	{
+		css_rule_import *i = (css_rule_import *) rule;
+
+		i->url = get_required_string(ctx);
+		if (ctx->error != CSS_OK) {
+			free(rule);
+			return;
+		}
+
+		i->media = get_mq_list(ctx);
+	}
+		break;
+	case CSS_RULE_MEDIA:
+		((css_rule_media *) rule)->media = get_mq_list(ctx);
+		break;
+	case CSS_RULE_FONT_FACE:
+		((css_rule_font_face *) rule)->font_face = get_font_face(ctx);
+		break;
+	case CSS_RULE_PAGE:
+	{
+		css_rule_page *p = (css_rule_page *) rule;
+
+		if (get_u8(ctx) != 0) {
+			p->selector = get_selector_chain(ctx);
+			if (p->selector != NULL)
+				p->selector->rule = rule;
+		}
+
+		if (ctx->error == CSS_OK)
+			p->style = get_style(ctx);
+	}
+		break;
+	}
+
+	if (ctx->error != CSS_OK) {
+		destroy_rule(ctx, rule);
+		return;
+	}
+
+	if (add_rule(ctx, rule, parent) == false)
+		return;
+
+	if (type == CSS_RULE_MEDIA) {
+		uint32_t index = ctx->n_rules - 1;
+		/* A rule is at least its type */
+		uint32_t count = get_count(ctx, 1);
+
+		while (ctx->error == CSS_OK && count-- > 0)
+			get_rule(ctx, index, depth + 1);
+	}
+}
+
+/**
+ * Read the string table, interning each string
+ *
+ * \param ctx     Deserialisation context
+ * \param vector  Pointer to location to receive bytecode vector length
+ */
+static void get_strings(deserialise_ctx *ctx, uint32_t *vector)
+{
+	uint32_t count;
+
+	/* A string is at least its length */
+	count = get_count(ctx, sizeof(uint32_t));
+	*vector = get_u32(ctx);
+	if (*vector > count)
+		fail(ctx, CSS_INVALID);
+	if (ctx->error != CSS_OK)
+		return;
+
+	ctx->strings = malloc(max(count, 1) * sizeof(lwc_string *));
+	if (ctx->strings == NULL) {
+		fail(ctx, CSS_NOMEM);
+		return;
+	}
+
+	while (ctx->n_strings < count) {
+		uint32_t len = get_count(ctx, 1);
+		lwc_error lerror;
+
+		if (ctx->error != CSS_OK)
+			return;
+
+		lerror = lwc_intern_string((const char *) ctx->data + ctx->pos,
+				len, &ctx->strings[ctx->n_strings]);
+		if (lerror != lwc_error_ok) {
+			fail(ctx, css_error_from_lwc_error(lerror));
+			return;
+		}
+
+		ctx->pos += len;
+		ctx->n_strings++;
+	}
+}
+
+/**
+ * Load a serialised stylesheet
+ *
+ * \param sheet  The stylesheet to load into
+ * \param data   Data produced by css_stylesheet_serialise()
+ * \param len    Length of data
+ * \return CSS_OK on success,
+ *	   CSS_IMPORTS_PENDING if there are imports pending,
+ *	   CSS_BADPARM on bad parameters,
+ *	   CSS_INVALID if the data is not usable by this sheet,
+ *	   CSS_NOMEM on memory exhaustion
+ *
+ * This takes the place of css_stylesheet_append_data() and
+ * css_stylesheet_data_done(). The sheet must have been created with the
+ * same language level, URL, quirks and inline style parameters as the one
+ * that was serialised, and must not have had any data appended.
+ *
+ * The client is notified of imports as if the sheet had been parsed.
+ *
+ * If CSS_INVALID is returned the sheet is unchanged, so the client may
+ * parse the source instead. After any other error the sheet must be
+ * destroyed.
+ */
+css_error css_stylesheet_deserialise(css_stylesheet *sheet,
+		const uint8_t *data, size_t len)
+{
+	deserialise_ctx ctx;
+	uint32_t header[6];
+	uint8_t flags[5];
+	uint32_t vector, count, url_len, i;
+	lwc_string **string_vector;
+	css_error error;
+
+	if (sheet == NULL || data == NULL)
+		return CSS_BADPARM;
+
+	if (sheet->parser == NULL || sheet->rule_count != 0 ||
+			sheet->string_vector_c != 0)
+		return CSS_INVALID;
+
+	if (len < SERIALISE_HEADER_SIZE)
+		return CSS_INVALID;
+
+	memcpy(header, data, sizeof(header));
+	if (header[0] != SERIALISE_MAGIC ||
+			header[1] != SERIALISE_VERSION ||
+			header[2] != CSS_N_PROPERTIES ||
+			header[3] != sizeof(css_code_t) ||
+			header[5] != len - SERIALISE_HEADER_SIZE ||
+			header[4] != serialise_checksum(
+				data + SERIALISE_HEADER_SIZE, header[5]))
+		return CSS_INVALID;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.sheet = sheet;
+	ctx.data = data + SERIALISE_HEADER_SIZE;
+	ctx.len = header[5];
+
+	/* Check the sheet was compiled in the same way as this one */
+	get_bytes(&ctx, flags, sizeof(flags));
+	url_len = get_count(&ctx, 1);
+	if (ctx.error != CSS_OK || flags[0] != sheet->level ||
+			flags[1] != sheet->quirks_allowed ||
+			flags[2] != sheet->inline_style ||
+			url_len != strlen(sheet->url) ||
+			memcmp(ctx.data + ctx.pos, sheet->url, url_len) != 0)
+		return CSS_INVALID;
+	ctx.pos += url_len;
+
+	/* Build everything detached from the sheet, so that it is left
+	 * untouched if the data turns out to be unusable */
+	get_strings(&ctx, &vector);
+
+	/* A rule is at least its type */
+	count = get_count(&ctx, 1);
+	while (ctx.error == CSS_OK && count-- > 0)
+		get_rule(&ctx, STRING_NONE, 0);
+
+	if (ctx.error == CSS_OK && ctx.pos != ctx.len)
+		fail(&ctx, CSS_INVALID);
+
+	string_vector = NULL;
+	if (ctx.error == CSS_OK && vector > 0) {
+		string_vector = malloc(vector * sizeof(lwc_string *));
+		if (string_vector == NULL)
+			fail(&ctx, CSS_NOMEM);
+	}
+
+	if (ctx.error != CSS_OK) {
+		for (i = ctx.n_rules; i > 0; i--)
+			destroy_rule(&ctx, ctx.rules[i - 1].rule);
+		error = ctx.error;
+		goto cleanup;
+	}
+
+	/* Install the bytecode's strings, which are in the same order */
+	for (i = 0; i < vector; i++)
+		string_vector[i] = lwc_string_ref(ctx.strings[i]);
+	free(sheet->string_vector);
+	sheet->string_vector = string_vector;
+	sheet->string_vector_l = vector;
+	sheet->string_vector_c = vector;
+
+	/* Add the rules, in document order */
+	error = CSS_OK;
+	for (i = 0; i < ctx.n_rules; i++) {
+		css_rule *rule = ctx.rules[i].rule;
+		css_rule *parent = NULL;
+		css_font_face *font_face = NULL;
+
+		if (error != CSS_OK) {
+			destroy_rule(&ctx, rule);
+			continue;
+		}
+
+		if (ctx.rules[i].parent != STRING_NONE)
+			parent = ctx.rules[ctx.rules[i].parent].rule;
+
+		if (rule->type == CSS_RULE_IMPORT && sheet->import != NULL) {
+			error = sheet->import(sheet->import_pw, sheet,
+					((css_rule_import *) rule)->url);
+			if (error != CSS_OK) {
+				destroy_rule(&ctx, rule);
+				continue;
+			}
+		}
+
+		/* The parser adds @font-face rules before their descriptors
+		 * are read, so do likewise to account for the same size */
+		if (rule->type == CSS_RULE_FONT_FACE) {
+			font_face = ((css_rule_font_face *) rule)->font_face;
+			((css_rule_font_face *) rule)->font_face = NULL;
+		}
+
+		error = css__stylesheet_add_rule(sheet, rule, parent);
+
+		if (rule->type == CSS_RULE_FONT_FACE)
+			((css_rule_font_face *) rule)->font_face = font_face;
+
+		if (error != CSS_OK)
+			destroy_rule(&ctx, rule);
+	}
+
+	if (error == CSS_OK) {
+		sheet->quirks_used = flags[3];
+		sheet->uses_revert = flags[4];
+
+		error = css__stylesheet_data_complete(sheet);
+	}
+
+cleanup:
+	for (i = 0; i < ctx.n_strings; i++)
+		lwc_string_unref(ctx.strings[i]);
+	free(ctx.strings);
+	free(ctx.rules);
+
+	return error;
+}
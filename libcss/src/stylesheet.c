@@ -330,7 +330,6 @@ css_error css_stylesheet_append_data(css_stylesheet *sheet,
  */
 css_error css_stylesheet_data_done(css_stylesheet *sheet)
 {
-	const css_rule *r;
 	css_error error;
 
 	if (sheet == NULL)
@@ -343,6 +342,20 @@ css_error css_stylesheet_data_done(css_stylesheet *sheet)
 	if (error != CSS_OK)
 		return error;
 
+	return css__stylesheet_data_complete(sheet);
+}
+
+/**
+ * Finish loading a stylesheet, once all of its rules have been added
+ *
+ * \param sheet	 The stylesheet in question
+ * \return CSS_OK on success,
+ *	   CSS_IMPORTS_PENDING if there are imports pending
+ */
+css_error css__stylesheet_data_complete(css_stylesheet *sheet)
+{
+	const css_rule *r;
+
 	/* Destroy the parser, as it's no longer needed */
 	css__language_destroy(sheet->parser_frontend);
 	css__parser_destroy(sheet->parser);
@@ -323,6 +323,8 @@ css_error css__stylesheet_add_rule(css_stylesheet *sheet, css_rule *rule,
 		css_rule *parent);
 css_error css__stylesheet_remove_rule(css_stylesheet *sheet, css_rule *rule);
 
+css_error css__stylesheet_data_complete(css_stylesheet *sheet);
+
 css_error css__stylesheet_string_get(css_stylesheet *sheet,
 		uint32_t string_number, lwc_string **string);
 
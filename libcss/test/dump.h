@@ -2501,8 +2501,9 @@ void dump_bytecode(css_style *style, char **ptr, uint32_t depth)
                                                                 (int) lwc_string_length(he),
                                                                 lwc_string_data(he));
 
+						snum = *((uint32_t *) bytecode);
 						css__stylesheet_string_get(style->sheet, snum, &he);
-						ADVANCE(sizeof(he));
+						ADVANCE(sizeof(snum));
 						*ptr += sprintf(*ptr, " '%.*s' ",
                                                                 (int) lwc_string_length(he),
                                                                 lwc_string_data(he));
@@ -0,0 +1,215 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <libcss/libcss.h>
+#include "stylesheet.h"
+
+#include "dump.h"
+#include "testutils.h"
+
+/* Number of loads used for timing */
+#define ITERATIONS (20)
+
+static css_error resolve_url(void *pw,
+		const char *base, lwc_string *rel, lwc_string **abs)
+{
+	UNUSED(pw);
+	UNUSED(base);
+
+	/* About as useless as possible */
+	*abs = lwc_string_ref(rel);
+
+	return CSS_OK;
+}
+
+static css_error count_import(void *pw,
+		css_stylesheet *parent, lwc_string *url)
+{
+	UNUSED(parent);
+	UNUSED(url);
+
+	(*((int *) pw))++;
+
+	return CSS_OK;
+}
+
+static void init_params(css_stylesheet_params *params, const char *url,
+		int *imports)
+{
+	params->params_version = CSS_STYLESHEET_PARAMS_VERSION_1;
+	params->level = CSS_LEVEL_21;
+	params->charset = "UTF-8";
+	params->url = url;
+	params->title = NULL;
+	params->allow_quirks = false;
+	params->inline_style = false;
+	params->resolve = resolve_url;
+	params->resolve_pw = NULL;
+	params->import = count_import;
+	params->import_pw = imports;
+	params->color = NULL;
+	params->color_pw = NULL;
+	params->font = NULL;
+	params->font_pw = NULL;
+}
+
+static css_stylesheet *parse(const css_stylesheet_params *params,
+		const uint8_t *data, size_t len)
+{
+	css_stylesheet *sheet;
+	css_error error;
+
+	assert(css_stylesheet_create(params, &sheet) == CSS_OK);
+
+	error = css_stylesheet_append_data(sheet, data, len);
+	assert(error == CSS_OK || error == CSS_NEEDDATA);
+
+	error = css_stylesheet_data_done(sheet);
+	assert(error == CSS_OK || error == CSS_IMPORTS_PENDING);
+
+	return sheet;
+}
+
+static css_stylesheet *load(const css_stylesheet_params *params,
+		const uint8_t *data, size_t len)
+{
+	css_stylesheet *sheet;
+	css_error error;
+
+	assert(css_stylesheet_create(params, &sheet) == CSS_OK);
+
+	error = css_stylesheet_deserialise(sheet, data, len);
+	assert(error == CSS_OK || error == CSS_IMPORTS_PENDING);
+
+	return sheet;
+}
+
+static char *dump(css_stylesheet *sheet, size_t size, size_t *len)
+{
+	char *out = malloc(size);
+	size_t outlen = size;
+
+	assert(out != NULL);
+
+	dump_sheet(sheet, out, &outlen);
+	*len = size - outlen;
+
+	return out;
+}
+
+int main(int argc, char **argv)
+{
+	css_stylesheet_params params;
+	css_stylesheet *sheet, *loaded;
+	FILE *fp;
+	uint8_t *source, *data, *again;
+	size_t len, datalen, againlen;
+	char *out, *loaded_out;
+	size_t outlen, loaded_outlen;
+	int imports = 0, loaded_imports = 0;
+	clock_t start;
+	double parse_time, load_time;
+	int count;
+
+	if (argc != 2) {
+		printf("Usage: %s <filename>\n", argv[0]);
+		return 1;
+	}
+
+	fp = fopen(argv[1], "rb");
+	if (fp == NULL) {
+		printf("Failed opening %s\n", argv[1]);
+		return 1;
+	}
+
+	fseek(fp, 0, SEEK_END);
+	len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	source = malloc(max(len, 1));
+	assert(source != NULL);
+	assert(fread(source, 1, len, fp) == len);
+
+	fclose(fp);
+
+	init_params(&params, argv[1], &imports);
+	sheet = parse(&params, source, len);
+
+	/* An incomplete sheet can't be serialised */
+	assert(css_stylesheet_create(&params, &loaded) == CSS_OK);
+	assert(css_stylesheet_serialise(loaded, &data, &datalen) ==
+			CSS_INVALID);
+	css_stylesheet_destroy(loaded);
+
+	assert(css_stylesheet_serialise(sheet, &data, &datalen) == CSS_OK);
+
+	/* Destroy the parsed sheet first, so that loading must intern its
+	 * strings afresh */
+	out = dump(sheet, max(16384, len * 8), &outlen);
+	css_stylesheet_destroy(sheet);
+
+	params.import_pw = &loaded_imports;
+	loaded = load(&params, data, datalen);
+
+	/* The loaded sheet must be identical to the parsed one */
+	assert(loaded_imports == imports);
+
+	loaded_out = dump(loaded, max(16384, len * 8), &loaded_outlen);
+	assert(outlen == loaded_outlen);
+	assert(memcmp(out, loaded_out, outlen) == 0);
+	free(loaded_out);
+	free(out);
+
+	assert(css_stylesheet_serialise(loaded, &again, &againlen) == CSS_OK);
+	assert(againlen == datalen);
+	assert(memcmp(again, data, datalen) == 0);
+	free(again);
+
+	/* Data can't be loaded into a sheet which has been used */
+	assert(css_stylesheet_deserialise(loaded, data, datalen) ==
+			CSS_INVALID);
+	css_stylesheet_destroy(loaded);
+
+	/* Data for a sheet with different parameters is rejected, leaving
+	 * the sheet able to parse the source instead */
+	params.url = "http://example.com/other.css";
+	assert(css_stylesheet_create(&params, &loaded) == CSS_OK);
+	assert(css_stylesheet_deserialise(loaded, data, datalen) ==
+			CSS_INVALID);
+	assert(css_stylesheet_append_data(loaded, source, len) != CSS_INVALID);
+	css_stylesheet_destroy(loaded);
+	params.url = argv[1];
+
+	/* Damaged data is rejected */
+	assert(css_stylesheet_create(&params, &loaded) == CSS_OK);
+	assert(css_stylesheet_deserialise(loaded, data, datalen - 1) ==
+			CSS_INVALID);
+	data[datalen - 1] ^= 0x55;
+	assert(css_stylesheet_deserialise(loaded, data, datalen) ==
+			CSS_INVALID);
+	data[datalen - 1] ^= 0x55;
+	css_stylesheet_destroy(loaded);
+
+	/* Compare the cost of parsing with that of loading */
+	start = clock();
+	for (count = 0; count < ITERATIONS; count++)
+		css_stylesheet_destroy(parse(&params, source, len));
+	parse_time = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+	start = clock();
+	for (count = 0; count < ITERATIONS; count++)
+		css_stylesheet_destroy(load(&params, data, datalen));
+	load_time = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+	printf("%zu bytes, %zu serialised: parse %.2fms, load %.2fms\n",
+			len, datalen, parse_time * 1000 / ITERATIONS,
+			load_time * 1000 / ITERATIONS);
+
+	free(data);
+	free(source);
+
+	printf("PASS\n");
+
+	return 0;
+}
@@ -592,6 +592,11 @@ dom_exception _dom_attr_set_value(struct dom_attr *attr,
 	/* Now the attribute node is specified */
 	attr->specified = true;
 
+	/* The owning element's ID may have changed */
+	if (a->parent != NULL && a->parent->type == DOM_ELEMENT_NODE)
+		_dom_document_id_update(a->owner,
+				(struct dom_element *) a->parent);
+
 	return DOM_NO_ERR;
 }
 
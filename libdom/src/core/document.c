@@ -31,6 +31,9 @@
 #include "utils/namespace.h"
 #include "utils/utils.h"
 
+/** Initial number of chains in the ID index */
+#define DOM_DOCUMENT_ID_CHAINS 61
+
 /**
  * Item in list of active nodelists
  */
@@ -63,6 +66,8 @@ static const struct dom_node_protect_vtable document_protect_vtable = {
 static dom_exception dom_document_dup_node(dom_document *doc, 
 		dom_node *node, bool deep, dom_node **result, 
 		dom_node_operation opt);
+static bool _dom_document_node_precedes(dom_node_internal *a,
+		dom_node_internal *b);
 
 
 /*----------------------------------------------------------------------*/
@@ -143,6 +148,9 @@ dom_exception _dom_document_initialise(dom_document *doc,
 
 	list_init(&doc->pending_nodes);
 
+	doc->id_map = NULL;
+	doc->id_map_incomplete = false;
+
 	err = dom_string_create_interned((const uint8_t *) "id",
 					 SLEN("id"), &doc->id_name);
 	if (err != DOM_NO_ERR) {
@@ -294,6 +302,9 @@ dom_exception _dom_document_initialise(dom_document *doc,
 /* Finalise the document */
 bool _dom_document_finalise(dom_document *doc)
 {
+	/* Empty the ID index before the tree it refers to is deleted */
+	_dom_document_id_remove_subtree(doc, &doc->base);
+
 	/* Finalise base class, delete the tree in force */
 	_dom_node_finalise(&doc->base);
 
@@ -319,6 +330,9 @@ bool _dom_document_finalise(dom_document *doc)
 	if (doc->id_name != NULL)
 		dom_string_unref(doc->id_name);
 
+	_dom_hash_destroy(doc->id_map);
+	doc->id_map = NULL;
+
 	dom_string_unref(doc->uri);
 	dom_string_unref(doc->class_string);
 	dom_string_unref(doc->script_string);
@@ -843,26 +857,46 @@ dom_exception _dom_document_get_elements_by_tag_name_ns(
  * The returned node will have its reference count increased. It is
  * the responsibility of the caller to unref the node once it has
  * finished with it.
+ *
+ * Elements in the document tree are indexed by ID, so no search of the
+ * tree is needed unless the index is incomplete.
  */
 dom_exception _dom_document_get_element_by_id(dom_document *doc,
 		dom_string *id, dom_element **result)
 {
+	struct dom_element *ele, *first;
 	dom_node_internal *root;
 	dom_exception err;
 
 	*result = NULL;
 
-	err = dom_document_get_document_element(doc, (void *) &root);
-	if (err != DOM_NO_ERR)
+	if (doc->id_map_incomplete) {
+		err = dom_document_get_document_element(doc, (void *) &root);
+		if (err != DOM_NO_ERR)
+			return err;
+
+		err = _dom_find_element_by_id(root, id, result);
+		dom_node_unref(root);
+
+		if (*result != NULL)
+			dom_node_ref(*result);
+
 		return err;
+	}
 
-	err = _dom_find_element_by_id(root, id, result);
-	dom_node_unref(root);
+	first = _dom_hash_get(doc->id_map, id);
+	if (first == NULL)
+		return DOM_NO_ERR;
 
-	if (*result != NULL)
-		dom_node_ref(*result);
+	/* Where the ID is not unique, the first in tree order wins */
+	for (ele = first->id_next; ele != NULL; ele = ele->id_next) {
+		if (_dom_document_node_precedes(&ele->base, &first->base))
+			first = ele;
+	}
 
-	return err;
+	*result = (dom_element *) dom_node_ref(first);
+
+	return DOM_NO_ERR;
 }
 
 /**
@@ -1534,6 +1568,325 @@ void _dom_document_set_id_name(dom_document *doc, dom_string *name)
 	if (doc->id_name != NULL)
 		dom_string_unref(doc->id_name);
 	doc->id_name = dom_string_ref(name);
+
+	/* The IDs of elements already in the tree may have changed */
+	if (doc->base.first_child != NULL) {
+		_dom_document_id_remove_subtree(doc, &doc->base);
+		_dom_document_id_add_subtree(doc, &doc->base);
+	}
+}
+
+/**
+ * Test whether a node is in the document tree
+ *
+ * \param doc   The document
+ * \param node  The node to test
+ * \return true if ::node is ::doc or a descendant of it, false otherwise
+ */
+bool _dom_document_contains(dom_document *doc, dom_node_internal *node)
+{
+	for (; node != NULL; node = node->parent) {
+		if (node == &doc->base)
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Find the next node of a subtree in tree order
+ *
+ * \param node  The current node
+ * \param root  The root of the subtree
+ * \return The next node, or NULL if ::node is the last in the subtree
+ */
+static dom_node_internal *_dom_document_next_in_subtree(
+		dom_node_internal *node, dom_node_internal *root)
+{
+	if (node->first_child != NULL)
+		return node->first_child;
+
+	while (node != root) {
+		if (node->next != NULL)
+			return node->next;
+
+		node = node->parent;
+	}
+
+	return NULL;
+}
+
+/**
+ * Test whether one node comes before another in tree order
+ *
+ * \param a  The first node
+ * \param b  The second node, in the same tree as ::a
+ * \return true if ::a precedes ::b, false otherwise
+ */
+static bool _dom_document_node_precedes(dom_node_internal *a,
+		dom_node_internal *b)
+{
+	dom_node_internal *n;
+	unsigned int adepth = 0, bdepth = 0;
+
+	for (n = a; n->parent != NULL; n = n->parent)
+		adepth++;
+	for (n = b; n->parent != NULL; n = n->parent)
+		bdepth++;
+
+	/* Bring both to the same depth; an ancestor precedes its
+	 * descendants */
+	for (; adepth > bdepth; adepth--)
+		a = a->parent;
+	if (a == b)
+		return false;
+
+	for (; bdepth > adepth; bdepth--)
+		b = b->parent;
+	if (a == b)
+		return true;
+
+	/* Find the ancestors which are siblings */
+	while (a->parent != b->parent) {
+		a = a->parent;
+		b = b->parent;
+	}
+
+	for (n = a->next; n != NULL; n = n->next) {
+		if (n == b)
+			return true;
+	}
+
+	return false;
+}
+
+/* ID index hash table callbacks. Keys are owned by the element at the
+ * head of each entry's list, so are neither copied nor destroyed. */
+static uint32_t _dom_document_id_hash(void *key, void *pw)
+{
+	UNUSED(pw);
+
+	return dom_string_hash(key);
+}
+
+static void *_dom_document_id_clone(void *key, void *pw)
+{
+	UNUSED(pw);
+
+	return key;
+}
+
+static void _dom_document_id_destroy(void *key, void *pw)
+{
+	UNUSED(key);
+	UNUSED(pw);
+}
+
+static bool _dom_document_id_isequal(void *key1, void *key2, void *pw)
+{
+	UNUSED(pw);
+
+	return dom_string_isequal(key1, key2);
+}
+
+static const dom_hash_vtable id_map_vtable = {
+	_dom_document_id_hash,
+	_dom_document_id_clone,
+	_dom_document_id_destroy,
+	_dom_document_id_clone,
+	_dom_document_id_destroy,
+	_dom_document_id_isequal
+};
+
+/**
+ * Add an element to the ID index
+ *
+ * \param doc  The document
+ * \param ele  The element, which must not already be indexed
+ * \param id   The element's ID
+ *
+ * On memory exhaustion the index is marked incomplete.
+ */
+static void _dom_document_id_add(dom_document *doc,
+		struct dom_element *ele, dom_string *id)
+{
+	struct dom_element *head;
+
+	assert(ele->indexed_id == NULL);
+
+	if (doc->id_map == NULL) {
+		doc->id_map = _dom_hash_create(DOM_DOCUMENT_ID_CHAINS,
+				&id_map_vtable, doc);
+		if (doc->id_map == NULL) {
+			doc->id_map_incomplete = true;
+			return;
+		}
+	}
+
+	ele->indexed_id = dom_string_ref(id);
+
+	head = _dom_hash_get(doc->id_map, id);
+	if (head != NULL) {
+		/* Duplicate ID: link in after the head */
+		ele->id_next = head->id_next;
+		head->id_next = ele;
+		return;
+	}
+
+	ele->id_next = NULL;
+	if (_dom_hash_add(doc->id_map, ele->indexed_id, ele, false) == false) {
+		dom_string_unref(ele->indexed_id);
+		ele->indexed_id = NULL;
+		doc->id_map_incomplete = true;
+	}
+}
+
+/**
+ * Remove an element from the ID index
+ *
+ * \param doc  The document
+ * \param ele  The element to remove, which need not be indexed
+ */
+void _dom_document_id_remove(dom_document *doc, struct dom_element *ele)
+{
+	struct dom_element *head, *prev;
+	dom_string *id;
+
+	if (ele->indexed_id == NULL)
+		return;
+
+	head = _dom_hash_get(doc->id_map, ele->indexed_id);
+	if (head == ele) {
+		struct dom_element *next = ele->id_next;
+
+		if (next == NULL) {
+			_dom_hash_del(doc->id_map, ele->indexed_id);
+		} else {
+			/* The next element becomes the head. The strings
+			 * are equal, so swap them over to hand ownership of
+			 * the table's key to the new head. */
+			id = next->indexed_id;
+			next->indexed_id = ele->indexed_id;
+			ele->indexed_id = id;
+
+			_dom_hash_add(doc->id_map, next->indexed_id, next,
+					true);
+		}
+	} else if (head != NULL) {
+		for (prev = head; prev->id_next != NULL;
+				prev = prev->id_next) {
+			if (prev->id_next == ele) {
+				prev->id_next = ele->id_next;
+				break;
+			}
+		}
+	}
+
+	dom_string_unref(ele->indexed_id);
+	ele->indexed_id = NULL;
+	ele->id_next = NULL;
+}
+
+/**
+ * Index an element which is in the document tree under its current ID
+ *
+ * \param doc  The document
+ * \param ele  The element to index
+ *
+ * If the element cannot be indexed the index is marked incomplete.
+ */
+static void _dom_document_id_set(dom_document *doc, struct dom_element *ele)
+{
+	dom_exception err;
+	dom_string *id;
+
+	err = _dom_element_get_id(ele, &id);
+	if (err != DOM_NO_ERR) {
+		_dom_document_id_remove(doc, ele);
+		doc->id_map_incomplete = true;
+		return;
+	}
+
+	if (id != NULL && ele->indexed_id != NULL &&
+			dom_string_isequal(id, ele->indexed_id)) {
+		/* Unchanged */
+		dom_string_unref(id);
+		return;
+	}
+
+	_dom_document_id_remove(doc, ele);
+
+	if (id != NULL) {
+		_dom_document_id_add(doc, ele, id);
+		dom_string_unref(id);
+	}
+}
+
+/**
+ * Index the elements in a subtree of the document tree by ID
+ *
+ * \param doc   The document
+ * \param root  Root of the subtree, which must be in the document tree
+ *
+ * On failure the index is marked incomplete, so lookups fall back to
+ * searching the tree.
+ */
+void _dom_document_id_add_subtree(dom_document *doc,
+		dom_node_internal *root)
+{
+	dom_node_internal *node;
+
+	for (node = root; node != NULL;
+			node = _dom_document_next_in_subtree(node, root)) {
+		if (doc->id_map_incomplete)
+			return;
+
+		if (node->type == DOM_ELEMENT_NODE)
+			_dom_document_id_set(doc, (struct dom_element *) node);
+	}
+}
+
+/**
+ * Remove the elements in a subtree from the ID index
+ *
+ * \param doc   The document
+ * \param root  Root of the subtree
+ */
+void _dom_document_id_remove_subtree(dom_document *doc,
+		dom_node_internal *root)
+{
+	dom_node_internal *node;
+
+	if (doc->id_map == NULL)
+		return;
+
+	for (node = root; node != NULL;
+			node = _dom_document_next_in_subtree(node, root)) {
+		if (node->type == DOM_ELEMENT_NODE)
+			_dom_document_id_remove(doc,
+					(struct dom_element *) node);
+	}
+}
+
+/**
+ * Bring an element's entry in the ID index up to date
+ *
+ * \param doc  The document
+ * \param ele  The element whose ID or position may have changed
+ *
+ * Only elements in the document tree are indexed. This is called once
+ * a mutation has been applied, so rather than failing it marks the
+ * index incomplete if the element cannot be indexed, and lookups then
+ * fall back to searching the tree.
+ */
+void _dom_document_id_update(dom_document *doc, struct dom_element *ele)
+{
+	if (_dom_document_contains(doc, &ele->base) == false) {
+		_dom_document_id_remove(doc, ele);
+		return;
+	}
+
+	_dom_document_id_set(doc, ele);
 }
 
 /*-----------------------------------------------------------------------*/
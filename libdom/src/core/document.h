@@ -52,6 +52,10 @@ struct dom_document {
 
 	dom_string *id_name;		/**< The ID attribute's name */
 
+	dom_hash_table *id_map;		/**< Elements in the tree by ID */
+	bool id_map_incomplete;		/**< Whether indexing an element
+					 * has failed */
+
 	dom_string *class_string;	/**< The string "class". */
 
 	dom_string *script_string;	/**< The string "script". */
@@ -275,6 +279,20 @@ dom_exception _dom_find_element_by_id(dom_node_internal *root,
 /* Set the ID attribute name of this document */
 void _dom_document_set_id_name(dom_document *doc, dom_string *name);
 
+/* Whether a node is in the document tree */
+bool _dom_document_contains(dom_document *doc, dom_node_internal *node);
+
+/* Index the elements in a subtree of the document tree by ID */
+void _dom_document_id_add_subtree(dom_document *doc,
+		dom_node_internal *root);
+/* Remove the elements in a subtree from the ID index */
+void _dom_document_id_remove_subtree(dom_document *doc,
+		dom_node_internal *root);
+/* Bring an element's entry in the ID index up to date */
+void _dom_document_id_update(dom_document *doc, struct dom_element *ele);
+/* Remove an element from the ID index */
+void _dom_document_id_remove(dom_document *doc, struct dom_element *ele);
+
 #define _dom_document_get_id_name(d) (d->id_name)
 
 #endif
@@ -601,6 +601,8 @@ dom_exception _dom_element_initialise(struct dom_document *doc,
 	/* Perform our type-specific initialisation */
 	el->id_ns = NULL;
 	el->id_name = NULL;
+	el->indexed_id = NULL;
+	el->id_next = NULL;
 	el->schema_type_info = NULL;
 
 	el->n_classes = 0;
@@ -629,6 +631,9 @@ void _dom_element_finalise(struct dom_element *ele)
 	/* Destroy the pre-separated class names */
 	_dom_element_destroy_classes(ele);
 
+	/* Remove from the document's ID index */
+	_dom_document_id_remove(ele->base.owner, ele);
+
 	/* Finalise base class */
 	_dom_node_finalise(&ele->base);
 }
@@ -1090,7 +1095,15 @@ dom_exception _dom_element_get_schema_type_info(struct dom_element *element,
 dom_exception _dom_element_set_id_attribute(struct dom_element *element,
 		dom_string *name, bool is_id)
 {
-	return _dom_element_set_id_attr(element, NULL, name, is_id);
+	dom_exception err;
+
+	err = _dom_element_set_id_attr(element, NULL, name, is_id);
+	if (err != DOM_NO_ERR)
+		return err;
+
+	_dom_document_id_update(element->base.owner, element);
+
+	return DOM_NO_ERR;
 }
 
 /**
@@ -1115,7 +1128,12 @@ dom_exception _dom_element_set_id_attribute_ns(struct dom_element *element,
 	
 	element->id_ns = dom_string_ref(namespace);
 
-	return err;
+	if (err != DOM_NO_ERR)
+		return err;
+
+	_dom_document_id_update(element->base.owner, element);
+
+	return DOM_NO_ERR;
 }
 
 /**
@@ -1149,6 +1167,8 @@ dom_exception _dom_element_set_id_attribute_node(struct dom_element *element,
 	
 	element->id_ns = namespace;
 
+	_dom_document_id_update(element->base.owner, element);
+
 	return DOM_NO_ERR;
 
 }
@@ -1582,6 +1602,8 @@ dom_exception _dom_element_copy_internal(dom_element *old, dom_element *new)
 
 	new->id_ns = NULL;
 	new->id_name = NULL;
+	new->indexed_id = NULL;
+	new->id_next = NULL;
 
 	/* TODO: deal with dom_type_info, it get no definition ! */
 
@@ -1752,6 +1774,9 @@ dom_exception _dom_element_set_attr(struct dom_element *element,
 			return err;
 	}
 
+	/* The element's ID may have changed */
+	_dom_document_id_update(e->owner, element);
+
 	return DOM_NO_ERR;
 }
 
@@ -1827,6 +1852,9 @@ dom_exception _dom_element_remove_attr(struct dom_element *element,
 				(dom_event_target *) e, &success);
 		if (err != DOM_NO_ERR)
 			return err;
+
+		/* The element's ID may have been removed */
+		_dom_document_id_update(doc, element);
 	}
 
 	/** \todo defaulted attribute handling */
@@ -2024,6 +2052,9 @@ dom_exception _dom_element_set_attr_node(struct dom_element *element,
 	else
 		_dom_element_attr_list_insert(element->attributes, match);
 
+	/* The element's ID may have changed */
+	_dom_document_id_update(doc, element);
+
 	return DOM_NO_ERR;
 }
 
@@ -2130,6 +2161,9 @@ dom_exception _dom_element_remove_attr_node(struct dom_element *element,
 	if (err != DOM_NO_ERR)
 		return err;
 
+	/* The element's ID may have been removed */
+	_dom_document_id_update(doc, element);
+
 	return DOM_NO_ERR;
 }
 
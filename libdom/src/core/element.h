@@ -35,6 +35,11 @@ struct dom_element {
 
 	dom_string *id_name; 	/**< The id attribute's name */
 
+	dom_string *indexed_id;	/**< ID the element is indexed under in
+				 * its document, or NULL if not indexed */
+	struct dom_element *id_next;	/**< Next indexed element with the
+					 * same ID */
+
 	struct dom_type_info *schema_type_info;	/**< Type information */
 
 	lwc_string **classes;
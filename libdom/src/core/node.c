@@ -869,7 +869,8 @@ dom_exception _dom_node_replace_child(dom_node_internal *node,
 		dom_node_internal *new_child, dom_node_internal *old_child,
 		dom_node_internal **result)
 {
-	dom_node_internal *n;
+	dom_node_internal *n, *first, *last;
+	bool in_document;
 
 	/* We don't support replacement of DocumentType or root Elements */
 	if (node->type == DOM_DOCUMENT_NODE && 
@@ -933,9 +934,27 @@ dom_exception _dom_node_replace_child(dom_node_internal *node,
 	 * list */
 	dom_node_remove_pending(new_child);
 
+	/* Elements leaving the document tree are no longer indexed */
+	in_document = _dom_document_contains(node->owner, node);
+	if (in_document)
+		_dom_document_id_remove_subtree(node->owner, old_child);
+
+	if (new_child->type == DOM_DOCUMENT_FRAGMENT_NODE) {
+		first = new_child->first_child;
+		last = new_child->last_child;
+	} else {
+		first = last = new_child;
+	}
+
 	/* Perform the replacement */
 	_dom_node_replace(old_child, new_child);
 
+	/* Index any elements added to the document tree */
+	if (in_document && first != NULL) {
+		for (n = first; n != last->next; n = n->next)
+			_dom_document_id_add_subtree(node->owner, n);
+	}
+
 	/* Sort out the return value */
 	dom_node_ref(old_child);
 	/* The replaced node should be marded pending */
@@ -2086,8 +2105,11 @@ dom_exception _dom_node_attach_range(dom_node_internal *first,
 {
 	dom_exception err;
 	bool success = true;
+	bool in_document;
 	dom_node_internal *n;
 
+	in_document = _dom_document_contains(parent->owner, parent);
+
 	first->previous = previous;
 	last->next = next;
 
@@ -2103,6 +2125,12 @@ dom_exception _dom_node_attach_range(dom_node_internal *first,
 
 	for (n = first; n != last->next; n = n->next) {
 		n->parent = parent;
+
+		/* Index any elements being added to the document tree. On
+		 * failure the index falls back to searching the tree. */
+		if (in_document)
+			_dom_document_id_add_subtree(parent->owner, n);
+
 		/* Dispatch a DOMNodeInserted event */
 		err = dom_node_dispatch_node_change_event(parent->owner, 
 				n, parent, DOM_MUTATION_ADDITION, &success);
@@ -2135,6 +2163,13 @@ dom_exception _dom_node_detach_range(dom_node_internal *first,
 	dom_node_internal *n;
 	dom_exception err = DOM_NO_ERR;
 
+	/* Elements leaving the document tree are no longer indexed */
+	parent = first->parent;
+	if (_dom_document_contains(parent->owner, parent)) {
+		for (n = first; n != last->next; n = n->next)
+			_dom_document_id_remove_subtree(parent->owner, n);
+	}
+
 	if (first->previous != NULL)
 		first->previous->next = last->next;
 	else
@@ -2145,7 +2180,6 @@ dom_exception _dom_node_detach_range(dom_node_internal *first,
 	else
 		last->parent->last_child = first->previous;
 
-	parent = first->parent;
 	for (n = first; n != last->next; n = n->next) {
 		/* Dispatch a DOMNodeRemoval event */
 		err = dom_node_dispatch_node_change_event(n->owner, n,
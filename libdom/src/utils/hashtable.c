@@ -35,6 +35,9 @@ struct dom_hash_table {
 };
 
 
+/* Average chain length above which a table is grown */
+#define DOM_HASH_MAX_LOAD 2
+
 /**
  * Create a new hash table, and return a context for it.  The memory consumption
  * of a hash table is approximately 8 + (nchains * 12) bytes if it is empty.
@@ -140,6 +143,43 @@ void _dom_hash_destroy(dom_hash_table *ht)
 	free(ht);
 }
 
+/**
+ * Grow a hash table, redistributing its entries over more chains
+ *
+ * \param ht  The hash table to grow
+ *
+ * The table is left unchanged if there is insufficient memory.
+ */
+static void _dom_hash_grow(dom_hash_table *ht)
+{
+	unsigned int nchains = ht->nchains * 2 + 1;
+	struct _dom_hash_entry **chain;
+	unsigned int i;
+
+	chain = calloc(nchains, sizeof(struct _dom_hash_entry *));
+	if (chain == NULL)
+		return;
+
+	for (i = 0; i < ht->nchains; i++) {
+		struct _dom_hash_entry *e = ht->chain[i];
+
+		while (e != NULL) {
+			struct _dom_hash_entry *n = e->next;
+			unsigned int c;
+
+			c = ht->vtable->hash(e->key, ht->pw) % nchains;
+			e->next = chain[c];
+			chain[c] = e;
+
+			e = n;
+		}
+	}
+
+	free(ht->chain);
+	ht->chain = chain;
+	ht->nchains = nchains;
+}
+
 /**
  * Adds a key/value pair to a hash table
  *
@@ -148,6 +188,9 @@ void _dom_hash_destroy(dom_hash_table *ht)
  * \param  value  The value to associate the key with.
  * \return true if the add succeeded, false otherwise.  (Failure most likely
  *         indicates insufficent memory to make copies of the key and value.
+ *
+ * The number of chains is increased as entries are added, so that
+ * lookups remain quick however many entries the table holds.
  */
 bool _dom_hash_add(dom_hash_table *ht, void *key, void *value, 
 		bool replace)
@@ -177,6 +220,11 @@ bool _dom_hash_add(dom_hash_table *ht, void *key, void *value,
 		return false;
 	}
 
+	if (ht->nentries >= ht->nchains * DOM_HASH_MAX_LOAD) {
+		_dom_hash_grow(ht);
+		c = h % ht->nchains;
+	}
+
 	e->key = key;
 	e->value = value;
 
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -124,6 +125,9 @@ int main(int argc, char **argv)
 	struct stat info;
 	int fd;
 	uint8_t *file;
+	struct timespec start, end;
+	hubbub_error error;
+	double secs;
 
 	if (argc != 2) {
 		printf("Usage: %s <filename>\n", argv[0]);
@@ -144,8 +148,16 @@ int main(int argc, char **argv)
 	fd = open(argv[1], 0);
 	file = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
 
-	assert(hubbub_parser_parse_chunk(parser, file, info.st_size)
-			== HUBBUB_OK);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	error = hubbub_parser_parse_chunk(parser, file, info.st_size);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	assert(error == HUBBUB_OK);
+
+	secs = (end.tv_sec - start.tv_sec) +
+			(end.tv_nsec - start.tv_nsec) / 1000000000.0;
+	printf("%s: %lld bytes in %.3fs (%.2f MB/s)\n", argv[1],
+			(long long) info.st_size, secs,
+			info.st_size / secs / (1024 * 1024));
 
 	return HUBBUB_OK;
 }
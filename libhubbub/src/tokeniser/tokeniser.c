@@ -11,6 +11,12 @@
 
 #include <stdio.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include <parserutils/charset/utf8.h>
 
 #include "utils/parserutilserror.h"
@@ -674,6 +680,153 @@ hubbub_error hubbub_tokeniser_run(hubbub_tokeniser *tokeniser)
 	} while (0)
 
 
+/** Word with every byte set to 0x01 */
+#define RUN_ONES ((size_t) -1 / 0xFF)
+
+/** Non-zero if any byte in the word x is equal to the byte c */
+#define RUN_HAS_BYTE(x, c) \
+	((((x) ^ (RUN_ONES * (c))) - RUN_ONES) & \
+			~((x) ^ (RUN_ONES * (c))) & (RUN_ONES * 0x80))
+
+/**
+ * Find the length of a run of bytes needing no data state processing
+ *
+ * The run ends at the first '&', '<', CR or NUL, or at the first '-' or
+ * '>' if escapes are significant.  Bytes are examined a vector or a
+ * machine word at a time, finishing with a byte at a time.
+ *
+ * \param data     Data to scan
+ * \param len      Length of data, in bytes
+ * \param escapes  Whether '-' and '>' end the run
+ * \return Number of bytes before the first byte ending the run
+ */
+static size_t hubbub_tokeniser_scan_data(const uint8_t *data, size_t len,
+		bool escapes)
+{
+	size_t pos = 0;
+
+#if defined(__SSE2__)
+	const __m128i amp = _mm_set1_epi8('&');
+	const __m128i lt = _mm_set1_epi8('<');
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i nul = _mm_setzero_si128();
+	const __m128i hyphen = _mm_set1_epi8('-');
+	const __m128i gt = _mm_set1_epi8('>');
+
+	for (; pos + sizeof(__m128i) <= len; pos += sizeof(__m128i)) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (data + pos));
+		__m128i match = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(v, amp),
+						_mm_cmpeq_epi8(v, lt)),
+				_mm_or_si128(_mm_cmpeq_epi8(v, cr),
+						_mm_cmpeq_epi8(v, nul)));
+		int mask;
+
+		if (escapes) {
+			match = _mm_or_si128(match, _mm_or_si128(
+					_mm_cmpeq_epi8(v, hyphen),
+					_mm_cmpeq_epi8(v, gt)));
+		}
+
+		mask = _mm_movemask_epi8(match);
+		if (mask != 0)
+			return pos + __builtin_ctz(mask);
+	}
+#elif defined(__ARM_NEON)
+	for (; pos + 16 <= len; pos += 16) {
+		uint8x16_t v = vld1q_u8(data + pos);
+		uint8x16_t match = vorrq_u8(
+				vorrq_u8(vceqq_u8(v, vdupq_n_u8('&')),
+						vceqq_u8(v, vdupq_n_u8('<'))),
+				vorrq_u8(vceqq_u8(v, vdupq_n_u8('\r')),
+						vceqq_u8(v, vdupq_n_u8(0))));
+		uint64x2_t lanes;
+
+		if (escapes) {
+			match = vorrq_u8(match, vorrq_u8(
+					vceqq_u8(v, vdupq_n_u8('-')),
+					vceqq_u8(v, vdupq_n_u8('>'))));
+		}
+
+		lanes = vreinterpretq_u64_u8(match);
+		if ((vgetq_lane_u64(lanes, 0) | vgetq_lane_u64(lanes, 1)) != 0)
+			break;
+	}
+#else
+	for (; pos + sizeof(size_t) <= len; pos += sizeof(size_t)) {
+		size_t v;
+		size_t match;
+
+		memcpy(&v, data + pos, sizeof(v));
+
+		match = RUN_HAS_BYTE(v, '&') | RUN_HAS_BYTE(v, '<') |
+				RUN_HAS_BYTE(v, '\r') | RUN_HAS_BYTE(v, 0);
+		if (escapes)
+			match |= RUN_HAS_BYTE(v, '-') | RUN_HAS_BYTE(v, '>');
+
+		if (match != 0)
+			break;
+	}
+#endif
+
+	for (; pos < len; pos++) {
+		const uint8_t c = data[pos];
+
+		if (c == '&' || c == '<' || c == '\r' || c == '\0' ||
+				(escapes && (c == '-' || c == '>')))
+			break;
+	}
+
+	return pos;
+}
+
+#undef RUN_HAS_BYTE
+#undef RUN_ONES
+
+/**
+ * Find the run of characters following the pending data which may be
+ * collected without further examination
+ *
+ * \param tokeniser  Tokeniser instance
+ * \return Length of the run, in bytes
+ */
+static size_t hubbub_tokeniser_data_run(hubbub_tokeniser *tokeniser)
+{
+	const parserutils_buffer *utf8 = tokeniser->input->utf8;
+	size_t off = tokeniser->input->cursor + tokeniser->context.pending;
+	const uint8_t *data;
+	size_t avail, run, lead, clen;
+
+	if (off >= utf8->length)
+		return 0;
+
+	data = utf8->data + off;
+	avail = utf8->length - off;
+
+	run = hubbub_tokeniser_scan_data(data, avail,
+			tokeniser->content_model == HUBBUB_CONTENT_MODEL_RCDATA ||
+			tokeniser->content_model == HUBBUB_CONTENT_MODEL_CDATA);
+
+	if (run == avail) {
+		/* Leave any incomplete character at the end of the
+		 * buffer for peek to deal with */
+		lead = run;
+		while (lead > 0 && run - lead < 4 &&
+				(data[lead - 1] & 0xC0) == 0x80)
+			lead--;
+
+		if (lead > 0 && (data[lead - 1] & 0x80) != 0) {
+			lead--;
+			if (parserutils_charset_utf8_char_byte_length(
+					data + lead, &clen) != PARSERUTILS_OK ||
+					lead + clen > run)
+				run = lead;
+		}
+	}
+
+	return run;
+}
+
 /* this should always be called with an empty "chars" buffer */
 hubbub_error hubbub_tokeniser_handle_data(hubbub_tokeniser *tokeniser)
 {
@@ -792,8 +945,12 @@ hubbub_error hubbub_tokeniser_handle_data(hubbub_tokeniser *tokeniser)
 			/* Advance over */
 			parserutils_inputstream_advance(tokeniser->input, 1);
 		} else {
-			/* Just collect into buffer */
+			/* Just collect into buffer, along with the run of
+			 * characters following it which need no special
+			 * handling */
 			tokeniser->context.pending += len;
+			tokeniser->context.pending +=
+					hubbub_tokeniser_data_run(tokeniser);
 		}
 	}
 
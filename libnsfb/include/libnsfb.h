@@ -12,6 +12,7 @@
 #define _LIBNSFB_H 1
 
 #include <stdint.h>
+#include <stddef.h>
 
 typedef struct nsfb_palette_s nsfb_palette_t;
 typedef struct nsfb_cursor_s nsfb_cursor_t;
@@ -32,6 +33,14 @@ typedef struct nsfb_bbox_s {
     int y1;
 } nsfb_bbox_t;
 
+/** Display update statistics */
+typedef struct nsfb_update_stats_s {
+    unsigned int frames; /**< Number of frames sent to the display. */
+    unsigned int rects; /**< Rectangles sent in the last frame. */
+    uint64_t pixels; /**< Pixels sent in the last frame. */
+    uint64_t total_pixels; /**< Pixels sent in all frames. */
+} nsfb_update_stats_t;
+
 /** The type of framebuffer surface. */
 enum nsfb_type_e {
     NSFB_SURFACE_NONE = 0, /**< No surface */
@@ -57,6 +66,7 @@ enum nsfb_format_e {
     NSFB_FMT_I8, /* 8bpp indexed */
     NSFB_FMT_I4, /* 4bpp indexed */
     NSFB_FMT_I1, /* black and white */
+    NSFB_FMT_RGB565A8, /* 16 bpp 565 followed by a plane of 8 bit alpha */
 };
 
 /** Callback for surface enumeration
@@ -128,6 +138,29 @@ int nsfb_claim(nsfb_t *nsfb, nsfb_bbox_t *box);
  */
 int nsfb_update(nsfb_t *nsfb, nsfb_bbox_t *box);
 
+/** Send accumulated updates to the display.
+ *
+ * Surfaces which pace display updates collect the areas passed to
+ * ::nsfb_update and send them to the display at most once a frame
+ * when this is called. It should be called once each time round the
+ * program main loop after redrawing.
+ *
+ * @param nsfb The context to flush.
+ * @return 0 if no updates remain pending, otherwise the number of
+ *         milliseconds until the pending updates can be sent.
+ */
+int nsfb_flush(nsfb_t *nsfb);
+
+/** Obtain display update statistics.
+ *
+ * Only surfaces which accumulate updates for ::nsfb_flush record
+ * statistics, for others they remain zero.
+ *
+ * @param nsfb The context to read.
+ * @param stats The structure to fill with the statistics.
+ */
+int nsfb_get_update_stats(nsfb_t *nsfb, nsfb_update_stats_t *stats);
+
 /** Obtain the geometry of a nsfb context.
  *
  * @param width a variable to store the framebuffer width in or NULL
@@ -158,6 +158,51 @@ bool nsfb_plot_bitmap(nsfb_t *nsfb, const nsfb_bbox_t *loc, const nsfb_colour_t
  */
 bool nsfb_plot_bitmap_tiles(nsfb_t *nsfb, const nsfb_bbox_t *loc, int tiles_x, int tiles_y, const nsfb_colour_t *pixel, int bmp_width, int bmp_height, int bmp_stride, bool alpha);
 
+/** Plot RGB565 bitmap.
+ *
+ * The bitmap pixels are 16 bit RGB565 values. If alpha is not NULL it
+ * is a plane of 8 bit alpha values, one per pixel, with the same
+ * stride as the pixels.
+ */
+bool nsfb_plot_bitmap565(nsfb_t *nsfb, const nsfb_bbox_t *loc, const uint16_t *pixel, const uint8_t *alpha, int bmp_width, int bmp_height, int bmp_stride);
+
+/** Plot tiled RGB565 bitmap.
+ */
+bool nsfb_plot_bitmap565_tiles(nsfb_t *nsfb, const nsfb_bbox_t *loc, int tiles_x, int tiles_y, const uint16_t *pixel, const uint8_t *alpha, int bmp_width, int bmp_height, int bmp_stride);
+
+/** Scaled bitmap cache statistics.
+ */
+typedef struct nsfb_plot_scale_cache_stats_s {
+    unsigned int hits; /**< scaled plots using a cached bitmap */
+    unsigned int misses; /**< scaled plots which created a cached bitmap */
+    unsigned int count; /**< number of cached bitmaps */
+    size_t size; /**< memory used by cached bitmaps */
+    size_t limit; /**< memory limit of the cache */
+} nsfb_plot_scale_cache_stats_t;
+
+/** Set the memory limit of the scaled bitmap cache.
+ *
+ * Bitmaps plotted at a size other than their own are scaled once,
+ * with filtering, and kept for later plots at the same size. The cache
+ * is disabled while the limit is zero, which is the default.
+ *
+ * When the cache is enabled the caller must use
+ * nsfb_plot_scale_cache_invalidate() whenever the pixels of a bitmap it
+ * has plotted are changed or freed. Surfaces are invalidated by the
+ * library when they are freed or their geometry changes.
+ */
+void nsfb_plot_scale_cache_set_limit(size_t limit);
+
+/** Discard any cached scaled copies of a bitmap.
+ *
+ * \param pixel The pixel data the bitmap was plotted from.
+ */
+void nsfb_plot_scale_cache_invalidate(const void *pixel);
+
+/** Get scaled bitmap cache statistics.
+ */
+void nsfb_plot_scale_cache_stats(nsfb_plot_scale_cache_stats_t *stats);
+
 /** Plot an 8 bit glyph.
  */
 bool nsfb_plot_glyph8(nsfb_t *nsfb, nsfb_bbox_t *loc, const uint8_t *pixel, int pitch, nsfb_colour_t c);
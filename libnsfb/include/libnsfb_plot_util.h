@@ -12,6 +12,32 @@
 #define _LIBNSFB_PLOT_UTIL_H 1
 
 
+/* convert a colour to a 16 bit RGB565 pixel value */
+static inline uint16_t
+nsfb_plot_colour_to_rgb565(nsfb_colour_t c)
+{
+    return ((c & 0xF8) << 8) | ((c & 0xFC00) >> 5) | ((c & 0xF80000) >> 19);
+}
+
+/* convert a 16 bit RGB565 pixel value to an opaque colour */
+static inline nsfb_colour_t
+nsfb_plot_rgb565_to_colour(uint16_t pixel)
+{
+    uint32_t r, g, b;
+
+    /* replicate the high bits into the low bits so full intensity
+     * components convert to full intensity.
+     */
+    r = (pixel >> 8) & 0xF8;
+    r |= r >> 5;
+    g = (pixel >> 3) & 0xFC;
+    g |= g >> 6;
+    b = (pixel << 3) & 0xF8;
+    b |= b >> 5;
+
+    return 0xFF000000 | (b << 16) | (g << 8) | r;
+}
+
 /* alpha blend two pixels together */
 static inline nsfb_colour_t 
 nsfb_plot_ablend(nsfb_colour_t pixel, nsfb_colour_t scrpixel)
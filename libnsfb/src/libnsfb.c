@@ -62,6 +62,9 @@ nsfb_free(nsfb_t *nsfb)
     if (nsfb->cursor != NULL)
 	nsfb_cursor_destroy(nsfb->cursor);
 
+    /* the surface memory may be reused for other pixels */
+    nsfb_plot_scale_cache_invalidate(nsfb->ptr);
+
     ret = nsfb->surface_rtns->finalise(nsfb);
 
     free(nsfb->surface_rtns);
@@ -91,6 +94,21 @@ nsfb_update(nsfb_t *nsfb, nsfb_bbox_t *box)
     return nsfb->surface_rtns->update(nsfb, box);
 }
 
+/* exported interface documented in libnsfb.h */
+int
+nsfb_flush(nsfb_t *nsfb)
+{
+    return nsfb->surface_rtns->flush(nsfb);
+}
+
+/* exported interface documented in libnsfb.h */
+int
+nsfb_get_update_stats(nsfb_t *nsfb, nsfb_update_stats_t *stats)
+{
+    *stats = nsfb->stats;
+    return 0;
+}
+
 /* exported interface documented in libnsfb.h */
 int 
 nsfb_set_geometry(nsfb_t *nsfb, int width, int height, enum nsfb_format_e format) 
@@ -104,6 +122,9 @@ nsfb_set_geometry(nsfb_t *nsfb, int width, int height, enum nsfb_format_e format
     if (format == NSFB_FMT_ANY)
 	    format = nsfb->format; 
 
+    /* the surface memory is reallocated and its layout changed */
+    nsfb_plot_scale_cache_invalidate(nsfb->ptr);
+
     return nsfb->surface_rtns->geometry(nsfb, width, height, format);
 }
 
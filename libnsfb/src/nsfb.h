@@ -36,6 +36,7 @@ struct nsfb_s {
     void *surface_priv; /**< surface opaque data. */
 
     nsfb_bbox_t clip; /**< current clipping rectangle for plotters */
+    nsfb_update_stats_t stats; /**< display update statistics */
     struct nsfb_plotter_fns_s *plotter_fns; /**< Plotter methods */
 };
 
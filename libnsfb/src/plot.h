@@ -129,6 +129,14 @@ typedef bool (nsfb_plotfn_bitmap_t)(nsfb_t *nsfb, const nsfb_bbox_t *loc, const
  */
 typedef bool (nsfb_plotfn_bitmap_tiles_t)(nsfb_t *nsfb, const nsfb_bbox_t *loc, int tiles_x, int tiles_y, const nsfb_colour_t *pixel, int bmp_width, int bmp_height, int bmp_stride, bool alpha);
 
+/** Plot RGB565 bitmap with optional alpha plane
+ */
+typedef bool (nsfb_plotfn_bitmap565_t)(nsfb_t *nsfb, const nsfb_bbox_t *loc, const uint16_t *pixel, const uint8_t *alpha, int bmp_width, int bmp_height, int bmp_stride);
+
+/** Plot tiled RGB565 bitmap with optional alpha plane
+ */
+typedef bool (nsfb_plotfn_bitmap565_tiles_t)(nsfb_t *nsfb, const nsfb_bbox_t *loc, int tiles_x, int tiles_y, const uint16_t *pixel, const uint8_t *alpha, int bmp_width, int bmp_height, int bmp_stride);
+
 
 /** Copy an area of screen 
  *
@@ -177,6 +185,8 @@ typedef struct nsfb_plotter_fns_s {
     nsfb_plotfn_arc_t *arc;
     nsfb_plotfn_bitmap_t *bitmap;
     nsfb_plotfn_bitmap_tiles_t *bitmap_tiles;
+    nsfb_plotfn_bitmap565_t *bitmap565;
+    nsfb_plotfn_bitmap565_tiles_t *bitmap565_tiles;
     nsfb_plotfn_point_t *point;
     nsfb_plotfn_copy_t *copy;
     nsfb_plotfn_glyph8_t *glyph8;
@@ -191,4 +201,21 @@ typedef struct nsfb_plotter_fns_s {
 
 bool select_plotters(nsfb_t *nsfb);
 
+/** Get a bitmap scaled to a size from the scaled bitmap cache.
+ *
+ * \return The scaled pixels, with a stride of \a width, or NULL if the
+ *         bitmap cannot be cached and must be scaled while plotting.
+ */
+const nsfb_colour_t *nsfb_scale_cache_bitmap(const nsfb_colour_t *pixel, int bmp_width, int bmp_height, int bmp_stride, bool alpha, int width, int height);
+
+/** Get a RGB565 bitmap scaled to a size from the scaled bitmap cache.
+ *
+ * The scaled alpha plane is returned in \a scaled_alpha, it is NULL
+ * when \a alpha is.
+ *
+ * \return The scaled pixels, with a stride of \a width, or NULL if the
+ *         bitmap cannot be cached and must be scaled while plotting.
+ */
+const uint16_t *nsfb_scale_cache_bitmap565(const uint16_t *pixel, const uint8_t *alpha, int bmp_width, int bmp_height, int bmp_stride, int width, int height, const uint8_t **scaled_alpha);
+
 #endif
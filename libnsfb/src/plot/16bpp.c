@@ -9,6 +9,7 @@
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "libnsfb.h"
 #include "libnsfb_plot.h"
@@ -40,6 +41,9 @@ static inline uint16_t colour_to_pixel(UNUSED nsfb_t *nsfb, nsfb_colour_t c)
 #define PLOT_TYPE uint16_t
 #define PLOT_LINELEN(ll) ((ll) >> 1)
 
+/* screen pixels are in the same format as RGB565 bitmaps */
+#define PLOT_RGB565_NATIVE 1
+
 #include "common.c"
 
 
@@ -114,6 +118,8 @@ const nsfb_plotter_fns_t _nsfb_16bpp_plotters = {
         .point = point,
         .bitmap = bitmap,
         .bitmap_tiles = bitmap_tiles,
+        .bitmap565 = bitmap565,
+        .bitmap565_tiles = bitmap565_tiles,
         .glyph8 = glyph8,
         .glyph1 = glyph1,
         .readrect = readrect,
@@ -95,6 +95,8 @@ const nsfb_plotter_fns_t _nsfb_32bpp_xbgr8888_plotters = {
         .point = point,
         .bitmap = bitmap,
         .bitmap_tiles = bitmap_tiles,
+        .bitmap565 = bitmap565,
+        .bitmap565_tiles = bitmap565_tiles,
         .glyph8 = glyph8,
         .glyph1 = glyph1,
         .readrect = readrect,
@@ -73,6 +73,8 @@ const nsfb_plotter_fns_t _nsfb_8bpp_plotters = {
         .point = point,
         .bitmap = bitmap,
         .bitmap_tiles = bitmap_tiles,
+        .bitmap565 = bitmap565,
+        .bitmap565_tiles = bitmap565_tiles,
         .glyph8 = glyph8,
         .glyph1 = glyph1,
         .readrect = readrect,
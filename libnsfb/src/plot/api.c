@@ -1,6 +1,7 @@
 /* public plotter interface */
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "libnsfb.h"
 #include "libnsfb_plot.h"
@@ -143,6 +144,15 @@ nsfb_plot_copy(nsfb_t *srcfb,
 	return dstfb->plotter_fns->copy(srcfb, srcbox, dstbox);
     }
 
+    if (srcfb->format == NSFB_FMT_RGB565) {
+	return dstfb->plotter_fns->bitmap565(dstfb, dstbox, (const uint16_t *)(void *)srcfb->ptr, NULL, srcfb->width, srcfb->height, srcfb->linelen >> 1);
+    }
+
+    /* the alpha plane follows the RGB565 pixels */
+    if (srcfb->format == NSFB_FMT_RGB565A8) {
+	return dstfb->plotter_fns->bitmap565(dstfb, dstbox, (const uint16_t *)(void *)srcfb->ptr, srcfb->ptr + (srcfb->linelen * srcfb->height), srcfb->width, srcfb->height, srcfb->linelen >> 1);
+    }
+
     if (srcfb->format == NSFB_FMT_ABGR8888) {
 	trans = true;
     }
@@ -173,6 +183,16 @@ bool nsfb_plot_bitmap_tiles(nsfb_t *nsfb, const nsfb_bbox_t *loc, int tiles_x, i
     return nsfb->plotter_fns->bitmap_tiles(nsfb, loc, tiles_x, tiles_y, pixel, bmp_width, bmp_height, bmp_stride, alpha);
 }
 
+bool nsfb_plot_bitmap565(nsfb_t *nsfb, const nsfb_bbox_t *loc, const uint16_t *pixel, const uint8_t *alpha, int bmp_width, int bmp_height, int bmp_stride)
+{
+    return nsfb->plotter_fns->bitmap565(nsfb, loc, pixel, alpha, bmp_width, bmp_height, bmp_stride);
+}
+
+bool nsfb_plot_bitmap565_tiles(nsfb_t *nsfb, const nsfb_bbox_t *loc, int tiles_x, int tiles_y, const uint16_t *pixel, const uint8_t *alpha, int bmp_width, int bmp_height, int bmp_stride)
+{
+    return nsfb->plotter_fns->bitmap565_tiles(nsfb, loc, tiles_x, tiles_y, pixel, alpha, bmp_width, bmp_height, bmp_stride);
+}
+
 /** Plot an 8 bit glyph.
  */
 bool nsfb_plot_glyph8(nsfb_t *nsfb, nsfb_bbox_t *loc, const uint8_t *pixel, int pitch, nsfb_colour_t c)
@@ -230,10 +230,15 @@ glyph8(nsfb_t *nsfb,
         return true;
 }
 
+static bool bitmap(nsfb_t *nsfb, const nsfb_bbox_t *loc,
+		const nsfb_colour_t *pixel, int bmp_width, int bmp_height,
+		int bmp_stride, bool alpha);
+
 static bool bitmap_scaled(nsfb_t *nsfb, const nsfb_bbox_t *loc,
 		const nsfb_colour_t *pixel, int bmp_width, int bmp_height,
 		int bmp_stride, bool alpha)
 {
+	const nsfb_colour_t *scaled; /* cached scaled bitmap */
 	PLOT_TYPE *pvideo;
 	PLOT_TYPE *pvideo_limit;
 	nsfb_colour_t abpixel; /* alphablended pixel */
@@ -260,6 +265,12 @@ static bool bitmap_scaled(nsfb_t *nsfb, const nsfb_bbox_t *loc,
 	if (!nsfb_plot_clip_ctx(nsfb, &clipped))
 		return true;
 
+	/* Plot a cached copy of the bitmap at this size if possible */
+	scaled = nsfb_scale_cache_bitmap(pixel, bmp_width, bmp_height,
+			bmp_stride, alpha, width, height);
+	if (scaled != NULL)
+		return bitmap(nsfb, loc, scaled, width, height, width, alpha);
+
 	/* get height of rendering region, after clipping */
 	if (height > (clipped.y1 - clipped.y0))
 		rheight = (clipped.y1 - clipped.y0);
@@ -689,6 +700,21 @@ bitmap_tiles(nsfb_t *nsfb,
 	if (!nsfb_plot_clip_ctx(nsfb, &render_area))
 		return true;
 
+	/* Tile a cached copy of the bitmap at this size if possible. Not
+	 * done for paletted screens which dither each scaled tile. */
+	if (scaled && nsfb->palette == NULL) {
+		const nsfb_colour_t *cached;
+
+		cached = nsfb_scale_cache_bitmap(pixel, bmp_width, bmp_height,
+				bmp_stride, alpha, width, height);
+		if (cached != NULL) {
+			pixel = cached;
+			bmp_width = bmp_stride = width;
+			bmp_height = height;
+			scaled = false;
+		}
+	}
+
 	/* Enable error diffusion for paletted screens, if not already on,
 	 * if not scaled or if not repeating in x direction */
 	if ((!scaled || tiles_x == 1) && nsfb->palette != NULL &&
@@ -761,6 +787,218 @@ bitmap_tiles(nsfb_t *nsfb,
 	return ok;
 }
 
+/* plot a RGB565 bitmap, scaling it to the location if necessary */
+static bool
+bitmap565(nsfb_t *nsfb,
+	  const nsfb_bbox_t *loc,
+	  const uint16_t *pixel,
+	  const uint8_t *alpha,
+	  int bmp_width,
+	  int bmp_height,
+	  int bmp_stride)
+{
+	PLOT_TYPE *pvideo;
+	const uint16_t *prow; /* current source pixel row */
+	const uint8_t *arow; /* current source alpha row */
+	nsfb_colour_t abpixel; /* alphablended pixel */
+	uint32_t opacity;
+	int xloop, yloop;
+	int xoff, yoff, xoffs; /* x and y offsets into image */
+	int x = loc->x0;
+	int y = loc->y0;
+	int width = loc->x1 - loc->x0; /* size to scale to */
+	int height = loc->y1 - loc->y0; /* size to scale to */
+	int rheight, rwidth; /* post-clipping render area dimensions */
+	int dx, dy; /* scale factor (integer part) */
+	int dxr, dyr; /* scale factor (remainder) */
+	int rx, ry, rxs; /* remainder trackers */
+	nsfb_bbox_t clipped; /* clipped display */
+	bool set_dither = false; /* true iff we enabled dithering here */
+
+	if (width == 0 || height == 0)
+		return true;
+
+	/* The part of the image actually displayed is cropped to the
+	 * current context. */
+	clipped.x0 = x;
+	clipped.y0 = y;
+	clipped.x1 = x + width;
+	clipped.y1 = y + height;
+
+	if (!nsfb_plot_clip_ctx(nsfb, &clipped))
+		return true;
+
+	/* Plot a cached copy of the bitmap at this size if possible */
+	if (width != bmp_width || height != bmp_height) {
+		const uint16_t *cached;
+		const uint8_t *cached_alpha;
+
+		cached = nsfb_scale_cache_bitmap565(pixel, alpha,
+				bmp_width, bmp_height, bmp_stride,
+				width, height, &cached_alpha);
+		if (cached != NULL) {
+			pixel = cached;
+			alpha = cached_alpha;
+			bmp_width = bmp_stride = width;
+			bmp_height = height;
+		}
+	}
+
+	rwidth = clipped.x1 - clipped.x0;
+	rheight = clipped.y1 - clipped.y0;
+
+	/* Enable error diffusion for paletted screens, if not already on */
+	if (nsfb->palette != NULL &&
+			nsfb_palette_dithering_on(nsfb->palette) == false) {
+		nsfb_palette_dither_init(nsfb->palette, rwidth);
+		set_dither = true;
+	}
+
+	/* get veritcal (y) and horizontal (x) scale factors; both integer
+	 * part and remainder. Unscaled plots step one pixel at a time. */
+	dx = bmp_width / width;
+	dy = bmp_height / height;
+	dxr = bmp_width % width;
+	dyr = bmp_height % height;
+
+	/* get start offsets to part of image being plotted, after clipping
+	 * and set remainder trackers to correct starting value */
+	xoffs = ((clipped.x0 - x) * bmp_width) / width;
+	rxs = ((clipped.x0 - x) * bmp_width) % width;
+	yoff = ((clipped.y0 - y) * bmp_height) / height;
+	ry = ((clipped.y0 - y) * bmp_height) % height;
+
+	pvideo = get_xy_loc(nsfb, clipped.x0, clipped.y0);
+
+	for (yloop = 0; yloop < rheight; yloop++) {
+		prow = pixel + (yoff * bmp_stride);
+		arow = (alpha != NULL) ? alpha + (yoff * bmp_stride) : NULL;
+
+#ifdef PLOT_RGB565_NATIVE
+		if ((arow == NULL) && (dx == 1) && (dxr == 0)) {
+			/* unscaled opaque rows need no conversion */
+			memcpy(pvideo, prow + xoffs, rwidth * sizeof(uint16_t));
+		} else
+#endif
+		{
+			xoff = xoffs;
+			rx = rxs;
+			for (xloop = 0; xloop < rwidth; xloop++) {
+				abpixel = nsfb_plot_rgb565_to_colour(prow[xoff]);
+				if (arow == NULL) {
+					*(pvideo + xloop) = colour_to_pixel(
+							nsfb, abpixel);
+				} else if ((opacity = arow[xoff]) != 0) {
+					/* pixel is not transparent; have to
+					 * plot something */
+					if (opacity != 0xFF) {
+						/* pixel is not opaque; need to
+						 * blend */
+						abpixel = nsfb_plot_ablend(
+							(abpixel & 0xFFFFFF) |
+							(opacity << 24),
+							pixel_to_colour(nsfb,
+							*(pvideo + xloop)));
+					}
+					*(pvideo + xloop) = colour_to_pixel(
+							nsfb, abpixel);
+				}
+
+				/* handle horizontal interpolation */
+				xoff += dx;
+				rx += dxr;
+				if (rx >= width) {
+					xoff++;
+					rx -= width;
+				}
+			}
+		}
+
+		pvideo += PLOT_LINELEN(nsfb->linelen);
+
+		/* handle vertical interpolation */
+		yoff += dy;
+		ry += dyr;
+		if (ry >= height) {
+			yoff++;
+			ry -= height;
+		}
+	}
+
+	if (set_dither) {
+		nsfb_palette_dither_fini(nsfb->palette);
+	}
+
+	return true;
+}
+
+/* plot tiles of a RGB565 bitmap, only tiles within the clip are plotted */
+static bool
+bitmap565_tiles(nsfb_t *nsfb,
+		const nsfb_bbox_t *loc,
+		int tiles_x,
+		int tiles_y,
+		const uint16_t *pixel,
+		const uint8_t *alpha,
+		int bmp_width,
+		int bmp_height,
+		int bmp_stride)
+{
+	nsfb_bbox_t render_area;
+	nsfb_bbox_t tloc;
+	int tx, ty;
+	int tx0, ty0, tx1, ty1; /* range of visible tiles */
+	int width = loc->x1 - loc->x0;
+	int height = loc->y1 - loc->y0;
+	bool ok = true;
+
+	/* Avoid pointless rendering */
+	if (width <= 0 || height <= 0)
+		return true;
+
+	render_area.x0 = loc->x0;
+	render_area.y0 = loc->y0;
+	render_area.x1 = loc->x0 + width * tiles_x;
+	render_area.y1 = loc->y0 + height * tiles_y;
+
+	if (!nsfb_plot_clip_ctx(nsfb, &render_area))
+		return true;
+
+	/* Tile a cached copy of the bitmap at this size if possible */
+	if (width != bmp_width || height != bmp_height) {
+		const uint16_t *cached;
+		const uint8_t *cached_alpha;
+
+		cached = nsfb_scale_cache_bitmap565(pixel, alpha,
+				bmp_width, bmp_height, bmp_stride,
+				width, height, &cached_alpha);
+		if (cached != NULL) {
+			pixel = cached;
+			alpha = cached_alpha;
+			bmp_width = bmp_stride = width;
+			bmp_height = height;
+		}
+	}
+
+	tx0 = (render_area.x0 - loc->x0) / width;
+	ty0 = (render_area.y0 - loc->y0) / height;
+	tx1 = (render_area.x1 - loc->x0 + width - 1) / width;
+	ty1 = (render_area.y1 - loc->y0 + height - 1) / height;
+
+	for (ty = ty0; ty < ty1; ty++) {
+		tloc.y0 = loc->y0 + ty * height;
+		tloc.y1 = tloc.y0 + height;
+		for (tx = tx0; tx < tx1; tx++) {
+			tloc.x0 = loc->x0 + tx * width;
+			tloc.x1 = tloc.x0 + width;
+			ok &= bitmap565(nsfb, &tloc, pixel, alpha,
+					bmp_width, bmp_height, bmp_stride);
+		}
+	}
+
+	return ok;
+}
+
 static bool readrect(nsfb_t *nsfb, nsfb_bbox_t *rect, nsfb_colour_t *buffer)
 {
         PLOT_TYPE *pvideo;
@@ -869,6 +869,144 @@ path(nsfb_t *nsfb, int pathc, nsfb_plot_pathop_t *pathop, nsfb_plot_pen_t *pen)
 	return true;
 }
 
+/**
+ * Expand a RGB565 bitmap and optional alpha plane to colour values.
+ *
+ * \return An allocated buffer of bmp_width * bmp_height colours or NULL
+ */
+static nsfb_colour_t *
+bitmap565_expand(const uint16_t *pixel,
+		 const uint8_t *alpha,
+		 int bmp_width,
+		 int bmp_height,
+		 int bmp_stride)
+{
+	nsfb_colour_t *expanded;
+	nsfb_colour_t *dst;
+	int xloop, yloop;
+
+	expanded = malloc(bmp_width * bmp_height * sizeof(nsfb_colour_t));
+	if (expanded == NULL) {
+		return NULL;
+	}
+
+	dst = expanded;
+	for (yloop = 0; yloop < bmp_height; yloop++) {
+		for (xloop = 0; xloop < bmp_width; xloop++) {
+			*dst = nsfb_plot_rgb565_to_colour(pixel[xloop]);
+			if (alpha != NULL) {
+				*dst = (*dst & 0xFFFFFF) |
+					((nsfb_colour_t)alpha[xloop] << 24);
+			}
+			dst++;
+		}
+		pixel += bmp_stride;
+		if (alpha != NULL) {
+			alpha += bmp_stride;
+		}
+	}
+
+	return expanded;
+}
+
+/**
+ * Substitute a cached scaled copy of a RGB565 bitmap if there is one.
+ *
+ * The expanded copy of the bitmap is temporary so it must not be what
+ * the scaled bitmap cache is keyed on.
+ */
+static void
+bitmap565_scale_cached(const uint16_t **pixel,
+		       const uint8_t **alpha,
+		       int *bmp_width,
+		       int *bmp_height,
+		       int *bmp_stride,
+		       const nsfb_bbox_t *loc)
+{
+	int width = loc->x1 - loc->x0;
+	int height = loc->y1 - loc->y0;
+	const uint16_t *cached;
+	const uint8_t *cached_alpha;
+
+	if (width == *bmp_width && height == *bmp_height) {
+		return;
+	}
+
+	cached = nsfb_scale_cache_bitmap565(*pixel, *alpha,
+			*bmp_width, *bmp_height, *bmp_stride,
+			width, height, &cached_alpha);
+	if (cached != NULL) {
+		*pixel = cached;
+		*alpha = cached_alpha;
+		*bmp_width = *bmp_stride = width;
+		*bmp_height = height;
+	}
+}
+
+/* RGB565 bitmap plot for formats without a specialised plotter */
+static bool
+bitmap565(nsfb_t *nsfb,
+	  const nsfb_bbox_t *loc,
+	  const uint16_t *pixel,
+	  const uint8_t *alpha,
+	  int bmp_width,
+	  int bmp_height,
+	  int bmp_stride)
+{
+	nsfb_colour_t *expanded;
+	bool ret;
+
+	bitmap565_scale_cached(&pixel, &alpha, &bmp_width, &bmp_height,
+			       &bmp_stride, loc);
+
+	expanded = bitmap565_expand(pixel, alpha,
+				    bmp_width, bmp_height, bmp_stride);
+	if (expanded == NULL) {
+		return false;
+	}
+
+	ret = nsfb->plotter_fns->bitmap(nsfb, loc, expanded,
+					bmp_width, bmp_height, bmp_width,
+					alpha != NULL);
+	nsfb_plot_scale_cache_invalidate(expanded);
+	free(expanded);
+
+	return ret;
+}
+
+/* RGB565 tiled bitmap plot for formats without a specialised plotter */
+static bool
+bitmap565_tiles(nsfb_t *nsfb,
+		const nsfb_bbox_t *loc,
+		int tiles_x,
+		int tiles_y,
+		const uint16_t *pixel,
+		const uint8_t *alpha,
+		int bmp_width,
+		int bmp_height,
+		int bmp_stride)
+{
+	nsfb_colour_t *expanded;
+	bool ret;
+
+	bitmap565_scale_cached(&pixel, &alpha, &bmp_width, &bmp_height,
+			       &bmp_stride, loc);
+
+	expanded = bitmap565_expand(pixel, alpha,
+				    bmp_width, bmp_height, bmp_stride);
+	if (expanded == NULL) {
+		return false;
+	}
+
+	ret = nsfb->plotter_fns->bitmap_tiles(nsfb, loc, tiles_x, tiles_y,
+					      expanded, bmp_width, bmp_height,
+					      bmp_width, alpha != NULL);
+	nsfb_plot_scale_cache_invalidate(expanded);
+	free(expanded);
+
+	return ret;
+}
+
 bool select_plotters(nsfb_t *nsfb)
 {
 	const nsfb_plotter_fns_t *table = NULL;
@@ -899,6 +1037,7 @@ bool select_plotters(nsfb_t *nsfb)
 
 	case NSFB_FMT_ARGB1555: /* 16 bpp 555 */ 
 	case NSFB_FMT_RGB565: /* 16 bpp 565 */ 
+	case NSFB_FMT_RGB565A8: /* 16 bpp 565 with alpha plane */
 		table = &_nsfb_16bpp_plotters;
 		nsfb->bpp = 16;
 		break;
@@ -948,6 +1087,14 @@ bool select_plotters(nsfb_t *nsfb)
 	nsfb->plotter_fns->path = path;
 	nsfb->plotter_fns->polylines = polylines;
 
+	/* formats without specialised RGB565 bitmap plotters expand them */
+	if (nsfb->plotter_fns->bitmap565 == NULL) {
+		nsfb->plotter_fns->bitmap565 = bitmap565;
+	}
+	if (nsfb->plotter_fns->bitmap565_tiles == NULL) {
+		nsfb->plotter_fns->bitmap565_tiles = bitmap565_tiles;
+	}
+
 	/* set default clip rectangle to size of framebuffer */
 	nsfb->clip.x0 = 0;
 	nsfb->clip.y0 = 0;
@@ -0,0 +1,593 @@
+/*
+ * Copyright 2026 NetSurf Browser Project
+ *
+ * This file is part of libnsfb, http://www.netsurf-browser.org/
+ * Licenced under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/**
+ * \file
+ * Cache of pre-scaled bitmaps.
+ *
+ * Plotting a bitmap at a size other than its own is done by resampling
+ * the source on every plot. When the same bitmap is plotted at the same
+ * size repeatedly (every redraw of a page with a scaled image or tiled
+ * background) the scaling is instead done once, with an area averaging
+ * filter, and the result kept here so later plots are straight copies.
+ *
+ * Entries are keyed on the source pixel pointer and geometry and are
+ * evicted least recently used first to stay within a memory limit. The
+ * cache is disabled until a limit is set because the library cannot
+ * tell when a callers pixel data changes; users enabling it must
+ * invalidate bitmaps whose pixels are modified or freed.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "libnsfb.h"
+#include "libnsfb_plot.h"
+#include "libnsfb_plot_util.h"
+
+#include "nsfb.h"
+#include "plot.h"
+
+/** Number of hash chains, entries for a bitmap share a chain */
+#define SCALE_CACHE_CHAINS 67
+
+/** Largest fraction of the limit a single entry may use */
+#define SCALE_CACHE_MAX_SHARE 2
+
+/** Type of pixel data held by an entry */
+enum scale_kind {
+	SCALE_COLOUR, /**< nsfb colour values, alpha ignored */
+	SCALE_COLOUR_ALPHA, /**< nsfb colour values with alpha */
+	SCALE_RGB565, /**< RGB565 values with optional alpha plane */
+};
+
+/** A scaled copy of a bitmap */
+struct scale_entry {
+	struct scale_entry *next; /**< next entry in hash chain */
+	struct scale_entry *prev_used; /**< more recently used entry */
+	struct scale_entry *next_used; /**< less recently used entry */
+
+	const void *pixel; /**< source pixels */
+	const uint8_t *alpha; /**< source alpha plane or NULL */
+	enum scale_kind kind; /**< source pixel type */
+	int bmp_width; /**< source width */
+	int bmp_height; /**< source height */
+	int bmp_stride; /**< source row stride in pixels */
+	int width; /**< scaled width */
+	int height; /**< scaled height */
+
+	size_t size; /**< memory used by the entry */
+	uint8_t *scaled_alpha; /**< scaled alpha plane for RGB565 sources */
+	nsfb_colour_t scaled[]; /**< scaled pixels */
+};
+
+/** Contributions of source pixels to each destination pixel on one axis */
+struct scale_axis {
+	int *first; /**< first source pixel of each destination pixel */
+	int *count; /**< number of source pixels of each destination pixel */
+	uint32_t *weight; /**< weights of contributing source pixels */
+	uint32_t total; /**< sum of the weights of every destination pixel */
+};
+
+static struct scale_entry *scale_chains[SCALE_CACHE_CHAINS];
+static struct scale_entry *scale_mru; /**< most recently used entry */
+static struct scale_entry *scale_lru; /**< least recently used entry */
+static nsfb_plot_scale_cache_stats_t scale_stats;
+
+static inline unsigned int scale_chain(const void *pixel)
+{
+	return ((uintptr_t)pixel >> 4) % SCALE_CACHE_CHAINS;
+}
+
+static void scale_unlink_used(struct scale_entry *entry)
+{
+	if (entry->prev_used != NULL) {
+		entry->prev_used->next_used = entry->next_used;
+	} else {
+		scale_mru = entry->next_used;
+	}
+
+	if (entry->next_used != NULL) {
+		entry->next_used->prev_used = entry->prev_used;
+	} else {
+		scale_lru = entry->prev_used;
+	}
+}
+
+static void scale_link_used(struct scale_entry *entry)
+{
+	entry->prev_used = NULL;
+	entry->next_used = scale_mru;
+	if (scale_mru != NULL) {
+		scale_mru->prev_used = entry;
+	} else {
+		scale_lru = entry;
+	}
+	scale_mru = entry;
+}
+
+static void scale_entry_free(struct scale_entry *entry)
+{
+	struct scale_entry **link;
+
+	link = &scale_chains[scale_chain(entry->pixel)];
+	while (*link != entry) {
+		link = &(*link)->next;
+	}
+	*link = entry->next;
+
+	scale_unlink_used(entry);
+
+	scale_stats.size -= entry->size;
+	scale_stats.count--;
+
+	free(entry);
+}
+
+/**
+ * Discard least recently used entries until there is space for another.
+ *
+ * \param size The size of the entry to be added.
+ */
+static void scale_make_space(size_t size)
+{
+	while ((scale_lru != NULL) &&
+	       (scale_stats.size + size > scale_stats.limit)) {
+		scale_entry_free(scale_lru);
+	}
+}
+
+static void scale_axis_fini(struct scale_axis *axis)
+{
+	free(axis->first);
+	free(axis->count);
+	free(axis->weight);
+}
+
+/**
+ * Compute the coverage of source pixels by destination pixels.
+ *
+ * Working in units of 1/dst of a source pixel, destination pixel j
+ * covers [j * src, (j + 1) * src) and source pixel i covers
+ * [i * dst, (i + 1) * dst). The weight of a source pixel is the length
+ * of its overlap with the destination pixel, giving a box filter when
+ * reducing and blending only at pixel boundaries when enlarging.
+ */
+static bool scale_axis_init(struct scale_axis *axis, int src, int dst)
+{
+	uint32_t pos, end, edge;
+	int i, j, w = 0;
+
+	axis->first = malloc(dst * sizeof(int));
+	axis->count = malloc(dst * sizeof(int));
+	axis->weight = malloc((src + dst) * sizeof(uint32_t));
+	axis->total = src;
+
+	if ((axis->first == NULL) ||
+	    (axis->count == NULL) ||
+	    (axis->weight == NULL)) {
+		scale_axis_fini(axis);
+		return false;
+	}
+
+	for (j = 0; j < dst; j++) {
+		pos = (uint32_t)j * src;
+		end = pos + src;
+		i = pos / dst;
+
+		axis->first[j] = i;
+		axis->count[j] = 0;
+
+		while (pos < end) {
+			edge = (uint32_t)(i + 1) * dst;
+			if (edge > end) {
+				edge = end;
+			}
+			axis->weight[w++] = edge - pos;
+			axis->count[j]++;
+			pos = edge;
+			i++;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Read a source row as colours with premultiplied alpha.
+ */
+static void
+scale_fetch_row(const struct scale_entry *entry, int y, nsfb_colour_t *row)
+{
+	const nsfb_colour_t *pixel;
+	const uint16_t *pixel565;
+	const uint8_t *alpha;
+	uint32_t a, c;
+	int x;
+
+	switch (entry->kind) {
+	case SCALE_COLOUR:
+		pixel = (const nsfb_colour_t *)entry->pixel +
+			y * entry->bmp_stride;
+		for (x = 0; x < entry->bmp_width; x++) {
+			row[x] = pixel[x] | 0xFF000000;
+		}
+		return;
+
+	case SCALE_COLOUR_ALPHA:
+		pixel = (const nsfb_colour_t *)entry->pixel +
+			y * entry->bmp_stride;
+		for (x = 0; x < entry->bmp_width; x++) {
+			row[x] = pixel[x];
+		}
+		break;
+
+	case SCALE_RGB565:
+		pixel565 = (const uint16_t *)entry->pixel +
+			y * entry->bmp_stride;
+		for (x = 0; x < entry->bmp_width; x++) {
+			row[x] = nsfb_plot_rgb565_to_colour(pixel565[x]);
+		}
+		if (entry->alpha == NULL) {
+			return;
+		}
+		alpha = entry->alpha + y * entry->bmp_stride;
+		for (x = 0; x < entry->bmp_width; x++) {
+			row[x] = (row[x] & 0xFFFFFF) |
+				((nsfb_colour_t)alpha[x] << 24);
+		}
+		break;
+	}
+
+	/* premultiply so transparent pixels do not bleed their colour */
+	for (x = 0; x < entry->bmp_width; x++) {
+		a = row[x] >> 24;
+		if (a == 0xFF) {
+			continue;
+		}
+		c = row[x];
+		row[x] = (a << 24) |
+			((((c >> 16) & 0xFF) * a + 127) / 255) << 16 |
+			((((c >> 8) & 0xFF) * a + 127) / 255) << 8 |
+			(((c & 0xFF) * a + 127) / 255);
+	}
+}
+
+/**
+ * Filter a premultiplied source row horizontally.
+ */
+static void
+scale_filter_row(const struct scale_axis *axis,
+		 const nsfb_colour_t *src,
+		 nsfb_colour_t *dst,
+		 int width)
+{
+	const uint32_t *weight = axis->weight;
+	uint32_t half = axis->total / 2;
+	uint32_t r, g, b, a, w;
+	nsfb_colour_t c;
+	int x, i, n;
+
+	for (x = 0; x < width; x++) {
+		r = g = b = a = half;
+		i = axis->first[x];
+		for (n = axis->count[x]; n > 0; n--) {
+			c = src[i++];
+			w = *weight++;
+			r += (c & 0xFF) * w;
+			g += ((c >> 8) & 0xFF) * w;
+			b += ((c >> 16) & 0xFF) * w;
+			a += (c >> 24) * w;
+		}
+		dst[x] = ((a / axis->total) << 24) |
+			((b / axis->total) << 16) |
+			((g / axis->total) << 8) |
+			(r / axis->total);
+	}
+}
+
+/**
+ * Store a filtered row, undoing the alpha premultiplication.
+ */
+static void
+scale_store_row(struct scale_entry *entry,
+		int y,
+		const uint32_t *acc,
+		uint32_t total)
+{
+	nsfb_colour_t *scaled = entry->scaled + y * entry->width;
+	uint16_t *scaled565;
+	uint32_t half = total / 2;
+	uint32_t r, g, b, a;
+	nsfb_colour_t c;
+	int x;
+
+	for (x = 0; x < entry->width; x++, acc += 4) {
+		r = (acc[0] + half) / total;
+		g = (acc[1] + half) / total;
+		b = (acc[2] + half) / total;
+		a = (acc[3] + half) / total;
+
+		if (a == 0) {
+			r = g = b = 0;
+		} else if (a != 0xFF) {
+			r = (r * 255 + a / 2) / a;
+			g = (g * 255 + a / 2) / a;
+			b = (b * 255 + a / 2) / a;
+			if (r > 0xFF) r = 0xFF;
+			if (g > 0xFF) g = 0xFF;
+			if (b > 0xFF) b = 0xFF;
+		}
+		c = (a << 24) | (b << 16) | (g << 8) | r;
+
+		if (entry->kind != SCALE_RGB565) {
+			scaled[x] = c;
+		} else {
+			scaled565 = (uint16_t *)(void *)entry->scaled;
+			scaled565[y * entry->width + x] =
+				nsfb_plot_colour_to_rgb565(c);
+			if (entry->scaled_alpha != NULL) {
+				entry->scaled_alpha[y * entry->width + x] = a;
+			}
+		}
+	}
+}
+
+/**
+ * Fill an entry by scaling its source bitmap.
+ *
+ * Each destination row is the weighted sum of horizontally filtered
+ * source rows. Consecutive destination rows usually share a source row
+ * at their boundary so the most recently filtered row is kept.
+ */
+static bool scale_entry_fill(struct scale_entry *entry)
+{
+	struct scale_axis xaxis, yaxis;
+	nsfb_colour_t *row, *filtered;
+	const uint32_t *weight;
+	uint32_t *acc;
+	uint32_t w;
+	int filtered_y = -1;
+	int x, y, i, n;
+	bool ok = false;
+
+	if (!scale_axis_init(&xaxis, entry->bmp_width, entry->width)) {
+		return false;
+	}
+	if (!scale_axis_init(&yaxis, entry->bmp_height, entry->height)) {
+		scale_axis_fini(&xaxis);
+		return false;
+	}
+
+	row = malloc(entry->bmp_width * sizeof(nsfb_colour_t));
+	filtered = malloc(entry->width * sizeof(nsfb_colour_t));
+	acc = malloc(entry->width * 4 * sizeof(uint32_t));
+	if ((row == NULL) || (filtered == NULL) || (acc == NULL)) {
+		goto out;
+	}
+
+	weight = yaxis.weight;
+	for (y = 0; y < entry->height; y++) {
+		for (x = 0; x < entry->width * 4; x++) {
+			acc[x] = 0;
+		}
+
+		i = yaxis.first[y];
+		for (n = yaxis.count[y]; n > 0; n--, i++) {
+			if (i != filtered_y) {
+				scale_fetch_row(entry, i, row);
+				scale_filter_row(&xaxis, row, filtered,
+						 entry->width);
+				filtered_y = i;
+			}
+
+			w = *weight++;
+			for (x = 0; x < entry->width; x++) {
+				acc[x * 4 + 0] += (filtered[x] & 0xFF) * w;
+				acc[x * 4 + 1] += ((filtered[x] >> 8) & 0xFF) * w;
+				acc[x * 4 + 2] += ((filtered[x] >> 16) & 0xFF) * w;
+				acc[x * 4 + 3] += (filtered[x] >> 24) * w;
+			}
+		}
+
+		scale_store_row(entry, y, acc, yaxis.total);
+	}
+
+	ok = true;
+
+out:
+	free(acc);
+	free(filtered);
+	free(row);
+	scale_axis_fini(&yaxis);
+	scale_axis_fini(&xaxis);
+
+	return ok;
+}
+
+/**
+ * Find or create a scaled copy of a bitmap.
+ *
+ * \return The cache entry or NULL if the bitmap could not be cached.
+ */
+static struct scale_entry *
+scale_cache_get(enum scale_kind kind,
+		const void *pixel,
+		const uint8_t *alpha,
+		int bmp_width,
+		int bmp_height,
+		int bmp_stride,
+		int width,
+		int height)
+{
+	struct scale_entry *entry;
+	unsigned int chain;
+	size_t size;
+
+	if ((scale_stats.limit == 0) ||
+	    (width <= 0) || (height <= 0) ||
+	    (bmp_width <= 0) || (bmp_height <= 0)) {
+		return NULL;
+	}
+
+	chain = scale_chain(pixel);
+	for (entry = scale_chains[chain]; entry != NULL; entry = entry->next) {
+		if ((entry->pixel == pixel) &&
+		    (entry->alpha == alpha) &&
+		    (entry->kind == kind) &&
+		    (entry->width == width) &&
+		    (entry->height == height) &&
+		    (entry->bmp_width == bmp_width) &&
+		    (entry->bmp_height == bmp_height) &&
+		    (entry->bmp_stride == bmp_stride)) {
+			if (entry != scale_mru) {
+				scale_unlink_used(entry);
+				scale_link_used(entry);
+			}
+			scale_stats.hits++;
+			return entry;
+		}
+	}
+
+	/* the axis weights are computed in 32 bits */
+	if (((uint64_t)bmp_width * width > UINT32_MAX) ||
+	    ((uint64_t)bmp_height * height > UINT32_MAX)) {
+		return NULL;
+	}
+
+	size = (size_t)width * height;
+	if (kind == SCALE_RGB565) {
+		size *= (alpha != NULL) ? 3 : 2;
+	} else {
+		size *= sizeof(nsfb_colour_t);
+	}
+	size += sizeof(struct scale_entry);
+
+	if (size > scale_stats.limit / SCALE_CACHE_MAX_SHARE) {
+		return NULL;
+	}
+
+	scale_stats.misses++;
+
+	scale_make_space(size);
+
+	entry = malloc(size);
+	if (entry == NULL) {
+		return NULL;
+	}
+
+	entry->pixel = pixel;
+	entry->alpha = alpha;
+	entry->kind = kind;
+	entry->bmp_width = bmp_width;
+	entry->bmp_height = bmp_height;
+	entry->bmp_stride = bmp_stride;
+	entry->width = width;
+	entry->height = height;
+	entry->size = size;
+	entry->scaled_alpha = NULL;
+	if ((kind == SCALE_RGB565) && (alpha != NULL)) {
+		entry->scaled_alpha = (uint8_t *)entry->scaled +
+			(size_t)width * height * 2;
+	}
+
+	if (!scale_entry_fill(entry)) {
+		free(entry);
+		return NULL;
+	}
+
+	entry->next = scale_chains[chain];
+	scale_chains[chain] = entry;
+	scale_link_used(entry);
+
+	scale_stats.size += size;
+	scale_stats.count++;
+
+	return entry;
+}
+
+/* exported interface documented in plot.h */
+const nsfb_colour_t *
+nsfb_scale_cache_bitmap(const nsfb_colour_t *pixel,
+			int bmp_width,
+			int bmp_height,
+			int bmp_stride,
+			bool alpha,
+			int width,
+			int height)
+{
+	struct scale_entry *entry;
+
+	entry = scale_cache_get(alpha ? SCALE_COLOUR_ALPHA : SCALE_COLOUR,
+				pixel, NULL,
+				bmp_width, bmp_height, bmp_stride,
+				width, height);
+	if (entry == NULL) {
+		return NULL;
+	}
+
+	return entry->scaled;
+}
+
+/* exported interface documented in plot.h */
+const uint16_t *
+nsfb_scale_cache_bitmap565(const uint16_t *pixel,
+			   const uint8_t *alpha,
+			   int bmp_width,
+			   int bmp_height,
+			   int bmp_stride,
+			   int width,
+			   int height,
+			   const uint8_t **scaled_alpha)
+{
+	struct scale_entry *entry;
+
+	entry = scale_cache_get(SCALE_RGB565, pixel, alpha,
+				bmp_width, bmp_height, bmp_stride,
+				width, height);
+	if (entry == NULL) {
+		return NULL;
+	}
+
+	*scaled_alpha = entry->scaled_alpha;
+	return (const uint16_t *)(void *)entry->scaled;
+}
+
+/* exported interface documented in libnsfb_plot.h */
+void nsfb_plot_scale_cache_invalidate(const void *pixel)
+{
+	struct scale_entry *entry;
+	struct scale_entry *next;
+
+	if (pixel == NULL) {
+		return;
+	}
+
+	entry = scale_chains[scale_chain(pixel)];
+	while (entry != NULL) {
+		next = entry->next;
+		if (entry->pixel == pixel) {
+			scale_entry_free(entry);
+		}
+		entry = next;
+	}
+}
+
+/* exported interface documented in libnsfb_plot.h */
+void nsfb_plot_scale_cache_set_limit(size_t limit)
+{
+	scale_stats.limit = limit;
+	scale_make_space(0);
+}
+
+/* exported interface documented in libnsfb_plot.h */
+void nsfb_plot_scale_cache_stats(nsfb_plot_scale_cache_stats_t *stats)
+{
+	*stats = scale_stats;
+}
@@ -28,6 +28,9 @@ typedef int (nsfb_surfacefn_claim_t)(nsfb_t *nsfb, nsfb_bbox_t *box);
 /* surface area update */
 typedef int (nsfb_surfacefn_update_t)(nsfb_t *nsfb, nsfb_bbox_t *box);
 
+/* surface accumulated update flush */
+typedef int (nsfb_surfacefn_flush_t)(nsfb_t *nsfb);
+
 /* surface cursor display */
 typedef int (nsfb_surfacefn_cursor_t)(nsfb_t *nsfb, struct nsfb_cursor_s *cursor);
 
@@ -41,6 +44,7 @@ typedef struct nsfb_surface_rtns_s {
     nsfb_surfacefn_claim_t *claim;
     nsfb_surfacefn_update_t *update;
     nsfb_surfacefn_cursor_t *cursor;
+    nsfb_surfacefn_flush_t *flush;
 } nsfb_surface_rtns_t;
 
 void _nsfb_register_surface(const enum nsfb_type_e type, const nsfb_surface_rtns_t *rtns, const char *name);
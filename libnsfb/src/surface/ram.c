@@ -20,6 +20,19 @@
 
 #define UNUSED(x) ((x) = (x))
 
+/* size of surface memory, including any alpha plane */
+static size_t ram_size(nsfb_t *nsfb)
+{
+    size_t size;
+
+    size = (nsfb->width * nsfb->height * nsfb->bpp) / 8;
+    if (nsfb->format == NSFB_FMT_RGB565A8) {
+        size += nsfb->width * nsfb->height;
+    }
+
+    return size;
+}
+
 static int ram_defaults(nsfb_t *nsfb)
 {
     nsfb->width = 0;
@@ -38,7 +51,7 @@ static int ram_initialise(nsfb_t *nsfb)
     size_t size;
     uint8_t *fbptr;
 
-    size = (nsfb->width * nsfb->height * nsfb->bpp) / 8;
+    size = ram_size(nsfb);
     fbptr = realloc(nsfb->ptr, size);
     if (fbptr == NULL) {
         return -1;
@@ -53,8 +66,8 @@ static int ram_initialise(nsfb_t *nsfb)
 static int
 ram_set_geometry(nsfb_t *nsfb, int width, int height, enum nsfb_format_e format)
 {
-    int startsize; 
-    int endsize;
+    size_t startsize;
+    size_t endsize;
 
     int prev_width;
     int prev_height;
@@ -64,7 +77,7 @@ ram_set_geometry(nsfb_t *nsfb, int width, int height, enum nsfb_format_e format)
     prev_height = nsfb->height;
     prev_format = nsfb->format;
 
-    startsize = (nsfb->width * nsfb->height * nsfb->bpp) / 8;
+    startsize = ram_size(nsfb);
 
     if (width > 0) {
 	nsfb->width = width;
@@ -82,7 +95,7 @@ ram_set_geometry(nsfb_t *nsfb, int width, int height, enum nsfb_format_e format)
     select_plotters(nsfb);
 
     /* reallocate surface memory if necessary */
-    endsize = (nsfb->width * nsfb->height * nsfb->bpp) / 8;
+    endsize = ram_size(nsfb);
     if ((nsfb->ptr != NULL) && (startsize != endsize)) {
         uint8_t *fbptr;
         fbptr = realloc(nsfb->ptr, endsize);
@@ -360,36 +360,154 @@ enum nsfb_key_code_e sdl_nsfb_map[] = {
 #define max(a,b) (((a) > (b)) ? (a) : (b))
 
 
-Uint32 last_update = 0;
-nsfb_bbox_t updaterect = {-1,-1,-1,-1};
+/** Maximum number of separate damage rectangles held for a frame */
+#define SDL_DAMAGE_MAX 16
 
-void SDL_ShouldUpdate(SDL_Surface* sdl_screen,Sint32 x, Sint32 y, Uint32 w, Uint32 h){
+/** Minimum time between display updates in milliseconds */
+#define SDL_FRAME_MS 16
 
-    if(updaterect.x0 == -1){
-        updaterect.x0 = x;
-        updaterect.x1 = x+w;
-        updaterect.y0 = y;
-        updaterect.y1 = y+h;
+/** Percentage of extra area the union of two damage rectangles may
+ * cover beyond the rectangles themselves and still be merged.
+ */
+#define SDL_DAMAGE_MERGE_SLACK 25
+
+/** Areas altered since the display was last updated */
+static nsfb_bbox_t damage[SDL_DAMAGE_MAX];
+static int damage_count = 0;
+
+/** Time the display was last updated */
+static Uint32 last_update = 0;
+
+static inline uint64_t bbox_area(const nsfb_bbox_t *box)
+{
+    return (uint64_t)(box->x1 - box->x0) * (uint64_t)(box->y1 - box->y0);
+}
+
+/* Decide if two damage rectangles cost less to send as their union */
+static bool damage_should_merge(const nsfb_bbox_t *a, const nsfb_bbox_t *b)
+{
+    nsfb_bbox_t u;
+    nsfb_bbox_t i;
+    uint64_t covered;
+
+    nsfb_plot_add_rect(a, b, &u);
+
+    covered = bbox_area(a) + bbox_area(b);
+
+    i = *a;
+    if (nsfb_plot_clip(b, &i)) {
+        covered -= bbox_area(&i);
     }
 
-    updaterect.x0 = min(updaterect.x0,x);
-    updaterect.y0 = min(updaterect.y0,y);
-    updaterect.x1 = max(updaterect.x1,(Sint32)(x+w));
-    updaterect.y1 = max(updaterect.y1,(Sint32)(y+h));
+    return (bbox_area(&u) * 100) <=
+        (covered * (100 + SDL_DAMAGE_MERGE_SLACK));
+}
+
+/* Remove an entry from the damage list */
+static inline void damage_remove(int idx)
+{
+    damage_count--;
+    damage[idx] = damage[damage_count];
+}
 
-    if(SDL_GetTicks()-last_update < 16){
-        SDL_Delay(max(16-(SDL_GetTicks()-last_update),0));
+/* Add an altered area to the damage list
+ *
+ * Rectangles are merged with existing damage they mostly overlap. If
+ * the list is full the rectangle is merged with the entry whose area
+ * grows least.
+ */
+static void damage_add(nsfb_t *nsfb, int x, int y, int w, int h)
+{
+    nsfb_bbox_t box;
+    nsfb_bbox_t fbarea;
+    nsfb_bbox_t merged;
+    uint64_t growth;
+    uint64_t best_growth;
+    int best;
+    int idx;
+
+    box.x0 = x;
+    box.y0 = y;
+    box.x1 = x + w;
+    box.y1 = y + h;
+
+    fbarea.x0 = 0;
+    fbarea.y0 = 0;
+    fbarea.x1 = nsfb->width;
+    fbarea.y1 = nsfb->height;
+
+    if (!nsfb_plot_clip(&fbarea, &box)) {
+        return;
     }
 
-    if(updaterect.x0 != -1 && (SDL_GetTicks()-last_update > 16 || SDL_GetTicks() < last_update)){
-        SDL_UpdateRect(sdl_screen,
-                    updaterect.x0,
-                    updaterect.y0,
-                    updaterect.x1 - updaterect.x0,
-                    updaterect.y1 - updaterect.y0);
-        updaterect.x0 = -1;
-        last_update = SDL_GetTicks();
+restart:
+    for (idx = 0; idx < damage_count; idx++) {
+        if (damage_should_merge(&damage[idx], &box)) {
+            nsfb_plot_add_rect(&damage[idx], &box, &box);
+            damage_remove(idx);
+            /* the larger box may now merge with earlier entries */
+            goto restart;
+        }
     }
+
+    if (damage_count == SDL_DAMAGE_MAX) {
+        best = 0;
+        best_growth = UINT64_MAX;
+        for (idx = 0; idx < damage_count; idx++) {
+            nsfb_plot_add_rect(&damage[idx], &box, &merged);
+            growth = bbox_area(&merged) - bbox_area(&damage[idx]);
+            if (growth < best_growth) {
+                best_growth = growth;
+                best = idx;
+            }
+        }
+        nsfb_plot_add_rect(&damage[best], &box, &box);
+        damage_remove(best);
+        goto restart;
+    }
+
+    damage[damage_count++] = box;
+}
+
+static int sdl_flush(nsfb_t *nsfb)
+{
+    SDL_Surface *sdl_screen = nsfb->surface_priv;
+    SDL_Rect rects[SDL_DAMAGE_MAX];
+    Uint32 now;
+    Uint32 elapsed;
+    uint64_t pixels = 0;
+    int idx;
+
+    if (damage_count == 0) {
+        return 0;
+    }
+
+    /* pace updates to the display frame rate */
+    now = SDL_GetTicks();
+    elapsed = now - last_update;
+    if (elapsed < SDL_FRAME_MS) {
+        return SDL_FRAME_MS - elapsed;
+    }
+
+    for (idx = 0; idx < damage_count; idx++) {
+        rects[idx].x = damage[idx].x0;
+        rects[idx].y = damage[idx].y0;
+        rects[idx].w = damage[idx].x1 - damage[idx].x0;
+        rects[idx].h = damage[idx].y1 - damage[idx].y0;
+        pixels += bbox_area(&damage[idx]);
+    }
+
+    SDL_UpdateRects(sdl_screen, damage_count, rects);
+
+    nsfb->stats.frames++;
+    nsfb->stats.rects = damage_count;
+    nsfb->stats.pixels = pixels;
+    nsfb->stats.total_pixels += pixels;
+
+    damage_count = 0;
+    last_update = now;
+
+    return 0;
 }
 
 
@@ -452,8 +570,7 @@ sdlcopy(nsfb_t *nsfb, nsfb_bbox_t *srcbox, nsfb_bbox_t *dstbox)
     }
 
 
-    SDL_ShouldUpdate(sdl_screen, dst.x, dst.y, dst.w, dst.h);
-    // SDL_UpdateRect(sdl_screen, dst.x, dst.y, dst.w, dst.h);
+    damage_add(nsfb, dst.x, dst.y, dst.w, dst.h);
 
     return true;
 
@@ -487,6 +604,9 @@ static int sdl_set_geometry(nsfb_t *nsfb, int width, int height,
         nsfb->surface_priv = sdl_screen;
         nsfb->ptr = sdl_screen->pixels;
         nsfb->linelen = sdl_screen->pitch;
+
+        /* damage to the old surface is meaningless */
+        damage_count = 0;
     }
 
     return 0;
@@ -773,7 +893,6 @@ static int sdl_claim(nsfb_t *nsfb, nsfb_bbox_t *box)
 static int
 sdl_cursor(nsfb_t *nsfb, struct nsfb_cursor_s *cursor)
 {
-    SDL_Surface *sdl_screen = nsfb->surface_priv;
     nsfb_bbox_t redraw;
     nsfb_bbox_t fbarea;
 
@@ -797,12 +916,11 @@ sdl_cursor(nsfb_t *nsfb, struct nsfb_cursor_s *cursor)
         nsfb_cursor_clear(nsfb, cursor);
 
         nsfb_cursor_plot(nsfb, cursor);
-        SDL_ShouldUpdate(sdl_screen,
-                    redraw.x0,
-                    redraw.y0,
-                    redraw.x1 - redraw.x0,
-                    redraw.y1 - redraw.y0);
-
+        damage_add(nsfb,
+                   redraw.x0,
+                   redraw.y0,
+                   redraw.x1 - redraw.x0,
+                   redraw.y1 - redraw.y0);
 
     }
     return true;
@@ -811,7 +929,6 @@ sdl_cursor(nsfb_t *nsfb, struct nsfb_cursor_s *cursor)
 
 static int sdl_update(nsfb_t *nsfb, nsfb_bbox_t *box)
 {
-    SDL_Surface *sdl_screen = nsfb->surface_priv;
     struct nsfb_cursor_s *cursor = nsfb->cursor;
 
     if ((cursor != NULL) &&
@@ -819,16 +936,11 @@ static int sdl_update(nsfb_t *nsfb, nsfb_bbox_t *box)
         nsfb_cursor_plot(nsfb, cursor);
     }
 
-    SDL_ShouldUpdate(sdl_screen,
-                   box->x0,
-                   box->y0,
-                   box->x1 - box->x0,
-                   box->y1 - box->y0);
-    // SDL_UpdateRect(sdl_screen,
-    //                box->x0,
-    //                box->y0,
-    //                box->x1 - box->x0,
-    //                box->y1 - box->y0);
+    damage_add(nsfb,
+               box->x0,
+               box->y0,
+               box->x1 - box->x0,
+               box->y1 - box->y0);
 
     return 0;
 }
@@ -840,6 +952,7 @@ const nsfb_surface_rtns_t sdl_rtns = {
     .claim = sdl_claim,
     .update = sdl_update,
     .cursor = sdl_cursor,
+    .flush = sdl_flush,
     .geometry = sdl_set_geometry,
 };
 
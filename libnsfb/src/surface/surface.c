@@ -77,6 +77,12 @@ static int surface_cursor(nsfb_t *nsfb, struct nsfb_cursor_s *cursor)
     return 0;
 }
 
+static int surface_flush(nsfb_t *nsfb)
+{
+    UNUSED(nsfb);
+    return 0;
+}
+
 static int surface_parameters(nsfb_t *nsfb, const char *parameters)
 {
     UNUSED(nsfb);
@@ -131,6 +137,10 @@ nsfb_surface_get_rtns(enum nsfb_type_e type)
 	    if (rtns->parameters == NULL) {
 		rtns->parameters = surface_parameters;
 	    }
+
+	    if (rtns->flush == NULL) {
+		rtns->flush = surface_flush;
+	    }
             
             break;
         }
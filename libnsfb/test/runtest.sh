@@ -14,4 +14,5 @@ ${TEST_PATH}/test_path ${TEST_FRONTEND}
 ${TEST_PATH}/test_polygon ${TEST_FRONTEND}
 ${TEST_PATH}/test_polystar ${TEST_FRONTEND}
 ${TEST_PATH}/test_polystar2 ${TEST_FRONTEND}
+${TEST_PATH}/test_scalecache ${TEST_FRONTEND}
 
@@ -0,0 +1,237 @@
+/* libnsfb scaled bitmap cache test program */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "libnsfb.h"
+#include "libnsfb_plot.h"
+
+#define UNUSED(x) ((x) = (x))
+
+/* size of bitmap and plot used for timing */
+#define BENCH_SRC 512
+#define BENCH_DST 300
+#define BENCH_PLOTS 1000
+#define BENCH_RUNS 3
+
+static int failed = 0;
+
+#define check(cond) do {                                                \
+        if (!(cond)) {                                                  \
+            fprintf(stderr, "%s:%d: check failed: %s\n",                \
+                    __FILE__, __LINE__, #cond);                         \
+            failed++;                                                   \
+        }                                                               \
+    } while (0)
+
+static nsfb_colour_t
+read_pixel(nsfb_t *nsfb, int x, int y)
+{
+    nsfb_bbox_t rect = { x, y, x + 1, y + 1 };
+    nsfb_colour_t c = 0;
+
+    nsfb_plot_readrect(nsfb, &rect, &c);
+
+    return c & 0xFFFFFF;
+}
+
+/* check a colour is within a small tolerance of an expected value */
+static bool
+close_to(nsfb_colour_t c, nsfb_colour_t expected)
+{
+    int shift;
+    int d;
+
+    for (shift = 0; shift < 24; shift += 8) {
+        d = (int)((c >> shift) & 0xFF) - (int)((expected >> shift) & 0xFF);
+        if (d < -2 || d > 2)
+            return false;
+    }
+
+    return true;
+}
+
+/* time plotting a bitmap scaled some number of times */
+static double
+time_plots(nsfb_t *nsfb, const nsfb_colour_t *pixels, int plots)
+{
+    nsfb_bbox_t loc = { 0, 0, BENCH_DST, BENCH_DST };
+    clock_t start;
+    int loop;
+
+    start = clock();
+    for (loop = 0; loop < plots; loop++) {
+        nsfb_plot_bitmap(nsfb, &loc, pixels,
+                         BENCH_SRC, BENCH_SRC, BENCH_SRC, true);
+    }
+
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* fastest of several timings, to reduce scheduling noise */
+static double
+best_plots(nsfb_t *nsfb, const nsfb_colour_t *pixels)
+{
+    double best = 0;
+    double taken;
+    int run;
+
+    for (run = 0; run < BENCH_RUNS; run++) {
+        taken = time_plots(nsfb, pixels, BENCH_PLOTS);
+        if (run == 0 || taken < best)
+            best = taken;
+    }
+
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    nsfb_t *nsfb;
+    nsfb_t *bmp;
+    nsfb_bbox_t box;
+    nsfb_bbox_t loc;
+    nsfb_plot_scale_cache_stats_t stats;
+    nsfb_colour_t checker[4] = {
+        0xFF000000, 0xFFFFFFFF, 0xFFFFFFFF, 0xFF000000
+    };
+    nsfb_colour_t edge[2] = { 0xFF0000FF, 0x0000FF00 };
+    uint16_t checker565[4] = { 0x0000, 0xFFFF, 0xFFFF, 0x0000 };
+    nsfb_colour_t *pixels;
+    uint8_t *fbptr;
+    int fbstride;
+    double uncached, filled, cached;
+    int loop;
+
+    UNUSED(argc);
+    UNUSED(argv);
+
+    nsfb = nsfb_new(NSFB_SURFACE_RAM);
+    if (nsfb == NULL) {
+        fprintf(stderr, "Unable to allocate nsfb surface\n");
+        return 2;
+    }
+
+    nsfb_set_geometry(nsfb, 800, 600, NSFB_FMT_XBGR8888);
+
+    if (nsfb_init(nsfb) == -1) {
+        fprintf(stderr, "Unable to initialise nsfb surface\n");
+        nsfb_free(nsfb);
+        return 4;
+    }
+
+    box.x0 = box.y0 = 0;
+    nsfb_get_geometry(nsfb, &box.x1, &box.y1, NULL);
+    nsfb_claim(nsfb, &box);
+
+    loc.x0 = loc.y0 = 10;
+    loc.x1 = loc.y1 = 11;
+
+    /* the cache is off by default */
+    nsfb_plot_clg(nsfb, 0xFFFFFFFF);
+    nsfb_plot_bitmap(nsfb, &loc, checker, 2, 2, 2, false);
+    nsfb_plot_scale_cache_stats(&stats);
+    check(stats.hits == 0 && stats.misses == 0 && stats.count == 0);
+
+    nsfb_plot_scale_cache_set_limit(1024 * 1024);
+
+    /* downscaling averages the source pixels */
+    nsfb_plot_bitmap(nsfb, &loc, checker, 2, 2, 2, false);
+    check(close_to(read_pixel(nsfb, 10, 10), 0x808080));
+    nsfb_plot_scale_cache_stats(&stats);
+    check(stats.misses == 1 && stats.hits == 0 && stats.count == 1);
+
+    /* later plots at the same size use the cached bitmap */
+    nsfb_plot_bitmap(nsfb, &loc, checker, 2, 2, 2, false);
+    nsfb_plot_scale_cache_stats(&stats);
+    check(stats.misses == 1 && stats.hits == 1);
+
+    /* invalidation picks up changed pixels */
+    checker[0] = checker[3] = 0xFFFFFFFF;
+    nsfb_plot_scale_cache_invalidate(checker);
+    nsfb_plot_scale_cache_stats(&stats);
+    check(stats.count == 0 && stats.size == 0);
+    nsfb_plot_bitmap(nsfb, &loc, checker, 2, 2, 2, false);
+    check(read_pixel(nsfb, 10, 10) == 0xFFFFFF);
+
+    /* transparent pixels do not contribute their colour */
+    nsfb_plot_clg(nsfb, 0xFFFFFFFF);
+    nsfb_plot_bitmap(nsfb, &loc, edge, 2, 1, 2, true);
+    check(close_to(read_pixel(nsfb, 10, 10), 0x7F7FFF));
+
+    /* tiles of scaled bitmaps */
+    nsfb_plot_clg(nsfb, 0xFFFFFFFF);
+    checker[0] = checker[3] = 0xFF000000;
+    nsfb_plot_scale_cache_invalidate(checker);
+    nsfb_plot_bitmap_tiles(nsfb, &loc, 3, 2, checker, 2, 2, 2, false);
+    check(close_to(read_pixel(nsfb, 12, 11), 0x808080));
+
+    /* RGB565 bitmaps, the average is stored as RGB565 */
+    nsfb_plot_bitmap565(nsfb, &loc, checker565, NULL, 2, 2, 2);
+    check(close_to(read_pixel(nsfb, 10, 10), 0x848284));
+    nsfb_plot_bitmap565(nsfb, &loc, checker565, NULL, 2, 2, 2);
+    nsfb_plot_scale_cache_stats(&stats);
+    check(stats.hits == 2);
+
+    /* freeing a surface discards bitmaps scaled from it */
+    bmp = nsfb_new(NSFB_SURFACE_RAM);
+    nsfb_set_geometry(bmp, 2, 2, NSFB_FMT_XBGR8888);
+    nsfb_init(bmp);
+    nsfb_get_buffer(bmp, &fbptr, &fbstride);
+    memcpy(fbptr, checker, sizeof(checker));
+    loc.x1 = loc.x0 + 3;
+    loc.y1 = loc.y0 + 3;
+    nsfb_plot_copy(bmp, NULL, nsfb, &loc);
+    nsfb_plot_scale_cache_stats(&stats);
+    loop = stats.count;
+    nsfb_free(bmp);
+    nsfb_plot_scale_cache_stats(&stats);
+    check(stats.count == (unsigned int)loop - 1);
+
+    /* lowering the limit evicts */
+    nsfb_plot_scale_cache_set_limit(0);
+    nsfb_plot_scale_cache_stats(&stats);
+    check(stats.count == 0 && stats.size == 0);
+
+    /* compare plotting a large scaled bitmap with and without the cache */
+    pixels = malloc(BENCH_SRC * BENCH_SRC * sizeof(nsfb_colour_t));
+    if (pixels == NULL) {
+        fprintf(stderr, "Unable to allocate bitmap\n");
+        return 5;
+    }
+    for (loop = 0; loop < BENCH_SRC * BENCH_SRC; loop++) {
+        pixels[loop] = 0xFF000000 | (loop * 2654435761u >> 8);
+    }
+
+    uncached = best_plots(nsfb, pixels);
+    nsfb_plot_scale_cache_stats(&stats);
+    loop = stats.misses;
+    nsfb_plot_scale_cache_set_limit(4 * 1024 * 1024);
+
+    /* the first plot fills the cache, so it is timed on its own */
+    filled = time_plots(nsfb, pixels, 1);
+    cached = best_plots(nsfb, pixels);
+
+    /* only the first plot scaled the bitmap */
+    nsfb_plot_scale_cache_stats(&stats);
+    check(stats.misses == (unsigned int)loop + 1);
+    printf("%d plots of %dx%d at %dx%d: uncached %.3fs, cached %.3fs "
+           "after a %.3fs fill\n",
+           BENCH_PLOTS, BENCH_SRC, BENCH_SRC, BENCH_DST, BENCH_DST,
+           uncached, cached, filled);
+
+    nsfb_plot_scale_cache_set_limit(0);
+    free(pixels);
+    nsfb_free(nsfb);
+
+    if (failed != 0) {
+        printf("FAIL\n");
+        return 1;
+    }
+
+    printf("PASS\n");
+    return 0;
+}
@@ -13,6 +13,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include <parserutils/charset/utf8.h>
 #include "charset/encodings/utf8impl.h"
 
@@ -173,3 +179,103 @@ parserutils_error parserutils_charset_utf8_next_paranoid(const uint8_t *s,
 	return error;
 }
 
+/**
+ * Find the length of a run of ASCII bytes
+ *
+ * \param s    The string
+ * \param len  Length of string, in bytes
+ * \return Number of bytes before the first non-ASCII byte
+ */
+static inline size_t utf8_ascii_run(const uint8_t *s, size_t len)
+{
+	size_t pos = 0;
+
+#if defined(__SSE2__)
+	for (; pos + sizeof(__m128i) <= len; pos += sizeof(__m128i)) {
+		int mask = _mm_movemask_epi8(
+				_mm_loadu_si128((const __m128i *) (s + pos)));
+		if (mask != 0)
+			return pos + __builtin_ctz(mask);
+	}
+#elif defined(__ARM_NEON)
+	for (; pos + 16 <= len; pos += 16) {
+		uint64x2_t lanes = vreinterpretq_u64_u8(vld1q_u8(s + pos));
+		if (((vgetq_lane_u64(lanes, 0) | vgetq_lane_u64(lanes, 1)) &
+				0x8080808080808080ULL) != 0)
+			break;
+	}
+#else
+	for (; pos + sizeof(size_t) <= len; pos += sizeof(size_t)) {
+		size_t word;
+
+		memcpy(&word, s + pos, sizeof(word));
+		if ((word & (((size_t) -1 / 0xFF) * 0x80)) != 0)
+			break;
+	}
+#endif
+
+	while (pos < len && s[pos] < 0x80)
+		pos++;
+
+	return pos;
+}
+
+/**
+ * Find the length of the valid prefix of a UTF-8 string
+ *
+ * A sequence is valid if ::parserutils_charset_utf8_to_ucs4 would
+ * accept it. Runs of ASCII are checked several bytes at a time.
+ *
+ * \param s      The string
+ * \param len    Length of string, in bytes
+ * \param valid  Pointer to location to receive length of valid prefix
+ * \return PARSERUTILS_OK if the entire string is valid,
+ *         PARSERUTILS_NEEDDATA if the string ends part way through a
+ *                              sequence,
+ *         PARSERUTILS_INVALID if an invalid sequence follows the prefix,
+ *         PARSERUTILS_BADPARM on bad parameters.
+ */
+parserutils_error parserutils_charset_utf8_validate(const uint8_t *s,
+		size_t len, size_t *valid)
+{
+	parserutils_error error = PARSERUTILS_OK;
+	size_t pos = 0;
+
+	if (s == NULL || valid == NULL)
+		return PARSERUTILS_BADPARM;
+
+	while (pos < len) {
+		const uint8_t *seq = s + pos;
+		size_t seqlen = len - pos;
+		uint32_t ucs4;
+		size_t clen;
+		uint32_t *uptr = &ucs4;
+		size_t *cptr = &clen;
+
+		if (*seq < 0x80) {
+			pos += utf8_ascii_run(seq, seqlen);
+			continue;
+		}
+
+		UTF8_TO_UCS4(seq, seqlen, uptr, cptr, error);
+		if (error == PARSERUTILS_NEEDDATA) {
+			size_t i;
+
+			/* Incomplete unless what there is can't be valid */
+			for (i = 1; i < seqlen; i++) {
+				if ((seq[i] & 0xC0) != 0x80) {
+					error = PARSERUTILS_INVALID;
+					break;
+				}
+			}
+		}
+		if (error != PARSERUTILS_OK)
+			break;
+
+		pos += clen;
+	}
+
+	*valid = pos;
+
+	return error;
+}
@@ -31,6 +31,8 @@ typedef struct parserutils_inputstream_private {
 	uint32_t encsrc;		/**< Charset source */
 
 	parserutils_filter *input;	/**< Charset conversion filter */
+	bool passthrough;		/**< Whether the input is UTF-8 and
+					 * is copied without conversion */
 
 	parserutils_charset_detect_func csdetect; /**< Charset detection func.*/
 } parserutils_inputstream_private;
@@ -39,6 +41,10 @@ static inline parserutils_error parserutils_inputstream_refill_buffer(
 		parserutils_inputstream_private *stream);
 static inline parserutils_error parserutils_inputstream_strip_bom(
 		uint16_t *mibenum, parserutils_buffer *buffer);
+static inline parserutils_error parserutils_inputstream_copy_utf8(
+		parserutils_inputstream_private *stream,
+		const uint8_t **data, size_t *len,
+		uint8_t **output, size_t *outlen);
 
 /**
  * Create an input stream
@@ -86,6 +92,7 @@ parserutils_error parserutils_inputstream_create(const char *enc,
 	s->public.cursor = 0;
 	s->public.had_eof = false;
 	s->done_first_chunk = false;
+	s->passthrough = false;
 
 	error = parserutils__filter_create("UTF-8", &s->input);
 	if (error != PARSERUTILS_OK) {
@@ -430,6 +437,11 @@ parserutils_error parserutils_inputstream_refill_buffer(
 		if (error != PARSERUTILS_OK)
 			return error;
 
+		/* UTF-8 input needs validating but not converting */
+		stream->passthrough = (stream->mibenum ==
+				parserutils_charset_mibenum_from_name("UTF-8",
+					SLEN("UTF-8")));
+
 		stream->done_first_chunk = true;
 	}
 
@@ -464,8 +476,13 @@ parserutils_error parserutils_inputstream_refill_buffer(
 	raw_length = stream->raw->length;
 
 	/* Try to fill utf8 buffer from the raw data */
-	error = parserutils__filter_process_chunk(stream->input, 
-			&raw, &raw_length, &utf8, &utf8_space);
+	if (stream->passthrough) {
+		error = parserutils_inputstream_copy_utf8(stream,
+				&raw, &raw_length, &utf8, &utf8_space);
+	} else {
+		error = parserutils__filter_process_chunk(stream->input, 
+				&raw, &raw_length, &utf8, &utf8_space);
+	}
 	/* _NOMEM implies that there's more input to read than available space
 	 * in the utf8 buffer. That's fine, so we'll ignore that error. */
 	if (error != PARSERUTILS_OK && error != PARSERUTILS_NOMEM)
@@ -487,6 +504,89 @@ parserutils_error parserutils_inputstream_refill_buffer(
 	return PARSERUTILS_OK;
 }
 
+/**
+ * Copy UTF-8 input into the UTF-8 buffer without conversion
+ *
+ * \param stream  The inputstream to operate on
+ * \param data    Pointer to pointer to input data (updated on exit)
+ * \param len     Pointer to length of input data (updated on exit)
+ * \param output  Pointer to pointer to output buffer (updated on exit)
+ * \param outlen  Pointer to space in output buffer (updated on exit)
+ * \return PARSERUTILS_OK on success,
+ *         PARSERUTILS_NOMEM if the output buffer is too small
+ *
+ * Valid data is copied in bulk and each invalid sequence is replaced
+ * with U+FFFD. A sequence which is incomplete at the end of the input
+ * is left for the next call, unless EOF has been reached in which case
+ * it, too, is replaced.
+ */
+parserutils_error parserutils_inputstream_copy_utf8(
+		parserutils_inputstream_private *stream,
+		const uint8_t **data, size_t *len,
+		uint8_t **output, size_t *outlen)
+{
+	while (*len > 0) {
+		parserutils_error error;
+		size_t window, valid, skip;
+
+		/* Validate no more than will fit in the output */
+		window = min(*len, *outlen);
+
+		error = parserutils_charset_utf8_validate(*data, window,
+				&valid);
+
+		memcpy(*output, *data, valid);
+		*output += valid;
+		*outlen -= valid;
+		*data += valid;
+		*len -= valid;
+
+		if (error == PARSERUTILS_OK || error == PARSERUTILS_NEEDDATA) {
+			/* Stopped by the size of the output buffer */
+			if (window < *len + valid)
+				return PARSERUTILS_NOMEM;
+		}
+
+		if (error == PARSERUTILS_OK)
+			break;
+
+		if (error == PARSERUTILS_NEEDDATA) {
+			if (stream->public.had_eof == false)
+				break;
+
+			skip = *len;
+		} else if (error == PARSERUTILS_INVALID) {
+			size_t clen = 1;
+
+			/* Skip the start byte and any continuation
+			 * bytes belonging to it */
+			skip = 1;
+			if ((**data & 0xC0) == 0xC0)
+				parserutils_charset_utf8_char_byte_length(
+						*data, &clen);
+			while (skip < clen && skip < *len &&
+					((*data)[skip] & 0xC0) == 0x80)
+				skip++;
+		} else {
+			return error;
+		}
+
+		if (*outlen < 3)
+			return PARSERUTILS_NOMEM;
+
+		(*output)[0] = 0xef;
+		(*output)[1] = 0xbf;
+		(*output)[2] = 0xbd;
+		*output += 3;
+		*outlen -= 3;
+
+		*data += skip;
+		*len -= skip;
+	}
+
+	return PARSERUTILS_OK;
+}
+
 /**
  * Strip a BOM from a buffer in the given encoding
  *
@@ -0,0 +1,262 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <parserutils/parserutils.h>
+#include <parserutils/charset/utf8.h>
+#include <parserutils/input/inputstream.h>
+
+#include "utils/utils.h"
+
+#include "input/filter.h"
+
+#include "testutils.h"
+
+#ifdef __riscos
+const char * const __dynamic_da_name = "UTF8Pass";
+int __dynamic_da_max_size = 128*1024*1024;
+#endif
+
+/* Size of the generated document used for timing */
+#define BENCH_SIZE (16 * 1024 * 1024)
+/* Size of chunks data is appended to the stream in */
+#define CHUNK_SIZE (4096)
+
+/**
+ * Read everything currently available from a stream
+ *
+ * \param stream  Stream to read from
+ * \param out     Buffer to append read data to, or NULL to discard it
+ * \param outlen  Pointer to length of data in out (updated on exit)
+ * \return Result of the final peek
+ */
+static parserutils_error drain(parserutils_inputstream *stream,
+		uint8_t *out, size_t *outlen)
+{
+	parserutils_error error;
+	const uint8_t *c;
+	size_t clen;
+
+	while ((error = parserutils_inputstream_peek(stream, 0, &c, &clen)) ==
+			PARSERUTILS_OK) {
+		/* Take the whole run of decoded data at once */
+		clen = stream->utf8->length - stream->cursor;
+
+		if (out != NULL)
+			memcpy(out + *outlen, c, clen);
+		*outlen += clen;
+
+		parserutils_inputstream_advance(stream, clen);
+	}
+
+	return error;
+}
+
+/**
+ * Run data through a UTF-8 input stream and check the result
+ *
+ * \param chunks    Array of input chunks, terminated by NULL
+ * \param expected  Expected output
+ */
+static void check(const char **chunks, const char *expected)
+{
+	parserutils_inputstream *stream;
+	uint8_t out[64];
+	size_t outlen = 0;
+
+	assert(parserutils_inputstream_create("UTF-8", 1, NULL,
+			&stream) == PARSERUTILS_OK);
+
+	for (; *chunks != NULL; chunks++) {
+		assert(parserutils_inputstream_append(stream,
+				(const uint8_t *) *chunks,
+				strlen(*chunks)) == PARSERUTILS_OK);
+
+		assert(drain(stream, out, &outlen) == PARSERUTILS_NEEDDATA);
+	}
+
+	assert(parserutils_inputstream_append(stream, NULL, 0) ==
+			PARSERUTILS_OK);
+
+	assert(drain(stream, out, &outlen) == PARSERUTILS_EOF);
+
+	assert(outlen == strlen(expected));
+	assert(memcmp(out, expected, outlen) == 0);
+
+	parserutils_inputstream_destroy(stream);
+}
+
+/**
+ * Build a document of mostly ASCII markup with some multibyte text
+ *
+ * \param len  Length of document to build
+ * \return Pointer to document, or NULL on memory exhaustion
+ */
+static uint8_t *generate(size_t len)
+{
+	static const char *pieces[] = {
+		"<p class=\"text\">Lorem ipsum dolor sit amet, ",
+		"consectetur adipiscing elit.</p>\n",
+		"<li>na\xc3\xafve caf\xc3\xa9 \xe2\x82\xac" "5</li>\n",
+		"<span>\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e</span> ",
+		"<a href=\"/\">\xf0\x9f\x98\x80</a>\n"
+	};
+	uint8_t *data;
+	size_t pos = 0, i = 0;
+
+	data = malloc(len);
+	if (data == NULL)
+		return NULL;
+
+	while (pos < len) {
+		const char *piece = pieces[i++ % N_ELEMENTS(pieces)];
+		size_t plen = strlen(piece);
+
+		if (plen > len - pos) {
+			/* Pad the tail with ASCII so it remains valid */
+			memset(data + pos, ' ', len - pos);
+			break;
+		}
+
+		memcpy(data + pos, piece, plen);
+		pos += plen;
+	}
+
+	return data;
+}
+
+static double elapsed(clock_t start)
+{
+	return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+static double rate(size_t len, double secs)
+{
+	return secs > 0 ? ((double) len / (1024 * 1024)) / secs : 0;
+}
+
+int main(int argc, char **argv)
+{
+	parserutils_filter_optparams params;
+	parserutils_inputstream *stream;
+	parserutils_filter *input;
+	uint8_t *data, *out, *dst;
+	const uint8_t *src;
+	size_t pos, outlen, srclen, dstlen;
+	double stream_time, filter_time;
+	clock_t start;
+
+	UNUSED(argc);
+	UNUSED(argv);
+
+	/* Valid input is unchanged */
+	{
+		const char *chunks[] = { "a\xc2\xa0" "b\xe2\x82\xac", NULL };
+		check(chunks, "a\xc2\xa0" "b\xe2\x82\xac");
+	}
+
+	/* Sequences split across chunks are joined */
+	{
+		const char *chunks[] = { "a\xe2", "\x82", "\xac" "b", NULL };
+		check(chunks, "a\xe2\x82\xac" "b");
+	}
+
+	/* Invalid bytes are replaced */
+	{
+		const char *chunks[] = { "a\xff" "b\x80" "c", NULL };
+		check(chunks, "a\xef\xbf\xbd" "b\xef\xbf\xbd" "c");
+	}
+
+	/* A truncated sequence is replaced, leaving what follows it */
+	{
+		const char *chunks[] = { "\xe2\x28\xa1", NULL };
+		check(chunks, "\xef\xbf\xbd(\xef\xbf\xbd");
+	}
+
+	/* An overlong form is replaced as a whole */
+	{
+		const char *chunks[] = { "\xc0\xaf" "x", NULL };
+		check(chunks, "\xef\xbf\xbd" "x");
+	}
+
+	/* An incomplete sequence at EOF is replaced */
+	{
+		const char *chunks[] = { "ab\xf0\x9f\x98", NULL };
+		check(chunks, "ab\xef\xbf\xbd");
+	}
+
+	/* Bulk validation agrees on a large document */
+	data = generate(BENCH_SIZE);
+	assert(data != NULL);
+
+	assert(parserutils_charset_utf8_validate(data, BENCH_SIZE, &pos) ==
+			PARSERUTILS_OK);
+	assert(pos == BENCH_SIZE);
+
+	out = malloc(BENCH_SIZE);
+	assert(out != NULL);
+
+	/* Time the input stream, which copies UTF-8 without conversion */
+	assert(parserutils_inputstream_create("UTF-8", 1, NULL,
+			&stream) == PARSERUTILS_OK);
+
+	outlen = 0;
+	start = clock();
+	for (pos = 0; pos < BENCH_SIZE; pos += CHUNK_SIZE) {
+		assert(parserutils_inputstream_append(stream, data + pos,
+				min(CHUNK_SIZE, BENCH_SIZE - pos)) ==
+				PARSERUTILS_OK);
+		assert(drain(stream, out, &outlen) == PARSERUTILS_NEEDDATA);
+	}
+	assert(parserutils_inputstream_append(stream, NULL, 0) ==
+			PARSERUTILS_OK);
+	assert(drain(stream, out, &outlen) == PARSERUTILS_EOF);
+	stream_time = elapsed(start);
+
+	assert(outlen == BENCH_SIZE);
+	assert(memcmp(out, data, BENCH_SIZE) == 0);
+
+	parserutils_inputstream_destroy(stream);
+
+	/* Time the same data through the conversion filter */
+	assert(parserutils__filter_create("UTF-8", &input) == PARSERUTILS_OK);
+
+	params.encoding.name = "UTF-8";
+	assert(parserutils__filter_setopt(input,
+			PARSERUTILS_FILTER_SET_ENCODING,
+			(parserutils_filter_optparams *) &params) ==
+			PARSERUTILS_OK);
+
+	src = data;
+	srclen = BENCH_SIZE;
+	dst = out;
+	dstlen = BENCH_SIZE;
+	start = clock();
+	while (srclen > 0) {
+		size_t chunk = min(CHUNK_SIZE, srclen);
+		size_t left = chunk;
+
+		assert(parserutils__filter_process_chunk(input, &src, &left,
+				&dst, &dstlen) == PARSERUTILS_OK);
+		srclen -= chunk - left;
+	}
+	filter_time = elapsed(start);
+
+	assert(dstlen == 0);
+	assert(memcmp(out, data, BENCH_SIZE) == 0);
+
+	parserutils__filter_destroy(input);
+
+	printf("%d bytes: stream %.2f MB/s, filter %.2f MB/s\n",
+			BENCH_SIZE, rate(BENCH_SIZE, stream_time),
+			rate(BENCH_SIZE, filter_time));
+
+	free(out);
+	free(data);
+
+	printf("PASS\n");
+
+	return 0;
+}
@@ -32,6 +32,8 @@ struct svgtiny_shape {
 	int stroke_width;
 };
 
+struct svgtiny_geometry;
+
 struct svgtiny_diagram {
 	int width, height;
 
@@ -40,6 +42,9 @@ struct svgtiny_diagram {
 
 	unsigned short error_line;
 	const char *error_message;
+
+	/* parsed shapes, which shape is laid out from for each viewport */
+	struct svgtiny_geometry *geometry;
 };
 
 typedef enum {
@@ -67,6 +72,8 @@ struct svgtiny_diagram *svgtiny_create(void);
 svgtiny_code svgtiny_parse(struct svgtiny_diagram *diagram,
 		const char *buffer, size_t size, const char *url,
 		int width, int height);
+svgtiny_code svgtiny_layout(struct svgtiny_diagram *diagram,
+		int width, int height);
 void svgtiny_free(struct svgtiny_diagram *svg);
 
 #endif
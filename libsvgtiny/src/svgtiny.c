@@ -38,6 +38,11 @@
 #define degToRad(angleInDegrees) ((angleInDegrees) * M_PI / 180.0)
 #define radToDeg(angleInRadians) ((angleInRadians) * 180.0 / M_PI)
 
+static svgtiny_code svgtiny_parse_geometry(struct svgtiny_diagram *diagram,
+		dom_document *document, dom_element *svg,
+		int viewport_width, int viewport_height);
+static svgtiny_code svgtiny_layout_shapes(struct svgtiny_diagram *diagram,
+		int viewport_width, int viewport_height);
 static svgtiny_code svgtiny_parse_svg(dom_element *svg,
 		struct svgtiny_parse_state state);
 static svgtiny_code svgtiny_parse_path(dom_element *path,
@@ -54,6 +59,12 @@ static svgtiny_code svgtiny_parse_poly(dom_element *poly,
 		struct svgtiny_parse_state state, bool polygon);
 static svgtiny_code svgtiny_parse_text(dom_element *text,
 		struct svgtiny_parse_state state);
+static svgtiny_code svgtiny_parse_view_box(dom_element *svg,
+		const struct svgtiny_parse_state *state,
+		float *min_x, float *min_y, float *width, float *height,
+		bool *found);
+static float svgtiny_parse_root_length(dom_element *svg, dom_string *name,
+		bool *relative, const struct svgtiny_parse_state state);
 static void svgtiny_parse_position_attributes(dom_element *node,
 		const struct svgtiny_parse_state state,
 		float *x, float *y, float *width, float *height);
@@ -590,9 +601,49 @@ struct svgtiny_diagram *svgtiny_create(void)
 	if (!diagram)
 		return 0;
 
+	diagram->geometry = calloc(sizeof(*diagram->geometry), 1);
+	if (!diagram->geometry) {
+		free(diagram);
+		return NULL;
+	}
+
 	return diagram;
-	free(diagram);
-	return NULL;
+}
+
+/**
+ * Free the shapes laid out for a viewport.
+ *
+ * The text of each shape belongs to the geometry it was laid out from.
+ */
+
+static void svgtiny_free_shapes(struct svgtiny_diagram *diagram)
+{
+	unsigned int i;
+
+	for (i = 0; i != diagram->shape_count; i++)
+		free(diagram->shape[i].path);
+
+	free(diagram->shape);
+	diagram->shape = NULL;
+	diagram->shape_count = 0;
+}
+
+/**
+ * Free the parsed shapes of a geometry.
+ */
+
+static void svgtiny_free_geometry_shapes(struct svgtiny_geometry *geometry)
+{
+	unsigned int i;
+
+	for (i = 0; i != geometry->shape_count; i++) {
+		free(geometry->shape[i].path);
+		free(geometry->shape[i].text);
+	}
+
+	free(geometry->shape);
+	geometry->shape = NULL;
+	geometry->shape_count = 0;
 }
 
 static void ignore_msg(uint32_t severity, void *ctx, const char *msg, ...)
@@ -617,9 +668,8 @@ svgtiny_code svgtiny_parse(struct svgtiny_diagram *diagram,
 	dom_element *svg;
 	dom_string *svg_name;
 	lwc_string *svg_name_lwc;
-	struct svgtiny_parse_state state;
-	float x, y, width, height;
-	svgtiny_code code;
+	struct svgtiny_geometry *geometry;
+	svgtiny_code code, layout_code;
 
 	assert(diagram);
 	assert(buffer);
@@ -627,6 +677,17 @@ svgtiny_code svgtiny_parse(struct svgtiny_diagram *diagram,
 
 	UNUSED(url);
 
+	/* discard the result of any previous parse */
+	svgtiny_free_shapes(diagram);
+	geometry = diagram->geometry;
+	svgtiny_free_geometry_shapes(geometry);
+	if (geometry->document != NULL) {
+		dom_node_unref(geometry->document);
+		geometry->document = NULL;
+	}
+	geometry->parsed = false;
+	geometry->code = svgtiny_LIBDOM_ERROR;
+
 	parser = dom_xml_parser_create(NULL, NULL,
 				       ignore_msg, NULL, &document);
 
@@ -661,6 +722,7 @@ svgtiny_code svgtiny_parse(struct svgtiny_diagram *diagram,
         if (svg == NULL) {
                 /* no root svg element */
                 dom_node_unref(document);
+		geometry->code = svgtiny_SVG_ERROR;
 		return svgtiny_SVG_ERROR;
         }
 
@@ -682,15 +744,53 @@ svgtiny_code svgtiny_parse(struct svgtiny_diagram *diagram,
 		dom_string_unref(svg_name);
 		dom_node_unref(svg);
 		dom_node_unref(document);
+		geometry->code = svgtiny_NOT_SVG;
 		return svgtiny_NOT_SVG;
 	}
 
 	lwc_string_unref(svg_name_lwc);
 	dom_string_unref(svg_name);
 
-	/* get graphic dimensions */
+	code = svgtiny_parse_geometry(diagram, document, svg,
+			viewport_width, viewport_height);
+	dom_node_unref(svg);
+
+	if (geometry->parsed && geometry->view_box_width == 0 &&
+			(geometry->width_relative ||
+			 geometry->height_relative)) {
+		/* lengths in user space are relative to the viewport, so the
+		 * document must be parsed again for other viewports */
+		geometry->document = document;
+	} else {
+		dom_node_unref(document);
+	}
+
+	layout_code = svgtiny_layout_shapes(diagram,
+			viewport_width, viewport_height);
+	if (code == svgtiny_OK)
+		code = layout_code;
+
+	return code;
+}
+
+
+/**
+ * Parse the root <svg> element of a document into the diagram's geometry.
+ */
+
+static svgtiny_code svgtiny_parse_geometry(struct svgtiny_diagram *diagram,
+		dom_document *document, dom_element *svg,
+		int viewport_width, int viewport_height)
+{
+	struct svgtiny_geometry *geometry = diagram->geometry;
+	struct svgtiny_parse_state state;
+	float min_x, min_y, vwidth, vheight;
+	bool view_box = false;
+	svgtiny_code code;
+
 	memset(&state, 0, sizeof(state));
 	state.diagram = diagram;
+	state.geometry = geometry;
 	state.document = document;
 	state.viewport_width = viewport_width;
 	state.viewport_height = viewport_height;
@@ -705,19 +805,45 @@ svgtiny_code svgtiny_parse(struct svgtiny_diagram *diagram,
 #include "svgtiny_strings.h"
 #undef SVGTINY_STRING_ACTION2
 
-	svgtiny_parse_position_attributes(svg, state, &x, &y, &width, &height);
-	diagram->width = width;
-	diagram->height = height;
+	/* get graphic dimensions */
+	geometry->width = svgtiny_parse_root_length(svg,
+			state.interned_width, &geometry->width_relative,
+			state);
+	geometry->height = svgtiny_parse_root_length(svg,
+			state.interned_height, &geometry->height_relative,
+			state);
+	geometry->viewport_width = viewport_width;
+	geometry->viewport_height = viewport_height;
+
+	code = svgtiny_parse_view_box(svg, &state, &min_x, &min_y,
+			&vwidth, &vheight, &view_box);
+	if (code != svgtiny_OK)
+		goto cleanup;
 
 	/* set up parsing state */
-	state.viewport_width = width;
-	state.viewport_height = height;
-	state.ctm.a = 1; /*(float) viewport_width / (float) width;*/
+	if (view_box) {
+		/* shapes are kept in the user space of the viewBox, which
+		 * is only mapped onto the viewport when laying out */
+		state.viewport_width = vwidth;
+		state.viewport_height = vheight;
+		geometry->view_box_width = vwidth;
+		geometry->view_box_height = vheight;
+	} else {
+		state.viewport_width = geometry->width_relative ?
+				geometry->width * viewport_width :
+				geometry->width;
+		state.viewport_height = geometry->height_relative ?
+				geometry->height * viewport_height :
+				geometry->height;
+		geometry->view_box_width = 0;
+		geometry->view_box_height = 0;
+	}
+	state.ctm.a = 1;
 	state.ctm.b = 0;
 	state.ctm.c = 0;
-	state.ctm.d = 1; /*(float) viewport_height / (float) height;*/
-	state.ctm.e = 0; /*x;*/
-	state.ctm.f = 0; /*y;*/
+	state.ctm.d = 1;
+	state.ctm.e = 0;
+	state.ctm.f = 0;
 	/*state.style = css_base_style;
 	state.style.font_size.value.length.value = option_font_size * 0.1;*/
 	state.fill = 0x000000;
@@ -725,11 +851,9 @@ svgtiny_code svgtiny_parse(struct svgtiny_diagram *diagram,
 	state.stroke_width = 1;
 
 	/* parse tree */
+	geometry->parsed = true;
 	code = svgtiny_parse_svg(svg, state);
 
-	dom_node_unref(svg);
-	dom_node_unref(document);
-
 cleanup:
 	svgtiny_cleanup_state_local(&state);
 #define SVGTINY_STRING_ACTION2(s,n)			\
@@ -737,10 +861,161 @@ cleanup:
 		dom_string_unref(state.interned_##s);
 #include "svgtiny_strings.h"
 #undef SVGTINY_STRING_ACTION2
+	geometry->code = code;
 	return code;
 }
 
 
+/**
+ * Lay the parsed shapes of a diagram out for a viewport.
+ *
+ * Maps the root viewBox onto the viewport, transforming each shape from
+ * the user space of the root <svg> element into the diagram.
+ */
+
+static svgtiny_code svgtiny_layout_shapes(struct svgtiny_diagram *diagram,
+		int viewport_width, int viewport_height)
+{
+	struct svgtiny_geometry *geometry = diagram->geometry;
+	float width, height;
+	float scale_x = 1, scale_y = 1;
+	unsigned int i, j;
+
+	width = geometry->width_relative ?
+			geometry->width * viewport_width : geometry->width;
+	height = geometry->height_relative ?
+			geometry->height * viewport_height : geometry->height;
+	diagram->width = width;
+	diagram->height = height;
+
+	if (geometry->view_box_width != 0) {
+		scale_x = width / geometry->view_box_width;
+		scale_y = height / geometry->view_box_height;
+	}
+
+	if (diagram->shape_count != geometry->shape_count) {
+		svgtiny_free_shapes(diagram);
+
+		if (geometry->shape_count == 0)
+			return svgtiny_OK;
+
+		diagram->shape = calloc(geometry->shape_count,
+				sizeof diagram->shape[0]);
+		if (!diagram->shape)
+			return svgtiny_OUT_OF_MEMORY;
+
+		for (i = 0; i != geometry->shape_count; i++) {
+			struct svgtiny_geometry_shape *from =
+					&geometry->shape[i];
+			struct svgtiny_shape *shape = &diagram->shape[i];
+
+			if (from->path) {
+				shape->path = malloc(from->path_length *
+						sizeof shape->path[0]);
+				if (!shape->path) {
+					diagram->shape_count = i;
+					svgtiny_free_shapes(diagram);
+					return svgtiny_OUT_OF_MEMORY;
+				}
+				shape->path_length = from->path_length;
+			}
+			shape->text = from->text;
+			shape->fill = from->fill;
+			shape->stroke = from->stroke;
+		}
+		diagram->shape_count = geometry->shape_count;
+	}
+
+	for (i = 0; i != geometry->shape_count; i++) {
+		struct svgtiny_geometry_shape *from = &geometry->shape[i];
+		struct svgtiny_shape *shape = &diagram->shape[i];
+
+		for (j = 0; j != from->path_length; ) {
+			unsigned int points = 0;
+			unsigned int k;
+			shape->path[j] = from->path[j];
+			switch ((int) from->path[j]) {
+			case svgtiny_PATH_MOVE:
+			case svgtiny_PATH_LINE:
+				points = 1;
+				break;
+			case svgtiny_PATH_CLOSE:
+				points = 0;
+				break;
+			case svgtiny_PATH_BEZIER:
+				points = 3;
+				break;
+			default:
+				assert(0);
+			}
+			j++;
+			for (k = 0; k != points; k++) {
+				shape->path[j] = scale_x * from->path[j];
+				shape->path[j + 1] = scale_y *
+						from->path[j + 1];
+				j += 2;
+			}
+		}
+
+		shape->text_x = scale_x * from->text_x;
+		shape->text_y = scale_y * from->text_y;
+
+		shape->stroke_width = lroundf((float) from->stroke_width *
+				(scale_x * from->stroke_scale_x +
+				 scale_y * from->stroke_scale_y) / 2.0);
+		if (0 < from->stroke_width && shape->stroke_width == 0)
+			shape->stroke_width = 1;
+	}
+
+	return svgtiny_OK;
+}
+
+
+/**
+ * Lay a parsed diagram out for another viewport.
+ *
+ * The document is only parsed again if lengths in it are relative to the
+ * viewport; otherwise the shapes kept from parsing are transformed.
+ */
+
+svgtiny_code svgtiny_layout(struct svgtiny_diagram *diagram,
+		int viewport_width, int viewport_height)
+{
+	struct svgtiny_geometry *geometry;
+
+	assert(diagram);
+
+	geometry = diagram->geometry;
+	if (!geometry->parsed)
+		return geometry->code;
+
+	if (geometry->document != NULL &&
+			(viewport_width != geometry->viewport_width ||
+			 viewport_height != geometry->viewport_height)) {
+		dom_element *svg;
+		dom_exception exc;
+
+		exc = dom_document_get_document_element(geometry->document,
+				&svg);
+		if (exc != DOM_NO_ERR || svg == NULL)
+			return svgtiny_LIBDOM_ERROR;
+
+		svgtiny_free_shapes(diagram);
+		svgtiny_free_geometry_shapes(geometry);
+
+		svgtiny_parse_geometry(diagram, geometry->document,
+				svg, viewport_width, viewport_height);
+		dom_node_unref(svg);
+	}
+
+	if (svgtiny_layout_shapes(diagram, viewport_width, viewport_height) !=
+			svgtiny_OK)
+		return svgtiny_OUT_OF_MEMORY;
+
+	return geometry->code;
+}
+
+
 /**
  * Parse a <svg> or <g> element node.
  */
@@ -749,9 +1024,11 @@ svgtiny_code svgtiny_parse_svg(dom_element *svg,
 		struct svgtiny_parse_state state)
 {
 	float x, y, width, height;
-	dom_string *view_box;
+	float min_x, min_y, vwidth, vheight;
+	bool view_box;
 	dom_element *child;
 	dom_exception exc;
+	svgtiny_code code;
 
 	svgtiny_setup_state_local(&state);
 
@@ -759,28 +1036,21 @@ svgtiny_code svgtiny_parse_svg(dom_element *svg,
 	svgtiny_parse_paint_attributes(svg, &state);
 	svgtiny_parse_font_attributes(svg, &state);
 
-	exc = dom_element_get_attribute(svg, state.interned_viewBox,
-					&view_box);
-	if (exc != DOM_NO_ERR) {
+	code = svgtiny_parse_view_box(svg, &state, &min_x, &min_y,
+			&vwidth, &vheight, &view_box);
+	if (code != svgtiny_OK) {
 		svgtiny_cleanup_state_local(&state);
-		return svgtiny_LIBDOM_ERROR;
+		return code;
 	}
 
 	if (view_box) {
-		char *s = strndup(dom_string_data(view_box),
-				  dom_string_byte_length(view_box));
-		float min_x, min_y, vwidth, vheight;
-		if (sscanf(s, "%f,%f,%f,%f",
-				&min_x, &min_y, &vwidth, &vheight) == 4 ||
-				sscanf(s, "%f %f %f %f",
-				&min_x, &min_y, &vwidth, &vheight) == 4) {
-			state.ctm.a = (float) state.viewport_width / vwidth;
-			state.ctm.d = (float) state.viewport_height / vheight;
-			state.ctm.e += -min_x * state.ctm.a;
-			state.ctm.f += -min_y * state.ctm.d;
-		}
-		free(s);
-		dom_string_unref(view_box);
+		state.ctm.a = (float) state.viewport_width / vwidth;
+		state.ctm.d = (float) state.viewport_height / vheight;
+		state.ctm.e += -min_x * state.ctm.a;
+		state.ctm.f += -min_y * state.ctm.d;
+		/* lengths within are relative to the viewBox */
+		state.viewport_width = vwidth;
+		state.viewport_height = vheight;
 	}
 
 	svgtiny_parse_transform_attributes(svg, &state);
@@ -793,7 +1063,8 @@ svgtiny_code svgtiny_parse_svg(dom_element *svg,
 	while (child != NULL) {
 		dom_element *next;
 		dom_node_type nodetype;
-		svgtiny_code code = svgtiny_OK;
+
+		code = svgtiny_OK;
 
 		exc = dom_node_get_node_type(child, &nodetype);
 		if (exc != DOM_NO_ERR) {
@@ -863,6 +1134,49 @@ svgtiny_code svgtiny_parse_svg(dom_element *svg,
 }
 
 
+/**
+ * Parse the viewBox attribute of a <svg> element, if present.
+ *
+ * http://www.w3.org/TR/SVG11/coords#ViewBoxAttribute
+ */
+
+static svgtiny_code svgtiny_parse_view_box(dom_element *svg,
+		const struct svgtiny_parse_state *state,
+		float *min_x, float *min_y, float *width, float *height,
+		bool *found)
+{
+	dom_string *view_box;
+	dom_exception exc;
+	char *s;
+
+	*found = false;
+
+	exc = dom_element_get_attribute(svg, state->interned_viewBox,
+					&view_box);
+	if (exc != DOM_NO_ERR)
+		return svgtiny_LIBDOM_ERROR;
+	if (view_box == NULL)
+		return svgtiny_OK;
+
+	s = strndup(dom_string_data(view_box),
+		    dom_string_byte_length(view_box));
+	dom_string_unref(view_box);
+	if (s == NULL)
+		return svgtiny_OUT_OF_MEMORY;
+
+	if (sscanf(s, "%f,%f,%f,%f", min_x, min_y, width, height) == 4 ||
+			sscanf(s, "%f %f %f %f",
+			min_x, min_y, width, height) == 4) {
+		/* a viewBox without area disables rendering, which is
+		 * not supported, so ignore it */
+		*found = 0 < *width && 0 < *height;
+	}
+	free(s);
+
+	return svgtiny_OK;
+}
+
+
 
 /**
  * Parse a <path> element node.
@@ -1720,7 +2034,8 @@ svgtiny_code svgtiny_parse_text(dom_element *text,
 							  state);
 			dom_string_unref(nodename);
 		} else if (nodetype == DOM_TEXT_NODE) {
-			struct svgtiny_shape *shape = svgtiny_add_shape(&state);
+			struct svgtiny_geometry_shape *shape =
+					svgtiny_add_shape(&state);
 			dom_string *content;
 			if (shape == NULL) {
 				dom_node_unref(child);
@@ -1742,7 +2057,7 @@ svgtiny_code svgtiny_parse_text(dom_element *text,
 			}
 			shape->text_x = px;
 			shape->text_y = py;
-			state.diagram->shape_count++;
+			state.geometry->shape_count++;
 		}
 
 		if (code != svgtiny_OK) {
@@ -1857,6 +2172,41 @@ float svgtiny_parse_length(dom_string *s, int viewport_size,
 	return ret;
 }
 
+/**
+ * Parse the width or height attribute of the root <svg> element.
+ *
+ * Lengths which are relative to the viewport, including a missing
+ * attribute, are returned as a fraction of it with relative set.
+ */
+
+static float svgtiny_parse_root_length(dom_element *svg, dom_string *name,
+		bool *relative, const struct svgtiny_parse_state state)
+{
+	dom_string *attr;
+	dom_exception exc;
+	float length = 1;
+
+	*relative = true;
+
+	exc = dom_element_get_attribute(svg, name, &attr);
+	if (exc == DOM_NO_ERR && attr != NULL) {
+		char *s = strndup(dom_string_data(attr),
+				  dom_string_byte_length(attr));
+		if (s != NULL) {
+			if (s[strspn(s, "0123456789+-.")] == '%') {
+				length = atof(s) / 100.0;
+			} else {
+				*relative = false;
+				length = _svgtiny_parse_length(s, 0, state);
+			}
+			free(s);
+		}
+		dom_string_unref(attr);
+	}
+
+	return length;
+}
+
 /**
  * Parse paint attributes, if present.
  */
@@ -2140,7 +2490,7 @@ void svgtiny_parse_transform(char *s, float *ma, float *mb,
 svgtiny_code svgtiny_add_path(float *p, unsigned int n,
 		struct svgtiny_parse_state *state)
 {
-	struct svgtiny_shape *shape;
+	struct svgtiny_geometry_shape *shape;
 
 	if (state->fill == svgtiny_LINEAR_GRADIENT)
 		return svgtiny_add_path_linear_gradient(p, n, state);
@@ -2154,35 +2504,37 @@ svgtiny_code svgtiny_add_path(float *p, unsigned int n,
 	}
 	shape->path = p;
 	shape->path_length = n;
-	state->diagram->shape_count++;
+	state->geometry->shape_count++;
 
 	return svgtiny_OK;
 }
 
 
 /**
- * Add a svgtiny_shape to the svgtiny_diagram.
+ * Add a svgtiny_geometry_shape to the diagram's geometry.
  */
 
-struct svgtiny_shape *svgtiny_add_shape(struct svgtiny_parse_state *state)
+struct svgtiny_geometry_shape *svgtiny_add_shape(
+		struct svgtiny_parse_state *state)
 {
-	struct svgtiny_shape *shape = realloc(state->diagram->shape,
-			(state->diagram->shape_count + 1) *
-			sizeof (state->diagram->shape[0]));
+	struct svgtiny_geometry_shape *shape = realloc(state->geometry->shape,
+			(state->geometry->shape_count + 1) *
+			sizeof (state->geometry->shape[0]));
 	if (!shape)
 		return 0;
-	state->diagram->shape = shape;
+	state->geometry->shape = shape;
 
-	shape += state->diagram->shape_count;
+	shape += state->geometry->shape_count;
 	shape->path = 0;
 	shape->path_length = 0;
 	shape->text = 0;
+	shape->text_x = 0;
+	shape->text_y = 0;
 	shape->fill = state->fill;
 	shape->stroke = state->stroke;
-	shape->stroke_width = lroundf((float) state->stroke_width *
-			(state->ctm.a + state->ctm.d) / 2.0);
-	if (0 < state->stroke_width && shape->stroke_width == 0)
-		shape->stroke_width = 1;
+	shape->stroke_width = state->stroke_width;
+	shape->stroke_scale_x = state->ctm.a;
+	shape->stroke_scale_y = state->ctm.d;
 
 	return shape;
 }
@@ -2235,15 +2587,14 @@ void svgtiny_transform_path(float *p, unsigned int n,
 
 void svgtiny_free(struct svgtiny_diagram *svg)
 {
-	unsigned int i;
 	assert(svg);
 
-	for (i = 0; i != svg->shape_count; i++) {
-		free(svg->shape[i].path);
-		free(svg->shape[i].text);
-	}
+	svgtiny_free_shapes(svg);
 
-	free(svg->shape);
+	svgtiny_free_geometry_shapes(svg->geometry);
+	if (svg->geometry->document != NULL)
+		dom_node_unref(svg->geometry->document);
+	free(svg->geometry);
 
 	free(svg);
 }
@@ -395,7 +395,7 @@ svgtiny_code svgtiny_add_path_linear_gradient(float *p, unsigned int n,
 		p[11] = p[8] - strip_dy;
 		p[12] = svgtiny_PATH_CLOSE;
 		svgtiny_transform_path(p, 13, state);
-		struct svgtiny_shape *shape = svgtiny_add_shape(state);
+		struct svgtiny_geometry_shape *shape = svgtiny_add_shape(state);
 		if (!shape) {
 			free(p);
 			return svgtiny_OUT_OF_MEMORY;
@@ -404,7 +404,7 @@ svgtiny_code svgtiny_add_path_linear_gradient(float *p, unsigned int n,
 		shape->path_length = 13;
 		shape->fill = svgtiny_TRANSPARENT;
 		shape->stroke = svgtiny_RGB(0, 0xff, 0);
-		state->diagram->shape_count++;
+		state->geometry->shape_count++;
 	}*/
 
 	/* invert gradient transform for applying to vertices */
@@ -578,7 +578,7 @@ svgtiny_code svgtiny_add_path_linear_gradient(float *p, unsigned int n,
 		struct grad_point *point_b = svgtiny_list_get(pts, b);
 		float mean_r = (point_t->r + point_a->r + point_b->r) / 3;
 		float *p;
-		struct svgtiny_shape *shape;
+		struct svgtiny_geometry_shape *shape;
 		/*fprintf(stderr, "triangle: t %i %.3f a %i %.3f b %i %.3f "
 				"mean_r %.3f\n",
 				t, pts[t].r, a, pts[a].r, b, pts[b].r,
@@ -638,7 +638,7 @@ svgtiny_code svgtiny_add_path_linear_gradient(float *p, unsigned int n,
 		#ifdef GRADIENT_DEBUG
 		shape->stroke = svgtiny_RGB(0, 0, 0xff);
 		#endif
-		state->diagram->shape_count++;
+		state->geometry->shape_count++;
 		if (point_a->r < point_b->r) {
 			t = a;
 			a = (a + 1) % svgtiny_list_size(pts);
@@ -662,7 +662,7 @@ svgtiny_code svgtiny_add_path_linear_gradient(float *p, unsigned int n,
 		p[5] = gradient_y1;
 		p[6] = svgtiny_PATH_CLOSE;
 		svgtiny_transform_path(p, 7, state);
-		struct svgtiny_shape *shape = svgtiny_add_shape(state);
+		struct svgtiny_geometry_shape *shape = svgtiny_add_shape(state);
 		if (!shape) {
 			free(p);
 			return svgtiny_OUT_OF_MEMORY;
@@ -671,7 +671,7 @@ svgtiny_code svgtiny_add_path_linear_gradient(float *p, unsigned int n,
 		shape->path_length = 7;
 		shape->fill = svgtiny_TRANSPARENT;
 		shape->stroke = svgtiny_RGB(0xff, 0, 0);
-		state->diagram->shape_count++;
+		state->geometry->shape_count++;
 	}
 	#endif
 
@@ -679,7 +679,7 @@ svgtiny_code svgtiny_add_path_linear_gradient(float *p, unsigned int n,
 	#ifdef GRADIENT_DEBUG
 	for (unsigned int i = 0; i != svgtiny_list_size(pts); i++) {
 		struct grad_point *point = svgtiny_list_get(pts, i);
-		struct svgtiny_shape *shape = svgtiny_add_shape(state);
+		struct svgtiny_geometry_shape *shape = svgtiny_add_shape(state);
 		if (!shape)
 			return svgtiny_OUT_OF_MEMORY;
 		char *text = malloc(20);
@@ -693,13 +693,13 @@ svgtiny_code svgtiny_add_path_linear_gradient(float *p, unsigned int n,
 				state->ctm.d * point->y + state->ctm.f;
 		shape->fill = svgtiny_RGB(0, 0, 0);
 		shape->stroke = svgtiny_TRANSPARENT;
-		state->diagram->shape_count++;
+		state->geometry->shape_count++;
 	}
 	#endif
 
 	/* plot actual path outline */
 	if (state->stroke != svgtiny_TRANSPARENT) {
-		struct svgtiny_shape *shape;
+		struct svgtiny_geometry_shape *shape;
 		svgtiny_transform_path(p, n, state);
 
 		shape = svgtiny_add_shape(state);
@@ -710,7 +710,7 @@ svgtiny_code svgtiny_add_path_linear_gradient(float *p, unsigned int n,
 		shape->path = p;
 		shape->path_length = n;
 		shape->fill = svgtiny_TRANSPARENT;
-		state->diagram->shape_count++;
+		state->geometry->shape_count++;
 	} else {
 		free(p);
 	}
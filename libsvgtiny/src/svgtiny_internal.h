@@ -34,8 +34,52 @@ struct svgtiny_parse_state_gradient {
 	} gradient_transform;
 };
 
+/**
+ * A shape in the user space of the root <svg> element.
+ */
+struct svgtiny_geometry_shape {
+	float *path;
+	unsigned int path_length;
+	char *text;
+	float text_x, text_y;
+	svgtiny_colour fill;
+	svgtiny_colour stroke;
+	int stroke_width;
+	/* horizontal and vertical scale of the ctm the stroke is drawn with */
+	float stroke_scale_x, stroke_scale_y;
+};
+
+/**
+ * The result of parsing a document, independent of the viewport.
+ *
+ * Shapes are held in the user space of the root <svg> element, so that
+ * laying the diagram out for another viewport only needs the mapping of
+ * the root viewBox onto the viewport applying to them.
+ */
+struct svgtiny_geometry {
+	struct svgtiny_geometry_shape *shape;
+	unsigned int shape_count;
+
+	/* result of parsing the document */
+	svgtiny_code code;
+	/* whether a root <svg> element was found */
+	bool parsed;
+
+	/* root width and height, in pixels or as a fraction of the viewport */
+	float width, height;
+	bool width_relative, height_relative;
+
+	/* size of the root viewBox, 0 if it has none */
+	float view_box_width, view_box_height;
+
+	/* document, kept only while the shapes depend on the viewport */
+	dom_document *document;
+	int viewport_width, viewport_height;
+};
+
 struct svgtiny_parse_state {
 	struct svgtiny_diagram *diagram;
+	struct svgtiny_geometry *geometry;
 	dom_document *document;
 
 	float viewport_width;
@@ -74,7 +118,8 @@ void svgtiny_parse_color(dom_string *s, svgtiny_colour *c,
 		struct svgtiny_parse_state *state);
 void svgtiny_parse_transform(char *s, float *ma, float *mb,
 		float *mc, float *md, float *me, float *mf);
-struct svgtiny_shape *svgtiny_add_shape(struct svgtiny_parse_state *state);
+struct svgtiny_geometry_shape *svgtiny_add_shape(
+		struct svgtiny_parse_state *state);
 void svgtiny_transform_path(float *p, unsigned int n,
 		struct svgtiny_parse_state *state);
 #if (defined(_GNU_SOURCE) && !defined(__APPLE__) || defined(__amigaos4__) || defined(__HAIKU__) || (defined(_POSIX_C_SOURCE) && ((_POSIX_C_SOURCE - 0) >= 200809L)))
@@ -86,6 +86,63 @@ static void write_mvg(FILE *fh, float scale, struct svgtiny_diagram *diagram)
         }
 }
 
+/**
+ * Check that laying a diagram out for a viewport gives the same shapes as
+ * parsing it for that viewport.
+ */
+static int check_layout(const char *buffer, size_t size, const char *url,
+                struct svgtiny_diagram *diagram)
+{
+        struct svgtiny_diagram *relaid;
+        unsigned int i, j;
+        int res = 0;
+
+        relaid = svgtiny_create();
+        if (!relaid) {
+                fprintf(stderr, "svgtiny_create failed\n");
+                return 1;
+        }
+
+        svgtiny_parse(relaid, buffer, size, url, 500, 700);
+        svgtiny_layout(relaid, 1000, 1000);
+
+        if (relaid->width != diagram->width ||
+            relaid->height != diagram->height ||
+            relaid->shape_count != diagram->shape_count) {
+                fprintf(stderr, "layout differs from parse\n");
+                res = 1;
+                goto out;
+        }
+
+        for (i = 0; i != diagram->shape_count; i++) {
+                struct svgtiny_shape *a = &relaid->shape[i];
+                struct svgtiny_shape *b = &diagram->shape[i];
+
+                if (a->path_length != b->path_length ||
+                    a->text_x != b->text_x ||
+                    a->text_y != b->text_y ||
+                    a->fill != b->fill ||
+                    a->stroke != b->stroke ||
+                    a->stroke_width != b->stroke_width) {
+                        res = 1;
+                }
+                for (j = 0; res == 0 && j != a->path_length; j++) {
+                        if (a->path[j] != b->path[j])
+                                res = 1;
+                }
+                if (res != 0) {
+                        fprintf(stderr, "layout differs from parse: "
+                                        "shape %u\n", i);
+                        break;
+                }
+        }
+
+out:
+        svgtiny_free(relaid);
+
+        return res;
+}
+
 int main(int argc, char *argv[])
 {
         FILE *fd;
@@ -97,6 +154,7 @@ int main(int argc, char *argv[])
         struct svgtiny_diagram *diagram;
         svgtiny_code code;
         FILE *outf = stdout;
+        int ret = 0;
 
         if (argc < 2 || argc > 4) {
                 fprintf(stderr, "Usage: %s FILE [SCALE] [out]\n", argv[0]);
@@ -180,6 +238,9 @@ int main(int argc, char *argv[])
                 fprintf(stderr, "\n");
         }
 
+        if (check_layout(buffer, size, argv[1], diagram) != 0)
+                ret = 1;
+
         free(buffer);
 
         write_mvg(outf, scale, diagram);
@@ -190,5 +251,5 @@ int main(int argc, char *argv[])
 
         svgtiny_free(diagram);
 
-        return 0;
+        return ret;
 }
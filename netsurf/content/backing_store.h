@@ -63,10 +63,11 @@ struct gui_llcache_table {
 	 * The object is placed in the persistent store and may be
 	 *  retrieved with the fetch method.
 	 *
-	 * The backing store will take a reference to the
+	 * On success the backing store will take a reference to the
 	 *  passed data, subsequently the caller should explicitly
 	 *  release the allocation using the release method and not
-	 *  free the data itself.
+	 *  free the data itself. On failure the caller retains
+	 *  ownership of the data.
 	 *
 	 * The caller may not assume that the persistent storage has
 	 *  been completely written on return.
@@ -75,7 +76,8 @@ struct gui_llcache_table {
 	 * @param[in] flags The flags to control how the object is stored.
 	 * @param[in] data The objects data.
 	 * @param[in] datalen The length of the \a data.
-	 * @return NSERROR_OK on success or error code on failure.
+	 * @return NSERROR_OK on success, NSERROR_NOSPACE if the store
+	 *         cannot currently accept more data or error code on failure.
 	 */
 	nserror (*store)(struct nsurl *url, enum backing_store_flags flags,
 			 uint8_t *data, const size_t datalen);
@@ -123,6 +125,18 @@ struct gui_llcache_table {
 
 };
 
+/**
+ * Report data written to persistent storage by the backing store.
+ *
+ * The backing store reports each write as it completes, with the time
+ * the write itself took, so the low level cache can tell whether
+ * persistent storage is fast enough to be useful.
+ *
+ * @param written The number of bytes written.
+ * @param elapsed The time in ms the write took.
+ */
+void llcache_store_written(size_t written, unsigned long elapsed);
+
 extern struct gui_llcache_table* null_llcache_table;
 extern struct gui_llcache_table* filesystem_llcache_table;
 
@@ -43,6 +43,18 @@
 
 #define URL_FMT_SPC "%.140s"
 
+/**
+ * Number of consecutive redraw requests a user may ignore before it is
+ * considered to no longer see the content.
+ */
+#define CONTENT_MISSED_REDRAW_LIMIT 2
+
+/**
+ * Smallest area, in pixels, a content must be redrawn at for the user to
+ * be considered to see it.
+ */
+#define CONTENT_VISIBLE_MIN_AREA 16
+
 const char * const content_status_name[] = {
 	"LOADING",
 	"READY",
@@ -128,17 +140,11 @@ content_llcache_callback(llcache_handle *llcache,
 		}
 		break;
 	case LLCACHE_EVENT_DONE:
-		{
-			size_t source_size;
-
-			(void) llcache_handle_get_source_data(llcache, &source_size);
-
-			content_set_status(c, messages_get("Processing"));
-			msg_data.explicit_status_text = NULL;
-			content_broadcast(c, CONTENT_MSG_STATUS, &msg_data);
+		content_set_status(c, messages_get("Processing"));
+		msg_data.explicit_status_text = NULL;
+		content_broadcast(c, CONTENT_MSG_STATUS, &msg_data);
 
-			content_convert(c);
-		}
+		content_convert(c);
 		break;
 	case LLCACHE_EVENT_ERROR:
 		/** \todo Error page? */
@@ -234,6 +240,7 @@ content__init(struct content *c,
 	c->user_list = user_sentinel;
 	c->sub_status[0] = 0;
 	c->locked = false;
+	c->visible = true;
 	c->total_size = 0;
 	c->http_code = 0;
 
@@ -553,6 +560,124 @@ bool content_saw_insecure_objects(struct hlcache_handle *h)
 }
 
 
+/**
+ * Update whether any user of a content is seeing it.
+ *
+ * The content handler is told when this changes.
+ *
+ * \param c The content
+ */
+static void content__update_visible(struct content *c)
+{
+	struct content_user *user;
+	bool visible = false;
+
+	if ((c->handler->set_visible == NULL) ||
+	    (c->user_list->next == NULL)) {
+		/* The handler does not care, or there is nobody to see
+		 * the content and the handler is told about the users
+		 * going instead. */
+		return;
+	}
+
+	for (user = c->user_list->next; user != NULL; user = user->next) {
+		if (user->missed_redraws < CONTENT_MISSED_REDRAW_LIMIT) {
+			visible = true;
+			break;
+		}
+	}
+
+	if (visible == c->visible) {
+		return;
+	}
+
+	NSLOG(netsurf, DEBUG, "content %p %s", c,
+	      visible ? "visible" : "hidden");
+
+	c->visible = visible;
+
+	if (c->handler->set_visible != NULL) {
+		c->handler->set_visible(c, visible);
+	}
+}
+
+
+/**
+ * Record that a user redrew a content.
+ *
+ * \param c The content
+ * \param h The high level cache handle the content was redrawn through
+ */
+static void content__user_redrawn(struct content *c, hlcache_handle *h)
+{
+	struct content_user *user;
+
+	/* Users added by the high level cache pass their handle as the
+	 * callback private data. */
+	for (user = c->user_list->next; user != NULL; user = user->next) {
+		if (user->pw == h) {
+			user->redrawn = true;
+			user->missed_redraws = 0;
+			break;
+		}
+	}
+
+	content__update_visible(c);
+}
+
+
+/**
+ * Ask the users of a content to redraw an area of it.
+ *
+ * Users which have not redrawn the content since the previous request
+ * are counted as having missed it. A user which missed a request is
+ * asked to redraw the whole content next, so that it is not considered
+ * to no longer see the content just because the changes were in a part
+ * of it which is out of view.
+ *
+ * \param c The content
+ * \param data The area to redraw
+ */
+static void
+content__broadcast_redraw(struct content *c,
+			  const union content_msg_data *data)
+{
+	struct content_user *user, *next;
+	union content_msg_data whole;
+
+	whole.redraw.x = 0;
+	whole.redraw.y = 0;
+	whole.redraw.width = c->width;
+	whole.redraw.height = c->height;
+
+	for (user = c->user_list->next; user != NULL; user = user->next) {
+		if (user->redrawn) {
+			user->missed_redraws = 0;
+		} else if (user->missed_redraws < CONTENT_MISSED_REDRAW_LIMIT) {
+			user->missed_redraws++;
+		}
+		user->redrawn = false;
+	}
+
+	content__update_visible(c);
+
+	for (user = c->user_list->next; user != NULL; user = next) {
+		next = user->next;  /* user may be destroyed during callback */
+		if (user->callback == NULL) {
+			continue;
+		}
+
+		if (user->missed_redraws == CONTENT_MISSED_REDRAW_LIMIT - 1) {
+			user->callback(c, CONTENT_MSG_REDRAW, &whole,
+				       user->pw);
+		} else {
+			user->callback(c, CONTENT_MSG_REDRAW, data,
+				       user->pw);
+		}
+	}
+}
+
+
 /* exported interface, documented in content/content.h */
 bool
 content_redraw(hlcache_handle *h,
@@ -574,6 +699,14 @@ content_redraw(hlcache_handle *h,
 		return true;
 	}
 
+	/* a content plotted at only a few pixels is not really seen */
+	if ((c->handler->set_visible != NULL) && ctx->interactive &&
+	    (data->width > 0) && (data->height > 0) &&
+	    ((unsigned long) data->width * data->height >=
+	     CONTENT_VISIBLE_MIN_AREA)) {
+		content__user_redrawn(c, h);
+	}
+
 	return c->handler->redraw(c, data, clip, ctx);
 }
 
@@ -669,12 +802,16 @@ content_add_user(struct content *c,
 		return false;
 	user->callback = callback;
 	user->pw = pw;
+	user->redrawn = false;
+	user->missed_redraws = 0;
 	user->next = c->user_list->next;
 	c->user_list->next = user;
 
 	if (c->handler->add_user != NULL)
 		c->handler->add_user(c);
 
+	content__update_visible(c);
+
 	return true;
 }
 
@@ -711,6 +848,8 @@ content_remove_user(struct content *c,
 	next = user->next;
 	user->next = next->next;
 	free(next);
+
+	content__update_visible(c);
 }
 
 
@@ -731,6 +870,13 @@ uint32_t content_count_users(struct content *c)
 }
 
 
+/* exported interface documented in content/content_protected.h */
+bool content_is_visible(struct content *c)
+{
+	return c->visible;
+}
+
+
 /* exported interface documented in content/content.h */
 bool content_matches_quirks(struct content *c, bool quirks)
 {
@@ -756,6 +902,12 @@ void content_broadcast(struct content *c, content_msg msg,
 	assert(c);
 
 	NSLOG(netsurf, DEEPDEBUG, "%p -> msg:%d", c, msg);
+
+	if ((msg == CONTENT_MSG_REDRAW) && (c->handler->set_visible != NULL)) {
+		content__broadcast_redraw(c, data);
+		return;
+	}
+
 	for (user = c->user_list->next; user != 0; user = next) {
 		next = user->next;  /* user may be destroyed during callback */
 		if (user->callback != 0)
@@ -1225,6 +1377,21 @@ const uint8_t *content__get_source_data(struct content *c, size_t *size)
 }
 
 
+/* exported interface documented in content/content_protected.h */
+const uint8_t *
+content__read_source_data(struct content *c, size_t offset, size_t *len)
+{
+	assert(len != NULL);
+
+	if (c == NULL) {
+		*len = 0;
+		return NULL;
+	}
+
+	return llcache_handle_read_source_data(c->llcache, offset, len);
+}
+
+
 /* exported interface documented in content/content.h */
 void content_invalidate_reuse_data(hlcache_handle *h)
 {
@@ -1437,6 +1604,7 @@ nserror content__clone(const struct content *c, struct content *nc)
 	memcpy(&(nc->sub_status), &(c->sub_status), 80);
 
 	nc->locked = c->locked;
+	nc->visible = true;
 	nc->total_size = c->total_size;
 	nc->http_code = c->http_code;
 
@@ -153,6 +153,20 @@ struct content_handler {
 	 */
 	bool (*is_opaque)(struct content *c);
 
+	/**
+	 * The content has become visible to, or hidden from, all its users.
+	 *
+	 * A user sees the content while it redraws it when asked to. The
+	 * content is hidden once no user does, for example because it has
+	 * been scrolled out of view, is in a window which is not shown or
+	 * is plotted at only a few pixels. Contents which animate should
+	 * stop doing work while hidden.
+	 *
+	 * \param c The content
+	 * \param visible true if a user now sees the content, else false
+	 */
+	void (*set_visible)(struct content *c, bool visible);
+
 	/**
 	 * There must be one content per user for this type.
 	 */
@@ -171,6 +185,11 @@ struct content_user
 			void *pw);
 	void *pw;
 
+	/** The user redrew the content since it was last asked to */
+	bool redrawn;
+	/** Number of consecutive redraw requests the user ignored */
+	unsigned int missed_redraws;
+
 	struct content_user *next;
 };
 
@@ -275,6 +294,10 @@ struct content {
 	 * inconsistent and content must not be redrawn or modified.
 	 */
 	bool locked;
+	/**
+	 * At least one user is seeing the content.
+	 */
+	bool visible;
 
 	/**
 	 * Total data size, 0 if unknown.
@@ -468,6 +491,20 @@ int content__get_available_width(struct content *c);
  */
 const uint8_t *content__get_source_data(struct content *c, size_t *size);
 
+/**
+ * Read a run of content source in place.
+ *
+ * Allows handlers which process source incrementally to avoid the
+ * source being made contiguous.
+ *
+ * \param c      Content to read source of.
+ * \param offset Byte offset within the source to read from.
+ * \param len    Pointer to location to receive byte size of the run.
+ * \return Pointer to source data at offset or NULL at end of source.
+ */
+const uint8_t *content__read_source_data(struct content *c, size_t offset,
+		size_t *len);
+
 /**
  * Invalidate content reuse data.
  *
@@ -574,6 +611,15 @@ void content_remove_user(struct content *c,
 uint32_t content_count_users(struct content *c);
 
 
+/**
+ * Determine if any user of a content is seeing it.
+ *
+ * \param c Content to consider
+ * \return true if the content is visible to a user, else false
+ */
+bool content_is_visible(struct content *c);
+
+
 /**
  * Determine if quirks mode matches
  *
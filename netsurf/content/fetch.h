@@ -42,6 +42,7 @@ typedef enum {
 	FETCH_CERTS,
 	FETCH_HEADER,
 	FETCH_DATA,
+	FETCH_DATA_ADOPT, /**< FETCH_DATA with ownership of a malloc()ed buf */
 	/* Anything after here is a completed fetch of some kind. */
 	FETCH_FINISHED,
 	FETCH_TIMEDOUT,
@@ -146,7 +147,9 @@ typedef void (*fetch_callback)(const fetch_msg *msg, void *p);
  * interesting happens. The callback function is first called with msg
  * FETCH_HEADER, with the header in data, then one or more times
  * with FETCH_DATA with some data for the url, and finally with
- * FETCH_FINISHED. Alternatively, FETCH_ERROR indicates an error occurred:
+ * FETCH_FINISHED. FETCH_DATA_ADOPT may be sent instead of FETCH_DATA
+ * to pass ownership of a buffer allocated with malloc() to the callback,
+ * which frees it whatever happens. Alternatively, FETCH_ERROR indicates an error occurred:
  * data contains an error message. FETCH_REDIRECT may replace the FETCH_HEADER,
  * FETCH_DATA, FETCH_FINISHED sequence if the server sends a replacement URL.
  *
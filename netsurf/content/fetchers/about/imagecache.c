@@ -65,7 +65,8 @@ bool fetch_about_imagecache_handler(struct fetch_about_context *ctx)
 	/* image cache summary */
 	slen = image_cache_snsummaryf(buffer, sizeof(buffer),
 		"<p>Configured limit of %a hysteresis of %b</p>\n"
-		"<p>Total bitmap size in use %c (in %d)</p>\n"
+		"<p>Total bitmap size in use %c (in %d), "
+				"%y at four bytes per pixel</p>\n"
 		"<p>Age %es</p>\n"
 		"<p>Peak size %f (in %g)</p>\n"
 		"<p>Peak image count %h (size %i)</p>\n"
@@ -93,6 +94,8 @@ bool fetch_about_imagecache_handler(struct fetch_about_context *ctx)
 				"(from %v images converted more than once)"
 				"</p>\n"
 		"<p>Bitmap of size %w had most (%x) conversions</p>\n"
+		"<p>Scaled bitmap cache hit/miss %A/%B (%pA%%/%pB%%), "
+				"%C bitmaps of size %D with limit %E</p>\n"
 		"<h2 class=\"ns-border\">Current contents</h2>\n");
 	if (slen >= (int) (sizeof(buffer))) {
 		goto fetch_about_imagecache_handler_aborted; /* overflow */
@@ -357,6 +357,7 @@ fetch_file_process_aborted:
 	fetch_msg msg;
 	char *buf;
 	size_t buf_size;
+	bool adopt;
 
 	ssize_t tot_read = 0;
 	ssize_t res;
@@ -381,13 +382,18 @@ fetch_file_process_aborted:
 		return;
 	}
 
-	/* set buffer size */
+	/* Read the whole file into a buffer which is handed over to the
+	 * cache, so the data is not copied again. If that much memory is
+	 * not available in one piece, fall back to sending the file a
+	 * buffer at a time for the cache to copy.
+	 */
 	buf_size = fdstat->st_size;
-	if (buf_size > FETCH_FILE_MAX_BUF_SIZE)
-		buf_size = FETCH_FILE_MAX_BUF_SIZE;
-
-	/* allocate the buffer storage */
 	buf = malloc(buf_size);
+	adopt = (buf != NULL);
+	if (buf == NULL && buf_size > FETCH_FILE_MAX_BUF_SIZE) {
+		buf_size = FETCH_FILE_MAX_BUF_SIZE;
+		buf = malloc(buf_size);
+	}
 	if (buf == NULL) {
 		msg.type = FETCH_ERROR;
 		msg.data.error =
@@ -427,7 +433,12 @@ fetch_file_process_aborted:
 
 	/* main data loop */
 	while (tot_read < fdstat->st_size) {
-		res = fread(buf, 1, buf_size, infile);
+		if (adopt) {
+			res = fread(buf + tot_read, 1,
+				    buf_size - tot_read, infile);
+		} else {
+			res = fread(buf, 1, buf_size, infile);
+		}
 		if (res == 0) {
 			if (feof(infile)) {
 				msg.type = FETCH_ERROR;
@@ -443,6 +454,9 @@ fetch_file_process_aborted:
 		}
 		tot_read += res;
 
+		if (adopt)
+			continue;
+
 		msg.type = FETCH_DATA;
 		msg.data.header_or_data.buf = (const uint8_t *) buf;
 		msg.data.header_or_data.len = res;
@@ -450,6 +464,16 @@ fetch_file_process_aborted:
 			break;
 	}
 
+	if (adopt && tot_read > 0) {
+		msg.type = FETCH_DATA_ADOPT;
+		msg.data.header_or_data.buf = (const uint8_t *) buf;
+		msg.data.header_or_data.len = tot_read;
+		/* the buffer belongs to the callback now */
+		buf = NULL;
+		if (fetch_file_send_callback(&msg, ctx))
+			goto fetch_file_process_aborted;
+	}
+
 	if (ctx->aborted == false) {
 		msg.type = FETCH_FINISHED;
 		fetch_file_send_callback(&msg, ctx);
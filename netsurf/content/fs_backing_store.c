@@ -27,6 +27,11 @@
  *
  * \todo Implement mmap retrieval where supported.
  *
+ * Where threads are available writes and file removals are performed
+ *  by a dedicated I/O thread. Requests are queued by the browser thread
+ *  and their completions are processed from a scheduled callback so the
+ *  store entries are only ever manipulated by the browser thread.
+ *
  * \todo Implement static retrieval for metadata objects as their heap
  *         lifetime is typically very short, though this may be obsoleted
  *         by a small object storage strategy.
@@ -42,6 +47,13 @@
 #include <time.h>
 #include <stdlib.h>
 #include <nsutils/unistd.h>
+#include <nsutils/time.h>
+
+#include "utils/config.h"
+
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#endif
 
 #include "netsurf/inttypes.h"
 #include "utils/filepath.h"
@@ -64,6 +76,17 @@
  */
 #define CONTROL_MAINT_TIME 10000
 
+/**
+ * Number of milliseconds between checks for completed I/O requests
+ */
+#define IO_COMPLETE_TIME 50
+
+/**
+ * Upper bound on the amount of object data queued for writing before
+ * the store refuses further objects.
+ */
+#define IO_QUEUE_LIMIT (4 * 1024 * 1024)
+
 /** Filename of serialised entries */
 #define ENTRIES_FNAME "entries"
 
@@ -191,6 +214,58 @@ static const unsigned int log2_block_size[ENTRY_ELEM_COUNT] = {
 	BLOCK_META_SIZE  /**< Metadata block size */
 };
 
+/**
+ * Operations performed by the I/O thread.
+ */
+enum store_io_op {
+	STORE_IO_WRITE_BLOCK, /**< write element data into a block file */
+	STORE_IO_WRITE_FILE, /**< write element data to an individual file */
+	STORE_IO_UNLINK, /**< remove an individual file */
+};
+
+/**
+ * Request for the I/O thread.
+ *
+ * Everything the operation needs is copied into the request when it is
+ * queued so the I/O thread never has to look at the store entries.
+ */
+struct store_io_request {
+	struct store_io_request *next; /**< next request in queue */
+	enum store_io_op op; /**< operation to perform */
+	nsurl *url; /**< url of the entry being written */
+	int elem_idx; /**< element index being written */
+	int fd; /**< block file descriptor for block writes */
+	off_t offset; /**< offset within block file */
+	char *fname; /**< filename for file writes and removal */
+	const uint8_t *data; /**< data to write */
+	size_t size; /**< size of data to write */
+	ssize_t written; /**< amount of data written */
+	uint64_t elapsed; /**< time in ms the operation took */
+	int err; /**< errno from failed operation */
+	nserror result; /**< result of operation */
+};
+
+/**
+ * I/O thread request queue.
+ */
+struct store_io_queue {
+	/** number of requests queued whose completion has not been run */
+	unsigned int outstanding;
+	/** size of data queued for writing whose completion has not been run */
+	size_t queued_size;
+#ifdef HAVE_PTHREADS
+	bool running; /**< the I/O thread has been started */
+	pthread_t thread; /**< the I/O thread */
+	pthread_mutex_t lock; /**< protects the request lists and quit flag */
+	pthread_cond_t cond; /**< signalled when a request is queued */
+	bool quit; /**< I/O thread should exit once queue is empty */
+	struct store_io_request *pending; /**< requests awaiting the thread */
+	struct store_io_request **pending_tail; /**< end of pending list */
+	struct store_io_request *complete; /**< requests awaiting completion */
+	struct store_io_request **complete_tail; /**< end of complete list */
+#endif
+};
+
 /**
  * Parameters controlling the backing store.
  */
@@ -223,6 +298,8 @@ struct store_state {
 	 */
 	bool blocks_opened;
 
+	/** requests for the I/O thread */
+	struct store_io_queue io;
 
 	/* stats */
 	uint64_t total_alloc; /**< total size of all allocated storage. */
@@ -406,6 +483,9 @@ store_fname(struct store_state *state,
 	return fname;
 }
 
+static nserror
+store_io_submit(struct store_state *state, struct store_io_request *req);
+
 /**
  * invalidate an element of an entry
  *
@@ -433,15 +513,20 @@ invalidate_element(struct store_state *state,
 		/* clear bit in use map */
 		state->blocks[elem_idx][bf].use_map[bi >> 3] &= ~(1U << (bi & 7));
 	} else {
-		char *fname;
+		struct store_io_request *req;
 
 		/* unlink the file from disc */
-		fname = store_fname(state, nsurl_hash(bse->url), elem_idx);
-		if (fname == NULL) {
+		req = calloc(1, sizeof(struct store_io_request));
+		if (req == NULL) {
 			return NSERROR_NOMEM;
 		}
-		unlink(fname);
-		free(fname);
+		req->op = STORE_IO_UNLINK;
+		req->fname = store_fname(state, nsurl_hash(bse->url), elem_idx);
+		if (req->fname == NULL) {
+			free(req);
+			return NSERROR_NOMEM;
+		}
+		store_io_submit(state, req);
 	}
 
 	state->total_alloc -= bse->elem[elem_idx].size;
@@ -884,6 +969,14 @@ static void control_maintenance(void *s)
 {
 	struct store_state *state = s;
 
+	/* do not write control data that refers to data which is not
+	 * yet on disc.
+	 */
+	if (state->io.outstanding > 0) {
+		guit->misc->schedule(CONTROL_MAINT_TIME, control_maintenance, state);
+		return;
+	}
+
 	write_entries(state);
 	write_blocks(state);
 	set_block_extents(state);
@@ -1408,6 +1501,351 @@ control_error: /* problem with the control file */
 
 
 
+/**
+ * release any allocation for an entry
+ */
+static nserror entry_release_alloc(struct store_entry_element *elem)
+{
+	if ((elem->flags & ENTRY_ELEM_FLAG_HEAP) != 0) {
+		elem->ref--;
+		if (elem->ref == 0) {
+			NSLOG(netsurf, DEEPDEBUG, "freeing %p", elem->data);
+			free(elem->data);
+			elem->flags &= ~ENTRY_ELEM_FLAG_HEAP;
+		}
+	}
+	return NSERROR_OK;
+}
+
+
+/**
+ * Perform an I/O request.
+ *
+ * This is called from the I/O thread (or directly when there is no
+ * I/O thread) and must only use the contents of the request.
+ *
+ * \param req The request to perform.
+ */
+static void store_io_perform(struct store_io_request *req)
+{
+	uint64_t startms = 0;
+	uint64_t endms = 0;
+	int fd;
+
+	nsu_getmonotonic_ms(&startms);
+
+	switch (req->op) {
+	case STORE_IO_WRITE_BLOCK:
+		req->written = nsu_pwrite(req->fd, req->data, req->size,
+					  req->offset);
+		req->err = errno;
+		break;
+
+	case STORE_IO_WRITE_FILE:
+		/* ensure all path elements to file exist */
+		if (netsurf_mkdir_all(req->fname) != NSERROR_OK) {
+			req->written = -1;
+			req->err = errno;
+			break;
+		}
+
+		fd = open(req->fname, O_CREAT | O_WRONLY, S_IRUSR | S_IWUSR);
+		if (fd < 0) {
+			req->written = -1;
+			req->err = errno;
+			break;
+		}
+
+		req->written = write(fd, req->data, req->size);
+		req->err = errno; /* close can change errno */
+
+		close(fd);
+		break;
+
+	case STORE_IO_UNLINK:
+		unlink(req->fname);
+		req->written = 0;
+		break;
+	}
+
+	nsu_getmonotonic_ms(&endms);
+	req->elapsed = endms - startms;
+
+	if (req->written != (ssize_t)req->size) {
+		req->result = NSERROR_SAVE_FAILED;
+	} else {
+		req->result = NSERROR_OK;
+	}
+}
+
+/**
+ * Finish a performed I/O request.
+ *
+ * Drops the reference the request held on the element data and
+ * invalidates the entry if the write failed or the entry was
+ * invalidated while the write was in progress.
+ *
+ * \param state The backing store state to use.
+ * \param req The request to finish, it is freed.
+ */
+static void
+store_io_finish(struct store_state *state, struct store_io_request *req)
+{
+	struct store_entry *bse;
+
+	if (req->op == STORE_IO_UNLINK) {
+		free(req->fname);
+		free(req);
+		return;
+	}
+
+	if (req->result != NSERROR_OK) {
+		NSLOG(netsurf, ERROR,
+		      "Write failed %"PRIssizet" of %"PRIsizet" bytes from %p at %"PRIsizet" errno %d",
+		      req->written,
+		      req->size,
+		      req->data,
+		      (size_t)req->offset,
+		      req->err);
+	} else {
+		NSLOG(netsurf, VERBOSE,
+		      "Wrote %"PRIssizet" bytes from %p at %"PRIsizet" in %"PRIu64"ms",
+		      req->written, req->data, (size_t)req->offset,
+		      req->elapsed);
+
+		llcache_store_written(req->written, req->elapsed);
+	}
+
+	bse = hashmap_lookup(state->entries, req->url);
+	if (bse != NULL) {
+		entry_release_alloc(&bse->elem[req->elem_idx]);
+
+		if ((req->result != NSERROR_OK) ||
+		    ((bse->flags & ENTRY_FLAGS_INVALID) != 0)) {
+			invalidate_entry(state, bse);
+		}
+	}
+
+	nsurl_unref(req->url);
+	free(req->fname);
+	free(req);
+}
+
+/**
+ * Create a request to write an element of an entry.
+ *
+ * The request holds a reference to the element data until it is
+ * finished.
+ *
+ * \param bse The entry to write.
+ * \param elem_idx The element index within the entry.
+ * \param op The write operation.
+ * \return The new request or NULL on allocation error.
+ */
+static struct store_io_request *
+store_io_write_request(struct store_entry *bse, int elem_idx, enum store_io_op op)
+{
+	struct store_io_request *req;
+
+	req = calloc(1, sizeof(struct store_io_request));
+	if (req == NULL) {
+		return NULL;
+	}
+
+	req->op = op;
+	req->url = nsurl_ref(bse->url);
+	req->elem_idx = elem_idx;
+	req->data = bse->elem[elem_idx].data;
+	req->size = bse->elem[elem_idx].size;
+
+	bse->elem[elem_idx].ref++;
+
+	return req;
+}
+
+#ifdef HAVE_PTHREADS
+
+/**
+ * I/O thread.
+ *
+ * Performs queued requests in order and moves them to the complete
+ * list. Exits once asked to quit and the queue is empty.
+ *
+ * \param p The I/O queue.
+ * \return NULL
+ */
+static void *store_io_thread(void *p)
+{
+	struct store_io_queue *io = p;
+	struct store_io_request *req;
+
+	pthread_mutex_lock(&io->lock);
+	for (;;) {
+		while ((io->pending == NULL) && (io->quit == false)) {
+			pthread_cond_wait(&io->cond, &io->lock);
+		}
+
+		req = io->pending;
+		if (req == NULL) {
+			break;
+		}
+		io->pending = req->next;
+		if (io->pending == NULL) {
+			io->pending_tail = &io->pending;
+		}
+		pthread_mutex_unlock(&io->lock);
+
+		store_io_perform(req);
+
+		pthread_mutex_lock(&io->lock);
+		req->next = NULL;
+		*io->complete_tail = req;
+		io->complete_tail = &req->next;
+	}
+	pthread_mutex_unlock(&io->lock);
+
+	return NULL;
+}
+
+/**
+ * Process completed I/O requests.
+ *
+ * Scheduled callback run while requests are outstanding.
+ *
+ * \param p The backing store state.
+ */
+static void store_io_complete(void *p)
+{
+	struct store_state *state = p;
+	struct store_io_request *req;
+	struct store_io_request *next;
+
+	pthread_mutex_lock(&state->io.lock);
+	req = state->io.complete;
+	state->io.complete = NULL;
+	state->io.complete_tail = &state->io.complete;
+	pthread_mutex_unlock(&state->io.lock);
+
+	while (req != NULL) {
+		next = req->next;
+		state->io.outstanding--;
+		state->io.queued_size -= req->size;
+		store_io_finish(state, req);
+		req = next;
+	}
+
+	if (state->io.outstanding > 0) {
+		guit->misc->schedule(IO_COMPLETE_TIME, store_io_complete, state);
+	}
+}
+
+#endif
+
+/**
+ * Submit an I/O request.
+ *
+ * The request is queued for the I/O thread if it is running otherwise
+ * it is performed immediately.
+ *
+ * \param state The backing store state to use.
+ * \param req The request to submit, ownership passes to the I/O queue.
+ * \return NSERROR_OK on success or error code if a synchronous request failed.
+ */
+static nserror
+store_io_submit(struct store_state *state, struct store_io_request *req)
+{
+	nserror ret;
+
+#ifdef HAVE_PTHREADS
+	if (state->io.running) {
+		pthread_mutex_lock(&state->io.lock);
+		*state->io.pending_tail = req;
+		state->io.pending_tail = &req->next;
+		pthread_cond_signal(&state->io.cond);
+		pthread_mutex_unlock(&state->io.lock);
+
+		if (state->io.outstanding == 0) {
+			guit->misc->schedule(IO_COMPLETE_TIME,
+					     store_io_complete,
+					     state);
+		}
+		state->io.outstanding++;
+		state->io.queued_size += req->size;
+
+		return NSERROR_OK;
+	}
+#endif
+
+	store_io_perform(req);
+	ret = req->result;
+	store_io_finish(state, req);
+
+	return ret;
+}
+
+/**
+ * Start the I/O thread.
+ *
+ * If the thread cannot be started requests are performed synchronously.
+ *
+ * \param state The backing store state to use.
+ */
+static void store_io_init(struct store_state *state)
+{
+#ifdef HAVE_PTHREADS
+	state->io.pending_tail = &state->io.pending;
+	state->io.complete_tail = &state->io.complete;
+
+	if (pthread_mutex_init(&state->io.lock, NULL) != 0) {
+		return;
+	}
+	if (pthread_cond_init(&state->io.cond, NULL) != 0) {
+		pthread_mutex_destroy(&state->io.lock);
+		return;
+	}
+	if (pthread_create(&state->io.thread, NULL,
+			   store_io_thread, &state->io) != 0) {
+		NSLOG(netsurf, WARNING,
+		      "Unable to start I/O thread, storing synchronously");
+		pthread_cond_destroy(&state->io.cond);
+		pthread_mutex_destroy(&state->io.lock);
+		return;
+	}
+
+	state->io.running = true;
+#endif
+}
+
+/**
+ * Stop the I/O thread.
+ *
+ * All queued requests are performed and finished before returning.
+ *
+ * \param state The backing store state to use.
+ */
+static void store_io_finalise(struct store_state *state)
+{
+#ifdef HAVE_PTHREADS
+	if (state->io.running == false) {
+		return;
+	}
+
+	pthread_mutex_lock(&state->io.lock);
+	state->io.quit = true;
+	pthread_cond_signal(&state->io.cond);
+	pthread_mutex_unlock(&state->io.lock);
+
+	pthread_join(state->io.thread, NULL);
+	state->io.running = false;
+
+	guit->misc->schedule(-1, store_io_complete, state);
+	store_io_complete(state);
+
+	pthread_cond_destroy(&state->io.cond);
+	pthread_mutex_destroy(&state->io.lock);
+#endif
+}
+
 /* Functions exported in the backing store table */
 
 /**
@@ -1498,6 +1936,8 @@ initialise(const struct llcache_store_parameters *parameters)
 		return ret;
 	}
 
+	store_io_init(newstate);
+
 	storestate = newstate;
 
 	NSLOG(netsurf, INFO, "FS backing store init successful");
@@ -1530,6 +1970,7 @@ finalise(void)
 
 	if (storestate != NULL) {
 		guit->misc->schedule(-1, control_maintenance, storestate);
+		store_io_finalise(storestate);
 		write_entries(storestate);
 		write_blocks(storestate);
 
@@ -1570,6 +2011,9 @@ finalise(void)
 /**
  * Write an element of an entry to backing storage in a small block file.
  *
+ * The block file is opened if necessary and the write is submitted
+ * to the I/O queue.
+ *
  * \param state The backing store state to use.
  * \param bse The entry to store
  * \param elem_idx The element index within the entry.
@@ -1582,8 +2026,7 @@ static nserror store_write_block(struct store_state *state,
 	block_index_t bf = (bse->elem[elem_idx].block >> BLOCK_ENTRY_COUNT) &
 		((1 << BLOCK_FILE_COUNT) - 1); /* block file block resides in */
 	block_index_t bi = bse->elem[elem_idx].block & ((1U << BLOCK_ENTRY_COUNT) -1); /* block index in file */
-	ssize_t wr;
-	off_t offst;
+	struct store_io_request *req;
 
 	/* ensure the block file fd is good */
 	if (state->blocks[elem_idx][bf].fd == -1) {
@@ -1598,35 +2041,21 @@ static nserror store_write_block(struct store_state *state,
 		state->blocks_opened = true;
 	}
 
-	offst = (unsigned int)bi << log2_block_size[elem_idx];
-
-	wr = nsu_pwrite(state->blocks[elem_idx][bf].fd,
-			bse->elem[elem_idx].data,
-			bse->elem[elem_idx].size,
-			offst);
-	if (wr != (ssize_t)bse->elem[elem_idx].size) {
-		NSLOG(netsurf, ERROR,
-		      "Write failed %"PRIssizet" of %"PRId32" bytes from %p at %"PRIsizet" block %"PRIu16" errno %d",
-		      wr,
-		      bse->elem[elem_idx].size,
-		      bse->elem[elem_idx].data,
-		      (size_t)offst,
-		      bse->elem[elem_idx].block,
-		      errno);
-		return NSERROR_SAVE_FAILED;
+	req = store_io_write_request(bse, elem_idx, STORE_IO_WRITE_BLOCK);
+	if (req == NULL) {
+		return NSERROR_NOMEM;
 	}
+	req->fd = state->blocks[elem_idx][bf].fd;
+	req->offset = (unsigned int)bi << log2_block_size[elem_idx];
 
-	NSLOG(netsurf, INFO,
-	      "Wrote %"PRIssizet" bytes from %p at %"PRIsizet" block %d", wr,
-	      bse->elem[elem_idx].data, (size_t)offst,
-	      bse->elem[elem_idx].block);
-
-	return NSERROR_OK;
+	return store_io_submit(state, req);
 }
 
 /**
  * Write an element of an entry to backing storage as an individual file.
  *
+ * The write is submitted to the I/O queue.
+ *
  * \param state The backing store state to use.
  * \param bse The entry to store
  * \param elem_idx The element index within the entry.
@@ -1636,49 +2065,36 @@ static nserror store_write_file(struct store_state *state,
 			 struct store_entry *bse,
 			 int elem_idx)
 {
-	ssize_t wr;
-	int fd;
-	int err;
+	struct store_io_request *req;
+	char *fname;
 
-	fd = store_open(state, nsurl_hash(bse->url), elem_idx, O_CREAT | O_WRONLY);
-	if (fd < 0) {
-		perror("");
-		NSLOG(netsurf, ERROR, "Open failed %d errno %d", fd, errno);
-		return NSERROR_SAVE_FAILED;
+	fname = store_fname(state, nsurl_hash(bse->url), elem_idx);
+	if (fname == NULL) {
+		NSLOG(netsurf, ERROR, "filename error");
+		return NSERROR_NOMEM;
 	}
 
-	wr = write(fd, bse->elem[elem_idx].data, bse->elem[elem_idx].size);
-	err = errno; /* close can change errno */
-
-	close(fd);
-	if (wr != (ssize_t)bse->elem[elem_idx].size) {
-		NSLOG(netsurf, ERROR,
-		      "Write failed %"PRIssizet" of %"PRId32" bytes from %p errno %d",
-		      wr,
-		      bse->elem[elem_idx].size,
-		      bse->elem[elem_idx].data,
-		      err);
-
-		/** @todo Delete the file? */
-		return NSERROR_SAVE_FAILED;
+	req = store_io_write_request(bse, elem_idx, STORE_IO_WRITE_FILE);
+	if (req == NULL) {
+		free(fname);
+		return NSERROR_NOMEM;
 	}
+	req->fname = fname;
 
-	NSLOG(netsurf, VERBOSE, "Wrote %"PRIssizet" bytes from %p", wr,
-	      bse->elem[elem_idx].data);
-
-	return NSERROR_OK;
+	return store_io_submit(state, req);
 }
 
 /**
  * Place an object in the backing store.
  *
- * takes ownership of the heap block passed in.
+ * takes ownership of the heap block passed in on success.
  *
  * @param url The url is used as the unique primary key for the data.
  * @param bsflags The flags to control how the object is stored.
  * @param data The objects source data.
  * @param datalen The length of the \a data.
- * @return NSERROR_OK on success or error code on failure.
+ * @return NSERROR_OK on success, NSERROR_NOSPACE if too much data is
+ *         waiting to be written or error code on failure.
  */
 static nserror
 store(nsurl *url,
@@ -1700,6 +2116,14 @@ store(nsurl *url,
 		elem_idx = ENTRY_ELEM_META;
 	} else {
 		elem_idx = ENTRY_ELEM_DATA;
+
+		/* refuse object data while too much is waiting to
+		 * be written. Metadata is always accepted so stored
+		 * data is never left without it.
+		 */
+		if (storestate->io.queued_size >= IO_QUEUE_LIMIT) {
+			return NSERROR_NOSPACE;
+		}
 	}
 
 	/* set the store entry up */
@@ -1717,25 +2141,19 @@ store(nsurl *url,
 		ret = store_write_file(storestate, bse, elem_idx);
 	}
 
-	return ret;
-}
-
-/**
- * release any allocation for an entry
- */
-static nserror entry_release_alloc(struct store_entry_element *elem)
-{
-	if ((elem->flags & ENTRY_ELEM_FLAG_HEAP) != 0) {
-		elem->ref--;
-		if (elem->ref == 0) {
-			NSLOG(netsurf, DEEPDEBUG, "freeing %p", elem->data);
-			free(elem->data);
-			elem->flags &= ~ENTRY_ELEM_FLAG_HEAP;
-		}
+	if (ret != NSERROR_OK) {
+		/* the caller keeps ownership of the data on failure so
+		 * drop the element's reference without freeing it and
+		 * discard the entry.
+		 */
+		bse->elem[elem_idx].flags &= ~ENTRY_ELEM_FLAG_HEAP;
+		bse->elem[elem_idx].data = NULL;
+		bse->elem[elem_idx].ref = 0;
+		invalidate_entry(storestate, bse);
 	}
-	return NSERROR_OK;
-}
 
+	return ret;
+}
 
 /**
  * Read an element of an entry from a small block file in the backing storage.
@@ -18,6 +18,7 @@
 
 #include <string.h>
 #include <assert.h>
+#include <inttypes.h>
 #include <libwapcaplet/libwapcaplet.h>
 #include <dom/dom.h>
 
@@ -27,10 +28,12 @@
 #include "utils/http.h"
 #include "utils/log.h"
 #include "utils/messages.h"
+#include "utils/nsoption.h"
 #include "content/content_protected.h"
 #include "content/content_factory.h"
 #include "content/fetch.h"
 #include "content/hlcache.h"
+#include "content/llcache.h"
 #include "desktop/system_colour.h"
 
 #include "css/css.h"
@@ -40,6 +43,12 @@
 /* Define to trace import fetches */
 #undef NSCSS_IMPORT_TRACE
 
+/**
+ * Minimum source size, in bytes, of stylesheets kept compiled in the
+ * backing store. Smaller sheets are quicker to parse than to retrieve.
+ */
+#define NSCSS_COMPILED_MIN_SIZE 1024
+
 /** Screen DPI in fixed point units: defaults to 90, which RISC OS uses */
 css_fixed nscss_screen_dpi = F_90;
 
@@ -75,8 +84,24 @@ typedef struct nscss_content
 	struct content base;		/**< Underlying content object */
 
 	struct content_css_data data;	/**< CSS data */
+
+	nsurl *compiled_key;		/**< Key of compiled stylesheet */
+	const uint8_t *compiled;	/**< Compiled stylesheet, or NULL */
+	size_t compiled_size;		/**< Byte length of compiled */
+	bool streamed;			/**< Source parsed as it arrived */
 } nscss_content;
 
+/**
+ * Header of a compiled stylesheet in the backing store
+ *
+ * Identifies the source the stylesheet was compiled from, so a compiled
+ * copy of a sheet whose source has since changed is not used.
+ */
+struct nscss_compiled_header {
+	uint64_t source_hash;		/**< FNV-1a hash of source */
+	uint64_t source_len;		/**< Byte length of source */
+};
+
 /**
  * Context for import fetches
  */
@@ -97,7 +122,11 @@ static nserror nscss_create_css_data(struct content_css_data *c,
 		nscss_done_callback done, void *pw);
 static css_error nscss_process_css_data(struct content_css_data *c, const char *data,
 		unsigned int size);
-static css_error nscss_convert_css_data(struct content_css_data *c);
+static css_error nscss_compile(nscss_content *css);
+static void nscss_compiled_fetch(nscss_content *css);
+static void nscss_compiled_release(nscss_content *css);
+static css_error nscss_convert_css_data(struct content_css_data *c,
+		css_error error);
 static void nscss_destroy_css_data(struct content_css_data *c);
 
 static void nscss_content_done(struct content_css_data *css, void *pw);
@@ -184,6 +213,9 @@ nscss_create(const content_handler *handler,
 	if (charset_value != NULL)
 		lwc_string_unref(charset_value);
 
+	/* Only wait for the whole source if it need not be parsed */
+	nscss_compiled_fetch(result);
+
 	*c = (struct content *) result;
 
 	return NSERROR_OK;
@@ -244,6 +276,10 @@ static nserror nscss_create_css_data(struct content_css_data *c,
 /**
  * Process CSS source data
  *
+ * The source is parsed as it arrives, unless a compiled copy of the
+ * stylesheet is available from the backing store, in which case it is
+ * checked against the complete source on conversion.
+ *
  * \param c     Content structure
  * \param data  Data to process
  * \param size  Number of bytes to process
@@ -255,6 +291,12 @@ nscss_process_data(struct content *c, const char *data, unsigned int size)
 	nscss_content *css = (nscss_content *) c;
 	css_error error;
 
+	if (css->compiled != NULL) {
+		return true;
+	}
+
+	css->streamed = true;
+
 	error = nscss_process_css_data(&css->data, data, size);
 	if (error != CSS_OK && error != CSS_NEEDDATA) {
 		content_broadcast_error(c, NSERROR_CSS, NULL);
@@ -289,7 +331,8 @@ bool nscss_convert(struct content *c)
 	nscss_content *css = (nscss_content *) c;
 	css_error error;
 
-	error = nscss_convert_css_data(&css->data);
+	error = nscss_compile(css);
+	error = nscss_convert_css_data(&css->data, error);
 	if (error != CSS_OK) {
 		content_broadcast_error(c, NSERROR_CSS, NULL);
 		return false;
@@ -299,17 +342,224 @@ bool nscss_convert(struct content *c)
 }
 
 /**
- * Convert CSS data ready for use
+ * Compute the key of a CSS content's compiled stylesheet
  *
- * \param c  CSS data to convert
- * \return CSS error
+ * The compiled stylesheet depends on the base URL and the system
+ * colours, as relative URLs and system colours are resolved while
+ * parsing, as well as the charset and quirks mode. The source is not
+ * part of the key, so it may be looked up before the source arrives.
+ *
+ * \param css  CSS content
+ * \param key  Pointer to location to receive key
+ * \return NSERROR_OK on success, appropriate error otherwise
  */
-static css_error nscss_convert_css_data(struct content_css_data *c)
+static nserror nscss_compiled_key(nscss_content *css, nsurl **key)
 {
-	css_error error;
+	const char *params[2];
+	const uint8_t *data;
+	size_t size;
+	uint64_t hash = 0xcbf29ce484222325;
+	char key_s[32];
+	unsigned int i;
+
+	if (css_stylesheet_get_url(css->data.sheet, &params[0]) != CSS_OK) {
+		return NSERROR_BAD_PARAMETER;
+	}
+	params[1] = css->data.charset != NULL ? css->data.charset : "";
+
+	/* 64 bit FNV-1a over the parameters */
+	for (i = 0; i < 2; i++) {
+		/* include the terminator to separate the values */
+		size = strlen(params[i]) + 1;
+		for (data = (const uint8_t *) params[i]; size > 0; size--) {
+			hash = (hash ^ *data++) * 0x100000001b3;
+		}
+	}
+	hash = (hash ^ css->base.quirks) * 0x100000001b3;
+
+	for (i = NSOPTION_SYS_COLOUR_START; i <= NSOPTION_SYS_COLOUR_END; i++) {
+		colour c = nsoptions[i].value.c;
+		unsigned int byte;
+
+		for (byte = 0; byte < 4; byte++) {
+			hash = (hash ^ ((c >> (byte * 8)) & 0xff)) *
+					0x100000001b3;
+		}
+	}
 
-	error = css_stylesheet_data_done(c->sheet);
+	snprintf(key_s, sizeof(key_s), "x-ns-css:%016" PRIx64, hash);
+
+	return nsurl_create(key_s, key);
+}
+
+/**
+ * Identify the source of a CSS content
+ *
+ * \param css  CSS content
+ * \param header  Updated with the source hash and length
+ */
+static void
+nscss_source_identify(nscss_content *css, struct nscss_compiled_header *header)
+{
+	const uint8_t *data;
+	size_t offset = 0;
+	size_t size;
+	uint64_t hash = 0xcbf29ce484222325;
+	size_t i;
+
+	/* 64 bit FNV-1a over the source */
+	while ((data = content__read_source_data(&css->base,
+						 offset, &size)) != NULL) {
+		for (i = 0; i < size; i++) {
+			hash = (hash ^ data[i]) * 0x100000001b3;
+		}
+		offset += size;
+	}
+
+	header->source_hash = hash;
+	header->source_len = offset;
+}
+
+/**
+ * Retrieve a CSS content's compiled stylesheet from the backing store
+ *
+ * \param css  CSS content
+ */
+static void nscss_compiled_fetch(nscss_content *css)
+{
+	const uint8_t *data;
+	size_t size;
+
+	if (css->compiled_key == NULL &&
+	    nscss_compiled_key(css, &css->compiled_key) != NSERROR_OK) {
+		css->compiled_key = NULL;
+		return;
+	}
+
+	if (llcache_fetch_derived_data(css->compiled_key,
+				       &data, &size) != NSERROR_OK) {
+		return;
+	}
+
+	if (size <= sizeof(struct nscss_compiled_header)) {
+		llcache_release_derived_data(css->compiled_key);
+		return;
+	}
 
+	css->compiled = data;
+	css->compiled_size = size;
+}
+
+/**
+ * Release a CSS content's compiled stylesheet
+ *
+ * \param css  CSS content
+ */
+static void nscss_compiled_release(nscss_content *css)
+{
+	if (css->compiled != NULL) {
+		llcache_release_derived_data(css->compiled_key);
+		css->compiled = NULL;
+		css->compiled_size = 0;
+	}
+}
+
+/**
+ * Complete a CSS content's stylesheet
+ *
+ * If the source was not parsed as it arrived, a compiled copy of the
+ * stylesheet is loaded from the backing store when one made from the
+ * same source is available, and otherwise the source is parsed now.
+ * Parsed stylesheets are placed in the backing store.
+ *
+ * \param css  CSS content to compile
+ * \return CSS_OK on success,
+ *	   CSS_IMPORTS_PENDING if there are imports pending,
+ *	   appropriate error otherwise
+ */
+static css_error nscss_compile(nscss_content *css)
+{
+	struct content_css_data *c = &css->data;
+	struct nscss_compiled_header header;
+	const uint8_t *data = NULL;
+	size_t offset = 0;
+	size_t size;
+	uint8_t *compiled;
+	css_error error = CSS_OK;
+
+	if (!css->streamed && css->compiled == NULL) {
+		/* a clone, which has been given no source data */
+		nscss_compiled_fetch(css);
+	}
+
+	nscss_source_identify(css, &header);
+
+	if (css->compiled != NULL) {
+		if (memcmp(css->compiled, &header, sizeof(header)) == 0) {
+			error = css_stylesheet_deserialise(c->sheet,
+					css->compiled + sizeof(header),
+					css->compiled_size - sizeof(header));
+		} else {
+			error = CSS_INVALID;
+		}
+		nscss_compiled_release(css);
+
+		if (error != CSS_INVALID) {
+			return error;
+		}
+
+		/* unusable, so the sheet was left ready for parsing */
+		NSLOG(netsurf, INFO, "Compiled stylesheet %s unusable",
+		      nsurl_access(css->compiled_key));
+	}
+
+	if (!css->streamed) {
+		while ((data = content__read_source_data(&css->base,
+						 offset, &size)) != NULL) {
+			error = nscss_process_css_data(c,
+					(const char *) data, size);
+			if (error != CSS_OK && error != CSS_NEEDDATA) {
+				break;
+			}
+			offset += size;
+		}
+	}
+
+	if (data == NULL) {
+		error = css_stylesheet_data_done(c->sheet);
+	}
+
+	if ((css->compiled_key != NULL) &&
+	    (header.source_len >= NSCSS_COMPILED_MIN_SIZE) &&
+	    (error == CSS_OK || error == CSS_IMPORTS_PENDING) &&
+	    (css_stylesheet_serialise(c->sheet,
+				      &compiled, &size) == CSS_OK)) {
+		uint8_t *stored;
+
+		stored = realloc(compiled, sizeof(header) + size);
+		if (stored == NULL) {
+			free(compiled);
+		} else {
+			memmove(stored + sizeof(header), stored, size);
+			memcpy(stored, &header, sizeof(header));
+			llcache_store_derived_data(css->compiled_key,
+					stored, sizeof(header) + size);
+		}
+	}
+
+	return error;
+}
+
+/**
+ * Convert CSS data ready for use
+ *
+ * \param c      CSS data to convert
+ * \param error  Result of completing the stylesheet
+ * \return CSS error
+ */
+static css_error nscss_convert_css_data(struct content_css_data *c,
+		css_error error)
+{
 	/* Process pending imports */
 	if (error == CSS_IMPORTS_PENDING) {
 		/* We must not have registered any imports yet */
@@ -346,6 +596,11 @@ void nscss_destroy(struct content *c)
 {
 	nscss_content *css = (nscss_content *) c;
 
+	nscss_compiled_release(css);
+	if (css->compiled_key != NULL) {
+		nsurl_unref(css->compiled_key);
+	}
+
 	nscss_destroy_css_data(&css->data);
 }
 
@@ -379,8 +634,6 @@ nserror nscss_clone(const struct content *old, struct content **newc)
 {
 	const nscss_content *old_css = (const nscss_content *) old;
 	nscss_content *new_css;
-	const uint8_t *data;
-	size_t size;
 	nserror error;
 
 	new_css = calloc(1, sizeof(nscss_content));
@@ -394,7 +647,7 @@ nserror nscss_clone(const struct content *old, struct content **newc)
 		return error;
 	}
 
-	/* Simply replay create/process/convert */
+	/* Simply replay create/convert, which reads the source itself */
 	error = nscss_create_css_data(&new_css->data,
 			nsurl_access(content_get_url(&new_css->base)),
 			old_css->data.charset,
@@ -405,16 +658,6 @@ nserror nscss_clone(const struct content *old, struct content **newc)
 		return error;
 	}
 
-	data = content__get_source_data(&new_css->base, &size);
-	if (size > 0) {
-		if (nscss_process_data(&new_css->base,
-				       (char *)data,
-				       (unsigned int)size) == false) {
-			content_destroy(&new_css->base);
-			return NSERROR_CLONE_FAILED;
-		}
-	}
-
 	if (old->status == CONTENT_STATUS_READY ||
 			old->status == CONTENT_STATUS_DONE) {
 		if (nscss_convert(&new_css->base) == false) {
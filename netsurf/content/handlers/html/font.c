@@ -22,12 +22,77 @@
  * HTML internal font handling implementation.
  */
 
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "utils/nsoption.h"
+#include "utils/log.h"
 #include "netsurf/plot_style.h"
+#include "netsurf/layout.h"
 #include "css/utils.h"
 
+#include "html/private.h"
+#include "html/box.h"
 #include "html/font.h"
 
+/** Initial number of slots in a measurement cache, a power of two */
+#define MEASURE_CACHE_INITIAL 1024
+
+/**
+ * Maximum number of slots in a measurement cache, a power of two
+ *
+ * Each document has its own cache, so this is kept small enough for
+ * constrained frontends; a full table is simply emptied and refilled.
+ */
+#define MEASURE_CACHE_MAX (1 << 12)
+
+/** Maximum number of distinct font family lists recorded by a cache */
+#define MEASURE_FAMILIES_MAX 64
+
+/** Value of x for measurements of the width of a whole string */
+#define MEASURE_WIDTH INT_MIN
+
+/**
+ * A cached text measurement
+ */
+struct font_measure {
+	const char *text; /**< Text measured, or NULL for an empty slot */
+	size_t length; /**< Length of text, in bytes */
+	unsigned int families; /**< Index of the font family list */
+	plot_style_fixed size; /**< Font size */
+	int weight; /**< Font weight */
+	plot_font_generic_family_t family; /**< Generic font family */
+	plot_font_flags_t flags; /**< Font flags */
+	int x; /**< Width available to split, or MEASURE_WIDTH */
+	size_t offset; /**< Split offset */
+	int width; /**< Width of text, or of text up to split offset */
+};
+
+/**
+ * A font family list used by cached measurements
+ */
+struct font_measure_families {
+	uint64_t hash; /**< Hash of the family names */
+	unsigned int count; /**< Number of family names */
+	lwc_string **names; /**< Referenced family names */
+};
+
+/**
+ * A cache of text measurements, as an open addressed hash table
+ */
+struct font_measure_cache {
+	struct font_measure *slots; /**< Table of measurements */
+	unsigned int size; /**< Number of slots, a power of two */
+	unsigned int used; /**< Number of slots in use */
+	struct font_measure_families *families; /**< Family lists seen */
+	unsigned int family_count; /**< Number of family lists seen */
+	unsigned int hits; /**< Number of lookups which were found */
+	unsigned int misses; /**< Number of lookups which were measured */
+};
+
 /**
  * Map a generic CSS font family to a generic plot font family
  *
@@ -163,3 +228,374 @@ void font_plot_style_from_css(
 	fstyle->foreground = nscss_color_to_ns(col);
 	fstyle->background = 0;
 }
+
+
+/**
+ * Find or record a font family list in a cache
+ *
+ * Family names are interned, so two lists name the same families
+ * exactly when they hold the same strings in the same order.
+ *
+ * \param cache     Cache to search
+ * \param families  NULL terminated list of family names, or NULL
+ * \param index     Updated to the index of the list in the cache
+ * \return true on success, false if the list could not be recorded
+ */
+static bool font_measure_families(struct font_measure_cache *cache,
+		lwc_string * const *families, unsigned int *index)
+{
+	struct font_measure_families *f;
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	unsigned int count = 0;
+	unsigned int i;
+	unsigned int n;
+
+	/* FNV-1a over the interned family names */
+	if (families != NULL) {
+		for (; families[count] != NULL; count++) {
+			hash ^= (uintptr_t) families[count];
+			hash *= 0x100000001b3ULL;
+		}
+	}
+
+	for (i = 0; i < cache->family_count; i++) {
+		f = &cache->families[i];
+		if (f->hash != hash || f->count != count) {
+			continue;
+		}
+		for (n = 0; n < count; n++) {
+			if (f->names[n] != families[n]) {
+				break;
+			}
+		}
+		if (n == count) {
+			*index = i;
+			return true;
+		}
+	}
+
+	if (cache->family_count == MEASURE_FAMILIES_MAX) {
+		return false;
+	}
+
+	f = &cache->families[cache->family_count];
+	f->names = NULL;
+	if (count != 0) {
+		f->names = malloc(count * sizeof(*f->names));
+		if (f->names == NULL) {
+			return false;
+		}
+	}
+	for (n = 0; n < count; n++) {
+		f->names[n] = lwc_string_ref(families[n]);
+	}
+	f->hash = hash;
+	f->count = count;
+
+	*index = cache->family_count++;
+	return true;
+}
+
+
+/**
+ * Fill in the key of a measurement
+ *
+ * \param cache   Cache the measurement is for
+ * \param m       Measurement to fill in
+ * \param fstyle  Plot style of text
+ * \param string  Text measured
+ * \param length  Length of text
+ * \param x       Width available, or MEASURE_WIDTH
+ * \return true on success, false if the text cannot be cached
+ */
+static bool font_measure_key(struct font_measure_cache *cache,
+		struct font_measure *m,
+		const plot_font_style_t *fstyle,
+		const char *string, size_t length, int x)
+{
+	if (!font_measure_families(cache, fstyle->families, &m->families)) {
+		return false;
+	}
+
+	m->text = string;
+	m->length = length;
+	m->size = fstyle->size;
+	m->weight = fstyle->weight;
+	m->family = fstyle->family;
+	m->flags = fstyle->flags;
+	m->x = x;
+
+	return true;
+}
+
+
+/**
+ * Hash the key of a measurement
+ *
+ * \param m  Measurement with key filled in
+ * \return Hash of the key
+ */
+static unsigned int font_measure_hash(const struct font_measure *m)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	hash ^= (uint64_t) m->families << 32 | m->flags;
+	hash *= 0x100000001b3ULL;
+	hash ^= (uintptr_t) m->text;
+	hash *= 0x100000001b3ULL;
+	hash ^= m->length;
+	hash *= 0x100000001b3ULL;
+	hash ^= (uint64_t) m->size << 32 | (uint32_t) m->x;
+	hash *= 0x100000001b3ULL;
+	hash ^= (uint64_t) m->weight << 32 | m->family;
+	hash *= 0x100000001b3ULL;
+
+	return hash ^ (hash >> 32);
+}
+
+
+/**
+ * Find the slot for a measurement in a cache
+ *
+ * \param cache  Cache to search
+ * \param key    Measurement with key filled in
+ * \return The slot holding the measurement, or the empty slot where it
+ *         belongs
+ */
+static struct font_measure *font_measure_find(
+		const struct font_measure_cache *cache,
+		const struct font_measure *key)
+{
+	unsigned int mask = cache->size - 1;
+	unsigned int i = font_measure_hash(key) & mask;
+	struct font_measure *m;
+
+	for (;;) {
+		m = &cache->slots[i];
+		if (m->text == NULL ||
+		    (m->text == key->text &&
+		     m->length == key->length &&
+		     m->x == key->x &&
+		     m->families == key->families &&
+		     m->size == key->size &&
+		     m->weight == key->weight &&
+		     m->family == key->family &&
+		     m->flags == key->flags)) {
+			return m;
+		}
+		i = (i + 1) & mask;
+	}
+}
+
+
+/**
+ * Store a measurement in a cache
+ *
+ * The table grows until it reaches its maximum size, after which it is
+ * emptied whenever it fills.
+ *
+ * \param cache  Cache to store in
+ * \param m      Measurement to store, not already in the cache
+ */
+static void font_measure_insert(struct font_measure_cache *cache,
+		const struct font_measure *m)
+{
+	if ((cache->used + 1) * 4 > cache->size * 3) {
+		struct font_measure *old = cache->slots;
+		struct font_measure *slots = NULL;
+		unsigned int size = cache->size;
+		unsigned int i;
+
+		if (size < MEASURE_CACHE_MAX) {
+			slots = calloc(size * 2, sizeof(*slots));
+		}
+
+		if (slots == NULL) {
+			NSLOG(netsurf, INFO, "emptying %u measurements",
+			      cache->used);
+			memset(old, 0, size * sizeof(*old));
+			cache->used = 0;
+		} else {
+			cache->slots = slots;
+			cache->size = size * 2;
+			for (i = 0; i < size; i++) {
+				if (old[i].text != NULL) {
+					*font_measure_find(cache, &old[i]) =
+							old[i];
+				}
+			}
+			free(old);
+		}
+	}
+
+	*font_measure_find(cache, m) = *m;
+	cache->used++;
+}
+
+
+/* exported function documented in html/font.h */
+nserror font_measure_cache_create(struct font_measure_cache **cache_out)
+{
+	struct font_measure_cache *cache;
+
+	cache = malloc(sizeof(*cache));
+	if (cache == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	cache->slots = calloc(MEASURE_CACHE_INITIAL, sizeof(*cache->slots));
+	if (cache->slots == NULL) {
+		free(cache);
+		return NSERROR_NOMEM;
+	}
+	cache->families = calloc(MEASURE_FAMILIES_MAX,
+			sizeof(*cache->families));
+	if (cache->families == NULL) {
+		free(cache->slots);
+		free(cache);
+		return NSERROR_NOMEM;
+	}
+	cache->size = MEASURE_CACHE_INITIAL;
+	cache->used = 0;
+	cache->family_count = 0;
+	cache->hits = 0;
+	cache->misses = 0;
+
+	*cache_out = cache;
+	return NSERROR_OK;
+}
+
+
+/* exported function documented in html/font.h */
+void font_measure_cache_destroy(struct font_measure_cache *cache)
+{
+	unsigned int i;
+	unsigned int n;
+
+	if (cache == NULL) {
+		return;
+	}
+
+	NSLOG(netsurf, INFO, "%u measurements, %u hits, %u misses",
+	      cache->used, cache->hits, cache->misses);
+
+	for (i = 0; i < cache->family_count; i++) {
+		for (n = 0; n < cache->families[i].count; n++) {
+			lwc_string_unref(cache->families[i].names[n]);
+		}
+		free(cache->families[i].names);
+	}
+
+	free(cache->families);
+	free(cache->slots);
+	free(cache);
+}
+
+
+/* exported function documented in html/font.h */
+void font_measure_cache_invalidate_box(struct font_measure_cache *cache,
+		const struct box *box)
+{
+	struct font_measure *old;
+	const char *end;
+	unsigned int i;
+
+	if (cache == NULL || box->text == NULL || cache->used == 0) {
+		return;
+	}
+
+	/* this is rare, so simply rebuild the table without the
+	 * measurements of any part of the box's text */
+	old = cache->slots;
+	cache->slots = calloc(cache->size, sizeof(*old));
+	if (cache->slots == NULL) {
+		cache->slots = old;
+		memset(old, 0, cache->size * sizeof(*old));
+		cache->used = 0;
+		return;
+	}
+
+	end = box->text + box->length;
+	cache->used = 0;
+	for (i = 0; i < cache->size; i++) {
+		if (old[i].text == NULL ||
+		    (old[i].text >= box->text && old[i].text <= end)) {
+			continue;
+		}
+		*font_measure_find(cache, &old[i]) = old[i];
+		cache->used++;
+	}
+	free(old);
+}
+
+
+/* exported function documented in html/font.h */
+nserror font_measure_width(const struct html_content *html,
+		const plot_font_style_t *fstyle,
+		const char *string, size_t length, int *width)
+{
+	struct font_measure_cache *cache = html->font_measure_cache;
+	struct font_measure key;
+	struct font_measure *m;
+	nserror res;
+
+	if (cache == NULL || !font_measure_key(cache, &key, fstyle,
+			string, length, MEASURE_WIDTH)) {
+		return html->font_func->width(fstyle, string, length, width);
+	}
+
+	m = font_measure_find(cache, &key);
+	if (m->text != NULL) {
+		cache->hits++;
+		*width = m->width;
+		return NSERROR_OK;
+	}
+
+	cache->misses++;
+	res = html->font_func->width(fstyle, string, length, width);
+	if (res == NSERROR_OK) {
+		key.offset = length;
+		key.width = *width;
+		font_measure_insert(cache, &key);
+	}
+
+	return res;
+}
+
+
+/* exported function documented in html/font.h */
+nserror font_measure_split(const struct html_content *html,
+		const plot_font_style_t *fstyle,
+		const char *string, size_t length,
+		int x, size_t *char_offset, int *actual_x)
+{
+	struct font_measure_cache *cache = html->font_measure_cache;
+	struct font_measure key;
+	struct font_measure *m;
+	nserror res;
+
+	if (cache == NULL || x == MEASURE_WIDTH ||
+	    !font_measure_key(cache, &key, fstyle, string, length, x)) {
+		return html->font_func->split(fstyle, string, length, x,
+				char_offset, actual_x);
+	}
+
+	m = font_measure_find(cache, &key);
+	if (m->text != NULL) {
+		cache->hits++;
+		*char_offset = m->offset;
+		*actual_x = m->width;
+		return NSERROR_OK;
+	}
+
+	cache->misses++;
+	res = html->font_func->split(fstyle, string, length, x,
+			char_offset, actual_x);
+	if (res == NSERROR_OK) {
+		key.offset = *char_offset;
+		key.width = *actual_x;
+		font_measure_insert(cache, &key);
+	}
+
+	return res;
+}
@@ -28,6 +28,9 @@
 #define NETSURF_HTML_FONT_H
 
 struct plot_font_style;
+struct html_content;
+struct box;
+struct font_measure_cache;
 
 /**
  * Populate a font style using data from a computed CSS style
@@ -40,4 +43,75 @@ void font_plot_style_from_css(const css_unit_ctx *unit_len_ctx,
 			      const css_computed_style *css,
 			      struct plot_font_style *fstyle);
 
+/**
+ * Create a cache of text measurements
+ *
+ * The cache holds the results of the layout table's width and split
+ * operations, keyed by the address and length of the text measured and
+ * the parts of the font style which affect its width. Text must not be
+ * modified while it is in the cache.
+ *
+ * \param cache_out  Updated to the new cache on success
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+nserror font_measure_cache_create(struct font_measure_cache **cache_out);
+
+/**
+ * Destroy a cache of text measurements
+ *
+ * \param cache  Cache to destroy, may be NULL
+ */
+void font_measure_cache_destroy(struct font_measure_cache *cache);
+
+/**
+ * Remove the measurements of a box's text from a cache
+ *
+ * Must be called before the text of a box is changed or freed while
+ * the box tree remains in use.
+ *
+ * \param cache  Cache to update, may be NULL
+ * \param box    Box whose text is changing
+ */
+void font_measure_cache_invalidate_box(struct font_measure_cache *cache,
+		const struct box *box);
+
+/**
+ * Measure the width of a string, using a document's measurement cache
+ *
+ * As gui_layout_table width(), but only measures each string once for
+ * each font style. The string must be part of the document's box tree,
+ * or otherwise remain unchanged for the life of the document.
+ *
+ * \param html    Document the string belongs to
+ * \param fstyle  Plot style for the text
+ * \param string  UTF-8 string to measure
+ * \param length  Length of string, in bytes
+ * \param width   Updated to width of string[0..length)
+ * \return NSERROR_OK and width updated or appropriate error code
+ */
+nserror font_measure_width(const struct html_content *html,
+		const struct plot_font_style *fstyle,
+		const char *string, size_t length, int *width);
+
+/**
+ * Find where to split a string to make it fit a width, using a
+ * document's measurement cache
+ *
+ * As gui_layout_table split(), with the same restrictions on the string
+ * as font_measure_width().
+ *
+ * \param html         Document the string belongs to
+ * \param fstyle       Plot style for the text
+ * \param string       UTF-8 string to measure
+ * \param length       Length of string, in bytes
+ * \param x            Width available
+ * \param char_offset  Updated to offset in string of actual_x, [1..length]
+ * \param actual_x     Updated to x coordinate of character closest to x
+ * \return NSERROR_OK or appropriate error code on failure
+ */
+nserror font_measure_split(const struct html_content *html,
+		const struct plot_font_style *fstyle,
+		const char *string, size_t length,
+		int x, size_t *char_offset, int *actual_x);
+
 #endif
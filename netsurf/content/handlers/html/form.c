@@ -1362,6 +1362,7 @@ form__select_process_selection(html_content *html,
 		}
 	}
 
+	font_measure_cache_invalidate_box(html->font_measure_cache, inline_box);
 	talloc_free(inline_box->text);
 	inline_box->text = 0;
 
@@ -68,9 +68,11 @@
 #include "html/box_construct.h"
 #include "html/box_inspect.h"
 #include "html/form_internal.h"
+#include "html/font.h"
 #include "html/imagemap.h"
 #include "html/layout.h"
 #include "html/textselection.h"
+#include "html/redraw_list.h"
 
 #define CHUNK 4096
 
@@ -220,6 +222,7 @@ static void html_box_convert_done(html_content *c, bool success)
 	dom_node *html;
 
 	NSLOG(netsurf, INFO, "DOM to box conversion complete (content %p)", c);
+	guit->misc->phase("html_finish_conversion", false);
 
 	c->box_conversion_context = NULL;
 
@@ -387,6 +390,7 @@ void html_finish_conversion(html_content *htmlc)
 
 	/* convert dom tree to box tree */
 	NSLOG(netsurf, INFO, "DOM to box (%p)", htmlc);
+	guit->misc->phase("html_finish_conversion", true);
 	content_set_status(&htmlc->base, messages_get("Processing"));
 	msg_data.explicit_status_text = NULL;
 	content_broadcast(&htmlc->base, CONTENT_MSG_STATUS, &msg_data);
@@ -396,6 +400,7 @@ void html_finish_conversion(html_content *htmlc)
 		NSLOG(netsurf, INFO, "error retrieving html element from dom");
 		content_broadcast_error(&htmlc->base, NSERROR_DOM, NULL);
 		content_set_error(&htmlc->base);
+		guit->misc->phase("html_finish_conversion", false);
 		return;
 	}
 
@@ -408,6 +413,7 @@ void html_finish_conversion(html_content *htmlc)
 		html_object_free_objects(htmlc);
 		content_broadcast_error(&htmlc->base, error, NULL);
 		content_set_error(&htmlc->base);
+		guit->misc->phase("html_finish_conversion", false);
 		return;
 	}
 
@@ -475,6 +481,7 @@ html_create_html_data(html_content *c, const http_parameter *params)
 	c->title = NULL;
 	c->bctx = NULL;
 	c->layout = NULL;
+	c->redraw_list = NULL;
 	c->background_colour = NS_TRANSPARENT;
 	c->stylesheet_count = 0;
 	c->stylesheets = NULL;
@@ -490,6 +497,7 @@ html_create_html_data(html_content *c, const http_parameter *params)
 	c->iframe = NULL;
 	c->page = NULL;
 	c->font_func = guit->layout;
+	c->font_measure_cache = NULL;
 	c->drag_type = HTML_DRAG_NONE;
 	c->drag_owner.no_owner = true;
 	c->selection_type = HTML_SELECTION_NONE;
@@ -655,6 +663,7 @@ html_process_encoding_change(struct content *c,
 	dom_hubbub_error error;
 	const char *encoding;
 	const uint8_t *source_data;
+	size_t source_offset = 0;
 	size_t source_size;
 
 	/* Retrieve new encoding */
@@ -714,15 +723,22 @@ html_process_encoding_change(struct content *c,
 
 	}
 
-	source_data = content__get_source_data(c, &source_size);
-
 	/* Reprocess all the data.  This is safe because
 	 * the encoding is now specified at parser start which means
 	 * it cannot be changed again.
 	 */
-	error = dom_hubbub_parser_parse_chunk(html->parser,
-					      source_data,
-					      source_size);
+	error = DOM_HUBBUB_OK;
+	while ((source_data = content__read_source_data(c,
+						       source_offset,
+						       &source_size)) != NULL) {
+		error = dom_hubbub_parser_parse_chunk(html->parser,
+						      source_data,
+						      source_size);
+		if (error != DOM_HUBBUB_OK) {
+			break;
+		}
+		source_offset += source_size;
+	}
 
 	return libdom_hubbub_error_to_nserror(error);
 }
@@ -890,6 +906,7 @@ html_begin_conversion(html_content *htmlc)
 
 	/* Conversion begins proper at this point */
 	htmlc->conversion_begun = true;
+	guit->misc->phase("html_begin_conversion", true);
 
 	/* complete script execution, including deferred scripts */
 	html_script_exec(htmlc, true);
@@ -908,7 +925,7 @@ html_begin_conversion(html_content *htmlc)
 			content_broadcast_error(&htmlc->base,
 						NSERROR_NOMEM,
 						NULL);
-			return false;
+			goto failed;
 		}
 
 		htmlc->encoding = strdup(encoding);
@@ -916,7 +933,7 @@ html_begin_conversion(html_content *htmlc)
 			content_broadcast_error(&htmlc->base,
 						NSERROR_NOMEM,
 						NULL);
-			return false;
+			goto failed;
 		}
 	}
 
@@ -925,7 +942,7 @@ html_begin_conversion(html_content *htmlc)
 	if ((exc != DOM_NO_ERR) || (html == NULL)) {
 		NSLOG(netsurf, INFO, "error retrieving html element from dom");
 		content_broadcast_error(&htmlc->base, NSERROR_DOM, NULL);
-		return false;
+		goto failed;
 	}
 
 	exc = dom_node_get_node_name(html, &node_name);
@@ -936,7 +953,7 @@ html_begin_conversion(html_content *htmlc)
 		NSLOG(netsurf, INFO, "root element not html");
 		content_broadcast_error(&htmlc->base, NSERROR_DOM, NULL);
 		dom_node_unref(html);
-		return false;
+		goto failed;
 	}
 	dom_string_unref(node_name);
 
@@ -963,7 +980,7 @@ html_begin_conversion(html_content *htmlc)
 			content_broadcast_error(&htmlc->base, ns_error, NULL);
 
 			dom_node_unref(html);
-			return false;
+			goto failed;
 		}
 
 		free(f->action);
@@ -975,7 +992,7 @@ html_begin_conversion(html_content *htmlc)
 						NULL);
 
 			dom_node_unref(html);
-			return false;
+			goto failed;
 		}
 
 		/* Ensure each form has a document encoding */
@@ -986,18 +1003,24 @@ html_begin_conversion(html_content *htmlc)
 							NSERROR_NOMEM,
 							NULL);
 				dom_node_unref(html);
-				return false;
+				goto failed;
 			}
 		}
 	}
 
 	dom_node_unref(html);
 
+	guit->misc->phase("html_begin_conversion", false);
+
 	if (htmlc->base.active == 0) {
 		html_finish_conversion(htmlc);
 	}
 
 	return true;
+
+failed:
+	guit->misc->phase("html_begin_conversion", false);
+	return false;
 }
 
 
@@ -1068,6 +1091,18 @@ static void html_reformat(struct content *c, int width, int height)
 			INTTOFIX(height), htmlc->unit_len_ctx.device_dpi);
 	htmlc->unit_len_ctx.root_style = htmlc->layout->style;
 
+	/* the display list is recorded afresh from the new layout */
+	html_redraw_list_destroy(htmlc->redraw_list);
+	htmlc->redraw_list = NULL;
+
+	/* text measurements are kept between layouts; without the cache
+	 * text is measured each time */
+	if (htmlc->font_measure_cache == NULL &&
+			font_measure_cache_create(
+				&htmlc->font_measure_cache) != NSERROR_OK) {
+		htmlc->font_measure_cache = NULL;
+	}
+
 	layout_document(htmlc, width, height);
 	layout = htmlc->layout;
 
@@ -1110,8 +1145,13 @@ static void html_reformat(struct content *c, int width, int height)
 
 void html_redraw_a_box(hlcache_handle *h, struct box *box)
 {
+	html_content *html = (html_content *) hlcache_handle_get_content(h);
 	int x, y;
 
+	if (html->redraw_list != NULL) {
+		html_redraw_list_invalidate(html->redraw_list, box);
+	}
+
 	box_coords(box, &x, &y);
 
 	content_request_redraw(h, x, y,
@@ -1131,6 +1171,10 @@ void html__redraw_a_box(struct html_content *html, struct box *box)
 {
 	int x, y;
 
+	if (html->redraw_list != NULL) {
+		html_redraw_list_invalidate(html->redraw_list, box);
+	}
+
 	box_coords(box, &x, &y);
 
 	content__request_redraw((struct content *)html, x, y,
@@ -1215,6 +1259,9 @@ static void html_destroy(struct content *c)
 
 	selection_destroy(html->sel);
 
+	html_redraw_list_destroy(html->redraw_list);
+	font_measure_cache_destroy(html->font_measure_cache);
+
 	/* Destroy forms */
 	for (f = html->forms; f != NULL; f = g) {
 		g = f->prev;
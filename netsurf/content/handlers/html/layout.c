@@ -53,11 +53,13 @@
 #include "netsurf/content.h"
 #include "netsurf/browser_window.h"
 #include "netsurf/layout.h"
+#include "netsurf/misc.h"
 #include "content/content.h"
 #include "content/content_protected.h"
 #include "css/utils.h"
 #include "desktop/scrollbar.h"
 #include "desktop/textarea.h"
+#include "desktop/gui_internal.h"
 
 #include "html/html.h"
 #include "html/html_save.h"
@@ -568,8 +570,8 @@ layout_minmax_line(struct box *first,
 
 			if (b->next) {
 				if (b->space == UNKNOWN_WIDTH) {
-					font_func->width(&fstyle, " ", 1,
-							 &b->space);
+					font_measure_width(content, &fstyle, " ", 1,
+							&b->space);
 				}
 				max += b->space;
 			}
@@ -618,16 +620,16 @@ layout_minmax_line(struct box *first,
 						b->width += SCROLLBAR_WIDTH;
 
 				} else {
-					font_func->width(&fstyle, b->text,
-						b->length, &b->width);
+					font_measure_width(content, &fstyle, b->text,
+							b->length, &b->width);
 					b->flags |= MEASURED;
 				}
 			}
 			max += b->width;
 			if (b->next) {
 				if (b->space == UNKNOWN_WIDTH) {
-					font_func->width(&fstyle, " ", 1,
-							 &b->space);
+					font_measure_width(content, &fstyle, " ", 1,
+							&b->space);
 				}
 				max += b->space;
 			}
@@ -653,8 +655,8 @@ layout_minmax_line(struct box *first,
 					for (j = i; j != b->length &&
 							b->text[j] != ' '; j++)
 						;
-					font_func->width(&fstyle, b->text + i,
-							 j - i, &width);
+					font_measure_width(content, &fstyle,
+							b->text + i, j - i, &width);
 					if (min < width)
 						min = width;
 					i = j + 1;
@@ -2377,7 +2379,6 @@ layout_text_box_split(html_content *content,
 {
 	int space_width = split_box->space;
 	struct box *c2;
-	const struct gui_layout_table *font_func = content->font_func;
 	bool space = (split_box->text[new_length] == ' ');
 	int used_length = new_length + (space ? 1 : 0);
 
@@ -2385,7 +2386,7 @@ layout_text_box_split(html_content *content,
 		/* We're need to add a space, and we don't know how big
 		 * it's to be, OR we have a space of unknown width anyway;
 		 * Calculate space width */
-		font_func->width(fstyle, " ", 1, &space_width);
+		font_measure_width(content, fstyle, " ", 1, &space_width);
 	}
 
 	if (split_box->space == UNKNOWN_WIDTH)
@@ -2866,7 +2867,8 @@ layout_line(struct box *first,
 		} else if (b->type == BOX_INLINE_END) {
 			b->width = 0;
 			if (b->space == UNKNOWN_WIDTH) {
-				font_func->width(&fstyle, " ", 1, &b->space);
+				font_measure_width(content, &fstyle, " ", 1,
+						&b->space);
 				/** \todo handle errors */
 			}
 			space_after = b->space;
@@ -2917,7 +2919,7 @@ layout_line(struct box *first,
 					if (nsoption_bool(core_select_menu))
 						b->width += SCROLLBAR_WIDTH;
 				} else {
-					font_func->width(&fstyle, b->text,
+					font_measure_width(content, &fstyle, b->text,
 							b->length, &b->width);
 					b->flags |= MEASURED;
 				}
@@ -2930,14 +2932,15 @@ layout_line(struct box *first,
 			if (b->text && (x + b->width < x1 - x0) &&
 					!(b->flags & MEASURED) &&
 					b->next) {
-				font_func->width(&fstyle, b->text,
-						 b->length, &b->width);
+				font_measure_width(content, &fstyle, b->text,
+						b->length, &b->width);
 				b->flags |= MEASURED;
 			}
 
 			x += b->width;
 			if (b->space == UNKNOWN_WIDTH) {
-				font_func->width(&fstyle, " ", 1, &b->space);
+				font_measure_width(content, &fstyle, " ", 1,
+						&b->space);
 				/** \todo handle errors */
 			}
 			space_after = b->space;
@@ -3073,8 +3076,8 @@ layout_line(struct box *first,
 							&content->unit_len_ctx,
 							b->style, &fstyle);
 					/** \todo handle errors */
-					font_func->width(&fstyle, " ", 1,
-							 &b->space);
+					font_measure_width(content, &fstyle, " ", 1,
+							&b->space);
 				}
 				space_after = b->space;
 			} else {
@@ -3227,12 +3230,12 @@ layout_line(struct box *first,
 			font_plot_style_from_css(&content->unit_len_ctx,
 					split_box->style, &fstyle);
 			/** \todo handle errors */
-			font_func->split(&fstyle,
-					 split_box->text,
-					 split_box->length,
-					 x1 - x0 - x - space_before,
-					 &split,
-					 &w);
+			font_measure_split(content, &fstyle,
+					split_box->text,
+					split_box->length,
+					x1 - x0 - x - space_before,
+					&split,
+					&w);
 		}
 
 		/* split == 0 implies that text can't be split */
@@ -4449,7 +4452,8 @@ layout_lists(const html_content *content, struct box *box)
 							&content->unit_len_ctx,
 							marker->style,
 							&fstyle);
-					content->font_func->width(&fstyle,
+					font_measure_width(content,
+							&fstyle,
 							marker->text,
 							marker->length,
 							&marker->width);
@@ -5426,6 +5430,8 @@ bool layout_document(html_content *content, int width, int height)
 			width, height, nsurl_access(content_get_url(
 					&content->base)));
 
+	guit->misc->phase("layout_document", true);
+
 	layout_minmax_block(doc, font_func, content);
 
 	layout_block_find_dimensions(&content->unit_len_ctx,
@@ -5466,5 +5472,7 @@ bool layout_document(html_content *content, int width, int height)
 
 	layout_calculate_descendant_bboxes(&content->unit_len_ctx, doc);
 
+	guit->misc->phase("layout_document", false);
+
 	return ret;
 }
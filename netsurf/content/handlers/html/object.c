@@ -46,6 +46,7 @@
 #include "html/box.h"
 #include "html/box_inspect.h"
 #include "html/object.h"
+#include "html/redraw_list.h"
 
 /* break reference loop */
 static void html_object_refresh(void *p);
@@ -199,6 +200,11 @@ html_object_callback(hlcache_handle *object,
 
 		html_object_done(box, object, o->background);
 
+		/* the box's redraw may have changed without a reformat */
+		if (c->redraw_list != NULL) {
+			html_redraw_list_invalidate(c->redraw_list, box);
+		}
+
 		if (c->base.status != CONTENT_STATUS_LOADING &&
 				box->flags & REPLACE_DIM) {
 			union content_msg_data data;
@@ -35,6 +35,8 @@ struct gui_layout_table;
 struct scrollbar_msg_data;
 struct content_redraw_data;
 struct selection;
+struct html_redraw_list;
+struct font_measure_cache;
 
 typedef enum {
 	HTML_DRAG_NONE,			/** No drag */
@@ -138,11 +140,15 @@ typedef struct html_content {
 	void *box_conversion_context;
 	/** Box tree, or NULL. */
 	struct box *layout;
+	/** Retained display list of box tree, or NULL. */
+	struct html_redraw_list *redraw_list;
 	/** Document background colour. */
 	colour background_colour;
 
 	/** Font callback table */
 	const struct gui_layout_table *font_func;
+	/** Cache of text measurements made with font_func, or NULL */
+	struct font_measure_cache *font_measure_cache;
 
 	/** Number of entries in scripts */
 	unsigned int scripts_count;
@@ -46,6 +46,7 @@
 #include "netsurf/plotters.h"
 #include "netsurf/bitmap.h"
 #include "netsurf/layout.h"
+#include "netsurf/misc.h"
 #include "content/content.h"
 #include "content/content_protected.h"
 #include "content/textsearch.h"
@@ -63,6 +64,7 @@
 #include "html/form_internal.h"
 #include "html/private.h"
 #include "html/layout.h"
+#include "html/redraw_list.h"
 
 
 bool html_redraw_debug = false;
@@ -220,16 +222,16 @@ text_redraw(const char *utf8_text,
 				endtxt_idx = utf8_len;
 			}
 
-			res = guit->layout->width(fstyle,
-						  utf8_text, start_idx,
-						  &startx);
+			res = font_measure_width((html_content *)c, fstyle,
+						 utf8_text, start_idx,
+						 &startx);
 			if (res != NSERROR_OK) {
 				startx = 0;
 			}
 
-			res = guit->layout->width(fstyle,
-						  utf8_text, endtxt_idx,
-						  &endx);
+			res = font_measure_width((html_content *)c, fstyle,
+						 utf8_text, endtxt_idx,
+						 &endx);
 			if (res != NSERROR_OK) {
 				endx = 0;
 			}
@@ -573,6 +575,41 @@ static bool html_redraw_file(int x, int y, int width, int height,
 }
 
 
+/**
+ * Plot a background image content.
+ *
+ * When recording a display list the image is recorded for replay rather
+ * than plotted, so that animated images are redrawn in their current frame.
+ *
+ * \param  image  background image content
+ * \param  data   redraw data for the image
+ * \param  clip   clip rectangle for the image
+ * \param  ctx    current redraw context
+ * \return true if successful, false otherwise
+ */
+
+static bool html_redraw_background_image(struct hlcache_handle *image,
+		struct content_redraw_data *data, const struct rect *clip,
+		const struct redraw_context *ctx)
+{
+	struct html_redraw_list *list = html_redraw_list_recording(ctx);
+
+	if (list != NULL) {
+		return (html_redraw_list_add_content(list, image, data,
+				clip) == NSERROR_OK);
+	}
+
+	if (ctx->plot->clip(ctx, clip) != NSERROR_OK) {
+		return false;
+	}
+
+	/* We just continue if redraw fails */
+	content_redraw(image, data, clip, ctx);
+
+	return true;
+}
+
+
 /**
  * Plot background images.
  *
@@ -776,11 +813,6 @@ static bool html_redraw_background(int x, int y, struct box *box, float scale,
 			if ((r.x0 < r.x1) && (r.y0 < r.y1)) {
 				struct content_redraw_data bg_data;
 
-				res = ctx->plot->clip(ctx, &r);
-				if (res != NSERROR_OK) {
-					return false;
-				}
-
 				bg_data.x = x;
 				bg_data.y = y;
 				bg_data.width = ceilf(width * scale);
@@ -790,9 +822,10 @@ static bool html_redraw_background(int x, int y, struct box *box, float scale,
 				bg_data.repeat_x = repeat_x;
 				bg_data.repeat_y = repeat_y;
 
-				/* We just continue if redraw fails */
-				content_redraw(background->background,
-						&bg_data, &r, ctx);
+				if (!html_redraw_background_image(
+						background->background,
+						&bg_data, &r, ctx))
+					return false;
 			}
 		}
 
@@ -936,11 +969,6 @@ static bool html_redraw_inline_background(int x, int y, struct box *box,
 		if ((r.x0 < r.x1) && (r.y0 < r.y1)) {
 			struct content_redraw_data bg_data;
 
-			res = ctx->plot->clip(ctx, &r);
-			if (res != NSERROR_OK) {
-				return false;
-			}
-
 			bg_data.x = x;
 			bg_data.y = y;
 			bg_data.width = ceilf(width * scale);
@@ -950,8 +978,9 @@ static bool html_redraw_inline_background(int x, int y, struct box *box,
 			bg_data.repeat_x = repeat_x;
 			bg_data.repeat_y = repeat_y;
 
-			/* We just continue if redraw fails */
-			content_redraw(box->background, &bg_data, &r, ctx);
+			if (!html_redraw_background_image(box->background,
+					&bg_data, &r, ctx))
+				return false;
 		}
 	}
 
@@ -1213,7 +1242,240 @@ static bool html_redraw_box_children(const html_content *html, struct box *box,
 }
 
 /**
- * Recursively draw a box.
+ * Get the element type of a box's node.
+ *
+ * \param  box  box to get element type of
+ * \return the element type, or DOM_HTML_ELEMENT_TYPE__UNKNOWN
+ */
+
+static dom_html_element_type html_redraw_box_tag_type(struct box *box)
+{
+	dom_html_element_type tag_type;
+	dom_exception exc;
+
+	if (box->node == NULL) {
+		return DOM_HTML_ELEMENT_TYPE__UNKNOWN;
+	}
+
+	exc = dom_html_element_get_tag_type(box->node, &tag_type);
+	if (exc != DOM_NO_ERR) {
+		return DOM_HTML_ELEMENT_TYPE__UNKNOWN;
+	}
+
+	return tag_type;
+}
+
+
+/**
+ * Determine whether a box has content plotted in place of its children.
+ *
+ * \param  box       box to check
+ * \param  tag_type  element type of the box's node
+ * \param  width     width of the box
+ * \param  height    height of the box
+ * \return true if html_redraw_box_content() plots the box's content
+ */
+
+static bool html_redraw_box_is_replaced(struct box *box,
+		dom_html_element_type tag_type, int width, int height)
+{
+	if (box->object && width != 0 && height != 0)
+		return true;
+
+	if (tag_type == DOM_HTML_ELEMENT_TYPE_CANVAS &&
+			box->node != NULL && box->flags & REPLACE_DIM)
+		return true;
+
+	if (box->iframe)
+		return true;
+
+	if (box->gadget && (box->gadget->type == GADGET_CHECKBOX ||
+			box->gadget->type == GADGET_RADIO ||
+			box->gadget->type == GADGET_FILE ||
+			box->gadget->type == GADGET_TEXTAREA ||
+			box->gadget->type == GADGET_PASSWORD ||
+			box->gadget->type == GADGET_TEXTBOX))
+		return true;
+
+	return (box->text != NULL);
+}
+
+
+/**
+ * Draw the content of a box: its object, canvas, iframe, form gadget or
+ * text.
+ *
+ * \param  html	      html content
+ * \param  box	      box to draw
+ * \param  tag_type      element type of the box's node
+ * \param  x	      coordinate of box
+ * \param  y	      coordinate of box
+ * \param  width	      width of box
+ * \param  height	      height of box
+ * \param  padding_left  left padding of box
+ * \param  padding_top   top padding of box
+ * \param  clip	      clip rectangle
+ * \param  scale	      scale for redraw
+ * \param  current_background_color  background colour under this box
+ * \param  ctx	      current redraw context
+ * \return true if successful, false otherwise
+ *
+ * x, y, width, height and padding are scaled and in target coordinates.
+ */
+
+static bool html_redraw_box_content(const html_content *html,
+		struct box *box, dom_html_element_type tag_type,
+		int x, int y, int width, int height,
+		int padding_left, int padding_top,
+		const struct rect *clip, const float scale,
+		colour current_background_color,
+		const struct redraw_context *ctx)
+{
+	struct rect rect;
+	int x_scrolled, y_scrolled;
+	dom_exception exc;
+
+	if (box->object && width != 0 && height != 0) {
+		struct content_redraw_data obj_data;
+
+		x_scrolled = x - scrollbar_get_offset(box->scroll_x) * scale;
+		y_scrolled = y - scrollbar_get_offset(box->scroll_y) * scale;
+
+		obj_data.x = x_scrolled + padding_left;
+		obj_data.y = y_scrolled + padding_top;
+		obj_data.width = width;
+		obj_data.height = height;
+		obj_data.background_colour = current_background_color;
+		obj_data.scale = scale;
+		obj_data.repeat_x = false;
+		obj_data.repeat_y = false;
+
+		if (content_get_type(box->object) == CONTENT_HTML) {
+			obj_data.x /= scale;
+			obj_data.y /= scale;
+		}
+
+		if (!content_redraw(box->object, &obj_data, clip, ctx)) {
+			/* Show image fail */
+			/* Unicode (U+FFFC) 'OBJECT REPLACEMENT CHARACTER' */
+			const char *obj = "\xef\xbf\xbc";
+			int obj_width;
+			int obj_x = x + padding_left;
+			nserror res;
+
+			rect.x0 = x + padding_left;
+			rect.y0 = y + padding_top;
+			rect.x1 = x + padding_left + width - 1;
+			rect.y1 = y + padding_top + height - 1;
+			res = ctx->plot->rectangle(ctx, plot_style_broken_object, &rect);
+			if (res != NSERROR_OK) {
+				return false;
+			}
+
+			res = guit->layout->width(plot_fstyle_broken_object,
+						  obj,
+						  sizeof(obj) - 1,
+						  &obj_width);
+			if (res != NSERROR_OK) {
+				obj_x += 1;
+			} else {
+				obj_x += width / 2 - obj_width / 2;
+			}
+
+			if (ctx->plot->text(ctx,
+					    plot_fstyle_broken_object,
+					    obj_x, y + padding_top + (int)(height * 0.75),
+					    obj, sizeof(obj) - 1) != NSERROR_OK)
+				return false;
+		}
+	} else if (tag_type == DOM_HTML_ELEMENT_TYPE_CANVAS &&
+		   box->node != NULL &&
+		   box->flags & REPLACE_DIM) {
+		/* Canvas to draw */
+		struct bitmap *bitmap = NULL;
+		exc = dom_node_get_user_data(box->node,
+					     corestring_dom___ns_key_canvas_node_data,
+					     &bitmap);
+		if (exc != DOM_NO_ERR) {
+			bitmap = NULL;
+		}
+		if (bitmap != NULL &&
+		    ctx->plot->bitmap(ctx, bitmap, x + padding_left, y + padding_top,
+				      width, height, current_background_color,
+				      BITMAPF_NONE) != NSERROR_OK)
+			return false;
+	} else if (box->iframe) {
+		/* Offset is passed to browser window redraw unscaled */
+		browser_window_redraw(box->iframe,
+				x + padding_left,
+				y + padding_top, clip, ctx);
+
+	} else if (box->gadget && box->gadget->type == GADGET_CHECKBOX) {
+		if (!html_redraw_checkbox(x + padding_left, y + padding_top,
+				width, height, box->gadget->selected, ctx))
+			return false;
+
+	} else if (box->gadget && box->gadget->type == GADGET_RADIO) {
+		if (!html_redraw_radio(x + padding_left, y + padding_top,
+				width, height, box->gadget->selected, ctx))
+			return false;
+
+	} else if (box->gadget && box->gadget->type == GADGET_FILE) {
+		if (!html_redraw_file(x + padding_left, y + padding_top,
+				width, height, box, scale,
+				current_background_color, &html->unit_len_ctx, ctx))
+			return false;
+
+	} else if (box->gadget &&
+			(box->gadget->type == GADGET_TEXTAREA ||
+			box->gadget->type == GADGET_PASSWORD ||
+			box->gadget->type == GADGET_TEXTBOX)) {
+		textarea_redraw(box->gadget->data.text.ta, x, y,
+				current_background_color, scale, clip, ctx);
+
+	} else if (box->text) {
+		if (!html_redraw_text_box(html, box, x, y, clip, scale,
+				current_background_color, ctx))
+			return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * Draw the scrollbars of a box.
+ *
+ * \param  box	     box to draw scrollbars of
+ * \param  x_parent  coordinate of parent box
+ * \param  y_parent  coordinate of parent box
+ * \param  clip      clip rectangle
+ * \param  scale     scale for redraw
+ * \param  ctx	     current redraw context
+ */
+
+static void html_redraw_box_scrollbars(struct box *box,
+		int x_parent, int y_parent,
+		const struct rect *clip, const float scale,
+		const struct redraw_context *ctx)
+{
+	if (box->scroll_x != NULL)
+		scrollbar_redraw(box->scroll_x,
+				x_parent + box->x,
+				y_parent + box->y + box->padding[TOP] +
+				box->height + box->padding[BOTTOM] -
+				SCROLLBAR_WIDTH, clip, scale, ctx);
+	if (box->scroll_y != NULL)
+		scrollbar_redraw(box->scroll_y,
+				x_parent + box->x + box->padding[LEFT] +
+				box->width + box->padding[RIGHT] -
+				SCROLLBAR_WIDTH,
+				y_parent + box->y, clip, scale, ctx);
+}
+
+
+/**
+ * Draw a box and its descendants.
  *
  * \param  html	     html content
  * \param  box	     box to draw
@@ -1228,25 +1490,25 @@ static bool html_redraw_box_children(const html_content *html, struct box *box,
  * x, y, clip_[xy][01] are in target coordinates.
  */
 
-bool html_redraw_box(const html_content *html, struct box *box,
+static bool html_redraw_box_plot(const html_content *html, struct box *box,
 		int x_parent, int y_parent,
 		const struct rect *clip, const float scale,
 		colour current_background_color,
 		const struct redraw_context *ctx)
 {
 	const struct plotter_table *plot = ctx->plot;
+	struct html_redraw_list *list = html_redraw_list_recording(ctx);
 	int x, y;
 	int width, height;
 	int padding_left, padding_top, padding_width, padding_height;
 	int border_left, border_top, border_right, border_bottom;
 	struct rect r;
 	struct rect rect;
-	int x_scrolled, y_scrolled;
+	struct rect extent;
 	struct box *bg_box = NULL;
 	css_computed_clip_rect css_rect;
 	enum css_overflow_e overflow_x = CSS_OVERFLOW_VISIBLE;
 	enum css_overflow_e overflow_y = CSS_OVERFLOW_VISIBLE;
-	dom_exception exc;
 	dom_html_element_type tag_type;
 
 
@@ -1362,6 +1624,9 @@ bool html_redraw_box(const html_content *html, struct box *box,
 		}
 	}
 
+	/* area the box's content may plot within */
+	extent = r;
+
 	/* return if the rectangle is completely outside the clip rectangle */
 	if (clip->y1 < r.y0 || r.y1 < clip->y0 ||
 			clip->x1 < r.x0 || r.x1 < clip->x0)
@@ -1746,122 +2011,26 @@ bool html_redraw_box(const html_content *html, struct box *box,
 			return false;
 	}
 
-	if (box->node != NULL) {
-		exc = dom_html_element_get_tag_type(box->node, &tag_type);
-		if (exc != DOM_NO_ERR) {
-			tag_type = DOM_HTML_ELEMENT_TYPE__UNKNOWN;
-		}
-	} else {
-		tag_type = DOM_HTML_ELEMENT_TYPE__UNKNOWN;
-	}
-
-	if (box->object && width != 0 && height != 0) {
-		struct content_redraw_data obj_data;
-
-		x_scrolled = x - scrollbar_get_offset(box->scroll_x) * scale;
-		y_scrolled = y - scrollbar_get_offset(box->scroll_y) * scale;
-
-		obj_data.x = x_scrolled + padding_left;
-		obj_data.y = y_scrolled + padding_top;
-		obj_data.width = width;
-		obj_data.height = height;
-		obj_data.background_colour = current_background_color;
-		obj_data.scale = scale;
-		obj_data.repeat_x = false;
-		obj_data.repeat_y = false;
-
-		if (content_get_type(box->object) == CONTENT_HTML) {
-			obj_data.x /= scale;
-			obj_data.y /= scale;
-		}
-
-		if (!content_redraw(box->object, &obj_data, &r, ctx)) {
-			/* Show image fail */
-			/* Unicode (U+FFFC) 'OBJECT REPLACEMENT CHARACTER' */
-			const char *obj = "\xef\xbf\xbc";
-			int obj_width;
-			int obj_x = x + padding_left;
-			nserror res;
-
-			rect.x0 = x + padding_left;
-			rect.y0 = y + padding_top;
-			rect.x1 = x + padding_left + width - 1;
-			rect.y1 = y + padding_top + height - 1;
-			res = ctx->plot->rectangle(ctx, plot_style_broken_object, &rect);
-			if (res != NSERROR_OK) {
-				return false;
-			}
-
-			res = guit->layout->width(plot_fstyle_broken_object,
-						  obj,
-						  sizeof(obj) - 1,
-						  &obj_width);
-			if (res != NSERROR_OK) {
-				obj_x += 1;
-			} else {
-				obj_x += width / 2 - obj_width / 2;
-			}
-
-			if (ctx->plot->text(ctx,
-					    plot_fstyle_broken_object,
-					    obj_x, y + padding_top + (int)(height * 0.75),
-					    obj, sizeof(obj) - 1) != NSERROR_OK)
-				return false;
-		}
-	} else if (tag_type == DOM_HTML_ELEMENT_TYPE_CANVAS &&
-		   box->node != NULL &&
-		   box->flags & REPLACE_DIM) {
-		/* Canvas to draw */
-		struct bitmap *bitmap = NULL;
-		exc = dom_node_get_user_data(box->node,
-					     corestring_dom___ns_key_canvas_node_data,
-					     &bitmap);
-		if (exc != DOM_NO_ERR) {
-			bitmap = NULL;
-		}
-		if (bitmap != NULL &&
-		    ctx->plot->bitmap(ctx, bitmap, x + padding_left, y + padding_top,
-				      width, height, current_background_color,
-				      BITMAPF_NONE) != NSERROR_OK)
-			return false;
-	} else if (box->iframe) {
-		/* Offset is passed to browser window redraw unscaled */
-		browser_window_redraw(box->iframe,
-				x + padding_left,
-				y + padding_top, &r, ctx);
-
-	} else if (box->gadget && box->gadget->type == GADGET_CHECKBOX) {
-		if (!html_redraw_checkbox(x + padding_left, y + padding_top,
-				width, height, box->gadget->selected, ctx))
-			return false;
-
-	} else if (box->gadget && box->gadget->type == GADGET_RADIO) {
-		if (!html_redraw_radio(x + padding_left, y + padding_top,
-				width, height, box->gadget->selected, ctx))
-			return false;
+	tag_type = html_redraw_box_tag_type(box);
 
-	} else if (box->gadget && box->gadget->type == GADGET_FILE) {
-		if (!html_redraw_file(x + padding_left, y + padding_top,
-				width, height, box, scale,
-				current_background_color, &html->unit_len_ctx, ctx))
+	if (!html_redraw_box_is_replaced(box, tag_type, width, height)) {
+		if (!html_redraw_box_children(html, box, x_parent, y_parent, &r,
+				scale, current_background_color, ctx))
 			return false;
 
-	} else if (box->gadget &&
-			(box->gadget->type == GADGET_TEXTAREA ||
-			box->gadget->type == GADGET_PASSWORD ||
-			box->gadget->type == GADGET_TEXTBOX)) {
-		textarea_redraw(box->gadget->data.text.ta, x, y,
-				current_background_color, scale, &r, ctx);
-
-	} else if (box->text) {
-		if (!html_redraw_text_box(html, box, x, y, &r, scale,
-				current_background_color, ctx))
+	} else if (list != NULL) {
+		/* content may change without the box tree changing, so it is
+		 * plotted each time the display list is replayed */
+		if (html_redraw_list_add_box(list,
+				HTML_REDRAW_LIST_BOX_CONTENT, box, x, y,
+				&r, &extent, current_background_color) !=
+				NSERROR_OK)
 			return false;
 
-	} else {
-		if (!html_redraw_box_children(html, box, x_parent, y_parent, &r,
-				scale, current_background_color, ctx))
-			return false;
+	} else if (!html_redraw_box_content(html, box, tag_type, x, y,
+			width, height, padding_left, padding_top, &r,
+			scale, current_background_color, ctx)) {
+		return false;
 	}
 
 	if (box->type == BOX_BLOCK || box->type == BOX_INLINE_BLOCK ||
@@ -1906,18 +2075,22 @@ bool html_redraw_box(const html_content *html, struct box *box,
 			return false;
 		}
 
-		if (box->scroll_x != NULL)
-			scrollbar_redraw(box->scroll_x,
-					x_parent + box->x,
-					y_parent + box->y + box->padding[TOP] +
-					box->height + box->padding[BOTTOM] -
-					SCROLLBAR_WIDTH, clip, scale, ctx);
-		if (box->scroll_y != NULL)
-			scrollbar_redraw(box->scroll_y,
-					x_parent + box->x + box->padding[LEFT] +
-					box->width + box->padding[RIGHT] -
-					SCROLLBAR_WIDTH,
-					y_parent + box->y, clip, scale, ctx);
+		if (list != NULL) {
+			/* scrollbars are plotted each time the display list
+			 * is replayed, to show their current state */
+			rect.x0 = x;
+			rect.y0 = y;
+			rect.x1 = x + padding_width;
+			rect.y1 = y + padding_height;
+			if (html_redraw_list_add_box(list,
+					HTML_REDRAW_LIST_BOX_SCROLLBARS, box,
+					x_parent, y_parent, clip, &rect,
+					current_background_color) != NSERROR_OK)
+				return false;
+		} else {
+			html_redraw_box_scrollbars(box, x_parent, y_parent,
+					clip, scale, ctx);
+		}
 	}
 
 	if (box->type == BOX_BLOCK || box->type == BOX_INLINE_BLOCK ||
@@ -1929,6 +2102,164 @@ bool html_redraw_box(const html_content *html, struct box *box,
 	return ((!plot->group_end) || (ctx->plot->group_end(ctx) == NSERROR_OK));
 }
 
+/**
+ * Recursively draw a box.
+ *
+ * \param  html	     html content
+ * \param  box	     box to draw
+ * \param  x_parent  coordinate of parent box
+ * \param  y_parent  coordinate of parent box
+ * \param  clip      clip rectangle
+ * \param  scale     scale for redraw
+ * \param  current_background_color  background colour under this box
+ * \param  ctx	     current redraw context
+ * \return true if successful, false otherwise
+ *
+ * x, y, clip_[xy][01] are in target coordinates.
+ *
+ * When recording a display list, boxes whose redraw may change without a
+ * reflow start a segment of the list which can be recorded again alone.
+ */
+
+bool html_redraw_box(const html_content *html, struct box *box,
+		int x_parent, int y_parent,
+		const struct rect *clip, const float scale,
+		colour current_background_color,
+		const struct redraw_context *ctx)
+{
+	struct html_redraw_list *list = html_redraw_list_recording(ctx);
+	int segment;
+	bool result;
+
+	if (list == NULL || (box->parent != NULL &&
+			box->object == NULL && box->iframe == NULL &&
+			box->gadget == NULL && (box->style == NULL ||
+			(css_computed_overflow_x(box->style) ==
+					CSS_OVERFLOW_VISIBLE &&
+			 css_computed_overflow_y(box->style) ==
+					CSS_OVERFLOW_VISIBLE)))) {
+		return html_redraw_box_plot(html, box, x_parent, y_parent,
+				clip, scale, current_background_color, ctx);
+	}
+
+	segment = html_redraw_list_segment_start(list, box, x_parent, y_parent,
+			clip, current_background_color);
+	if (segment == -1)
+		return false;
+
+	result = html_redraw_box_plot(html, box, x_parent, y_parent,
+			clip, scale, current_background_color, ctx);
+
+	html_redraw_list_segment_end(list, segment);
+
+	return result;
+}
+
+
+/**
+ * Record a box for a display list.
+ *
+ * Callback for html_redraw_list_update().
+ */
+
+static bool html_redraw_list_record(void *pw, struct box *box,
+		int x_parent, int y_parent, const struct rect *clip,
+		colour background, const struct redraw_context *ctx)
+{
+	return html_redraw_box(pw, box, x_parent, y_parent, clip, 1.0,
+			background, ctx);
+}
+
+
+/**
+ * Plot a display list item which refers back to its box.
+ *
+ * Callback for html_redraw_list_replay().
+ */
+
+static bool html_redraw_list_plot_box(void *pw,
+		enum html_redraw_list_box_type type, struct box *box,
+		int x, int y, const struct rect *clip, colour background,
+		const struct redraw_context *ctx)
+{
+	switch (type) {
+	case HTML_REDRAW_LIST_BOX_CONTENT:
+		return html_redraw_box_content(pw, box,
+				html_redraw_box_tag_type(box), x, y,
+				box->width, box->height,
+				box->padding[LEFT], box->padding[TOP],
+				clip, 1.0, background, ctx);
+
+	case HTML_REDRAW_LIST_BOX_SCROLLBARS:
+		html_redraw_box_scrollbars(box, x, y, clip, 1.0, ctx);
+		break;
+	}
+
+	return true;
+}
+
+
+/**
+ * Draw the box tree of a CONTENT_HTML.
+ *
+ * Interactive redraws at unit scale are replayed from the document's
+ * display list, which is recorded first if required. Other redraws, and
+ * any for which the display list can't be recorded, walk the box tree.
+ *
+ * \param  html	     html content
+ * \param  data	     redraw data for this content redraw
+ * \param  clip	     current clip region
+ * \param  background  background colour under the document
+ * \param  ctx	     current redraw context
+ * \return true if successful, false otherwise
+ */
+
+static bool html_redraw_layout(html_content *html,
+		struct content_redraw_data *data, const struct rect *clip,
+		colour background, const struct redraw_context *ctx)
+{
+	nserror res;
+
+	if (!ctx->interactive || html_redraw_printing || data->scale != 1.0) {
+		return html_redraw_box(html, html->layout, data->x, data->y,
+				clip, data->scale, background, ctx);
+	}
+
+	if (html->redraw_list != NULL &&
+			!html_redraw_list_matches(html->redraw_list, background,
+					ctx->background_images,
+					html_redraw_debug)) {
+		html_redraw_list_destroy(html->redraw_list);
+		html->redraw_list = NULL;
+	}
+
+	if (html->redraw_list == NULL) {
+		res = html_redraw_list_create(background,
+				ctx->background_images, html_redraw_debug,
+				&html->redraw_list);
+		if (res != NSERROR_OK) {
+			return html_redraw_box(html, html->layout,
+					data->x, data->y, clip, data->scale,
+					background, ctx);
+		}
+	}
+
+	res = html_redraw_list_update(html->redraw_list, html->layout,
+			html_redraw_list_record, html);
+	if (res != NSERROR_OK) {
+		NSLOG(netsurf, INFO, "Unable to record display list: %s",
+		      messages_get_errorcode(res));
+		html_redraw_list_destroy(html->redraw_list);
+		html->redraw_list = NULL;
+		return html_redraw_box(html, html->layout, data->x, data->y,
+				clip, data->scale, background, ctx);
+	}
+
+	return html_redraw_list_replay(html->redraw_list, data->x, data->y,
+			clip, html_redraw_list_plot_box, html, ctx);
+}
+
+
 /**
  * Draw a CONTENT_HTML using the current set of plotters (plot).
  *
@@ -1956,6 +2287,8 @@ bool html_redraw(struct content *c, struct content_redraw_data *data,
 	box = html->layout;
 	assert(box);
 
+	guit->misc->phase("html_redraw", true);
+
 	/* The select menu needs special treating because, when opened, it
 	 * reaches beyond its layout box.
 	 */
@@ -1979,8 +2312,8 @@ bool html_redraw(struct content *c, struct content_redraw_data *data,
 
 		result &= (ctx->plot->rectangle(ctx, &pstyle_fill_bg, clip) == NSERROR_OK);
 
-		result &= html_redraw_box(html, box, data->x, data->y, clip,
-				data->scale, pstyle_fill_bg.fill_colour, ctx);
+		result &= html_redraw_layout(html, data, clip,
+				pstyle_fill_bg.fill_colour, ctx);
 	}
 
 	if (select) {
@@ -1996,6 +2329,8 @@ bool html_redraw(struct content *c, struct content_redraw_data *data,
 				data->scale, clip, ctx);
 	}
 
+	guit->misc->phase("html_redraw", false);
+
 	return result;
 
 }
@@ -0,0 +1,1096 @@
+/*
+ * Copyright 2026 NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Retained display list for HTML redraw implementation.
+ *
+ * Items are held in paint order in a single array. The spatial index
+ * divides the document into horizontal rows, each listing the items
+ * which intersect it in paint order, so a redraw only considers the
+ * items in the rows its clip rectangle covers.
+ */
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/errors.h"
+#include "utils/log.h"
+#include "netsurf/content.h"
+#include "netsurf/plotters.h"
+
+#include "html/box.h"
+#include "html/redraw_list.h"
+
+/** Height of the rows of the spatial index, in pixels */
+#define ROW_HEIGHT 256
+
+/** Maximum number of rows in the spatial index */
+#define MAX_ROWS 4096
+
+/** Coordinate bounding the clip rectangle used to record a document */
+#define UNCLIPPED (INT_MAX / 4)
+
+/** Maximum number of points in a recorded polygon */
+#define MAX_POLYGON_POINTS 4
+
+enum html_redraw_item_type {
+	ITEM_RECTANGLE,
+	ITEM_LINE,
+	ITEM_POLYGON,
+	ITEM_CONTENT,
+	ITEM_BOX
+};
+
+/**
+ * A display list item
+ *
+ * All coordinates are in document space.
+ */
+struct html_redraw_item {
+	enum html_redraw_item_type type;
+	struct rect clip; /**< Clip rectangle in force for the item */
+	struct rect bounds; /**< Area the item may plot within */
+	union {
+		struct {
+			plot_style_t style;
+			struct rect rect;
+		} rectangle; /**< ITEM_RECTANGLE and ITEM_LINE */
+		struct {
+			plot_style_t style;
+			int p[MAX_POLYGON_POINTS * 2];
+			unsigned int n;
+		} polygon; /**< ITEM_POLYGON */
+		struct {
+			struct hlcache_handle *content;
+			struct content_redraw_data data;
+		} content; /**< ITEM_CONTENT */
+		struct {
+			enum html_redraw_list_box_type type;
+			struct box *box;
+			int x;
+			int y;
+			struct rect area; /**< Clip passed to box redraw */
+			colour background;
+		} box; /**< ITEM_BOX */
+	} data;
+};
+
+/**
+ * A segment of a display list
+ *
+ * Holds the parameters a box subtree was recorded with, so it can be
+ * recorded again in place.
+ */
+struct html_redraw_segment {
+	struct box *box; /**< Box at root of the subtree */
+	unsigned int first; /**< Index of first item of segment */
+	unsigned int count; /**< Number of items in segment */
+	unsigned int nested; /**< Number of segments nested within */
+	int x_parent;
+	int y_parent;
+	struct rect clip;
+	colour background;
+	bool invalid; /**< Segment must be recorded again */
+};
+
+/**
+ * A retained display list
+ */
+struct html_redraw_list {
+	/* parameters of recording */
+	colour background;
+	bool background_images;
+	bool debug;
+
+	struct html_redraw_item *items; /**< Items in paint order */
+	unsigned int item_count;
+	unsigned int item_alloc;
+
+	struct html_redraw_segment *segments; /**< Segments in start order */
+	unsigned int segment_count;
+	unsigned int segment_alloc;
+
+	bool invalid; /**< Some segments must be recorded again */
+
+	/** Clip rectangle in force while recording */
+	struct rect recording_clip;
+
+	bool indexed; /**< Spatial index is up to date */
+	int row_y0; /**< Top of the first row of the index */
+	int row_height; /**< Height of index rows */
+	unsigned int row_count; /**< Number of rows in the index */
+	unsigned int *row_start; /**< Start of each row in row_items */
+	unsigned int *row_items; /**< Item indices for each row in turn */
+
+	unsigned int *found; /**< Items found by a query */
+	unsigned int found_alloc;
+};
+
+static const struct plotter_table html_redraw_list_plotters;
+
+
+/**
+ * Intersect two rectangles
+ *
+ * \param a       First rectangle, updated to the intersection
+ * \param b       Second rectangle
+ * \return true if the intersection is not empty, false otherwise
+ */
+static inline bool rect_intersect(struct rect *a, const struct rect *b)
+{
+	if (a->x0 < b->x0) {
+		a->x0 = b->x0;
+	}
+	if (a->y0 < b->y0) {
+		a->y0 = b->y0;
+	}
+	if (a->x1 > b->x1) {
+		a->x1 = b->x1;
+	}
+	if (a->y1 > b->y1) {
+		a->y1 = b->y1;
+	}
+
+	return (a->x0 < a->x1) && (a->y0 < a->y1);
+}
+
+
+/**
+ * Allocate a new item at the end of a display list
+ *
+ * \param list  The list being recorded
+ * \param type  Type of item
+ * \param item_out  Updated to the new item
+ * \return NSERROR_OK on success, NSERROR_NOMEM on memory exhaustion
+ */
+static nserror
+html_redraw_list_add(struct html_redraw_list *list,
+		     enum html_redraw_item_type type,
+		     struct html_redraw_item **item_out)
+{
+	struct html_redraw_item *item;
+
+	if (list->item_count == list->item_alloc) {
+		unsigned int alloc = list->item_alloc ?
+				list->item_alloc * 2 : 256;
+
+		item = realloc(list->items, alloc * sizeof(*item));
+		if (item == NULL) {
+			return NSERROR_NOMEM;
+		}
+		list->items = item;
+		list->item_alloc = alloc;
+	}
+
+	item = &list->items[list->item_count++];
+	item->type = type;
+	item->clip = list->recording_clip;
+
+	list->indexed = false;
+
+	*item_out = item;
+	return NSERROR_OK;
+}
+
+
+/**
+ * Set the bounds of an item to an area expanded by a stroke width
+ *
+ * \param item   Item to set bounds of
+ * \param area   Area plotted by the item
+ * \param style  Style the area is plotted with
+ * \return true if the item plots anything, false otherwise
+ */
+static bool
+html_redraw_list_set_bounds(struct html_redraw_item *item,
+			    const struct rect *area,
+			    const plot_style_t *style)
+{
+	int stroke = 0;
+
+	if (style->stroke_type != PLOT_OP_TYPE_NONE) {
+		stroke = plot_style_fixed_to_int(style->stroke_width) / 2 + 1;
+	}
+
+	item->bounds.x0 = area->x0 - stroke;
+	item->bounds.y0 = area->y0 - stroke;
+	item->bounds.x1 = area->x1 + stroke + 1;
+	item->bounds.y1 = area->y1 + stroke + 1;
+
+	return rect_intersect(&item->bounds, &item->clip);
+}
+
+
+/* Recording plotters */
+
+static struct html_redraw_list *
+html_redraw_list_from_ctx(const struct redraw_context *ctx)
+{
+	return ctx->priv;
+}
+
+static nserror
+html_redraw_list_plot_clip(const struct redraw_context *ctx,
+			   const struct rect *clip)
+{
+	html_redraw_list_from_ctx(ctx)->recording_clip = *clip;
+	return NSERROR_OK;
+}
+
+/**
+ * Record a rectangle or line
+ *
+ * \param ctx    Recording redraw context
+ * \param type   ITEM_RECTANGLE or ITEM_LINE
+ * \param style  Style to plot with
+ * \param rect   Rectangle, or line end points
+ * \return NSERROR_OK on success, NSERROR_NOMEM on memory exhaustion
+ */
+static nserror
+html_redraw_list_add_rectangle(const struct redraw_context *ctx,
+			       enum html_redraw_item_type type,
+			       const plot_style_t *style,
+			       const struct rect *rect)
+{
+	struct html_redraw_list *list = html_redraw_list_from_ctx(ctx);
+	struct html_redraw_item *item;
+	struct rect area = *rect;
+	nserror res;
+
+	res = html_redraw_list_add(list, type, &item);
+	if (res != NSERROR_OK) {
+		return res;
+	}
+
+	item->data.rectangle.style = *style;
+	item->data.rectangle.rect = *rect;
+
+	/* rectangles may be given with their corners either way round */
+	if (area.x0 > area.x1) {
+		area.x0 = rect->x1;
+		area.x1 = rect->x0;
+	}
+	if (area.y0 > area.y1) {
+		area.y0 = rect->y1;
+		area.y1 = rect->y0;
+	}
+
+	if (!html_redraw_list_set_bounds(item, &area, style)) {
+		/* entirely clipped out */
+		list->item_count--;
+	}
+
+	return NSERROR_OK;
+}
+
+static nserror
+html_redraw_list_plot_rectangle(const struct redraw_context *ctx,
+				const plot_style_t *style,
+				const struct rect *rect)
+{
+	return html_redraw_list_add_rectangle(ctx, ITEM_RECTANGLE,
+			style, rect);
+}
+
+static nserror
+html_redraw_list_plot_line(const struct redraw_context *ctx,
+			   const plot_style_t *style,
+			   const struct rect *line)
+{
+	return html_redraw_list_add_rectangle(ctx, ITEM_LINE, style, line);
+}
+
+static nserror
+html_redraw_list_plot_polygon(const struct redraw_context *ctx,
+			      const plot_style_t *style,
+			      const int *p,
+			      unsigned int n)
+{
+	struct html_redraw_list *list = html_redraw_list_from_ctx(ctx);
+	struct html_redraw_item *item;
+	struct rect area;
+	unsigned int i;
+	nserror res;
+
+	if (n == 0) {
+		return NSERROR_OK;
+	}
+	if (n > MAX_POLYGON_POINTS) {
+		return NSERROR_NOT_IMPLEMENTED;
+	}
+
+	res = html_redraw_list_add(list, ITEM_POLYGON, &item);
+	if (res != NSERROR_OK) {
+		return res;
+	}
+
+	item->data.polygon.style = *style;
+	item->data.polygon.n = n;
+	memcpy(item->data.polygon.p, p, n * 2 * sizeof(int));
+
+	area.x0 = area.x1 = p[0];
+	area.y0 = area.y1 = p[1];
+	for (i = 1; i < n; i++) {
+		if (p[i * 2] < area.x0) {
+			area.x0 = p[i * 2];
+		}
+		if (p[i * 2] > area.x1) {
+			area.x1 = p[i * 2];
+		}
+		if (p[i * 2 + 1] < area.y0) {
+			area.y0 = p[i * 2 + 1];
+		}
+		if (p[i * 2 + 1] > area.y1) {
+			area.y1 = p[i * 2 + 1];
+		}
+	}
+
+	if (!html_redraw_list_set_bounds(item, &area, style)) {
+		list->item_count--;
+	}
+
+	return NSERROR_OK;
+}
+
+/**
+ * Plot operations which are never recorded.
+ *
+ * The box redraw code only uses these when plotting items which refer
+ * back to their box, so reaching them is an error which abandons the
+ * recording.
+ */
+static nserror
+html_redraw_list_plot_arc(const struct redraw_context *ctx,
+			  const plot_style_t *style,
+			  int x, int y, int radius, int angle1, int angle2)
+{
+	return NSERROR_NOT_IMPLEMENTED;
+}
+
+static nserror
+html_redraw_list_plot_disc(const struct redraw_context *ctx,
+			   const plot_style_t *style,
+			   int x, int y, int radius)
+{
+	return NSERROR_NOT_IMPLEMENTED;
+}
+
+static nserror
+html_redraw_list_plot_path(const struct redraw_context *ctx,
+			   const plot_style_t *pstyle,
+			   const float *p,
+			   unsigned int n,
+			   const float transform[6])
+{
+	return NSERROR_NOT_IMPLEMENTED;
+}
+
+static nserror
+html_redraw_list_plot_bitmap(const struct redraw_context *ctx,
+			     struct bitmap *bitmap,
+			     int x, int y,
+			     int width,
+			     int height,
+			     colour bg,
+			     bitmap_flags_t flags)
+{
+	return NSERROR_NOT_IMPLEMENTED;
+}
+
+static nserror
+html_redraw_list_plot_text(const struct redraw_context *ctx,
+			   const struct plot_font_style *fstyle,
+			   int x,
+			   int y,
+			   const char *text,
+			   size_t length)
+{
+	return NSERROR_NOT_IMPLEMENTED;
+}
+
+/** Plotters which record a display list */
+static const struct plotter_table html_redraw_list_plotters = {
+	.clip = html_redraw_list_plot_clip,
+	.arc = html_redraw_list_plot_arc,
+	.disc = html_redraw_list_plot_disc,
+	.line = html_redraw_list_plot_line,
+	.rectangle = html_redraw_list_plot_rectangle,
+	.polygon = html_redraw_list_plot_polygon,
+	.path = html_redraw_list_plot_path,
+	.bitmap = html_redraw_list_plot_bitmap,
+	.text = html_redraw_list_plot_text,
+	.option_knockout = false,
+};
+
+
+/* exported interface documented in html/redraw_list.h */
+struct html_redraw_list *
+html_redraw_list_recording(const struct redraw_context *ctx)
+{
+	if (ctx->plot != &html_redraw_list_plotters) {
+		return NULL;
+	}
+	return ctx->priv;
+}
+
+
+/* exported interface documented in html/redraw_list.h */
+int html_redraw_list_segment_start(struct html_redraw_list *list,
+		struct box *box, int x_parent, int y_parent,
+		const struct rect *clip, colour background)
+{
+	struct html_redraw_segment *segment;
+
+	if (list->segment_count == list->segment_alloc) {
+		unsigned int alloc = list->segment_alloc ?
+				list->segment_alloc * 2 : 64;
+
+		segment = realloc(list->segments, alloc * sizeof(*segment));
+		if (segment == NULL) {
+			return -1;
+		}
+		list->segments = segment;
+		list->segment_alloc = alloc;
+	}
+
+	segment = &list->segments[list->segment_count];
+	segment->box = box;
+	segment->first = list->item_count;
+	segment->count = 0;
+	segment->nested = 0;
+	segment->x_parent = x_parent;
+	segment->y_parent = y_parent;
+	segment->clip = *clip;
+	segment->background = background;
+	segment->invalid = false;
+
+	return list->segment_count++;
+}
+
+
+/* exported interface documented in html/redraw_list.h */
+void html_redraw_list_segment_end(struct html_redraw_list *list,
+		int segment)
+{
+	struct html_redraw_segment *s = &list->segments[segment];
+
+	s->count = list->item_count - s->first;
+	s->nested = list->segment_count - segment - 1;
+}
+
+
+/* exported interface documented in html/redraw_list.h */
+nserror html_redraw_list_add_box(struct html_redraw_list *list,
+		enum html_redraw_list_box_type type, struct box *box,
+		int x, int y, const struct rect *clip,
+		const struct rect *extent, colour background)
+{
+	struct html_redraw_item *item;
+	nserror res;
+
+	res = html_redraw_list_add(list, ITEM_BOX, &item);
+	if (res != NSERROR_OK) {
+		return res;
+	}
+
+	item->data.box.type = type;
+	item->data.box.box = box;
+	item->data.box.x = x;
+	item->data.box.y = y;
+	item->data.box.area = *clip;
+	item->data.box.background = background;
+
+	item->bounds = *extent;
+	if (!rect_intersect(&item->bounds, clip)) {
+		list->item_count--;
+	}
+
+	return NSERROR_OK;
+}
+
+
+/* exported interface documented in html/redraw_list.h */
+nserror html_redraw_list_add_content(struct html_redraw_list *list,
+		struct hlcache_handle *content,
+		const struct content_redraw_data *data,
+		const struct rect *clip)
+{
+	struct html_redraw_item *item;
+	nserror res;
+
+	if (clip->x0 >= clip->x1 || clip->y0 >= clip->y1) {
+		return NSERROR_OK;
+	}
+
+	res = html_redraw_list_add(list, ITEM_CONTENT, &item);
+	if (res != NSERROR_OK) {
+		return res;
+	}
+
+	item->clip = *clip;
+	item->bounds = *clip;
+	item->data.content.content = content;
+	item->data.content.data = *data;
+
+	return NSERROR_OK;
+}
+
+
+/* exported interface documented in html/redraw_list.h */
+nserror html_redraw_list_create(colour background, bool background_images,
+		bool debug, struct html_redraw_list **list_out)
+{
+	struct html_redraw_list *list;
+
+	list = calloc(1, sizeof(*list));
+	if (list == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	list->background = background;
+	list->background_images = background_images;
+	list->debug = debug;
+
+	*list_out = list;
+	return NSERROR_OK;
+}
+
+
+/* exported interface documented in html/redraw_list.h */
+void html_redraw_list_destroy(struct html_redraw_list *list)
+{
+	if (list == NULL) {
+		return;
+	}
+
+	free(list->items);
+	free(list->segments);
+	free(list->row_start);
+	free(list->row_items);
+	free(list->found);
+	free(list);
+}
+
+
+/* exported interface documented in html/redraw_list.h */
+bool html_redraw_list_matches(const struct html_redraw_list *list,
+		colour background, bool background_images, bool debug)
+{
+	return list->background == background &&
+		list->background_images == background_images &&
+		list->debug == debug;
+}
+
+
+/* exported interface documented in html/redraw_list.h */
+void html_redraw_list_invalidate(struct html_redraw_list *list,
+		struct box *box)
+{
+	unsigned int s;
+
+	if (list->segment_count == 0) {
+		return;
+	}
+
+	for (; box != NULL; box = box->parent) {
+		for (s = 0; s < list->segment_count; s++) {
+			if (list->segments[s].box == box) {
+				list->segments[s].invalid = true;
+				list->invalid = true;
+				return;
+			}
+		}
+	}
+
+	/* not part of any segment, so record the whole document */
+	list->segments[0].invalid = true;
+	list->invalid = true;
+}
+
+
+/**
+ * Record a segment of a display list again
+ *
+ * The items and nested segments are recorded at the end of their arrays
+ * then moved over those they replace.
+ *
+ * \param list    The list to update
+ * \param s       Index of segment to record
+ * \param record  Callback to record a box subtree
+ * \param pw      Client data for callback
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+static nserror
+html_redraw_list_rerecord(struct html_redraw_list *list, unsigned int s,
+			  html_redraw_list_record_cb *record, void *pw)
+{
+	struct html_redraw_segment old = list->segments[s];
+	struct redraw_context ctx = {
+		.interactive = true,
+		.background_images = list->background_images,
+		.plot = &html_redraw_list_plotters,
+		.priv = list,
+	};
+	unsigned int item_mark = list->item_count;
+	unsigned int segment_mark = list->segment_count;
+	unsigned int old_segments = old.nested + 1;
+	unsigned int new_items, new_segments;
+	struct html_redraw_item *items;
+	struct html_redraw_segment *segments;
+	unsigned int i;
+
+	list->recording_clip = old.clip;
+	if (!record(pw, old.box, old.x_parent, old.y_parent, &old.clip,
+		    old.background, &ctx)) {
+		return NSERROR_NOMEM;
+	}
+
+	new_items = list->item_count - item_mark;
+	new_segments = list->segment_count - segment_mark;
+	if (new_segments == 0 || list->segments[segment_mark].box != old.box) {
+		/* the box no longer starts a segment */
+		return NSERROR_INVALID;
+	}
+
+	/* move the new items into place */
+	items = malloc(new_items * sizeof(*items) + 1);
+	if (items == NULL) {
+		return NSERROR_NOMEM;
+	}
+	memcpy(items, list->items + item_mark, new_items * sizeof(*items));
+	memmove(list->items + old.first + new_items,
+		list->items + old.first + old.count,
+		(item_mark - old.first - old.count) * sizeof(*items));
+	memcpy(list->items + old.first, items, new_items * sizeof(*items));
+	free(items);
+	list->item_count = item_mark - old.count + new_items;
+
+	/* and the new segments */
+	segments = malloc(new_segments * sizeof(*segments));
+	if (segments == NULL) {
+		return NSERROR_NOMEM;
+	}
+	memcpy(segments, list->segments + segment_mark,
+	       new_segments * sizeof(*segments));
+	for (i = 0; i < new_segments; i++) {
+		segments[i].first = segments[i].first - item_mark + old.first;
+	}
+	for (i = s + old_segments; i < segment_mark; i++) {
+		list->segments[i].first += new_items;
+		list->segments[i].first -= old.count;
+	}
+	memmove(list->segments + s + new_segments,
+		list->segments + s + old_segments,
+		(segment_mark - s - old_segments) * sizeof(*segments));
+	memcpy(list->segments + s, segments,
+	       new_segments * sizeof(*segments));
+	free(segments);
+	list->segment_count = segment_mark - old_segments + new_segments;
+
+	/* update the segments this one is nested within */
+	for (i = 0; i < s; i++) {
+		if (i + list->segments[i].nested >= s) {
+			list->segments[i].count += new_items;
+			list->segments[i].count -= old.count;
+			list->segments[i].nested += new_segments;
+			list->segments[i].nested -= old_segments;
+		}
+	}
+
+	list->indexed = false;
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Build the spatial index of a display list
+ *
+ * \param list  The list to index
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+static nserror html_redraw_list_index(struct html_redraw_list *list)
+{
+	unsigned int *row_start;
+	unsigned int *row_items;
+	unsigned int row_count;
+	unsigned int total;
+	int y0 = INT_MAX;
+	int y1 = INT_MIN;
+	int row_height;
+	unsigned int i, r, r0, r1;
+
+	for (i = 0; i < list->item_count; i++) {
+		if (list->items[i].bounds.y0 < y0)
+			y0 = list->items[i].bounds.y0;
+		if (list->items[i].bounds.y1 > y1)
+			y1 = list->items[i].bounds.y1;
+	}
+	if (list->item_count == 0) {
+		y0 = y1 = 0;
+	}
+
+	/* pathologically tall documents get taller rows */
+	row_height = ROW_HEIGHT;
+	while ((y1 - y0) / row_height >= MAX_ROWS) {
+		row_height *= 2;
+	}
+	row_count = (y1 - y0) / row_height + 1;
+
+	row_start = calloc(row_count + 1, sizeof(*row_start));
+	if (row_start == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	/* count the items in each row */
+	for (i = 0; i < list->item_count; i++) {
+		r0 = (list->items[i].bounds.y0 - y0) / row_height;
+		r1 = (list->items[i].bounds.y1 - 1 - y0) / row_height;
+		for (r = r0; r <= r1; r++) {
+			row_start[r + 1]++;
+		}
+	}
+	for (r = 0; r < row_count; r++) {
+		row_start[r + 1] += row_start[r];
+	}
+	total = row_start[row_count];
+
+	row_items = malloc(total * sizeof(*row_items) + 1);
+	if (row_items == NULL) {
+		free(row_start);
+		return NSERROR_NOMEM;
+	}
+
+	/* fill each row in paint order, using the start of the following
+	 * row as a cursor and restoring it afterwards */
+	for (i = 0; i < list->item_count; i++) {
+		r0 = (list->items[i].bounds.y0 - y0) / row_height;
+		r1 = (list->items[i].bounds.y1 - 1 - y0) / row_height;
+		for (r = r0; r <= r1; r++) {
+			row_items[row_start[r]++] = i;
+		}
+	}
+	for (r = row_count; r > 0; r--) {
+		row_start[r] = row_start[r - 1];
+	}
+	row_start[0] = 0;
+
+	if (list->found_alloc < total) {
+		unsigned int *found = realloc(list->found,
+				total * sizeof(*found));
+		if (found == NULL) {
+			free(row_items);
+			free(row_start);
+			return NSERROR_NOMEM;
+		}
+		list->found = found;
+		list->found_alloc = total;
+	}
+
+	free(list->row_start);
+	free(list->row_items);
+	list->row_start = row_start;
+	list->row_items = row_items;
+	list->row_count = row_count;
+	list->row_height = row_height;
+	list->row_y0 = y0;
+	list->indexed = true;
+
+	NSLOG(netsurf, DEBUG, "%u items, %u segments, %u rows of %d",
+	      list->item_count, list->segment_count, row_count, row_height);
+
+	return NSERROR_OK;
+}
+
+
+/* exported interface documented in html/redraw_list.h */
+nserror html_redraw_list_update(struct html_redraw_list *list,
+		struct box *root, html_redraw_list_record_cb *record, void *pw)
+{
+	struct rect clip = {
+		-UNCLIPPED, -UNCLIPPED, UNCLIPPED, UNCLIPPED
+	};
+	struct redraw_context ctx = {
+		.interactive = true,
+		.background_images = list->background_images,
+		.plot = &html_redraw_list_plotters,
+		.priv = list,
+	};
+	unsigned int s;
+	nserror res;
+
+	if (list->segment_count != 0 && list->segments[0].box != root) {
+		/* the box tree has been replaced */
+		list->item_count = 0;
+		list->segment_count = 0;
+		list->invalid = false;
+		list->indexed = false;
+	}
+
+	if (list->segment_count == 0) {
+		/* record the whole document */
+		list->recording_clip = clip;
+		if (!record(pw, root, 0, 0, &clip, list->background, &ctx)) {
+			return NSERROR_NOMEM;
+		}
+		if (list->segment_count == 0 ||
+		    list->segments[0].box != root) {
+			return NSERROR_BAD_PARAMETER;
+		}
+	}
+
+	/* segments nested within an invalid segment are recorded with it,
+	 * so the outermost is always found first */
+	while (list->invalid) {
+		list->invalid = false;
+		for (s = 0; s < list->segment_count; s++) {
+			if (list->segments[s].invalid) {
+				res = html_redraw_list_rerecord(list, s,
+						record, pw);
+				if (res != NSERROR_OK) {
+					return res;
+				}
+				list->invalid = true;
+				break;
+			}
+		}
+	}
+
+	if (!list->indexed) {
+		return html_redraw_list_index(list);
+	}
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Compare item indices for sorting
+ */
+static int html_redraw_list_cmp(const void *a, const void *b)
+{
+	unsigned int ia = *(const unsigned int *)a;
+	unsigned int ib = *(const unsigned int *)b;
+
+	return (ia > ib) - (ia < ib);
+}
+
+
+/**
+ * Find the items of a display list which may plot within an area
+ *
+ * \param list    The list to search
+ * \param area    Area to search, in document space
+ * \param count   Updated to the number of items found
+ * \return Item indices in paint order
+ */
+static const unsigned int *
+html_redraw_list_find(struct html_redraw_list *list,
+		      const struct rect *area, unsigned int *count)
+{
+	int r0, r1, r;
+	unsigned int i, n = 0, last;
+
+	r0 = (area->y0 - list->row_y0) / list->row_height;
+	r1 = (area->y1 - 1 - list->row_y0) / list->row_height;
+	if (area->y0 < list->row_y0) {
+		r0 = 0;
+	}
+	if (area->y1 - 1 < list->row_y0) {
+		r1 = -1;
+	}
+	if (r1 >= (int)list->row_count) {
+		r1 = list->row_count - 1;
+	}
+
+	if (r0 > r1) {
+		*count = 0;
+		return NULL;
+	}
+
+	if (r0 == r1) {
+		/* the common case; a single row is already in order */
+		*count = list->row_start[r0 + 1] - list->row_start[r0];
+		return list->row_items + list->row_start[r0];
+	}
+
+	/* gather the rows, then restore paint order, dropping the copies of
+	 * items which span several rows */
+	for (r = r0; r <= r1; r++) {
+		for (i = list->row_start[r]; i < list->row_start[r + 1]; i++) {
+			list->found[n++] = list->row_items[i];
+		}
+	}
+	qsort(list->found, n, sizeof(*list->found), html_redraw_list_cmp);
+	for (i = 1, last = 0; i < n; i++) {
+		if (list->found[i] != list->found[last]) {
+			list->found[++last] = list->found[i];
+		}
+	}
+	n = (n == 0) ? 0 : last + 1;
+
+	*count = n;
+	return list->found;
+}
+
+
+/**
+ * Set the clip rectangle for an item being replayed
+ *
+ * \param clip     Clip rectangle required
+ * \param current  Clip rectangle in force, updated
+ * \param valid    Whether current is known, updated
+ * \param ctx      Current redraw context
+ * \return true on success, false on error
+ */
+static inline bool
+html_redraw_list_clip(const struct rect *clip, struct rect *current,
+		      bool *valid, const struct redraw_context *ctx)
+{
+	if (*valid &&
+	    current->x0 == clip->x0 && current->y0 == clip->y0 &&
+	    current->x1 == clip->x1 && current->y1 == clip->y1) {
+		return true;
+	}
+
+	*current = *clip;
+	*valid = true;
+
+	return ctx->plot->clip(ctx, clip) == NSERROR_OK;
+}
+
+
+/* exported interface documented in html/redraw_list.h */
+bool html_redraw_list_replay(struct html_redraw_list *list, int x, int y,
+		const struct rect *clip, html_redraw_list_box_cb *plot,
+		void *pw, const struct redraw_context *ctx)
+{
+	const struct html_redraw_item *item;
+	const unsigned int *found;
+	unsigned int count, i, j;
+	struct rect area;
+	struct rect current = { 0, 0, 0, 0 };
+	bool current_valid = false;
+	bool ok = true;
+
+	/* the clip rectangle in document space */
+	area.x0 = clip->x0 - x;
+	area.y0 = clip->y0 - y;
+	area.x1 = clip->x1 - x;
+	area.y1 = clip->y1 - y;
+
+	found = html_redraw_list_find(list, &area, &count);
+
+	for (i = 0; i < count && ok; i++) {
+		struct rect item_clip;
+		struct rect r;
+		int p[MAX_POLYGON_POINTS * 2];
+
+		item = &list->items[found[i]];
+
+		if (item->bounds.x1 <= area.x0 || area.x1 <= item->bounds.x0 ||
+		    item->bounds.y1 <= area.y0 || area.y1 <= item->bounds.y0)
+			continue;
+
+		item_clip = item->clip;
+		if (!rect_intersect(&item_clip, &area))
+			continue;
+		item_clip.x0 += x;
+		item_clip.y0 += y;
+		item_clip.x1 += x;
+		item_clip.y1 += y;
+
+		ok = html_redraw_list_clip(&item_clip, &current,
+				&current_valid, ctx);
+		if (!ok)
+			break;
+
+		switch (item->type) {
+		case ITEM_RECTANGLE:
+		case ITEM_LINE:
+			r = item->data.rectangle.rect;
+			r.x0 += x;
+			r.y0 += y;
+			r.x1 += x;
+			r.y1 += y;
+			if (item->type == ITEM_RECTANGLE) {
+				ok = ctx->plot->rectangle(ctx,
+						&item->data.rectangle.style,
+						&r) == NSERROR_OK;
+			} else {
+				ok = ctx->plot->line(ctx,
+						&item->data.rectangle.style,
+						&r) == NSERROR_OK;
+			}
+			break;
+
+		case ITEM_POLYGON:
+			for (j = 0; j < item->data.polygon.n; j++) {
+				p[j * 2] = item->data.polygon.p[j * 2] + x;
+				p[j * 2 + 1] = item->data.polygon.p[j * 2 + 1] + y;
+			}
+			ok = ctx->plot->polygon(ctx,
+					&item->data.polygon.style,
+					p, item->data.polygon.n) == NSERROR_OK;
+			break;
+
+		case ITEM_CONTENT:
+		{
+			struct content_redraw_data data;
+
+			data = item->data.content.data;
+			data.x += x;
+			data.y += y;
+
+			/* We just continue if redraw fails */
+			content_redraw(item->data.content.content,
+					&data, &item_clip, ctx);
+			current_valid = false;
+			break;
+		}
+
+		case ITEM_BOX:
+			r = item->data.box.area;
+			if (!rect_intersect(&r, &area))
+				break;
+			r.x0 += x;
+			r.y0 += y;
+			r.x1 += x;
+			r.y1 += y;
+			ok = plot(pw, item->data.box.type, item->data.box.box,
+					item->data.box.x + x,
+					item->data.box.y + y,
+					&r, item->data.box.background, ctx);
+			current_valid = false;
+			break;
+		}
+	}
+
+	NSLOG(netsurf, DEEPDEBUG, "replayed %u of %u items", count,
+	      list->item_count);
+
+	/* leave the clip rectangle as a box tree redraw would */
+	if (ok) {
+		ok = html_redraw_list_clip(clip, &current, &current_valid,
+				ctx);
+	}
+
+	return ok;
+}
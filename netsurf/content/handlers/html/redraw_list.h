@@ -0,0 +1,243 @@
+/*
+ * Copyright 2026 NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Interface to the retained display list for HTML redraw.
+ *
+ * The display list holds the output of a redraw of a whole document at
+ * unit scale, recorded by running the box redraw code with plotters
+ * which store their operations rather than plotting them. Redraws then
+ * replay only the items which intersect their clip rectangle instead of
+ * walking the box tree.
+ *
+ * Items whose appearance can change without a reflow, such as text
+ * (which may be selected), form gadgets, objects and scrollbars, are not
+ * recorded as plot operations. They refer back to their box and are
+ * plotted by the box redraw code each time they are replayed.
+ *
+ * The list is divided into segments, each holding the items recorded
+ * for the subtree of a box which may need recording again, such as a
+ * scrolling box. Invalidating a box causes the smallest segment
+ * containing it to be recorded again before the next replay.
+ */
+
+#ifndef NETSURF_HTML_REDRAW_LIST_H
+#define NETSURF_HTML_REDRAW_LIST_H
+
+#include <stdbool.h>
+
+#include "netsurf/types.h"
+
+struct box;
+struct rect;
+struct hlcache_handle;
+struct content_redraw_data;
+struct redraw_context;
+struct html_redraw_list;
+
+/**
+ * Types of item plotted by the box redraw code when replayed
+ */
+enum html_redraw_list_box_type {
+	/** The contents of a box: text, an object or a gadget */
+	HTML_REDRAW_LIST_BOX_CONTENT,
+	/** The scrollbars of a box, positioned relative to its parent */
+	HTML_REDRAW_LIST_BOX_SCROLLBARS
+};
+
+/**
+ * Record a box subtree into a display list
+ *
+ * Called to record a segment of the list. The box must be redrawn as
+ * html_redraw_box() would, using the recording context given.
+ *
+ * \param pw          Client data
+ * \param box         Box to record
+ * \param x_parent    Position of the box's parent
+ * \param y_parent    Position of the box's parent
+ * \param clip        Clip rectangle for the box
+ * \param background  Background colour beneath the box
+ * \param ctx         Recording redraw context
+ * \return true on success, false on error
+ */
+typedef bool (html_redraw_list_record_cb)(void *pw, struct box *box,
+		int x_parent, int y_parent, const struct rect *clip,
+		colour background, const struct redraw_context *ctx);
+
+/**
+ * Plot an item which refers back to its box
+ *
+ * \param pw          Client data
+ * \param type        Type of item
+ * \param box         Box the item was recorded for
+ * \param x           Position the item was recorded at, in target space
+ * \param y           Position the item was recorded at, in target space
+ * \param clip        Clip rectangle for the item, in target space
+ * \param background  Background colour beneath the item
+ * \param ctx         Current redraw context
+ * \return true on success, false on error
+ */
+typedef bool (html_redraw_list_box_cb)(void *pw,
+		enum html_redraw_list_box_type type, struct box *box,
+		int x, int y, const struct rect *clip, colour background,
+		const struct redraw_context *ctx);
+
+/**
+ * Create an empty display list
+ *
+ * \param background         Background colour beneath the document
+ * \param background_images  Whether background images are plotted
+ * \param debug              Whether box outlines are plotted
+ * \param list_out           Updated to the new list on success
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+nserror html_redraw_list_create(colour background, bool background_images,
+		bool debug, struct html_redraw_list **list_out);
+
+/**
+ * Destroy a display list
+ *
+ * \param list  The list to destroy, may be NULL
+ */
+void html_redraw_list_destroy(struct html_redraw_list *list);
+
+/**
+ * Check whether a display list was recorded with the given parameters
+ *
+ * \param list               The list to check
+ * \param background         Background colour beneath the document
+ * \param background_images  Whether background images are plotted
+ * \param debug              Whether box outlines are plotted
+ * \return true if the list can be replayed for a redraw with these
+ *         parameters, false otherwise
+ */
+bool html_redraw_list_matches(const struct html_redraw_list *list,
+		colour background, bool background_images, bool debug);
+
+/**
+ * Bring a display list up to date
+ *
+ * Records the whole document if the list is empty, and otherwise each
+ * invalidated segment, then rebuilds the spatial index if required.
+ *
+ * \param list    The list to update
+ * \param root    Root box of the document
+ * \param record  Callback to record a box subtree
+ * \param pw      Client data for callback
+ * \return NSERROR_OK on success, appropriate error otherwise. On error
+ *         the list must be destroyed.
+ */
+nserror html_redraw_list_update(struct html_redraw_list *list,
+		struct box *root, html_redraw_list_record_cb *record, void *pw);
+
+/**
+ * Replay a display list
+ *
+ * \param list  The list to replay
+ * \param x     Position of document in target space
+ * \param y     Position of document in target space
+ * \param clip  Clip rectangle, in target space
+ * \param plot  Callback to plot items which refer back to their box
+ * \param pw    Client data for callback
+ * \param ctx   Current redraw context
+ * \return true on success, false on error
+ */
+bool html_redraw_list_replay(struct html_redraw_list *list, int x, int y,
+		const struct rect *clip, html_redraw_list_box_cb *plot,
+		void *pw, const struct redraw_context *ctx);
+
+/**
+ * Invalidate the part of a display list holding a box
+ *
+ * The smallest segment containing the box is recorded again on the
+ * next update.
+ *
+ * \param list  The list to invalidate
+ * \param box   Box whose redraw has changed
+ */
+void html_redraw_list_invalidate(struct html_redraw_list *list,
+		struct box *box);
+
+/**
+ * Get the display list being recorded through a redraw context
+ *
+ * \param ctx  Redraw context
+ * \return The list being recorded, or NULL if ctx is not recording
+ */
+struct html_redraw_list *html_redraw_list_recording(
+		const struct redraw_context *ctx);
+
+/**
+ * Start a segment of a display list for a box subtree
+ *
+ * \param list        The list being recorded
+ * \param box         Box at the root of the subtree
+ * \param x_parent    Position of the box's parent
+ * \param y_parent    Position of the box's parent
+ * \param clip        Clip rectangle for the box
+ * \param background  Background colour beneath the box
+ * \return Segment number, to be passed to html_redraw_list_segment_end()
+ *         or -1 on memory exhaustion
+ */
+int html_redraw_list_segment_start(struct html_redraw_list *list,
+		struct box *box, int x_parent, int y_parent,
+		const struct rect *clip, colour background);
+
+/**
+ * Complete a segment of a display list
+ *
+ * \param list     The list being recorded
+ * \param segment  Segment number from html_redraw_list_segment_start()
+ */
+void html_redraw_list_segment_end(struct html_redraw_list *list,
+		int segment);
+
+/**
+ * Record an item which is plotted by the box redraw code
+ *
+ * \param list        The list being recorded
+ * \param type        Type of item
+ * \param box         Box the item is for
+ * \param x           Position to plot the item at
+ * \param y           Position to plot the item at
+ * \param clip        Clip rectangle to plot the item with
+ * \param extent      Area the item may cover
+ * \param background  Background colour beneath the item
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+nserror html_redraw_list_add_box(struct html_redraw_list *list,
+		enum html_redraw_list_box_type type, struct box *box,
+		int x, int y, const struct rect *clip,
+		const struct rect *extent, colour background);
+
+/**
+ * Record the redraw of a content, such as a background image
+ *
+ * \param list     The list being recorded
+ * \param content  Content to redraw
+ * \param data     Redraw data for the content
+ * \param clip     Clip rectangle for the content
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+nserror html_redraw_list_add_content(struct html_redraw_list *list,
+		struct hlcache_handle *content,
+		const struct content_redraw_data *data,
+		const struct rect *clip);
+
+#endif
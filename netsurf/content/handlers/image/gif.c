@@ -36,6 +36,7 @@
 #include <stdlib.h>
 
 #include <nsutils/assert.h>
+#include <nsutils/time.h>
 
 #include <nsgif.h>
 
@@ -61,6 +62,8 @@ typedef struct gif_content {
 
 	nsgif_t *gif; /**< GIF animation data */
 	uint32_t current_frame;   /**< current frame to display [0...(max-1)] */
+	uint64_t frame_due; /**< time the next frame is due, in ms, or 0 */
+	bool suspended; /**< animation stopped while nobody sees it */
 } gif_content;
 
 static inline nserror gif__nsgif_error_to_ns(nsgif_error gif_res)
@@ -186,10 +189,22 @@ static nserror gif__animate(gif_content *gif, bool redraw)
 	}
 
 	gif->current_frame = f;
+	gif->frame_due = 0;
 
 	/* Continue animating if we should */
 	if (nsoption_bool(animate_images) && delay != NSGIF_INFINITE) {
-		guit->misc->schedule(delay * 10, gif_animate_cb, gif);
+		uint64_t now;
+
+		nsu_getmonotonic_ms(&now);
+		gif->frame_due = now + delay * 10;
+
+		if (content_is_visible(&gif->base)) {
+			guit->misc->schedule(delay * 10, gif_animate_cb, gif);
+		} else {
+			/* Nobody is seeing the animation, so don't decode
+			 * any more frames until somebody does. */
+			gif->suspended = true;
+		}
 	}
 
 	if (redraw) {
@@ -363,6 +378,7 @@ static void gif_add_user(struct content *c)
 
 	if (content_count_users(c) == 1) {
 		/* First user, and content already converted, so start the animation. */
+		gif->suspended = false;
 		if (nsgif_reset(gif->gif) == NSGIF_OK) {
 			gif__animate(gif, true);
 		}
@@ -371,9 +387,88 @@ static void gif_add_user(struct content *c)
 
 static void gif_remove_user(struct content *c)
 {
+	gif_content *gif = (gif_content *) c;
+
 	if (content_count_users(c) == 1) {
 		/* Last user is about to be removed from this content, so stop the animation. */
 		guit->misc->schedule(-1, gif_animate_cb, c);
+		gif->suspended = false;
+	}
+}
+
+/**
+ * Resume a suspended animation at the frame it would have reached.
+ *
+ * Frames which fell due while the animation was suspended are skipped
+ * without being decoded. At most one pass through the frames is skipped;
+ * after a longer suspension the animation carries on from wherever that
+ * leaves it.
+ *
+ * \param gif The gif content to resume
+ */
+static void gif__resume(gif_content *gif)
+{
+	const nsgif_info_t *gif_info = nsgif_get_info(gif->gif);
+	union content_msg_data data;
+	nsgif_rect_t rect;
+	uint32_t delay = 0;
+	uint32_t skipped = 0;
+	uint32_t f;
+	uint64_t now;
+
+	nsu_getmonotonic_ms(&now);
+
+	while (gif->frame_due <= now) {
+		if (skipped++ == gif_info->frame_count) {
+			gif->frame_due = now;
+			break;
+		}
+
+		if (nsgif_frame_prepare(gif->gif, &rect, &delay,
+				&f) != NSGIF_OK) {
+			/* Animation finished */
+			gif->frame_due = 0;
+			break;
+		}
+
+		gif->current_frame = f;
+
+		if (delay == NSGIF_INFINITE) {
+			gif->frame_due = 0;
+			break;
+		}
+
+		gif->frame_due += delay * 10;
+	}
+
+	if (gif->frame_due != 0) {
+		guit->misc->schedule(gif->frame_due - now,
+				gif_animate_cb, gif);
+	}
+
+	/* the visible frame may have changed anywhere in the image */
+	data.redraw.x = 0;
+	data.redraw.y = 0;
+	data.redraw.width = gif->base.width;
+	data.redraw.height = gif->base.height;
+
+	content_broadcast(&gif->base, CONTENT_MSG_REDRAW, &data);
+}
+
+static void gif_set_visible(struct content *c, bool visible)
+{
+	gif_content *gif = (gif_content *) c;
+
+	if (!visible) {
+		guit->misc->schedule(-1, gif_animate_cb, c);
+		if (gif->frame_due != 0) {
+			gif->suspended = true;
+		}
+	} else if (gif->suspended) {
+		gif->suspended = false;
+		if (nsoption_bool(animate_images)) {
+			gif__resume(gif);
+		}
 	}
 }
 
@@ -415,6 +510,7 @@ static const content_handler gif_content_handler = {
 	.clone = gif_clone,
 	.add_user = gif_add_user,
 	.remove_user = gif_remove_user,
+	.set_visible = gif_set_visible,
 	.get_internal = gif_get_bitmap,
 	.type = gif_content_type,
 	.is_opaque = gif_content_is_opaque,
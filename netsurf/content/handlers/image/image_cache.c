@@ -19,6 +19,11 @@
 /**
  * \file
  * Cache implementation for bitmap images decoded into frontend format.
+ *
+ * Entries are found from their content through a hash index. Entries
+ * holding a bitmap are also kept on a least recently used list so the
+ * cleaner releases the bitmaps which have gone unused longest without
+ * examining every entry.
  */
 
 #include <assert.h>
@@ -32,6 +37,7 @@
 #include "utils/log.h"
 #include "netsurf/misc.h"
 #include "netsurf/bitmap.h"
+#include "netsurf/content.h"
 #include "content/llcache.h"
 #include "content/content_protected.h"
 #include "desktop/gui_internal.h"
@@ -39,6 +45,9 @@
 #include "image/image_cache.h"
 #include "image/image.h"
 
+/** Initial number of buckets in the content index */
+#define IMAGE_CACHE_INDEX_INITIAL_SIZE 64
+
 /**
  * Age of an entry within the cache
  *
@@ -54,6 +63,13 @@ struct image_cache_entry_s {
 	struct image_cache_entry_s *next; /**< next cache entry in list */
 	struct image_cache_entry_s *prev; /**< previous cache entry in list */
 
+	struct image_cache_entry_s *index_next; /**< next in index chain */
+	struct image_cache_entry_s *index_prev; /**< previous in index chain */
+
+	struct image_cache_entry_s *lru_next; /**< next less recently used */
+	struct image_cache_entry_s *lru_prev; /**< previous more recently used */
+	cache_age lru_age; /**< Age of last use of the bitmap */
+
 	/** content is used as a key */
 	struct content *content;
 	/** associated bitmap entry */
@@ -66,9 +82,17 @@ struct image_cache_entry_s {
 	unsigned int redraw_count; /**< number of times object has been drawn */
 	cache_age redraw_age; /**< Age of last redraw */
 	size_t bitmap_size; /**< size if storage occupied by bitmap */
+	size_t full_size; /**< size of bitmap at four bytes per pixel */
 	cache_age bitmap_age; /**< Age of last conversion to a bitmap by cache*/
 
 	int conversion_count; /**< Number of times image has been converted */
+
+	/** convert may produce bitmaps smaller than the content */
+	bool scalable;
+	/** convert rasterises the content at exactly the required size */
+	bool vector;
+	int decode_width; /**< width the bitmap has been required at */
+	int decode_height; /**< height the bitmap has been required at */
 };
 
 /**
@@ -89,11 +113,35 @@ struct image_cache_s {
 	/* The objects the cache holds */
 	struct image_cache_entry_s *entries;
 
+	/**
+	 * Hash index of the entries by content.
+	 *
+	 * Each bucket is a chain of entries linked through their
+	 * index_next and index_prev members.
+	 */
+	struct image_cache_entry_s **index;
+	/** Number of buckets in the index (a power of two) */
+	size_t index_size;
+	/** Number of entries in the index */
+	size_t index_count;
+
+	/** Entry holding the most recently used bitmap */
+	struct image_cache_entry_s *lru_head;
+	/** Entry holding the least recently used bitmap */
+	struct image_cache_entry_s *lru_tail;
+
+	/** Entry most recently returned by index in the entry list */
+	struct image_cache_entry_s *findn_entry;
+	/** Index of the most recently returned entry */
+	int findn_entryn;
+
 
 	/* Statistics for management algorithm */
 
 	/** total size of bitmaps currently allocated */
 	size_t total_bitmap_size;
+	/** total size of allocated bitmaps at four bytes per pixel */
+	size_t total_full_size;
 
 	/** Total count of bitmaps currently allocated */
 	int bitmap_count;
@@ -143,22 +191,53 @@ static struct image_cache_s *image_cache = NULL;
 /**
  * Find a cache entry by index.
  *
+ * Entries are usually enumerated in order so the walk starts from the
+ * previously found entry where possible.
+ *
  * \param entryn index of cache entry
  * \return cache entry at index or NULL if not found.
  */
 static struct image_cache_entry_s *image_cache__findn(int entryn)
 {
 	struct image_cache_entry_s *found;
+	int foundn = 0;
 
 	found = image_cache->entries;
-	while ((found != NULL) && (entryn > 0)) {
-		entryn--;
+	if ((image_cache->findn_entry != NULL) &&
+	    (image_cache->findn_entryn <= entryn)) {
+		found = image_cache->findn_entry;
+		foundn = image_cache->findn_entryn;
+	}
+
+	while ((found != NULL) && (foundn < entryn)) {
+		foundn++;
 		found = found->next;
 	}
+
+	image_cache->findn_entry = found;
+	image_cache->findn_entryn = foundn;
+
 	return found;
 }
 
 
+/**
+ * Compute the index hash of a content.
+ *
+ * \param c The content to hash.
+ * \return The hash value.
+ */
+static inline uint32_t image_cache__hash(const struct content *c)
+{
+	uint32_t hash;
+
+	/* contents are allocated so discard the low alignment bits */
+	hash = (uint32_t)((uintptr_t)c >> 3) * 2654435761u;
+
+	return hash ^ (hash >> 15);
+}
+
+
 /**
  * Find the cache entry for a content
  *
@@ -168,14 +247,165 @@ static struct image_cache_entry_s *image_cache__findn(int entryn)
 static struct image_cache_entry_s *image_cache__find(const struct content *c)
 {
 	struct image_cache_entry_s *found;
+	size_t bucket;
 
-	found = image_cache->entries;
+	bucket = image_cache__hash(c) & (image_cache->index_size - 1);
+
+	found = image_cache->index[bucket];
 	while ((found != NULL) && (found->content != c)) {
-		found = found->next;
+		found = found->index_next;
 	}
 	return found;
 }
 
+
+/**
+ * Double the number of buckets in the content index.
+ *
+ * If the larger table cannot be allocated the index continues to
+ * operate with longer chains.
+ */
+static void image_cache__index_grow(void)
+{
+	struct image_cache_entry_s **index;
+	struct image_cache_entry_s *centry, *next;
+	size_t size = image_cache->index_size * 2;
+	size_t bucket;
+	size_t idx;
+
+	index = calloc(size, sizeof(struct image_cache_entry_s *));
+	if (index == NULL) {
+		return;
+	}
+
+	for (idx = 0; idx < image_cache->index_size; idx++) {
+		for (centry = image_cache->index[idx];
+		     centry != NULL;
+		     centry = next) {
+			next = centry->index_next;
+
+			bucket = image_cache__hash(centry->content) & (size - 1);
+			centry->index_prev = NULL;
+			centry->index_next = index[bucket];
+			if (index[bucket] != NULL) {
+				index[bucket]->index_prev = centry;
+			}
+			index[bucket] = centry;
+		}
+	}
+
+	free(image_cache->index);
+	image_cache->index = index;
+	image_cache->index_size = size;
+}
+
+
+/**
+ * Add a cache entry to the content index.
+ *
+ * \param centry The entry to add, its content must be set.
+ */
+static void image_cache__index_add(struct image_cache_entry_s *centry)
+{
+	size_t bucket;
+
+	if (image_cache->index_count >= image_cache->index_size) {
+		image_cache__index_grow();
+	}
+
+	bucket = image_cache__hash(centry->content) &
+		(image_cache->index_size - 1);
+
+	centry->index_prev = NULL;
+	centry->index_next = image_cache->index[bucket];
+	if (centry->index_next != NULL) {
+		centry->index_next->index_prev = centry;
+	}
+	image_cache->index[bucket] = centry;
+
+	image_cache->index_count++;
+}
+
+
+/**
+ * Remove a cache entry from the content index.
+ *
+ * \param centry The entry to remove.
+ */
+static void image_cache__index_remove(struct image_cache_entry_s *centry)
+{
+	size_t bucket;
+
+	if (centry->index_prev == NULL) {
+		bucket = image_cache__hash(centry->content) &
+			(image_cache->index_size - 1);
+		image_cache->index[bucket] = centry->index_next;
+	} else {
+		centry->index_prev->index_next = centry->index_next;
+	}
+
+	if (centry->index_next != NULL) {
+		centry->index_next->index_prev = centry->index_prev;
+	}
+
+	centry->index_prev = NULL;
+	centry->index_next = NULL;
+
+	image_cache->index_count--;
+}
+
+
+/**
+ * Remove a cache entry from the least recently used list.
+ *
+ * \param centry The entry to remove, it need not be on the list.
+ */
+static void image_cache__lru_remove(struct image_cache_entry_s *centry)
+{
+	if (centry->lru_prev != NULL) {
+		centry->lru_prev->lru_next = centry->lru_next;
+	} else if (image_cache->lru_head == centry) {
+		image_cache->lru_head = centry->lru_next;
+	} else {
+		/* not on the list */
+		return;
+	}
+
+	if (centry->lru_next != NULL) {
+		centry->lru_next->lru_prev = centry->lru_prev;
+	} else {
+		image_cache->lru_tail = centry->lru_prev;
+	}
+
+	centry->lru_prev = NULL;
+	centry->lru_next = NULL;
+}
+
+
+/**
+ * Mark the bitmap of a cache entry as the most recently used.
+ *
+ * \param centry The entry holding a bitmap.
+ */
+static void image_cache__lru_touch(struct image_cache_entry_s *centry)
+{
+	centry->lru_age = image_cache->current_age;
+
+	if (image_cache->lru_head == centry) {
+		return;
+	}
+
+	image_cache__lru_remove(centry);
+
+	centry->lru_next = image_cache->lru_head;
+	if (centry->lru_next != NULL) {
+		centry->lru_next->lru_prev = centry;
+	} else {
+		image_cache->lru_tail = centry;
+	}
+	image_cache->lru_head = centry;
+}
+
 /**
  * Update the image cache statistics with an entry.
  *
@@ -186,7 +416,11 @@ static void image_cache_stats_bitmap_add(struct image_cache_entry_s *centry)
 	centry->bitmap_age = image_cache->current_age;
 	centry->conversion_count++;
 
+	/* frontends may store bitmaps more compactly than the estimate */
+	centry->bitmap_size = guit->bitmap->get_storage_size(centry->bitmap);
+
 	image_cache->total_bitmap_size += centry->bitmap_size;
+	image_cache->total_full_size += centry->full_size;
 	image_cache->bitmap_count++;
 
 	if (image_cache->total_bitmap_size > image_cache->max_bitmap_size) {
@@ -216,8 +450,30 @@ static void image_cache_stats_bitmap_add(struct image_cache_entry_s *centry)
 	}
 }
 
+/**
+ * Update the storage size of an entry whose bitmap may have changed.
+ *
+ * \param centry The image cache entry with a bitmap.
+ */
+static void image_cache__update_size(struct image_cache_entry_s *centry)
+{
+	size_t bitmap_size;
+
+	bitmap_size = guit->bitmap->get_storage_size(centry->bitmap);
+	if (bitmap_size != centry->bitmap_size) {
+		image_cache->total_bitmap_size -= centry->bitmap_size;
+		image_cache->total_bitmap_size += bitmap_size;
+		centry->bitmap_size = bitmap_size;
+	}
+}
+
 static void image_cache__link(struct image_cache_entry_s *centry)
 {
+	image_cache__index_add(centry);
+
+	/* entry indexes have all moved */
+	image_cache->findn_entry = NULL;
+
 	centry->next = image_cache->entries;
 	centry->prev = NULL;
 	if (centry->next != NULL) {
@@ -228,6 +484,10 @@ static void image_cache__link(struct image_cache_entry_s *centry)
 
 static void image_cache__unlink(struct image_cache_entry_s *centry)
 {
+	image_cache__index_remove(centry);
+
+	image_cache->findn_entry = NULL;
+
 	/* unlink entry */
 	if (centry->prev == NULL) {
 		/* first in list */
@@ -265,7 +525,9 @@ static void image_cache__free_bitmap(struct image_cache_entry_s *centry)
 #endif
 		guit->bitmap->destroy(centry->bitmap);
 		centry->bitmap = NULL;
+		image_cache__lru_remove(centry);
 		image_cache->total_bitmap_size -= centry->bitmap_size;
+		image_cache->total_full_size -= centry->full_size;
 		image_cache->bitmap_count--;
 		if (centry->redraw_count == 0) {
 			image_cache->specultive_miss_count++;
@@ -274,6 +536,65 @@ static void image_cache__free_bitmap(struct image_cache_entry_s *centry)
 
 }
 
+/**
+ * Record the size a scalable entries bitmap is required at.
+ *
+ * A bitmap which was converted smaller than the newly required size is
+ * freed so the next conversion produces a larger one. The bitmap of a
+ * vector entry is freed whenever the required size changes.
+ *
+ * \param centry The image cache entry.
+ * \param width The required width or zero for the full content width.
+ * \param height The required height or zero for the full content height.
+ */
+static void
+image_cache__require_size(struct image_cache_entry_s *centry,
+			  int width,
+			  int height)
+{
+	if (centry->vector) {
+		/* any existing bitmap will do when no size is given */
+		if ((width <= 0) || (height <= 0)) {
+			return;
+		}
+
+		if ((width != centry->decode_width) ||
+		    (height != centry->decode_height)) {
+			centry->decode_width = width;
+			centry->decode_height = height;
+			image_cache__free_bitmap(centry);
+		}
+		return;
+	}
+
+	if (!centry->scalable) {
+		return;
+	}
+
+	if ((width <= 0) || (width > centry->content->width)) {
+		width = centry->content->width;
+	}
+	if ((height <= 0) || (height > centry->content->height)) {
+		height = centry->content->height;
+	}
+
+	if ((width <= centry->decode_width) &&
+	    (height <= centry->decode_height)) {
+		return;
+	}
+
+	centry->decode_width = max(width, centry->decode_width);
+	centry->decode_height = max(height, centry->decode_height);
+
+	if ((centry->bitmap != NULL) &&
+	    ((guit->bitmap->get_width(centry->bitmap) <
+	      centry->decode_width) ||
+	     (guit->bitmap->get_height(centry->bitmap) <
+	      centry->decode_height))) {
+		image_cache__free_bitmap(centry);
+	}
+}
+
 /**
  * free image cache entry
  *
@@ -299,23 +620,29 @@ static void image_cache__free_entry(struct image_cache_entry_s *centry)
 /**
  * Image cache cleaner
  *
+ * Bitmaps are released from the least recently used end until the
+ * cache is within its hysteresis or the remaining bitmaps have been
+ * used recently.
+ *
  * \param icache The image cache context.
  */
 static void image_cache__clean(struct image_cache_s *icache)
 {
-	struct image_cache_entry_s *centry = icache->entries;
+	struct image_cache_entry_s *centry;
 
-	while (centry != NULL) {
-		if ((icache->current_age - centry->redraw_age) >
+	while ((centry = icache->lru_tail) != NULL) {
+		if (icache->total_bitmap_size <=
+		    (icache->params.limit - icache->params.hysteresis)) {
+			break;
+		}
+
+		/* only consider older entries, avoids active entries */
+		if ((icache->current_age - centry->lru_age) <=
 		    icache->params.bg_clean_time) {
-			/* only consider older entries, avoids active entries */
-			if ((icache->total_bitmap_size >
-			     (icache->params.limit - icache->params.hysteresis)) &&
-			    (rand() > (RAND_MAX / 2))) {
-				image_cache__free_bitmap(centry);
-			}
+			break;
 		}
-		centry=centry->next;
+
+		image_cache__free_bitmap(centry);
 	}
 }
 
@@ -342,16 +669,14 @@ static void image_cache__background_update(void *p)
 				icache);
 }
 
-/* exported interface documented in image_cache.h */
-struct bitmap *image_cache_get_bitmap(const struct content *c)
+/**
+ * Obtain the bitmap of a cache entry converting it if necessary.
+ *
+ * \param centry The image cache entry.
+ * \return The bitmap or NULL if conversion failed.
+ */
+static struct bitmap *image_cache__get_bitmap(struct image_cache_entry_s *centry)
 {
-	struct image_cache_entry_s *centry;
-
-	centry = image_cache__find(c);
-	if (centry == NULL) {
-		return NULL;
-	}
-
 	if (centry->bitmap == NULL) {
 		if (centry->convert != NULL) {
 			centry->bitmap = centry->convert(centry->content);
@@ -366,13 +691,34 @@ struct bitmap *image_cache_get_bitmap(const struct content *c)
 			image_cache->fail_size += centry->bitmap_size;
 		}
 	} else {
+		image_cache__update_size(centry);
 		image_cache->hit_count++;
 		image_cache->hit_size += centry->bitmap_size;
 	}
 
+	if (centry->bitmap != NULL) {
+		image_cache__lru_touch(centry);
+	}
+
 	return centry->bitmap;
 }
 
+/* exported interface documented in image_cache.h */
+struct bitmap *image_cache_get_bitmap(const struct content *c)
+{
+	struct image_cache_entry_s *centry;
+
+	centry = image_cache__find(c);
+	if (centry == NULL) {
+		return NULL;
+	}
+
+	/* callers may use the bitmap at any size */
+	image_cache__require_size(centry, 0, 0);
+
+	return image_cache__get_bitmap(centry);
+}
+
 /* exported interface documented in image_cache.h */
 bool image_cache_speculate(struct content *c)
 {
@@ -422,6 +768,15 @@ image_cache_init(const struct image_cache_parameters *image_cache_parameters)
 
 	image_cache->params = *image_cache_parameters;
 
+	image_cache->index_size = IMAGE_CACHE_INDEX_INITIAL_SIZE;
+	image_cache->index = calloc(image_cache->index_size,
+				    sizeof(struct image_cache_entry_s *));
+	if (image_cache->index == NULL) {
+		free(image_cache);
+		image_cache = NULL;
+		return NSERROR_NOMEM;
+	}
+
 	guit->misc->schedule(image_cache->params.bg_clean_time,
 				image_cache__background_update,
 				image_cache);
@@ -501,15 +856,28 @@ nserror image_cache_fini(void)
 	      image_cache->peak_conversions_size,
 	      image_cache->peak_conversions);
 
+	free(image_cache->index);
 	free(image_cache);
 
 	return NSERROR_OK;
 }
 
-/* exported interface documented in image_cache.h */
-nserror image_cache_add(struct content *content,
-			struct bitmap *bitmap,
-			image_cache_convert_fn *convert)
+/**
+ * Add or update the cache entry for a content.
+ *
+ * \param content The content used as a key
+ * \param bitmap The already converted content or NULL.
+ * \param convert Function to convert the content into a bitmap or NULL.
+ * \param scalable Whether convert may produce a reduced size bitmap.
+ * \param vector Whether convert rasterises at the required size.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror
+image_cache__add(struct content *content,
+		 struct bitmap *bitmap,
+		 image_cache_convert_fn *convert,
+		 bool scalable,
+		 bool vector)
 {
 	struct image_cache_entry_s *centry;
 
@@ -525,26 +893,32 @@ nserror image_cache_add(struct content *content,
 		if (centry == NULL) {
 			return NSERROR_NOMEM;
 		}
-		image_cache__link(centry);
 		centry->content = content;
+		image_cache__link(centry);
 
-		centry->bitmap_size = content->width * content->height * 4llu;
+		centry->full_size = content->width * content->height * 4llu;
+		centry->bitmap_size = centry->full_size;
 	}
 
 	NSLOG(netsurf, INFO, "centry %p, content %p, bitmap %p", centry,
 	      content, bitmap);
 
 	centry->convert = convert;
+	centry->scalable = scalable;
+	centry->vector = vector;
 
 	/* set bitmap entry if one is passed, free extant one if present */
 	if (bitmap != NULL) {
 		if (centry->bitmap != NULL) {
 			guit->bitmap->destroy(centry->bitmap);
+			centry->bitmap = bitmap;
+			image_cache__update_size(centry);
 		} else {
+			centry->bitmap = bitmap;
 			image_cache_stats_bitmap_add(centry);
 		}
-		centry->bitmap = bitmap;
-	} else {
+		image_cache__lru_touch(centry);
+	} else if (!vector) {
 		/* no bitmap, check to see if we should speculatively convert */
 		if ((centry->convert != NULL) &&
 		    (image_cache_speculate(content) == true)) {
@@ -552,6 +926,7 @@ nserror image_cache_add(struct content *content,
 
 			if (centry->bitmap != NULL) {
 				image_cache_stats_bitmap_add(centry);
+				image_cache__lru_touch(centry);
 			} else {
 				image_cache->fail_count++;
 			}
@@ -563,6 +938,46 @@ nserror image_cache_add(struct content *content,
 	return NSERROR_OK;
 }
 
+/* exported interface documented in image_cache.h */
+nserror image_cache_add(struct content *content,
+			struct bitmap *bitmap,
+			image_cache_convert_fn *convert)
+{
+	return image_cache__add(content, bitmap, convert, false, false);
+}
+
+/* exported interface documented in image_cache.h */
+nserror image_cache_add_scalable(struct content *content,
+				 image_cache_convert_fn *convert)
+{
+	return image_cache__add(content, NULL, convert, true, false);
+}
+
+/* exported interface documented in image_cache.h */
+nserror image_cache_add_vector(struct content *content,
+			       image_cache_convert_fn *convert)
+{
+	return image_cache__add(content, NULL, convert, false, true);
+}
+
+/* exported interface documented in image_cache.h */
+void image_cache_decode_size(const struct content *c, int *width, int *height)
+{
+	struct image_cache_entry_s *centry;
+
+	*width = c->width;
+	*height = c->height;
+
+	centry = image_cache__find(c);
+	if ((centry == NULL) || (centry->decode_width == 0)) {
+		/* size the content is required at is not yet known */
+		return;
+	}
+
+	*width = centry->decode_width;
+	*height = centry->decode_height;
+}
+
 /* exported interface documented in image_cache.h */
 nserror image_cache_remove(struct content *content)
 {
@@ -589,6 +1004,11 @@ int image_cache_snsummaryf(char *string, size_t size, const char *fmt)
 	bool pct;
 	unsigned int op_count;
 	uint64_t op_size;
+	struct bitmap_scale_cache_stats scale;
+	unsigned int scale_count;
+
+	guit->bitmap->get_scale_cache_stats(&scale);
+	scale_count = scale.hit_count + scale.miss_count;
 
 	op_count = image_cache->hit_count +
 		image_cache->miss_count +
@@ -667,6 +1087,38 @@ case chr :					\
 			FMTCHR('v', "d", total_extra_conversions_count);
 			FMTCHR('w', "u", peak_conversions_size);
 			FMTCHR('x', "d", peak_conversions);
+			FMTCHR('y', PRIsizet, total_full_size);
+
+			case 'A':
+				slen += snprintf(string + slen, size - slen,
+					"%u", pct ? ((scale_count > 0) ?
+					(unsigned int)((scale.hit_count * 100ull) /
+						       scale_count) : 100) :
+					scale.hit_count);
+				break;
+
+			case 'B':
+				slen += snprintf(string + slen, size - slen,
+					"%u", pct ? ((scale_count > 0) ?
+					(unsigned int)((scale.miss_count * 100ull) /
+						       scale_count) : 100) :
+					scale.miss_count);
+				break;
+
+			case 'C':
+				slen += snprintf(string + slen, size - slen,
+						 "%u", scale.count);
+				break;
+
+			case 'D':
+				slen += snprintf(string + slen, size - slen,
+						 "%"PRIsizet, scale.size);
+				break;
+
+			case 'E':
+				slen += snprintf(string + slen, size - slen,
+						 "%"PRIsizet, scale.limit);
+				break;
 
 
 			}
@@ -810,6 +1262,8 @@ bool image_cache_redraw(struct content *c,
 		return false;
 	}
 
+	image_cache__require_size(centry, data->width, data->height);
+
 	if (centry->bitmap == NULL) {
 		if (centry->convert != NULL) {
 			centry->bitmap = centry->convert(centry->content);
@@ -825,11 +1279,14 @@ bool image_cache_redraw(struct content *c,
 			return false;
 		}
 	} else {
+		image_cache__update_size(centry);
 		image_cache->hit_count++;
 		image_cache->hit_size += centry->bitmap_size;
 	}
 
 
+	image_cache__lru_touch(centry);
+
 	/* update statistics */
 	centry->redraw_count++;
 	centry->redraw_age = image_cache->current_age;
@@ -861,8 +1318,16 @@ void *image_cache_get_internal(const struct content *c, void *context)
 /* exported interface documented in image_cache.h */
 bool image_cache_is_opaque(struct content *c)
 {
+	struct image_cache_entry_s *centry;
 	struct bitmap *bmp;
-	bmp = image_cache_get_bitmap(c);
+
+	centry = image_cache__find(c);
+	if (centry == NULL) {
+		return false;
+	}
+
+	/* opacity does not depend on the size of the bitmap */
+	bmp = image_cache__get_bitmap(centry);
 	if (bmp != NULL) {
 		return guit->bitmap->get_opaque(bmp);
 	}
@@ -78,6 +78,49 @@ nserror image_cache_add(struct content *content,
 			struct bitmap *bitmap, 
 			image_cache_convert_fn *convert);
 
+/**
+ * Adds an image content whose conversion can produce a reduced size bitmap.
+ *
+ * The convert function should use image_cache_decode_size() to find the
+ * size the bitmap is needed at. The bitmap is converted again if the
+ * content is later required larger than the existing bitmap.
+ *
+ * @param content The content handle used as a key
+ * @param convert A function pointer to convert the content into a bitmap.
+ * @return A netsurf error code.
+ */
+nserror image_cache_add_scalable(struct content *content,
+				 image_cache_convert_fn *convert);
+
+/**
+ * Adds a vector image content which is rasterised at its redraw size.
+ *
+ * The convert function should use image_cache_decode_size() to find the
+ * size to rasterise at. The bitmap is converted again whenever the
+ * content is redrawn at a different size, or after it has been evicted.
+ * No speculative conversion is made as the size is not yet known.
+ *
+ * @param content The content handle used as a key
+ * @param convert A function pointer to rasterise the content.
+ * @return A netsurf error code.
+ */
+nserror image_cache_add_vector(struct content *content,
+			       image_cache_convert_fn *convert);
+
+/**
+ * Get the size a scalable content should be converted at.
+ *
+ * This is the largest size the content has been redrawn at, limited to
+ * the content dimensions, or the content dimensions when it has not
+ * been redrawn or the bitmap has been requested directly. For a vector
+ * content it is the size it was last redrawn at, without limit.
+ *
+ * @param c The content to be converted.
+ * @param width Updated with the width the bitmap is required at.
+ * @param height Updated with the height the bitmap is required at.
+ */
+void image_cache_decode_size(const struct content *c, int *width, int *height);
+
 nserror image_cache_remove(struct content *content);
 
 
@@ -156,6 +199,12 @@ int image_cache_snentryf(char *string, size_t size, unsigned int entryn,
  *     of times.
  * x The number of times the image that was converted (read missed cache) 
  *     highest number of times.
+ * y Current caches total size if every bitmap used four bytes per pixel
+ * A The number of plots using a front end cached scaled bitmap
+ * B The number of plots which scaled a bitmap into the front end cache
+ * C The number of bitmaps in the front end scaled bitmap cache
+ * D The size of the front end scaled bitmap cache
+ * E The configured limit of the front end scaled bitmap cache
  *
  * format modifiers:
  * A p before the value modifies the replacement to be a percentage.
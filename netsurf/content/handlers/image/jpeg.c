@@ -248,6 +248,34 @@ static inline void nsjpeg__decode_client_fmt(
 	} while (cinfo->output_scanline != cinfo->output_height);
 }
 
+/**
+ * Select the smallest DCT scaling which decodes at least the required size.
+ *
+ * libjpeg scales during the inverse DCT so a reduced size image is
+ * decoded with a fraction of the work and memory of the full image.
+ *
+ * \param cinfo The decompressor with the header read.
+ * \param width The width the image is required at.
+ * \param height The height the image is required at.
+ */
+static void nsjpeg__set_scale(struct jpeg_decompress_struct *cinfo,
+		int width, int height)
+{
+	unsigned int denom;
+
+	for (denom = 8; denom > 1; denom /= 2) {
+		if ((((cinfo->image_width + denom - 1) / denom) >=
+		     (unsigned int)width) &&
+		    (((cinfo->image_height + denom - 1) / denom) >=
+		     (unsigned int)height)) {
+			break;
+		}
+	}
+
+	cinfo->scale_num = 1;
+	cinfo->scale_denom = denom;
+}
+
 /**
  * create a bitmap from jpeg content.
  */
@@ -262,6 +290,7 @@ jpeg_cache_convert(struct content *c)
 	struct bitmap * volatile bitmap = NULL;
 	uint8_t * volatile pixels = NULL;
 	size_t rowstride;
+	int width, height; /* size the bitmap is required at */
 	struct jpeg_source_mgr source_mgr = {
 		0,
 		0,
@@ -332,6 +361,10 @@ jpeg_cache_convert(struct content *c)
 	}
 	cinfo.dct_method = JDCT_ISLOW;
 
+	/* decode no larger than the image is displayed */
+	image_cache_decode_size(c, &width, &height);
+	nsjpeg__set_scale(&cinfo, width, height);
+
 	/* commence the decompression, output parameters now valid */
 	jpeg_start_decompress(&cinfo);
 
@@ -428,7 +461,7 @@ static bool nsjpeg_convert(struct content *c)
 
 	jpeg_destroy_decompress(&cinfo);
 
-	image_cache_add(c, NULL, jpeg_cache_convert);
+	image_cache_add_scalable(c, jpeg_cache_convert);
 
 	/* set title text */
 	title = messages_get_buff("JPEGTitle",
@@ -23,6 +23,7 @@
 
 #include <assert.h>
 #include <limits.h>
+#include <math.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -31,13 +32,24 @@
 #include "utils/messages.h"
 #include "utils/utils.h"
 #include "utils/nsurl.h"
+#include "utils/nsoption.h"
+#include "netsurf/bitmap.h"
 #include "netsurf/plotters.h"
 #include "netsurf/content.h"
 #include "content/content_protected.h"
 #include "content/content_factory.h"
+#include "desktop/gui_internal.h"
+#include "desktop/bitmap.h"
 
+#include "image/image_cache.h"
 #include "image/svg.h"
 
+/** Number of sub-scanlines sampled for each pixel row when rasterising */
+#define SVG_RASTER_SAMPLES 4
+
+/** Largest area, in pixels, an SVG is rasterised at for redraw */
+#define SVG_RASTER_MAX_AREA (1024 * 1024)
+
 typedef struct svg_content {
 	struct content base;
 
@@ -45,8 +57,49 @@ typedef struct svg_content {
 
 	int current_width;
 	int current_height;
+
+	bool rasterised; /**< redraws use a bitmap held in the image cache */
 } svg_content;
 
+/** An edge of an outline being rasterised */
+struct svg_raster_edge {
+	float x0, y0; /**< upper end of edge */
+	float x1, y1; /**< lower end of edge */
+	int winding; /**< 1 if the outline runs down the edge, else -1 */
+};
+
+/** An edge crossing a sub-scanline */
+struct svg_raster_crossing {
+	float x;
+	int winding;
+};
+
+/** A point of a flattened path */
+struct svg_raster_point {
+	float x, y;
+	bool move; /**< point starts a subpath */
+};
+
+/** State of a rasterisation into a bitmap */
+struct svg_raster {
+	uint8_t *buffer; /**< R8G8B8A8 pixels */
+	size_t rowstride;
+	int width;
+	int height;
+
+	struct svg_raster_point *point; /**< flattened path */
+	unsigned int point_count;
+	unsigned int point_alloc;
+
+	struct svg_raster_edge *edge; /**< outline to paint */
+	unsigned int edge_count;
+	unsigned int edge_alloc;
+
+	struct svg_raster_edge **active; /**< edges crossing current row */
+	struct svg_raster_crossing *crossing; /**< sub-scanline crossings */
+	float *cover; /**< coverage of each pixel of the current row */
+};
+
 
 
 static nserror svg_create_svg_data(svg_content *c)
@@ -102,12 +155,653 @@ static nserror svg_create(const content_handler *handler,
 
 
 
+/**
+ * Add a point to the flattened path of a rasterisation.
+ */
+
+static nserror
+svg_raster_add_point(struct svg_raster *r, float x, float y, bool move)
+{
+	struct svg_raster_point *point;
+	unsigned int alloc;
+
+	if (r->point_count == r->point_alloc) {
+		alloc = r->point_alloc == 0 ? 64 : r->point_alloc * 2;
+		point = realloc(r->point, alloc * sizeof(*point));
+		if (point == NULL) {
+			return NSERROR_NOMEM;
+		}
+		r->point = point;
+		r->point_alloc = alloc;
+	}
+
+	point = &r->point[r->point_count++];
+	point->x = x;
+	point->y = y;
+	point->move = move || (r->point_count == 1);
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Flatten a diagram path into points in bitmap space.
+ *
+ * Curves are replaced by line segments short enough that the error is
+ * not visible.
+ */
+
+static nserror
+svg_raster_flatten(struct svg_raster *r, const float *path,
+		unsigned int path_length, float sx, float sy)
+{
+	float x = 0, y = 0, start_x = 0, start_y = 0;
+	float x1, y1, x2, y2, x3, y3, t, u, length;
+	unsigned int i = 0;
+	int n, segments;
+	nserror res = NSERROR_OK;
+
+	r->point_count = 0;
+
+	while ((i < path_length) && (res == NSERROR_OK)) {
+		switch ((int) path[i]) {
+		case svgtiny_PATH_MOVE:
+			if (i + 3 > path_length) {
+				return NSERROR_OK;
+			}
+			x = start_x = path[i + 1] * sx;
+			y = start_y = path[i + 2] * sy;
+			res = svg_raster_add_point(r, x, y, true);
+			i += 3;
+			break;
+
+		case svgtiny_PATH_CLOSE:
+			x = start_x;
+			y = start_y;
+			if (r->point_count != 0) {
+				res = svg_raster_add_point(r, x, y, false);
+			}
+			i += 1;
+			break;
+
+		case svgtiny_PATH_LINE:
+			if (i + 3 > path_length) {
+				return NSERROR_OK;
+			}
+			x = path[i + 1] * sx;
+			y = path[i + 2] * sy;
+			res = svg_raster_add_point(r, x, y, false);
+			i += 3;
+			break;
+
+		case svgtiny_PATH_BEZIER:
+			if (i + 7 > path_length) {
+				return NSERROR_OK;
+			}
+			x1 = path[i + 1] * sx;
+			y1 = path[i + 2] * sy;
+			x2 = path[i + 3] * sx;
+			y2 = path[i + 4] * sy;
+			x3 = path[i + 5] * sx;
+			y3 = path[i + 6] * sy;
+
+			/* the control polygon bounds the curve length */
+			length = hypotf(x1 - x, y1 - y) +
+				hypotf(x2 - x1, y2 - y1) +
+				hypotf(x3 - x2, y3 - y2);
+			segments = (length < 4 * 64) ?
+				max((int) (length / 4), 1) : 64;
+
+			for (n = 1; (n <= segments) && (res == NSERROR_OK);
+					n++) {
+				t = (float) n / segments;
+				u = 1 - t;
+				res = svg_raster_add_point(r,
+					u * u * u * x + 3 * u * u * t * x1 +
+					3 * u * t * t * x2 + t * t * t * x3,
+					u * u * u * y + 3 * u * u * t * y1 +
+					3 * u * t * t * y2 + t * t * t * y3,
+					false);
+			}
+			x = x3;
+			y = y3;
+			i += 7;
+			break;
+
+		default:
+			/* unknown path element */
+			return NSERROR_OK;
+		}
+	}
+
+	return res;
+}
+
+
+/**
+ * Add an edge to the outline of a rasterisation.
+ */
+
+static nserror
+svg_raster_add_edge(struct svg_raster *r,
+		float x0, float y0, float x1, float y1)
+{
+	struct svg_raster_edge *edge;
+	unsigned int alloc;
+
+	if (y0 == y1) {
+		/* horizontal edges never cross a sub-scanline */
+		return NSERROR_OK;
+	}
+
+	if (r->edge_count == r->edge_alloc) {
+		alloc = r->edge_alloc == 0 ? 64 : r->edge_alloc * 2;
+		edge = realloc(r->edge, alloc * sizeof(*edge));
+		if (edge == NULL) {
+			return NSERROR_NOMEM;
+		}
+		r->edge = edge;
+		r->edge_alloc = alloc;
+	}
+
+	edge = &r->edge[r->edge_count++];
+	if (y0 < y1) {
+		edge->x0 = x0;
+		edge->y0 = y0;
+		edge->x1 = x1;
+		edge->y1 = y1;
+		edge->winding = 1;
+	} else {
+		edge->x0 = x1;
+		edge->y0 = y1;
+		edge->x1 = x0;
+		edge->y1 = y0;
+		edge->winding = -1;
+	}
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Add the outline of a line segment of a stroke.
+ *
+ * Every segment is given the same orientation so that the non-zero
+ * winding rule paints the union of the segments of a stroke.
+ */
+
+static nserror
+svg_raster_add_segment(struct svg_raster *r,
+		float x0, float y0, float x1, float y1, float half_width)
+{
+	float length = hypotf(x1 - x0, y1 - y0);
+	float nx, ny;
+	nserror res;
+
+	if (length == 0) {
+		return NSERROR_OK;
+	}
+
+	nx = (y0 - y1) * half_width / length;
+	ny = (x1 - x0) * half_width / length;
+
+	res = svg_raster_add_edge(r, x0 + nx, y0 + ny, x1 + nx, y1 + ny);
+	if (res == NSERROR_OK) {
+		res = svg_raster_add_edge(r, x1 + nx, y1 + ny,
+				x1 - nx, y1 - ny);
+	}
+	if (res == NSERROR_OK) {
+		res = svg_raster_add_edge(r, x1 - nx, y1 - ny,
+				x0 - nx, y0 - ny);
+	}
+	if (res == NSERROR_OK) {
+		res = svg_raster_add_edge(r, x0 - nx, y0 - ny,
+				x0 + nx, y0 + ny);
+	}
+
+	return res;
+}
+
+
+/**
+ * Add a round join between stroke segments.
+ *
+ * The disc is oriented the same way as the segments.
+ */
+
+static nserror
+svg_raster_add_join(struct svg_raster *r, float x, float y,
+		float half_width)
+{
+	int sides = (half_width < 16) ? max((int) (half_width * 2), 8) : 32;
+	float px = x + half_width, py = y;
+	float a, nx, ny;
+	int n;
+	nserror res = NSERROR_OK;
+
+	for (n = 1; (n <= sides) && (res == NSERROR_OK); n++) {
+		a = -2 * M_PI * n / sides;
+		nx = x + half_width * cosf(a);
+		ny = y + half_width * sinf(a);
+		res = svg_raster_add_edge(r, px, py, nx, ny);
+		px = nx;
+		py = ny;
+	}
+
+	return res;
+}
+
+
+/**
+ * Build the outline filling each subpath of the flattened path.
+ *
+ * Open subpaths are closed implicitly.
+ */
+
+static nserror svg_raster_fill_outline(struct svg_raster *r)
+{
+	unsigned int i, start = 0;
+	const struct svg_raster_point *p = r->point;
+	nserror res = NSERROR_OK;
+
+	r->edge_count = 0;
+
+	for (i = 0; (i < r->point_count) && (res == NSERROR_OK); i++) {
+		if (i + 1 == r->point_count || p[i + 1].move) {
+			res = svg_raster_add_edge(r, p[i].x, p[i].y,
+					p[start].x, p[start].y);
+			start = i + 1;
+		} else {
+			res = svg_raster_add_edge(r, p[i].x, p[i].y,
+					p[i + 1].x, p[i + 1].y);
+		}
+	}
+
+	return res;
+}
+
+
+/**
+ * Build the outline of the stroke of the flattened path.
+ */
+
+static nserror
+svg_raster_stroke_outline(struct svg_raster *r, float half_width)
+{
+	unsigned int i, start = 0;
+	const struct svg_raster_point *p = r->point;
+	bool closed;
+	nserror res = NSERROR_OK;
+
+	r->edge_count = 0;
+
+	for (i = 0; (i < r->point_count) && (res == NSERROR_OK); i++) {
+		if (p[i].move) {
+			start = i;
+		}
+
+		if (i + 1 == r->point_count || p[i + 1].move) {
+			/* end of subpath; join back to the start if the
+			 * subpath was closed */
+			closed = (i != start) &&
+				(p[i].x == p[start].x) &&
+				(p[i].y == p[start].y);
+			if (closed && half_width >= 1) {
+				res = svg_raster_add_join(r, p[i].x, p[i].y,
+						half_width);
+			}
+			continue;
+		}
+
+		res = svg_raster_add_segment(r, p[i].x, p[i].y,
+				p[i + 1].x, p[i + 1].y, half_width);
+
+		if ((res == NSERROR_OK) && (i != start) && half_width >= 1) {
+			res = svg_raster_add_join(r, p[i].x, p[i].y,
+					half_width);
+		}
+	}
+
+	return res;
+}
+
+
+/**
+ * Order edges by their upper end.
+ */
+
+static int svg_raster_edge_cmp(const void *a, const void *b)
+{
+	const struct svg_raster_edge *ea = a;
+	const struct svg_raster_edge *eb = b;
+
+	return (ea->y0 > eb->y0) - (ea->y0 < eb->y0);
+}
+
+
+/**
+ * Order crossings from left to right.
+ */
+
+static int svg_raster_crossing_cmp(const void *a, const void *b)
+{
+	const struct svg_raster_crossing *ca = a;
+	const struct svg_raster_crossing *cb = b;
+
+	return (ca->x > cb->x) - (ca->x < cb->x);
+}
+
+
+/**
+ * Add the coverage of a span of a sub-scanline to the current row.
+ */
+
+static void
+svg_raster_cover_span(struct svg_raster *r, float x0, float x1, float weight)
+{
+	int i0, i1, i;
+
+	x0 = max(x0, 0);
+	x1 = min(x1, r->width);
+	if (x0 >= x1) {
+		return;
+	}
+
+	i0 = (int) x0;
+	i1 = (int) x1;
+	if (i0 == i1) {
+		r->cover[i0] += (x1 - x0) * weight;
+		return;
+	}
+
+	r->cover[i0] += (i0 + 1 - x0) * weight;
+	for (i = i0 + 1; i < i1; i++) {
+		r->cover[i] += weight;
+	}
+	if (i1 < r->width) {
+		r->cover[i1] += (x1 - i1) * weight;
+	}
+}
+
+
+/**
+ * Composite a colour over the pixels of a row by their coverage.
+ *
+ * The bitmap holds unpremultiplied alpha.
+ */
+
+static void
+svg_raster_composite_row(struct svg_raster *r, int y, svgtiny_colour colour)
+{
+	uint8_t *pixel = r->buffer + y * r->rowstride;
+	uint8_t src[3] = {
+		svgtiny_RED(colour),
+		svgtiny_GREEN(colour),
+		svgtiny_BLUE(colour)
+	};
+	float sa, da, oa;
+	int x, k;
+
+	for (x = 0; x < r->width; x++, pixel += 4) {
+		sa = min(r->cover[x], 1);
+		r->cover[x] = 0;
+		if (sa <= 0) {
+			continue;
+		}
+
+		da = pixel[3] / 255.0f;
+		if ((sa >= 1) || (da == 0)) {
+			pixel[0] = src[0];
+			pixel[1] = src[1];
+			pixel[2] = src[2];
+			pixel[3] = sa * 255 + 0.5f;
+			continue;
+		}
+
+		oa = sa + da * (1 - sa);
+		for (k = 0; k < 3; k++) {
+			pixel[k] = (src[k] * sa +
+				    pixel[k] * da * (1 - sa)) / oa + 0.5f;
+		}
+		pixel[3] = oa * 255 + 0.5f;
+	}
+}
+
+
+/**
+ * Paint the outline of a rasterisation in a colour.
+ *
+ * Coverage is found with the non-zero winding rule at several
+ * sub-scanlines of each row and exact horizontal extents.
+ */
+
+static void svg_raster_paint(struct svg_raster *r, svgtiny_colour colour)
+{
+	unsigned int next = 0, active = 0, crossings, i, j;
+	const float weight = 1.0f / SVG_RASTER_SAMPLES;
+	struct svg_raster_edge *edge;
+	float ymin, ymax, sy;
+	int y, y0, y1, s, winding;
+
+	qsort(r->edge, r->edge_count, sizeof(*r->edge), svg_raster_edge_cmp);
+
+	ymin = r->edge[0].y0;
+	ymax = r->edge[0].y1;
+	for (i = 1; i < r->edge_count; i++) {
+		ymax = max(ymax, r->edge[i].y1);
+	}
+
+	ymin = max(ymin, 0);
+	ymax = min(ymax, r->height);
+	y0 = floorf(ymin);
+	y1 = ceilf(ymax);
+
+	for (y = y0; y < y1; y++) {
+		for (s = 0; s < SVG_RASTER_SAMPLES; s++) {
+			sy = y + (s + 0.5f) * weight;
+
+			/* bring in edges starting above the sub-scanline */
+			while ((next < r->edge_count) &&
+			       (r->edge[next].y0 <= sy)) {
+				r->active[active++] = &r->edge[next++];
+			}
+
+			/* find the crossings, dropping edges above it */
+			crossings = 0;
+			for (i = 0, j = 0; i < active; i++) {
+				edge = r->active[i];
+				if (edge->y1 <= sy) {
+					continue;
+				}
+				r->active[j++] = edge;
+				r->crossing[crossings].x = edge->x0 +
+					(sy - edge->y0) *
+					(edge->x1 - edge->x0) /
+					(edge->y1 - edge->y0);
+				r->crossing[crossings].winding = edge->winding;
+				crossings++;
+			}
+			active = j;
+
+			qsort(r->crossing, crossings, sizeof(*r->crossing),
+					svg_raster_crossing_cmp);
+
+			winding = 0;
+			for (i = 0; i + 1 < crossings; i++) {
+				winding += r->crossing[i].winding;
+				if (winding != 0) {
+					svg_raster_cover_span(r,
+							r->crossing[i].x,
+							r->crossing[i + 1].x,
+							weight);
+				}
+			}
+		}
+
+		svg_raster_composite_row(r, y, colour);
+	}
+}
+
+
+/**
+ * Paint an outline once the working space for it is available.
+ */
+
+static nserror
+svg_raster_paint_outline(struct svg_raster *r, svgtiny_colour colour)
+{
+	struct svg_raster_edge **active;
+	struct svg_raster_crossing *crossing;
+
+	if (r->edge_count == 0) {
+		return NSERROR_OK;
+	}
+
+	active = realloc(r->active, r->edge_alloc * sizeof(*active));
+	if (active == NULL) {
+		return NSERROR_NOMEM;
+	}
+	r->active = active;
+
+	crossing = realloc(r->crossing, r->edge_alloc * sizeof(*crossing));
+	if (crossing == NULL) {
+		return NSERROR_NOMEM;
+	}
+	r->crossing = crossing;
+
+	svg_raster_paint(r, colour);
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Rasterise the paths of a diagram.
+ *
+ * Text is not rasterised as it is plotted with the fonts of the
+ * frontend.
+ */
+
+static nserror
+svg_raster_diagram(struct svg_raster *r,
+		const struct svgtiny_diagram *diagram, float sx, float sy)
+{
+	const struct svgtiny_shape *shape;
+	float half_width;
+	unsigned int i;
+	nserror res = NSERROR_OK;
+
+	for (i = 0; (i != diagram->shape_count) && (res == NSERROR_OK); i++) {
+		shape = &diagram->shape[i];
+		if (shape->path == NULL) {
+			continue;
+		}
+
+		res = svg_raster_flatten(r, shape->path, shape->path_length,
+				sx, sy);
+
+		if ((res == NSERROR_OK) &&
+		    (shape->fill != svgtiny_TRANSPARENT)) {
+			res = svg_raster_fill_outline(r);
+			if (res == NSERROR_OK) {
+				res = svg_raster_paint_outline(r, shape->fill);
+			}
+		}
+
+		/* a zero width stroke draws nothing, while thinner strokes
+		 * than a pixel are widened to remain visible */
+		if ((res == NSERROR_OK) &&
+		    (shape->stroke != svgtiny_TRANSPARENT) &&
+		    (shape->stroke_width > 0)) {
+			half_width = max(shape->stroke_width * (sx + sy) / 4,
+					0.5f);
+			res = svg_raster_stroke_outline(r, half_width);
+			if (res == NSERROR_OK) {
+				res = svg_raster_paint_outline(r,
+						shape->stroke);
+			}
+		}
+	}
+
+	return res;
+}
+
+
+/**
+ * Rasterise a CONTENT_SVG for the image cache.
+ *
+ * The bitmap is the size the content was last redrawn at.
+ */
+
+static struct bitmap *svg_cache_convert(struct content *c)
+{
+	svg_content *svg = (svg_content *) c;
+	struct svg_raster raster = { 0 };
+	struct bitmap *bitmap;
+	int width, height;
+	nserror res;
+
+	if ((c->width <= 0) || (c->height <= 0)) {
+		return NULL;
+	}
+
+	image_cache_decode_size(c, &width, &height);
+
+	bitmap = guit->bitmap->create(width, height, BITMAP_CLEAR);
+	if (bitmap == NULL) {
+		return NULL;
+	}
+
+	raster.buffer = guit->bitmap->get_buffer(bitmap);
+	raster.rowstride = guit->bitmap->get_rowstride(bitmap);
+	raster.width = width;
+	raster.height = height;
+	raster.cover = calloc(width + 1, sizeof(float));
+
+	if ((raster.buffer == NULL) || (raster.cover == NULL)) {
+		res = NSERROR_NOMEM;
+	} else {
+		res = svg_raster_diagram(&raster, svg->diagram,
+				(float) width / c->width,
+				(float) height / c->height);
+	}
+
+	free(raster.point);
+	free(raster.edge);
+	free(raster.active);
+	free(raster.crossing);
+	free(raster.cover);
+
+	if (res != NSERROR_OK) {
+		guit->bitmap->destroy(bitmap);
+		return NULL;
+	}
+
+	guit->bitmap->set_opaque(bitmap, bitmap_test_opaque(bitmap));
+	bitmap_format_to_client(bitmap, &(bitmap_fmt_t) {
+		.layout = BITMAP_LAYOUT_R8G8B8A8,
+	});
+	guit->bitmap->modified(bitmap);
+
+	return bitmap;
+}
+
+
 /**
  * Convert a CONTENT_SVG for display.
  */
 
 static bool svg_convert(struct content *c)
 {
+	svg_content *svg = (svg_content *) c;
+
+	/* The diagram is rasterised at the size it is redrawn at, so the
+	 * bitmap can only be made once the size is known. */
+	if (nsoption_bool(rasterise_svg) &&
+	    (image_cache_add_vector(c, svg_cache_convert) == NSERROR_OK)) {
+		svg->rasterised = true;
+	}
+
 	/*c->title = malloc(100);
 	if (c->title)
 		snprintf(c->title, 100, messages_get("svgTitle"),
@@ -130,19 +824,35 @@ static void svg_reformat(struct content *c, int width, int height)
 	svg_content *svg = (svg_content *) c;
 	const uint8_t *source_data;
 	size_t source_size;
+	nserror res;
 
 	assert(svg->diagram);
 
 	/* Avoid reformats to same width/height as we already reformatted to */
 	if (width != svg->current_width || height != svg->current_height) {
-		source_data = content__get_source_data(c, &source_size);
-
-		svgtiny_parse(svg->diagram,
-			      (const char *)source_data,
-			      source_size,
-			      nsurl_access(content_get_url(c)),
-			      width,
-			      height);
+		if (svg->current_width == INT_MAX) {
+			/* First reformat: parse the source. */
+			source_data = content__get_source_data(c, &source_size);
+
+			svgtiny_parse(svg->diagram,
+				      (const char *)source_data,
+				      source_size,
+				      nsurl_access(content_get_url(c)),
+				      width,
+				      height);
+		} else {
+			/* The diagram keeps the shapes it parsed, so only
+			 * needs laying out for the new viewport. */
+			svgtiny_layout(svg->diagram, width, height);
+
+			if (svg->rasterised) {
+				/* drop the bitmap of the previous layout */
+				image_cache_remove(c);
+				res = image_cache_add_vector(c,
+						svg_cache_convert);
+				svg->rasterised = (res == NSERROR_OK);
+			}
+		}
 
 		svg->current_width = width;
 		svg->current_height = height;
@@ -166,7 +876,8 @@ svg_redraw_internal(struct content *c,
 		    const struct rect *clip,
 		    const struct redraw_context *ctx,
 		    float scale,
-		    colour background_colour)
+		    colour background_colour,
+		    bool plot_paths)
 {
 	svg_content *svg = (svg_content *) c;
 	float transform[6];
@@ -193,6 +904,9 @@ svg_redraw_internal(struct content *c,
 
 	for (i = 0; i != diagram->shape_count; i++) {
 		if (diagram->shape[i].path) {
+			if (!plot_paths) {
+				continue;
+			}
 			pstyle.stroke_width = plot_style_int_to_fixed(
 					diagram->shape[i].stroke_width);
 			pstyle.stroke_colour = BGR(diagram->shape[i].stroke);
@@ -236,27 +950,30 @@ svg_redraw_internal(struct content *c,
 
 
 /**
- * Redraw a CONTENT_SVG.
+ * Redraw the shapes of a CONTENT_SVG, tiled as required.
+ *
+ * \param c           content to redraw
+ * \param data        redraw data for the content
+ * \param clip        clip rectangle
+ * \param ctx         current redraw context
+ * \param plot_paths  whether to plot paths as well as text
+ * \return true on success, false on error
  */
 
-static bool svg_redraw(struct content *c, struct content_redraw_data *data,
-		const struct rect *clip, const struct redraw_context *ctx)
+static bool
+svg_redraw_tiled(struct content *c, struct content_redraw_data *data,
+		const struct rect *clip, const struct redraw_context *ctx,
+		bool plot_paths)
 {
 	int x = data->x;
 	int y = data->y;
 
-	if ((data->width <= 0) && (data->height <= 0)) {
-		/* No point trying to plot SVG if it does not occupy a valid
-		 * area */
-		return true;
-	}
-
 	if ((data->repeat_x == false) && (data->repeat_y == false)) {
 		/* Simple case: SVG is not tiled */
 		return svg_redraw_internal(c, x, y,
 				data->width, data->height,
 				clip, ctx, data->scale,
-				data->background_colour);
+				data->background_colour, plot_paths);
 	} else {
 		/* Tiled redraw required.  SVG repeats to extents of clip
 		 * rectangle, in x, y or both directions */
@@ -284,7 +1001,8 @@ static bool svg_redraw(struct content *c, struct content_redraw_data *data,
 				if (!svg_redraw_internal(c, x, y,
 						data->width, data->height,
 						clip, ctx, data->scale,
-						data->background_colour)) {
+						data->background_colour,
+						plot_paths)) {
 					return false;
 				}
 			}
@@ -295,6 +1013,42 @@ static bool svg_redraw(struct content *c, struct content_redraw_data *data,
 }
 
 
+/**
+ * Redraw a CONTENT_SVG.
+ */
+
+static bool svg_redraw(struct content *c, struct content_redraw_data *data,
+		const struct rect *clip, const struct redraw_context *ctx)
+{
+	svg_content *svg = (svg_content *) c;
+	struct svgtiny_diagram *diagram = svg->diagram;
+	unsigned int i;
+
+	if ((data->width <= 0) && (data->height <= 0)) {
+		/* No point trying to plot SVG if it does not occupy a valid
+		 * area */
+		return true;
+	}
+
+	/* Plot the paths from a bitmap rasterised at this size, unless the
+	 * output is not a display or the bitmap would be too large. */
+	if (svg->rasterised && ctx->interactive &&
+	    (data->width > 0) && (data->height > 0) &&
+	    (data->width <= SVG_RASTER_MAX_AREA / data->height) &&
+	    image_cache_redraw(c, data, clip, ctx)) {
+		for (i = 0; i != diagram->shape_count; i++) {
+			if (diagram->shape[i].text != NULL) {
+				return svg_redraw_tiled(c, data, clip, ctx,
+						false);
+			}
+		}
+		return true;
+	}
+
+	return svg_redraw_tiled(c, data, clip, ctx, true);
+}
+
+
 /**
  * Destroy a CONTENT_SVG and free all resources it owns.
  */
@@ -303,6 +1057,9 @@ static void svg_destroy(struct content *c)
 {
 	svg_content *svg = (svg_content *) c;
 
+	if (svg->rasterised)
+		image_cache_destroy(c);
+
 	if (svg->diagram != NULL)
 		svgtiny_free(svg->diagram);
 }
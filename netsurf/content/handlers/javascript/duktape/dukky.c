@@ -25,14 +25,20 @@
  */
 
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <nsutils/time.h>
 
 #include "netsurf/inttypes.h"
 #include "utils/utils.h"
 #include "utils/nsoption.h"
+#include "utils/nsurl.h"
 #include "utils/log.h"
 #include "utils/corestrings.h"
+#include "netsurf/misc.h"
 #include "content/content.h"
+#include "content/llcache.h"
+#include "desktop/gui_internal.h"
 
 #include "javascript/js.h"
 #include "javascript/content.h"
@@ -53,6 +59,31 @@
 #define GENERICS_MAGIC MAGIC(GENERICS_TABLE)
 #define THREAD_MAP MAGIC(THREAD_MAP)
 
+/**
+ * Minimum source size, in bytes, of scripts whose compiled bytecode is
+ * kept in the backing store. Smaller scripts compile quickly enough.
+ */
+#define DUKKY_BYTECODE_MIN_SIZE 4096
+
+/** Magic number identifying stored bytecode ("NSJB") */
+#define DUKKY_BYTECODE_MAGIC 0x4e534a42
+
+/**
+ * Header preceding bytecode kept in the backing store
+ *
+ * Duktape does not validate bytecode as it is loaded, so this records
+ * enough to be sure the bytecode was produced by this engine version
+ * from the same source and has not been damaged since.
+ */
+struct dukky_bytecode_header {
+	uint32_t magic; /**< DUKKY_BYTECODE_MAGIC */
+	uint32_t version; /**< DUK_VERSION of the compiling engine */
+	uint64_t source_hash; /**< hash of the script source */
+	uint64_t source_len; /**< byte length of the script source */
+	uint64_t checksum; /**< hash of the bytecode */
+	uint64_t length; /**< byte length of the bytecode */
+};
+
 /**
  * dukky javascript heap
  */
@@ -917,11 +948,213 @@ void dukky_log_stack_frame(duk_context *ctx, const char * reason)
 }
 
 
+/**
+ * Continue a 64 bit FNV-1a hash over a block of data
+ *
+ * \param hash  Hash of the preceding data
+ * \param data  Data to hash
+ * \param len   Byte length of data
+ * \return The updated hash
+ */
+static uint64_t dukky_hash(uint64_t hash, const uint8_t *data, size_t len)
+{
+	while (len-- > 0) {
+		hash = (hash ^ *data++) * 0x100000001b3;
+	}
+	return hash;
+}
+
+/**
+ * Create the backing store key for the bytecode of a script
+ *
+ * \param source_hash  Hash of the script source
+ * \param name         Name the script is compiled with
+ * \param key          Pointer to location to receive the key
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+static nserror
+dukky_bytecode_key(uint64_t source_hash, const char *name, nsurl **key)
+{
+	uint32_t version = DUK_VERSION;
+	uint64_t hash;
+	char key_s[32];
+
+	/* the name is recorded in the bytecode for error reports */
+	hash = dukky_hash(source_hash, (const uint8_t *)name, strlen(name) + 1);
+	hash = dukky_hash(hash, (const uint8_t *)&version, sizeof(version));
+
+	snprintf(key_s, sizeof(key_s), "x-ns-js:%016" PRIx64, hash);
+
+	return nsurl_create(key_s, key);
+}
+
+static duk_ret_t dukky_safe_load_function(duk_context *ctx, void *udata)
+{
+	duk_load_function(ctx);
+	return 1;
+}
+
+/**
+ * Load script bytecode from the backing store
+ *
+ * On success the loaded function is pushed on to the stack.
+ *
+ * \param ctx          Context to load the bytecode into
+ * \param key          Key the bytecode was stored under
+ * \param source_hash  Hash of the script source
+ * \param source_len   Byte length of the script source
+ * \return true if the bytecode was loaded, false otherwise
+ */
+static bool
+dukky_load_bytecode(duk_context *ctx, nsurl *key,
+		    uint64_t source_hash, size_t source_len)
+{
+	struct dukky_bytecode_header header;
+	const uint8_t *data;
+	size_t len;
+	void *buf;
+
+	if (llcache_fetch_derived_data(key, &data, &len) != NSERROR_OK) {
+		return false;
+	}
+
+	if (len < sizeof(header)) {
+		goto invalid;
+	}
+	memcpy(&header, data, sizeof(header));
+	data += sizeof(header);
+	len -= sizeof(header);
+
+	if (header.magic != DUKKY_BYTECODE_MAGIC ||
+	    header.version != DUK_VERSION ||
+	    header.source_hash != source_hash ||
+	    header.source_len != source_len ||
+	    header.length != len ||
+	    header.checksum != dukky_hash(0xcbf29ce484222325, data, len)) {
+		goto invalid;
+	}
+
+	buf = duk_push_fixed_buffer(ctx, len);
+	memcpy(buf, data, len);
+	llcache_release_derived_data(key);
+
+	if (duk_safe_call(ctx, dukky_safe_load_function, NULL, 1, 1) != 0) {
+		NSLOG(dukky, INFO, "Failed to load bytecode %s: %s",
+		      nsurl_access(key), duk_safe_to_string(ctx, -1));
+		duk_pop(ctx);
+		return false;
+	}
+
+	return true;
+
+invalid:
+	llcache_release_derived_data(key);
+	NSLOG(dukky, INFO, "Bytecode %s unusable", nsurl_access(key));
+	return false;
+}
+
+static duk_ret_t dukky_safe_dump_function(duk_context *ctx, void *udata)
+{
+	duk_dump_function(ctx);
+	return 1;
+}
+
+/**
+ * Place the bytecode of a compiled script in the backing store
+ *
+ * \param ctx          Context with the compiled function on the stack top
+ * \param key          Key to store the bytecode under
+ * \param source_hash  Hash of the script source
+ * \param source_len   Byte length of the script source
+ */
+static void
+dukky_store_bytecode(duk_context *ctx, nsurl *key,
+		     uint64_t source_hash, size_t source_len)
+{
+	struct dukky_bytecode_header header;
+	const uint8_t *bytecode;
+	duk_size_t len;
+	uint8_t *data;
+
+	duk_dup(ctx, -1);
+	if (duk_safe_call(ctx, dukky_safe_dump_function, NULL, 1, 1) != 0) {
+		duk_pop(ctx);
+		return;
+	}
+	bytecode = duk_get_buffer(ctx, -1, &len);
+
+	header.magic = DUKKY_BYTECODE_MAGIC;
+	header.version = DUK_VERSION;
+	header.source_hash = source_hash;
+	header.source_len = source_len;
+	header.checksum = dukky_hash(0xcbf29ce484222325, bytecode, len);
+	header.length = len;
+
+	data = malloc(sizeof(header) + len);
+	if (data != NULL) {
+		memcpy(data, &header, sizeof(header));
+		memcpy(data + sizeof(header), bytecode, len);
+		llcache_store_derived_data(key, data, sizeof(header) + len);
+	}
+
+	duk_pop(ctx);
+}
+
+/**
+ * Compile script source for execution
+ *
+ * Large scripts are compiled once and their bytecode kept in the
+ * backing store, from where it is loaded on later visits.
+ *
+ * \param ctx     Context to compile the script in
+ * \param txt     Script source
+ * \param txtlen  Byte length of script source
+ * \param name    Name of the script, used in error reports
+ * \return 0 with the compiled function on the stack top on success, or
+ *         non-zero with the error on the stack top
+ */
+static duk_int_t
+dukky_compile(duk_context *ctx, const uint8_t *txt, size_t txtlen,
+	      const char *name)
+{
+	uint64_t source_hash = 0;
+	nsurl *key = NULL;
+	duk_int_t ret;
+
+	if (txtlen >= DUKKY_BYTECODE_MIN_SIZE) {
+		source_hash = dukky_hash(0xcbf29ce484222325, txt, txtlen);
+		if (dukky_bytecode_key(source_hash, name, &key) != NSERROR_OK) {
+			key = NULL;
+		}
+	}
+
+	if (key != NULL &&
+	    dukky_load_bytecode(ctx, key, source_hash, txtlen)) {
+		NSLOG(dukky, DEEPDEBUG, "Loaded bytecode for %s", name);
+		nsurl_unref(key);
+		return 0;
+	}
+
+	duk_push_string(ctx, name);
+	ret = duk_pcompile_lstring_filename(ctx, DUK_COMPILE_EVAL,
+					    (const char *)txt, txtlen);
+
+	if (key != NULL) {
+		if (ret == 0) {
+			dukky_store_bytecode(ctx, key, source_hash, txtlen);
+		}
+		nsurl_unref(key);
+	}
+
+	return ret;
+}
+
 /* exported interface documented in js.h */
 bool
 js_exec(jsthread *thread, const uint8_t *txt, size_t txtlen, const char *name)
 {
 	bool ret = false;
+	duk_int_t compiled;
 	assert(thread);
 
 	if (txt == NULL || txtlen == 0) {
@@ -940,15 +1173,13 @@ js_exec(jsthread *thread, const uint8_t *txt, size_t txtlen, const char *name)
 	/* NSLOG(dukky, DEEPDEBUG, "\n%s\n", txt); */
 
 	dukky_reset_start_time(CTX);
-	if (name != NULL) {
-		duk_push_string(CTX, name);
-	} else {
-		duk_push_string(CTX, "?unknown source?");
+	if (name == NULL) {
+		name = "?unknown source?";
 	}
-	if (duk_pcompile_lstring_filename(CTX,
-					  DUK_COMPILE_EVAL,
-					  (const char *)txt,
-					  txtlen) != 0) {
+	guit->misc->phase("js_compile", true);
+	compiled = dukky_compile(CTX, txt, txtlen, name);
+	guit->misc->phase("js_compile", false);
+	if (compiled != 0) {
 		NSLOG(dukky, DEBUG, "Failed to compile JavaScript input");
 		goto handle_error;
 	}
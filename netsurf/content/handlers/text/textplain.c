@@ -54,6 +54,24 @@ struct textplain_line {
 	size_t	length;
 };
 
+/**
+ * Checkpoint in the physical line index
+ *
+ * Checkpoints are placed at the start of hard lines, so the text from
+ * one checkpoint to the next can be wrapped without reference to any
+ * other part of it. Only the number of physical lines after each
+ * checkpoint is kept up to date as the width changes; the lines
+ * themselves are wrapped when they are first needed.
+ */
+struct textplain_checkpoint {
+	size_t start; /**< byte offset of first hard line */
+	unsigned long hard_lines; /**< number of hard lines */
+	size_t columns; /**< columns needed to avoid wrapping any line */
+	unsigned long line; /**< line number of first physical line */
+	unsigned long line_count; /**< number of physical lines */
+	struct textplain_line *lines; /**< physical lines, or NULL */
+};
+
 /**
  * plain text content
  */
@@ -66,7 +84,9 @@ typedef struct textplain_content {
 	size_t utf8_data_size;
 	size_t utf8_data_allocated;
 	unsigned long physical_line_count;
-	struct textplain_line *physical_line;
+	struct textplain_checkpoint *checkpoint; /**< physical line index */
+	unsigned long checkpoint_count;
+	size_t columns; /**< columns the text is wrapped to */
 	int formatted_width;
 	struct browser_window *bw;
 
@@ -76,6 +96,7 @@ typedef struct textplain_content {
 
 
 #define CHUNK 32768 /* Must be a power of 2 */
+#define CHECKPOINT_SIZE (64 * 1024) /* bytes of text between checkpoints */
 #define MARGIN 4
 
 #define TAB_WIDTH 8  /* must be power of 2 currently */
@@ -165,8 +186,10 @@ textplain_create_internal(textplain_content *c, lwc_string *encoding)
 	c->utf8_data = utf8_data;
 	c->utf8_data_size = 0;
 	c->utf8_data_allocated = CHUNK;
-	c->physical_line = 0;
 	c->physical_line_count = 0;
+	c->checkpoint = NULL;
+	c->checkpoint_count = 0;
+	c->columns = 0;
 	c->formatted_width = 0;
 	c->bw = NULL;
 	c->sel = selection_create((struct content *)c);
@@ -354,6 +377,91 @@ no_memory:
 }
 
 
+/**
+ * Build the checkpoint index of the text.
+ *
+ * The text is valid UTF-8, having come through the input stream, so
+ * characters are counted by their lead bytes.
+ *
+ * \param text The text content to index.
+ * \return true on success, false on memory exhaustion.
+ */
+static bool textplain_build_index(textplain_content *text)
+{
+	const char *utf8_data = text->utf8_data;
+	size_t utf8_data_size = text->utf8_data_size;
+	struct textplain_checkpoint *checkpoint = NULL;
+	struct textplain_checkpoint *cp = NULL;
+	unsigned long count = 0;
+	size_t limit = 0;
+	size_t i = 0;
+
+	while (true) {
+		size_t col = 0, columns = 0;
+
+		if (cp == NULL || i >= limit) {
+			if (count % 64 == 0) {
+				struct textplain_checkpoint *cp1;
+				cp1 = realloc(checkpoint, sizeof(*cp1) *
+					      (count + 64));
+				if (cp1 == NULL) {
+					free(checkpoint);
+					return false;
+				}
+				checkpoint = cp1;
+			}
+
+			cp = &checkpoint[count++];
+			cp->start = i;
+			cp->hard_lines = 0;
+			cp->columns = 0;
+			cp->line = 0;
+			cp->line_count = 0;
+			cp->lines = NULL;
+
+			limit = i + CHECKPOINT_SIZE;
+		}
+
+		/* measure the hard line starting at i */
+		cp->hard_lines++;
+		while (i < utf8_data_size &&
+		       utf8_data[i] != '\n' && utf8_data[i] != '\r') {
+			if ((utf8_data[i] & 0xc0) != 0x80) {
+				size_t next_col = col + 1;
+
+				if (utf8_data[i] == '\t') {
+					next_col = (next_col + TAB_WIDTH - 1) &
+						~(TAB_WIDTH - 1);
+				}
+				if (next_col > columns)
+					columns = next_col;
+				col++;
+			}
+			i++;
+		}
+		if (columns > cp->columns)
+			cp->columns = columns;
+
+		if (i == utf8_data_size)
+			break;
+
+		/* skip second char of CR/LF or LF/CR pair */
+		if (i + 1 < utf8_data_size &&
+		    utf8_data[i+1] != utf8_data[i] &&
+		    (utf8_data[i+1] == '\n' || utf8_data[i+1] == '\r')) {
+			i++;
+		}
+		i++;
+	}
+
+	free(text->checkpoint);
+	text->checkpoint = checkpoint;
+	text->checkpoint_count = count;
+
+	return true;
+}
+
+
 /**
  * Convert a CONTENT_TEXTPLAIN for display.
  */
@@ -374,6 +482,11 @@ static bool textplain_convert(struct content *c)
 	parserutils_inputstream_destroy(stream);
 	text->inputstream = NULL;
 
+	if (textplain_build_index(text) == false) {
+		content_broadcast_error(c, NSERROR_NOMEM, NULL);
+		return false;
+	}
+
 	content_set_ready(c);
 	content_set_done(c);
 	content_set_status(c, messages_get("Done"));
@@ -397,62 +510,44 @@ static float textplain_line_height(void)
 
 
 /**
- * Reformat a CONTENT_TEXTPLAIN to a new width.
+ * Wrap the text of a checkpoint.
+ *
+ * \param text The text content.
+ * \param cp The checkpoint to wrap the text of.
+ * \param line Array to fill with the physical lines, or NULL to just
+ *             count them.
+ * \return The number of physical lines.
  */
-static void textplain_reformat(struct content *c, int width, int height)
+static unsigned long
+textplain_wrap(textplain_content *text,
+	       const struct textplain_checkpoint *cp,
+	       struct textplain_line *line)
 {
-	textplain_content *text = (textplain_content *) c;
-	char *utf8_data = text->utf8_data;
-	size_t utf8_data_size = text->utf8_data_size;
+	const char *utf8_data = text->utf8_data;
+	size_t columns = text->columns;
+	size_t end = text->utf8_data_size;
 	unsigned long line_count = 0;
-	struct textplain_line *line = text->physical_line;
-	struct textplain_line *line1;
+	size_t line_start = cp->start;
 	size_t i, space, col;
-	size_t columns = 80;
-	int character_width;
-	size_t line_start;
-	nserror res;
 
-	NSLOG(netsurf, INFO, "content %p w:%d h:%d", c, width, height);
-
-	/* compute available columns (assuming monospaced font) - use 8
-	 * characters for better accuracy
-	 */
-	res = guit->layout->width(&textplain_style,
-				  "ABCDEFGH", 8,
-				  &character_width);
-	if (res != NSERROR_OK) {
-		return;
+	if (cp != &text->checkpoint[text->checkpoint_count - 1]) {
+		end = cp[1].start;
 	}
 
-	columns = (width - MARGIN - MARGIN) * 8 / character_width;
-	textplain_tab_width = (TAB_WIDTH * character_width) / 8;
-
-	text->formatted_width = width;
-
-	text->physical_line_count = 0;
-
-	if (!line) {
-		text->physical_line = line =
-			malloc(sizeof(struct textplain_line) * (1024 + 3));
-		if (!line)
-			goto no_memory;
-	}
-
-	line[line_count++].start = line_start = 0;
 	space = 0;
-	i = 0;
+	i = cp->start;
 	col = 0;
-	while (i < utf8_data_size) {
+	while (i < end) {
 		size_t csize; /* number of bytes in character */
 		uint32_t chr;
 		bool term;
 		size_t next_col;
 		parserutils_error perror;
 
-		perror = parserutils_charset_utf8_to_ucs4((const uint8_t *)utf8_data + i, utf8_data_size - i, &chr, &csize);
+		perror = parserutils_charset_utf8_to_ucs4((const uint8_t *)utf8_data + i, end - i, &chr, &csize);
 		if (perror != PARSERUTILS_OK) {
 			chr = 0xfffd;
+			csize = 1;
 		}
 
 		term = (chr == '\n' || chr == '\r');
@@ -464,20 +559,13 @@ static void textplain_reformat(struct content *c, int width, int height)
 		}
 
 		if (term || next_col >= columns) {
-			if (line_count % 1024 == 0) {
-				line1 = realloc(line,
-						sizeof(struct textplain_line) *
-						(line_count + 1024 + 3));
-				if (!line1)
-					goto no_memory;
-				text->physical_line = line = line1;
-			}
+			size_t length;
 
 			if (term) {
-				line[line_count-1].length = i - line_start;
+				length = i - line_start;
 
 				/* skip second char of CR/LF or LF/CR pair */
-				if (i + 1 < utf8_data_size &&
+				if (i + 1 < end &&
 				    utf8_data[i+1] != utf8_data[i] &&
 				    (utf8_data[i+1] == '\n' ||
 				     utf8_data[i+1] == '\r')) {
@@ -487,12 +575,19 @@ static void textplain_reformat(struct content *c, int width, int height)
 				if (space) {
 					/* break at last space in line */
 					i = space;
-					line[line_count-1].length = (i + 1) - line_start;
+					csize = 1;
+					length = (i + 1) - line_start;
 				} else
-					line[line_count-1].length = i - line_start;
+					length = i - line_start;
+			}
+
+			if (line != NULL) {
+				line[line_count].start = line_start;
+				line[line_count].length = length;
 			}
+			line_count++;
 
-			line[line_count++].start = line_start = i + 1;
+			line_start = i + 1;
 			col = 0;
 			space = 0;
 		} else {
@@ -502,18 +597,181 @@ static void textplain_reformat(struct content *c, int width, int height)
 		}
 		i += csize;
 	}
-	line[line_count-1].length = i - line[line_count-1].start;
-	line[line_count].start = utf8_data_size;
+
+	/* the last line of the text has no terminator */
+	if (end == text->utf8_data_size) {
+		if (line != NULL) {
+			line[line_count].start = line_start;
+			line[line_count].length = end - line_start;
+		}
+		line_count++;
+	}
+
+	return line_count;
+}
+
+
+/**
+ * Find the checkpoint a physical line follows.
+ *
+ * \param text The text content.
+ * \param lineno The physical line number, which must be valid.
+ * \return The checkpoint.
+ */
+static struct textplain_checkpoint *
+textplain_checkpoint_for_line(textplain_content *text, unsigned long lineno)
+{
+	unsigned long lo = 0;
+	unsigned long hi = text->checkpoint_count;
+
+	/* find the last checkpoint starting at or before the line */
+	while (hi - lo > 1) {
+		unsigned long mid = lo + (hi - lo) / 2;
+
+		if (text->checkpoint[mid].line <= lineno)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	return &text->checkpoint[lo];
+}
+
+
+/**
+ * Find the checkpoint a byte of the text follows.
+ *
+ * \param text The text content.
+ * \param offset The byte offset within the text.
+ * \return The checkpoint.
+ */
+static struct textplain_checkpoint *
+textplain_checkpoint_for_offset(textplain_content *text, size_t offset)
+{
+	unsigned long lo = 0;
+	unsigned long hi = text->checkpoint_count;
+
+	/* find the last checkpoint starting at or before the offset */
+	while (hi - lo > 1) {
+		unsigned long mid = lo + (hi - lo) / 2;
+
+		if (text->checkpoint[mid].start <= offset)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	return &text->checkpoint[lo];
+}
+
+
+/**
+ * Ensure the physical lines following a checkpoint are available.
+ *
+ * \param text The text content.
+ * \param cp The checkpoint.
+ * \return true on success, false on memory exhaustion.
+ */
+static bool
+textplain_checkpoint_lines(textplain_content *text,
+			   struct textplain_checkpoint *cp)
+{
+	if (cp->lines != NULL)
+		return true;
+
+	cp->lines = malloc(sizeof(struct textplain_line) * cp->line_count);
+	if (cp->lines == NULL) {
+		NSLOG(netsurf, INFO, "out of memory (line_count %lu)",
+		      cp->line_count);
+		return false;
+	}
+
+	textplain_wrap(text, cp, cp->lines);
+
+	return true;
+}
+
+
+/**
+ * Get a physical line of the text.
+ *
+ * \param text The text content.
+ * \param lineno The physical line number, which must be valid.
+ * \return The line, or NULL on memory exhaustion.
+ */
+static const struct textplain_line *
+textplain_physical_line(textplain_content *text, unsigned long lineno)
+{
+	struct textplain_checkpoint *cp;
+
+	assert(lineno < text->physical_line_count);
+
+	cp = textplain_checkpoint_for_line(text, lineno);
+	if (textplain_checkpoint_lines(text, cp) == false)
+		return NULL;
+
+	return &cp->lines[lineno - cp->line];
+}
+
+
+/**
+ * Reformat a CONTENT_TEXTPLAIN to a new width.
+ *
+ * Only the number of physical lines following each checkpoint is
+ * found. Checkpoints whose hard lines all fit in the width need no
+ * wrapping to do so.
+ */
+static void textplain_reformat(struct content *c, int width, int height)
+{
+	textplain_content *text = (textplain_content *) c;
+	unsigned long line_count = 0;
+	unsigned long i;
+	size_t columns = 80;
+	int character_width;
+	nserror res;
+
+	NSLOG(netsurf, INFO, "content %p w:%d h:%d", c, width, height);
+
+	/* compute available columns (assuming monospaced font) - use 8
+	 * characters for better accuracy
+	 */
+	res = guit->layout->width(&textplain_style,
+				  "ABCDEFGH", 8,
+				  &character_width);
+	if (res != NSERROR_OK) {
+		return;
+	}
+
+	columns = (width - MARGIN - MARGIN) * 8 / character_width;
+	textplain_tab_width = (TAB_WIDTH * character_width) / 8;
+
+	text->formatted_width = width;
+
+	if (columns != text->columns || text->physical_line_count == 0) {
+		text->columns = columns;
+
+		for (i = 0; i < text->checkpoint_count; i++) {
+			struct textplain_checkpoint *cp = &text->checkpoint[i];
+
+			free(cp->lines);
+			cp->lines = NULL;
+
+			if (cp->columns < columns) {
+				cp->line_count = cp->hard_lines;
+			} else {
+				cp->line_count = textplain_wrap(text, cp, NULL);
+			}
+		}
+	}
+
+	for (i = 0; i < text->checkpoint_count; i++) {
+		text->checkpoint[i].line = line_count;
+		line_count += text->checkpoint[i].line_count;
+	}
 
 	text->physical_line_count = line_count;
 	c->width = width;
 	c->height = line_count * textplain_line_height() + MARGIN + MARGIN;
-
-	return;
-
-no_memory:
-	NSLOG(netsurf, INFO, "out of memory (line_count %lu)", line_count);
-	return;
 }
 
 
@@ -531,8 +789,13 @@ static void textplain_destroy(struct content *c)
 		parserutils_inputstream_destroy(text->inputstream);
 	}
 
-	if (text->physical_line != NULL) {
-		free(text->physical_line);
+	if (text->checkpoint != NULL) {
+		unsigned long i;
+
+		for (i = 0; i < text->checkpoint_count; i++) {
+			free(text->checkpoint[i].lines);
+		}
+		free(text->checkpoint);
 	}
 
 	if (text->utf8_data != NULL) {
@@ -551,6 +814,7 @@ static nserror textplain_clone(const struct content *old, struct content **newc)
 	textplain_content *text;
 	nserror error;
 	const uint8_t *data;
+	size_t offset = 0;
 	size_t size;
 
 	text = calloc(1, sizeof(textplain_content));
@@ -570,14 +834,15 @@ static nserror textplain_clone(const struct content *old, struct content **newc)
 		return error;
 	}
 
-	data = content__get_source_data(&text->base, &size);
-	if (size > 0) {
+	while ((data = content__read_source_data(&text->base,
+						 offset, &size)) != NULL) {
 		if (textplain_process_data(&text->base,
 					   (const char *)data,
 					   size) == false) {
 			content_destroy(&text->base);
 			return NSERROR_NOMEM;
 		}
+		offset += size;
 	}
 
 	if (old->status == CONTENT_STATUS_READY ||
@@ -616,7 +881,7 @@ textplain_offset_from_coords(struct content *c, int x, int y, int dir)
 {
 	textplain_content *textc = (textplain_content *) c;
 	float line_height = textplain_line_height();
-	struct textplain_line *line;
+	const struct textplain_line *line;
 	const char *text;
 	unsigned nlines;
 	size_t length;
@@ -635,7 +900,10 @@ textplain_offset_from_coords(struct content *c, int x, int y, int dir)
 	else if ((unsigned)y >= nlines)
 		y = nlines - 1;
 
-	line = &textc->physical_line[y];
+	line = textplain_physical_line(textc, y);
+	if (line == NULL)
+		return 0;
+
 	text = textc->utf8_data + line->start;
 	length = line->length;
 	idx = 0;
@@ -1064,7 +1332,7 @@ textplain_redraw(struct content *c,
 	float scaled_line_height = line_height * data->scale;
 	long line0 = (clip->y0 - y * data->scale) / scaled_line_height - 1;
 	long line1 = (clip->y1 - y * data->scale) / scaled_line_height + 1;
-	struct textplain_line *line = text->physical_line;
+	const struct textplain_line *line;
 	size_t length;
 	plot_style_t *plot_style_highlight;
 	nserror res;
@@ -1085,7 +1353,7 @@ textplain_redraw(struct content *c,
 		return false;
 	}
 
-	if (!line)
+	if (line_count == 0)
 		return true;
 
 	/* choose a suitable background colour for any highlighted text */
@@ -1100,14 +1368,19 @@ textplain_redraw(struct content *c,
 	x = (x + MARGIN) * data->scale;
 	y = (y + MARGIN) * data->scale;
 	for (lineno = line0; lineno != line1; lineno++) {
-		const char *text_d = utf8_data + line[lineno].start;
+		const char *text_d;
 		int tab_width = textplain_tab_width * data->scale;
 		size_t offset = 0;
 		int tx = x;
 
 		if (!tab_width) tab_width = 1;
 
-		length = line[lineno].length;
+		line = textplain_physical_line(text, lineno);
+		if (line == NULL)
+			return false;
+
+		text_d = utf8_data + line->start;
+		length = line->length;
 		if (!length)
 			continue;
 
@@ -1126,7 +1399,7 @@ textplain_redraw(struct content *c,
 
 			if (!text_draw(text_d + offset,
 				       next_offset - offset,
-				       line[lineno].start + offset,
+				       line->start + offset,
 				       tx,
 				       y + (lineno * scaled_line_height),
 				       clip,
@@ -1159,7 +1432,7 @@ textplain_redraw(struct content *c,
 			 */
 
 			if (bw) {
-				unsigned tab_ofst = line[lineno].start + next_offset;
+				unsigned tab_ofst = line->start + next_offset;
 				struct selection *sel = text->sel;
 				bool highlighted = false;
 
@@ -1330,13 +1603,15 @@ textplain_get_line(struct content *c,
 		   size_t *plen)
 {
 	textplain_content *text = (textplain_content *) c;
-	struct textplain_line *line;
+	const struct textplain_line *line;
 
 	assert(c != NULL);
 
 	if (lineno >= text->physical_line_count)
 		return NULL;
-	line = &text->physical_line[lineno];
+	line = textplain_physical_line(text, lineno);
+	if (line == NULL)
+		return NULL;
 
 	*poffset = line->start;
 	*plen = line->length;
@@ -1357,28 +1632,37 @@ textplain_get_line(struct content *c,
 static int textplain_find_line(struct content *c, unsigned offset)
 {
 	textplain_content *text = (textplain_content *) c;
-	struct textplain_line *line;
-	int nlines;
-	int lineno = 0;
+	struct textplain_checkpoint *cp;
+	unsigned long lo, hi;
 
 	assert(c != NULL);
 
-	line = text->physical_line;
-	nlines = text->physical_line_count;
-
 	if (offset > text->utf8_data_size) {
 		return -1;
 	}
 
-/* \todo - implement binary search here */
-	while (lineno < nlines && line[lineno].start < offset) {
-		lineno++;
+	if (text->physical_line_count == 0) {
+		return 0;
+	}
+
+	cp = textplain_checkpoint_for_offset(text, offset);
+	if (textplain_checkpoint_lines(text, cp) == false) {
+		return cp->line;
 	}
-	if (line[lineno].start > offset) {
-		lineno--;
+
+	/* find the last line starting at or before the offset */
+	lo = 0;
+	hi = cp->line_count;
+	while (hi - lo > 1) {
+		unsigned long mid = lo + (hi - lo) / 2;
+
+		if (cp->lines[mid].start <= offset)
+			lo = mid;
+		else
+			hi = mid;
 	}
 
-	return lineno;
+	return cp->line + lo;
 }
 
 
@@ -1465,45 +1749,42 @@ textplain_coords_from_range(struct content *c,
 {
 	textplain_content *text = (textplain_content *) c;
 	float line_height = textplain_line_height();
-	char *utf8_data;
-	struct textplain_line *line;
+	const struct textplain_line *line = NULL;
 	unsigned lineno = 0;
-	unsigned nlines;
+	unsigned end_lineno;
 
 	assert(c != NULL);
 	assert(start <= end);
 	assert(end <= text->utf8_data_size);
 
-	utf8_data = text->utf8_data;
-	nlines = text->physical_line_count;
-	line = text->physical_line;
-
 	/* find start */
 	lineno = textplain_find_line(c, start);
 
 	r->y0 = (int)(MARGIN + lineno * line_height);
 
-	if (lineno + 1 <= nlines || line[lineno + 1].start >= end) {
-		/* \todo - it may actually be more efficient just to
-		 *   run forwards most of the time
-		 */
+	/* find end */
+	end_lineno = textplain_find_line(c, end);
+
+	if (end_lineno == lineno && lineno < text->physical_line_count) {
+		line = textplain_physical_line(text, lineno);
+	}
 
-		/* find end */
-		lineno = textplain_find_line(c, end);
+	if (line == NULL) {
+		lineno = end_lineno;
 
 		r->x0 = 0;
 		r->x1 = text->formatted_width;
 	} else {
 		/* single line */
-		const char *text = utf8_data + line[lineno].start;
+		const char *utf8_data = text->utf8_data + line->start;
 
-		r->x0 = textplain_coord_from_offset(text,
-						    start - line[lineno].start,
-						    line[lineno].length);
+		r->x0 = MARGIN + textplain_coord_from_offset(utf8_data,
+						start - line->start,
+						line->length);
 
-		r->x1 = textplain_coord_from_offset(text,
-						    end - line[lineno].start,
-						    line[lineno].length);
+		r->x1 = MARGIN + textplain_coord_from_offset(utf8_data,
+						end - line->start,
+						line->length);
 	}
 
 	r->y1 = (int)(MARGIN + (lineno + 1) * line_height);
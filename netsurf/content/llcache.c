@@ -161,6 +161,19 @@ typedef enum {
 	LLCACHE_STATE_DISC, /**< source data is stored on disc */
 } llcache_store_state;
 
+/**
+ * Chunk of low-level cache object source data.
+ *
+ * Source data is accumulated as a list of chunks while it is fetched
+ * so growing it never moves data already received.
+ */
+typedef struct llcache_chunk {
+	struct llcache_chunk *next;  /**< Next chunk of source data */
+	uint8_t *data;		     /**< Chunk data */
+	size_t len;		     /**< Byte length of data in chunk */
+	size_t alloc;		     /**< Allocated size of chunk data */
+} llcache_chunk;
+
 /**
  * Low-level cache object
  *
@@ -170,12 +183,22 @@ struct llcache_object {
 	llcache_object *prev;	     /**< Previous in list */
 	llcache_object *next;	     /**< Next in list */
 
+	llcache_object *index_prev;  /**< Previous in URL index chain */
+	llcache_object *index_next;  /**< Next in URL index chain */
+
 	nsurl *url;		     /**< Post-redirect URL for object */
+	uint32_t url_hash;	     /**< Hash of url used by the URL index */
 
-	/** \todo We need a generic dynamic buffer object */
-	uint8_t *source_data;	     /**< Source data for object */
+	/**
+	 * Source data for object when held contiguously.
+	 *
+	 * Only one of source_data and source_chunks holds the source
+	 * data at any time.
+	 */
+	uint8_t *source_data;
 	size_t source_len;	     /**< Byte length of source data */
-	size_t source_alloc;	     /**< Allocated size of source buffer */
+	llcache_chunk *source_chunks; /**< Source data chunks */
+	llcache_chunk *source_tail;  /**< Last source data chunk */
 
 	struct cert_chain *chain;    /**< Certificate chain from the fetch */
 
@@ -214,6 +237,20 @@ struct llcache_s {
 	/** Head of the low-level uncached object list */
 	llcache_object *uncached_objects;
 
+	/**
+	 * Hash index of the cached object list by URL.
+	 *
+	 * Each bucket is a chain of objects linked through their
+	 * index_next and index_prev members.
+	 */
+	llcache_object **cached_index;
+
+	/** Number of buckets in the cached object index (a power of two) */
+	size_t cached_index_size;
+
+	/** Number of objects in the cached object index */
+	size_t cached_index_count;
+
 	/** The target upper bound for the RAM cache size */
 	uint32_t limit;
 
@@ -263,6 +300,12 @@ struct llcache_s {
 
 };
 
+/** Minimum allocation size of a source data chunk */
+#define LLCACHE_CHUNK_SIZE (64 * 1024)
+
+/** Initial number of buckets in the cached object URL index */
+#define LLCACHE_INDEX_INITIAL_SIZE 256
+
 /** low level cache state */
 static struct llcache_s *llcache = NULL;
 
@@ -413,6 +456,312 @@ static nserror llcache_send_event_to_users(llcache_object *object,
 	return error;
 }
 
+/**
+ * Free the source data chunks of a low-level cache object
+ *
+ * \param object  Object to free source chunks of
+ */
+static void llcache_source_free_chunks(llcache_object *object)
+{
+	llcache_chunk *chunk, *next;
+
+	for (chunk = object->source_chunks; chunk != NULL; chunk = next) {
+		next = chunk->next;
+		free(chunk->data);
+		free(chunk);
+	}
+
+	object->source_chunks = NULL;
+	object->source_tail = NULL;
+}
+
+/**
+ * Make contiguous low-level cache object source data the first chunk
+ *
+ * RAM source data is adopted without copying. Source data owned by
+ * the backing store is copied and the store copy released.
+ *
+ * \param object  Object with contiguous source data
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+static nserror llcache_source_unflatten(llcache_object *object)
+{
+	llcache_chunk *chunk;
+
+	chunk = calloc(1, sizeof(llcache_chunk));
+	if (chunk == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	if (object->store_state == LLCACHE_STATE_DISC) {
+		chunk->data = malloc(object->source_len);
+		if (chunk->data == NULL) {
+			free(chunk);
+			return NSERROR_NOMEM;
+		}
+		memcpy(chunk->data, object->source_data, object->source_len);
+		guit->llcache->release(object->url, BACKING_STORE_NONE);
+		object->store_state = LLCACHE_STATE_RAM;
+	} else {
+		chunk->data = object->source_data;
+	}
+
+	chunk->len = chunk->alloc = object->source_len;
+
+	object->source_chunks = object->source_tail = chunk;
+	object->source_data = NULL;
+
+	return NSERROR_OK;
+}
+
+/**
+ * Append data to the source data of a low-level cache object
+ *
+ * Data is copied into the free space of the last chunk and any
+ * remainder placed in a new chunk. Data already held is never moved.
+ *
+ * \param object  Object to append data to
+ * \param data	  Data to append
+ * \param len	  Byte length of data
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+static nserror
+llcache_source_append(llcache_object *object, const uint8_t *data, size_t len)
+{
+	llcache_chunk *chunk;
+	size_t space;
+	nserror error;
+
+	if (len == 0) {
+		return NSERROR_OK;
+	}
+
+	if (object->source_data != NULL) {
+		error = llcache_source_unflatten(object);
+		if (error != NSERROR_OK) {
+			return error;
+		}
+	}
+
+	chunk = object->source_tail;
+	if (chunk != NULL) {
+		space = chunk->alloc - chunk->len;
+		if (space > len) {
+			space = len;
+		}
+		memcpy(chunk->data + chunk->len, data, space);
+		chunk->len += space;
+		object->source_len += space;
+		data += space;
+		len -= space;
+	}
+
+	if (len == 0) {
+		return NSERROR_OK;
+	}
+
+	chunk = calloc(1, sizeof(llcache_chunk));
+	if (chunk == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	chunk->alloc = (len > LLCACHE_CHUNK_SIZE) ? len : LLCACHE_CHUNK_SIZE;
+	chunk->data = malloc(chunk->alloc);
+	if (chunk->data == NULL) {
+		free(chunk);
+		return NSERROR_NOMEM;
+	}
+
+	memcpy(chunk->data, data, len);
+	chunk->len = len;
+
+	if (object->source_tail == NULL) {
+		object->source_chunks = chunk;
+	} else {
+		object->source_tail->next = chunk;
+	}
+	object->source_tail = chunk;
+	object->source_len += len;
+
+	return NSERROR_OK;
+}
+
+/**
+ * Adopt a buffer as the next run of low-level cache object source data
+ *
+ * \param object  Object to append data to
+ * \param data	  Data to adopt, allocated with malloc()
+ * \param len	  Byte length of data
+ * \return NSERROR_OK on success, appropriate error otherwise. The data
+ *         is freed on error.
+ */
+static nserror
+llcache_source_adopt(llcache_object *object, uint8_t *data, size_t len)
+{
+	llcache_chunk *chunk;
+	nserror error;
+
+	if (len == 0) {
+		free(data);
+		return NSERROR_OK;
+	}
+
+	if (object->source_data != NULL) {
+		error = llcache_source_unflatten(object);
+		if (error != NSERROR_OK) {
+			free(data);
+			return error;
+		}
+	}
+
+	chunk = calloc(1, sizeof(llcache_chunk));
+	if (chunk == NULL) {
+		free(data);
+		return NSERROR_NOMEM;
+	}
+
+	chunk->data = data;
+	chunk->len = chunk->alloc = len;
+
+	if (object->source_tail == NULL) {
+		object->source_chunks = chunk;
+	} else {
+		object->source_tail->next = chunk;
+	}
+	object->source_tail = chunk;
+	object->source_len += len;
+
+	return NSERROR_OK;
+}
+
+/**
+ * Release unused space at the end of low-level cache object source data
+ *
+ * \param object  Object to shrink the source data of
+ */
+static void llcache_source_shrink(llcache_object *object)
+{
+	llcache_chunk *chunk = object->source_tail;
+	uint8_t *temp;
+
+	if ((chunk == NULL) || (chunk->len == chunk->alloc)) {
+		return;
+	}
+
+	temp = realloc(chunk->data, chunk->len);
+	if (temp != NULL) {
+		chunk->data = temp;
+		chunk->alloc = chunk->len;
+	}
+}
+
+/**
+ * Make low-level cache object source data contiguous
+ *
+ * A single chunk is adopted without copying, otherwise the chunks are
+ * copied into a new buffer and freed.
+ *
+ * \param object  Object to flatten the source data of
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+static nserror llcache_source_flatten(llcache_object *object)
+{
+	llcache_chunk *chunk;
+	uint8_t *data;
+	size_t len = 0;
+
+	if (object->source_chunks == NULL) {
+		return NSERROR_OK;
+	}
+
+	if (object->source_chunks->next == NULL) {
+		llcache_source_shrink(object);
+		data = object->source_chunks->data;
+		object->source_chunks->data = NULL;
+	} else {
+		NSLOG(llcache, DEBUG, "Flattening %"PRIsizet" bytes for %p",
+		      object->source_len, object);
+
+		data = malloc(object->source_len);
+		if (data == NULL) {
+			return NSERROR_NOMEM;
+		}
+
+		for (chunk = object->source_chunks;
+		     chunk != NULL;
+		     chunk = chunk->next) {
+			memcpy(data + len, chunk->data, chunk->len);
+			len += chunk->len;
+		}
+	}
+
+	llcache_source_free_chunks(object);
+	object->source_data = data;
+
+	return NSERROR_OK;
+}
+
+/**
+ * Find a contiguous run of low-level cache object source data
+ *
+ * \param object  Object to read source data from
+ * \param offset  Byte offset of the start of the run
+ * \param len	  Pointer to location to receive the byte length of the run
+ * \return Pointer to the run, or NULL if there is no data at offset
+ */
+static const uint8_t *
+llcache_source_run(const llcache_object *object, size_t offset, size_t *len)
+{
+	const llcache_chunk *chunk;
+
+	*len = 0;
+
+	if (offset >= object->source_len) {
+		return NULL;
+	}
+
+	if (object->source_data != NULL) {
+		*len = object->source_len - offset;
+		return object->source_data + offset;
+	}
+
+	for (chunk = object->source_chunks; chunk != NULL; chunk = chunk->next) {
+		if (offset < chunk->len) {
+			*len = chunk->len - offset;
+			return chunk->data + offset;
+		}
+		offset -= chunk->len;
+	}
+
+	return NULL;
+}
+
+/**
+ * Discard the first run of low-level cache object source data
+ *
+ * Used when streaming to drop data once it has been delivered.
+ *
+ * \param object  Object to discard source data from
+ */
+static void llcache_source_discard_run(llcache_object *object)
+{
+	llcache_chunk *chunk = object->source_chunks;
+
+	if (object->source_data != NULL) {
+		free(object->source_data);
+		object->source_data = NULL;
+		object->source_len = 0;
+	} else if (chunk != NULL) {
+		object->source_chunks = chunk->next;
+		if (object->source_chunks == NULL) {
+			object->source_tail = NULL;
+		}
+		object->source_len -= chunk->len;
+		free(chunk->data);
+		free(chunk);
+	}
+}
+
 /**
  * Create a new low-level cache object
  *
@@ -429,6 +778,7 @@ static nserror llcache_object_new(nsurl *url, llcache_object **result)
 	NSLOG(llcache, DEBUG, "Created object %p (%s)", obj, nsurl_access(url));
 
 	obj->url = nsurl_ref(url);
+	obj->url_hash = nsurl_hash(url);
 
 	*result = obj;
 
@@ -1071,6 +1421,7 @@ static nserror llcache_object_destroy(llcache_object *object)
 			free(object->source_data);
 		}
 	}
+	llcache_source_free_chunks(object);
 
 	nsurl_unref(object->url);
 
@@ -1106,9 +1457,128 @@ static nserror llcache_object_destroy(llcache_object *object)
 	return NSERROR_OK;
 }
 
+/**
+ * Double the number of buckets in the cached object URL index.
+ *
+ * If the larger table cannot be allocated the index continues to
+ * operate with longer chains.
+ */
+static void llcache_index_grow(void)
+{
+	llcache_object **index;
+	llcache_object *object, *next;
+	size_t size = llcache->cached_index_size * 2;
+	size_t bucket;
+	size_t idx;
+
+	index = calloc(size, sizeof(llcache_object *));
+	if (index == NULL) {
+		return;
+	}
+
+	for (idx = 0; idx < llcache->cached_index_size; idx++) {
+		for (object = llcache->cached_index[idx];
+		     object != NULL;
+		     object = next) {
+			next = object->index_next;
+
+			bucket = object->url_hash & (size - 1);
+			object->index_prev = NULL;
+			object->index_next = index[bucket];
+			if (index[bucket] != NULL) {
+				index[bucket]->index_prev = object;
+			}
+			index[bucket] = object;
+		}
+	}
+
+	free(llcache->cached_index);
+	llcache->cached_index = index;
+	llcache->cached_index_size = size;
+}
+
+/**
+ * Add a low-level cache object to the cached object URL index
+ *
+ * \param object  Object to add
+ */
+static void llcache_index_add(llcache_object *object)
+{
+	size_t bucket;
+
+	if (llcache->cached_index_count >= llcache->cached_index_size) {
+		llcache_index_grow();
+	}
+
+	bucket = object->url_hash & (llcache->cached_index_size - 1);
+
+	object->index_prev = NULL;
+	object->index_next = llcache->cached_index[bucket];
+	if (object->index_next != NULL) {
+		object->index_next->index_prev = object;
+	}
+	llcache->cached_index[bucket] = object;
+
+	llcache->cached_index_count++;
+}
+
+/**
+ * Remove a low-level cache object from the cached object URL index
+ *
+ * \param object  Object to remove
+ */
+static void llcache_index_remove(llcache_object *object)
+{
+	size_t bucket;
+
+	if (object->index_prev == NULL) {
+		bucket = object->url_hash & (llcache->cached_index_size - 1);
+		llcache->cached_index[bucket] = object->index_next;
+	} else {
+		object->index_prev->index_next = object->index_next;
+	}
+
+	if (object->index_next != NULL) {
+		object->index_next->index_prev = object->index_prev;
+	}
+
+	object->index_prev = NULL;
+	object->index_next = NULL;
+
+	llcache->cached_index_count--;
+}
+
+/**
+ * Find the most recently requested cached object for a URL
+ *
+ * \param url  The URL to search for
+ * \return The newest cached object with the URL or NULL if there is none.
+ */
+static llcache_object *llcache_index_find_newest(nsurl *url)
+{
+	llcache_object *obj, *newest = NULL;
+	uint32_t hash = nsurl_hash(url);
+
+	for (obj = llcache->cached_index[hash & (llcache->cached_index_size - 1)];
+	     obj != NULL;
+	     obj = obj->index_next) {
+		if ((obj->url_hash == hash) &&
+		    (newest == NULL ||
+		     obj->cache.req_time > newest->cache.req_time) &&
+		    nsurl_compare(obj->url, url, NSURL_COMPLETE) == true) {
+			newest = obj;
+		}
+	}
+
+	return newest;
+}
+
 /**
  * Add a low-level cache object to a cache list
  *
+ * Objects added to the cached object list are also added to the URL
+ * index.
+ *
  * \param object  Object to add
  * \param list	  List to add to
  * \return NSERROR_OK
@@ -1123,6 +1593,10 @@ static nserror llcache_object_add_to_list(llcache_object *object,
 		(*list)->prev = object;
 	*list = object;
 
+	if (list == &llcache->cached_objects) {
+		llcache_index_add(object);
+	}
+
 	return NSERROR_OK;
 }
 
@@ -1259,6 +1733,9 @@ static nserror llcache_object_clone_cache_data(llcache_object *source,
 /**
  * Remove a low-level cache object from a cache list
  *
+ * Objects removed from the cached object list are also removed from
+ * the URL index.
+ *
  * \param object  Object to remove
  * \param list	  List to remove from
  * \return NSERROR_OK
@@ -1274,6 +1751,10 @@ llcache_object_remove_from_list(llcache_object *object, llcache_object **list)
 	if (object->next != NULL)
 		object->next->prev = object->prev;
 
+	if (list == &llcache->cached_objects) {
+		llcache_index_remove(object);
+	}
+
 	return NSERROR_OK;
 }
 
@@ -1291,6 +1772,7 @@ static nserror llcache_retrieve_persisted_data(llcache_object *object)
 {
 	/* ensure the source data is present if necessary */
 	if ((object->source_data != NULL) ||
+	    (object->source_chunks != NULL) ||
 	    (object->store_state != LLCACHE_STATE_DISC)) {
 		/* source data does not require retrieving from
 		 * persistent store.
@@ -1748,9 +2230,6 @@ skip_ssl_certificates:
 	/* update object on successful parse of metadata  */
 	object->source_len = source_length;
 
-	/** \todo really not sure this is right, nothing is allocated here? */
-	object->source_alloc = metadatalen;
-
 	object->cache.req_time = request_time;
 	object->cache.res_time = response_time;
 	object->cache.fin_time = completion_time;
@@ -1920,7 +2399,7 @@ llcache_object_retrieve_from_cache(nsurl *url,
 				   llcache_object **result)
 {
 	nserror error;
-	llcache_object *obj, *newest = NULL;
+	llcache_object *obj, *newest;
 
 	NSLOG(llcache, DEBUG,
 	      "Searching cache for %s flags:%"PRIx32" referer:%s post:%p",
@@ -1929,15 +2408,7 @@ llcache_object_retrieve_from_cache(nsurl *url,
 	      post);
 
 	/* Search for the most recently fetched matching object */
-	for (obj = llcache->cached_objects; obj != NULL; obj = obj->next) {
-
-		if ((newest == NULL ||
-		     obj->cache.req_time > newest->cache.req_time) &&
-		    nsurl_compare(obj->url, url,
-				  NSURL_COMPLETE) == true) {
-			newest = obj;
-		}
-	}
+	newest = llcache_index_find_newest(url);
 
 	/* No viable object found in cache create one and attempt to
 	 * pull from persistent store.
@@ -2497,12 +2968,14 @@ static nserror llcache_fetch_notmodified(llcache_object *object,
  * \param object  Object being fetched
  * \param data	  Data to process
  * \param len	  Byte length of data
+ * \param adopt	  Whether to take ownership of data instead of copying it
  * \return NSERROR_OK on success, appropriate error otherwise.
  */
 static nserror
 llcache_fetch_process_data(llcache_object *object,
 			   const uint8_t *data,
-			   size_t len)
+			   size_t len,
+			   bool adopt)
 {
 	if (object->fetch.state != LLCACHE_FETCH_DATA) {
 		/**
@@ -2538,22 +3011,12 @@ llcache_fetch_process_data(llcache_object *object,
 		object->fetch.state = LLCACHE_FETCH_DATA;
 	}
 
-	/* Resize source buffer if it's too small */
-	if (object->source_len + len >= object->source_alloc) {
-		const size_t new_len = object->source_len + len + 64 * 1024;
-		uint8_t *temp = realloc(object->source_data, new_len);
-		if (temp == NULL)
-			return NSERROR_NOMEM;
-
-		object->source_data = temp;
-		object->source_alloc = new_len;
+	/* Append this data to the source chunks */
+	if (adopt) {
+		return llcache_source_adopt(object, (uint8_t *) data, len);
 	}
 
-	/* Append this data chunk to source buffer */
-	memcpy(object->source_data + object->source_len, data, len);
-	object->source_len += len;
-
-	return NSERROR_OK;
+	return llcache_source_append(object, data, len);
 }
 
 
@@ -2823,9 +3286,14 @@ build_candidate_list(struct llcache_object ***lst_out, int *lst_len_out)
 /**
  * Write an object to the backing store.
  *
+ * The backing store may complete the write after this returns, so the
+ * time taken here is only that of handing the object to the store. The
+ * store reports the time the writes themselves took with
+ * llcache_store_written().
+ *
  * \param object The object to put in the backing store.
  * \param written_out The amount of data written out.
- * \param elapsed The time in ms it took to complete the write to backing store.
+ * \param elapsed The time in ms it took to hand the object to the store.
  * \return NSERROR_OK on success or appropriate error code.
  */
 static nserror
@@ -2841,6 +3309,12 @@ write_backing_store(struct llcache_object *object,
 
 	nsu_getmonotonic_ms(&startms);
 
+	/* the backing store requires the source data to be contiguous */
+	ret = llcache_source_flatten(object);
+	if (ret != NSERROR_OK) {
+		return ret;
+	}
+
 	/* put object data in backing store */
 	ret = guit->llcache->store(object->url,
 				   BACKING_STORE_NONE,
@@ -2878,7 +3352,7 @@ write_backing_store(struct llcache_object *object,
 
 	*written_out = object->source_len + metadatasize;
 
-	/* by ignoring the overflow this assumes the writeout took
+	/* by ignoring the overflow this assumes the handover took
 	 * less than 5 weeks.
 	 */
 	*elapsed = endms - startms;
@@ -2923,6 +3397,33 @@ static void llcache_persist_slowcheck(void *p)
 	}
 }
 
+/* exported interface documented in content/backing_store.h */
+void llcache_store_written(size_t written, unsigned long elapsed)
+{
+	if (llcache == NULL) {
+		return;
+	}
+
+	/* ensure the write is reported to have taken at least the
+	 * minimal amount of time
+	 */
+	if (elapsed == 0) {
+		elapsed = 1;
+	}
+
+	llcache->total_written += written;
+	llcache->total_elapsed += elapsed;
+
+	if (((written * 1000) / elapsed) < llcache->minimum_bandwidth) {
+		/* This write was slow. Schedule a check in the future
+		 * to see if overall performance is too slow to be useful.
+		 */
+		guit->misc->schedule(llcache->time_quantum * 100,
+				     llcache_persist_slowcheck,
+				     NULL);
+	}
+}
+
 /**
  * Possibly write objects data to backing store.
  *
@@ -2939,10 +3440,10 @@ static void llcache_persist(void *p)
 	unsigned long write_limit; /* max number of bytes to write in this run*/
 
 	size_t written; /* all bytes written for a single object */
-	unsigned long elapsed; /* how long writing an object took */
+	unsigned long elapsed; /* how long handing an object over took */
 
 	size_t total_written = 0; /* total bytes written in this run */
-	unsigned long total_elapsed = 1; /* total ms used to write bytes */
+	unsigned long total_elapsed = 1; /* total ms used to hand bytes over */
 	unsigned long total_bandwidth = 0; /* total bandwidth */
 
 	ret = build_candidate_list(&lst, &lst_count);
@@ -2956,6 +3457,13 @@ static void llcache_persist(void *p)
 	/* obtained a candidate list, make each object persistent in turn */
 	for (idx = 0; idx < lst_count; idx++) {
 		ret = write_backing_store(lst[idx], &written, &elapsed);
+		if (ret == NSERROR_NOSPACE) {
+			/* the backing store is still writing earlier
+			 * objects so try again later.
+			 */
+			next = llcache->time_quantum;
+			break;
+		}
 		if (ret != NSERROR_OK) {
 			continue;
 		}
@@ -2976,32 +3484,20 @@ static void llcache_persist(void *p)
 		if (total_elapsed > llcache->time_quantum) {
 			NSLOG(llcache, INFO, "Overran timeslot");
 			/* writeout has exhausted the available time.
-			 * Either the writeout is slow or the last
-			 * object was very large.
+			 * Either the store is slow to accept data or
+			 * the last object was very large.
 			 */
-			if (total_bandwidth < llcache->minimum_bandwidth) {
-				/* Writeout was slow in this time quantum.
-				 *  Schedule a check in the future to see if
-				 *  overall performance is too slow to be useful.
+			if (total_bandwidth > llcache->maximum_bandwidth) {
+				/* fast writeout of large file
+				 * so calculate delay as if
+				 * write happened only at max
+				 * limit
 				 */
-				guit->misc->schedule(
-						llcache->time_quantum * 100,
-						llcache_persist_slowcheck,
-						NULL);
-				break;
+				next = ((total_written * llcache->time_quantum) / write_limit) - total_elapsed;
 			} else {
-				if (total_bandwidth > llcache->maximum_bandwidth) {
-					/* fast writeout of large file
-					 * so calculate delay as if
-					 * write happened only at max
-					 * limit
-					 */
-					next = ((total_written * llcache->time_quantum) / write_limit) - total_elapsed;
-				} else {
-					next = llcache->time_quantum;
-				}
-				break;
+				next = llcache->time_quantum;
 			}
+			break;
 		} else if (total_written > write_limit) {
 			/* The bandwidth limit has been reached. */
 
@@ -3030,9 +3526,6 @@ static void llcache_persist(void *p)
 		}
 	}
 
-	llcache->total_written += total_written;
-	llcache->total_elapsed += total_elapsed;
-
 	NSLOG(llcache, DEBUG,
 	      "writeout size:%"PRIsizet" time:%lu bandwidth:%lubytes/s",
 	      total_written, total_elapsed, total_bandwidth);
@@ -3097,25 +3590,26 @@ static void llcache_fetch_callback(const fetch_msg *msg, void *p)
 		/* Received some data */
 		error = llcache_fetch_process_data(object,
 				msg->data.header_or_data.buf,
-				msg->data.header_or_data.len);
+				msg->data.header_or_data.len,
+				false);
+		break;
+
+	case FETCH_DATA_ADOPT:
+		/* Received some data in a buffer we now own */
+		error = llcache_fetch_process_data(object,
+				msg->data.header_or_data.buf,
+				msg->data.header_or_data.len,
+				true);
 		break;
 
 	case FETCH_FINISHED:
 		/* Finished fetching */
 	{
-		uint8_t *temp;
-
 		object->fetch.state = LLCACHE_FETCH_COMPLETE;
 		object->fetch.fetch = NULL;
 
 		/* Shrink source buffer to required size */
-		temp = realloc(object->source_data,
-				object->source_len);
-		/* If source_len is 0, then temp may be NULL */
-		if (temp != NULL || object->source_len == 0) {
-			object->source_data = temp;
-			object->source_alloc = object->source_len;
-		}
+		llcache_source_shrink(object);
 
 		llcache_object_cache_update(object);
 
@@ -3463,30 +3957,43 @@ static nserror llcache_object_notify_users(llcache_object *object)
 				objstate >= LLCACHE_FETCH_DATA &&
 				object->source_len > handle->bytes) {
 			size_t orig_handle_read;
+			bool streaming = (object->fetch.flags &
+					  LLCACHE_RETRIEVE_STREAM_DATA) != 0;
 
-			/* Construct HAD_DATA event */
+			/* Construct HAD_DATA event from the next run of
+			 * source data. Any further runs are emitted the
+			 * next time round.
+			 */
 			event.type = LLCACHE_EVENT_HAD_DATA;
-			event.data.data.buf =
-					object->source_data + handle->bytes;
-			event.data.data.len =
-					object->source_len - handle->bytes;
+			event.data.data.buf = llcache_source_run(object,
+					handle->bytes,
+					&event.data.data.len);
 
 			/* Update record of last byte emitted */
-			if (object->fetch.flags &
-					LLCACHE_RETRIEVE_STREAM_DATA) {
-				/* Streaming, so reset to zero to
-				 * minimise amount of cached source data.
-				 * Additionally, we don't support replay
-				 * when streaming. */
+			if (streaming) {
+				/* Streaming, so the run is discarded once
+				 * emitted to minimise amount of cached
+				 * source data. Additionally, we don't
+				 * support replay when streaming. */
 				orig_handle_read = 0;
-				handle->bytes = object->source_len = 0;
+				handle->bytes = 0;
 			} else {
 				orig_handle_read = handle->bytes;
-				handle->bytes = object->source_len;
+				handle->bytes += event.data.data.len;
 			}
 
 			/* Emit event */
 			error = handle->cb(handle, &event, handle->pw);
+
+			if (streaming) {
+				llcache_source_discard_run(object);
+			}
+
+			if (object->source_len > handle->bytes) {
+				/* more source data runs to emit */
+				llcache_users_not_caught_up();
+			}
+
 			if (user->queued_for_delete) {
 				next_user = user->next;
 				llcache_object_remove_user(object, user);
@@ -3512,9 +4019,12 @@ static nserror llcache_object_notify_users(llcache_object *object)
 			}
 		}
 
-		/* User: DATA, Obj: COMPLETE => User->COMPLETE */
+		/* User: DATA, Obj: COMPLETE, all source emitted =>
+		 * User->COMPLETE
+		 */
 		if (handle->state == LLCACHE_FETCH_DATA &&
-				objstate > LLCACHE_FETCH_DATA) {
+				objstate > LLCACHE_FETCH_DATA &&
+				object->source_len <= handle->bytes) {
 			handle->state = LLCACHE_FETCH_COMPLETE;
 
 			/* Emit DONE event */
@@ -3580,16 +4090,23 @@ llcache_object_snapshot(llcache_object *object,	llcache_object **snapshot)
 	if (error != NSERROR_OK)
 		return error;
 
-	newobj->source_alloc = newobj->source_len = object->source_len;
-
 	if (object->source_len > 0) {
-		newobj->source_data = malloc(newobj->source_alloc);
+		const uint8_t *run;
+		size_t run_len;
+
+		newobj->source_data = malloc(object->source_len);
 		if (newobj->source_data == NULL) {
 			llcache_object_destroy(newobj);
 			return NSERROR_NOMEM;
 		}
-		memcpy(newobj->source_data, object->source_data,
-				newobj->source_len);
+
+		while ((run = llcache_source_run(object,
+						 newobj->source_len,
+						 &run_len)) != NULL) {
+			memcpy(newobj->source_data + newobj->source_len,
+			       run, run_len);
+			newobj->source_len += run_len;
+		}
 	}
 
 	if (object->num_headers > 0) {
@@ -3644,7 +4161,7 @@ total_object_size(llcache_object *object)
 	tot = sizeof(*object);
 	tot += nsurl_length(object->url);
 
-	if (object->source_data != NULL) {
+	if ((object->source_data != NULL) || (object->source_chunks != NULL)) {
 		tot += object->source_len;
 	}
 
@@ -3896,6 +4413,15 @@ llcache_initialise(const struct llcache_parameters *prm)
 	llcache->fetch_attempts = prm->fetch_attempts;
 	llcache->all_caught_up = true;
 
+	llcache->cached_index_size = LLCACHE_INDEX_INITIAL_SIZE;
+	llcache->cached_index = calloc(llcache->cached_index_size,
+				       sizeof(llcache_object *));
+	if (llcache->cached_index == NULL) {
+		free(llcache);
+		llcache = NULL;
+		return NSERROR_NOMEM;
+	}
+
 	NSLOG(llcache, INFO,
 	      "llcache initialising with a limit of %"PRIu32" bytes",
 	      llcache->limit);
@@ -3972,6 +4498,7 @@ void llcache_finalise(void)
 	      llcache->total_elapsed,
 	      total_bandwidth);
 
+	free(llcache->cached_index);
 	free(llcache);
 	llcache = NULL;
 }
@@ -4194,11 +4721,31 @@ nsurl *llcache_handle_get_url(const llcache_handle *handle)
 const uint8_t *llcache_handle_get_source_data(const llcache_handle *handle,
 		size_t *size)
 {
+	if ((handle->object != NULL) &&
+	    (llcache_source_flatten(handle->object) != NSERROR_OK)) {
+		NSLOG(llcache, INFO, "Unable to flatten source of %p",
+		      handle->object);
+		*size = 0;
+		return NULL;
+	}
+
 	*size = handle->object != NULL ? handle->object->source_len : 0;
 
 	return handle->object != NULL ? handle->object->source_data : NULL;
 }
 
+/* See llcache.h for documentation */
+const uint8_t *llcache_handle_read_source_data(const llcache_handle *handle,
+		size_t offset, size_t *len)
+{
+	if (handle->object == NULL) {
+		*len = 0;
+		return NULL;
+	}
+
+	return llcache_source_run(handle->object, offset, len);
+}
+
 /* See llcache.h for documentation */
 const char *llcache_handle_get_header(const llcache_handle *handle,
 		const char *key)
@@ -4224,3 +4771,43 @@ bool llcache_handle_references_same_object(const llcache_handle *a,
 {
 	return a->object == b->object;
 }
+
+/* See llcache.h for documentation */
+nserror llcache_store_derived_data(nsurl *key, uint8_t *data, size_t len)
+{
+	nserror res;
+
+	res = guit->llcache->store(key, BACKING_STORE_NONE, data, len);
+	if (res != NSERROR_OK) {
+		free(data);
+		return res;
+	}
+
+	/* the backing store frees the data once it has been written */
+	guit->llcache->release(key, BACKING_STORE_NONE);
+
+	return NSERROR_OK;
+}
+
+/* See llcache.h for documentation */
+nserror llcache_fetch_derived_data(nsurl *key, const uint8_t **data,
+		size_t *len)
+{
+	uint8_t *stored;
+	nserror res;
+
+	res = guit->llcache->fetch(key, BACKING_STORE_NONE, &stored, len);
+	if (res != NSERROR_OK) {
+		return res;
+	}
+
+	*data = stored;
+
+	return NSERROR_OK;
+}
+
+/* See llcache.h for documentation */
+void llcache_release_derived_data(nsurl *key)
+{
+	guit->llcache->release(key, BACKING_STORE_NONE);
+}
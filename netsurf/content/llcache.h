@@ -258,6 +258,10 @@ nsurl *llcache_handle_get_url(const llcache_handle *handle);
 /**
  * Retrieve source data of a low-level cache object
  *
+ * The source data is held in chunks as it is fetched and is made
+ * contiguous when this is called. Callers able to process the data
+ * in pieces should use llcache_handle_read_source_data() instead.
+ *
  * \param handle  Handle to retrieve source data from
  * \param size    Pointer to location to receive byte length of data
  * \return Pointer to source data
@@ -265,6 +269,21 @@ nsurl *llcache_handle_get_url(const llcache_handle *handle);
 const uint8_t *llcache_handle_get_source_data(const llcache_handle *handle,
 		size_t *size);
 
+/**
+ * Read a run of source data of a low-level cache object in place
+ *
+ * The source data is returned as a sequence of contiguous runs
+ * without being copied. The caller starts at offset zero and advances
+ * the offset by the returned length until NULL is returned.
+ *
+ * \param handle  Handle to read source data from
+ * \param offset  Byte offset within the source data to read from
+ * \param len     Pointer to location to receive byte length of the run
+ * \return Pointer to source data at offset, or NULL at end of the data
+ */
+const uint8_t *llcache_handle_read_source_data(const llcache_handle *handle,
+		size_t offset, size_t *len);
+
 /**
  * Retrieve a header value associated with a low-level cache object
  *
@@ -291,4 +310,41 @@ const char *llcache_handle_get_header(const llcache_handle *handle,
 bool llcache_handle_references_same_object(const llcache_handle *a,
 		const llcache_handle *b);
 
+/**
+ * Place data derived from source objects in the backing store
+ *
+ * Content handlers may use this to keep data which is expensive to
+ * compute from a source object, such as a compiled form of it, between
+ * sessions. The data is stored under its own key, which must not be
+ * the URL of a source object, and may be discarded at any time.
+ *
+ * \param key   Key to store the data under
+ * \param data  Data to store, which the cache takes ownership of
+ * \param len   Byte length of data
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+nserror llcache_store_derived_data(nsurl *key, uint8_t *data, size_t len);
+
+/**
+ * Retrieve derived data from the backing store
+ *
+ * The data must not be altered and must be released with
+ * llcache_release_derived_data() once it is no longer needed.
+ *
+ * \param key   Key the data was stored under
+ * \param data  Pointer to location to receive the data
+ * \param len   Pointer to location to receive byte length of data
+ * \return NSERROR_OK on success, NSERROR_NOT_FOUND if there is no data
+ *         stored under \a key, appropriate error otherwise
+ */
+nserror llcache_fetch_derived_data(nsurl *key, const uint8_t **data,
+		size_t *len);
+
+/**
+ * Release derived data retrieved from the backing store
+ *
+ * \param key  Key the data was retrieved with
+ */
+void llcache_release_derived_data(nsurl *key);
+
 #endif
@@ -82,13 +82,21 @@
  * simpler implementation. Entries in this tree comprise pointers to the
  * leaf nodes of the host tree described above.
  *
+ * The database is saved as a snapshot file holding a host index sorted
+ * by name, which is mapped when loaded. Only the snapshot's bloom filter
+ * is used at load time, each host's paths being added to the trees above
+ * the first time the host is looked up. Databases in the older text
+ * format are imported in full and saved as a snapshot thereafter.
+ *
  * REALLY IMPORTANT NOTE: urldb expects all URLs to be normalised. Use of
  * non-normalised URLs with urldb will result in undefined behaviour and
  * potential crashes.
  */
 
 #include <assert.h>
+#include <errno.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -97,7 +105,14 @@
 #ifdef WITH_NSPSL
 #include <nspsl.h>
 #endif
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
+#include "utils/config.h"
 #include "utils/inet.h"
 #include "utils/nsoption.h"
 #include "utils/log.h"
@@ -299,9 +314,9 @@ static struct search_node *search_trees[NUM_SEARCH_TREES] = {
 /** loaded cookie file version */
 static int loaded_cookie_file_version;
 
-/** Minimum URL database file version */
+/** Minimum text URL database file version */
 #define MIN_URL_FILE_VERSION 106
-/** Current URL database file version */
+/** Final text URL database file version, now only imported */
 #define URL_FILE_VERSION 107
 
 /**
@@ -322,176 +337,287 @@ static struct bloom_filter *url_bloom;
 #define BLOOM_SIZE (1024 * 32)
 
 
+/** URL database snapshot file identifier */
+#define URL_SNAPSHOT_MAGIC "NSURLDB"
+/** Current URL database snapshot version */
+#define URL_SNAPSHOT_VERSION 1
 /**
- * write a time_t to a file portably
+ * URL hashed to check snapshot compatibility
  *
- * \param fp File to write to
- * \param val the unix time value to output
- * \return NSERROR_OK on success
+ * The bloom filter and URL entries of a snapshot hold nsurl_hash()
+ * values, which may only be used if URLs still hash the same way.
  */
-static nserror urldb_write_timet(FILE *fp, time_t val)
-{
-	int use;
-	char op[32];
+#define URL_SNAPSHOT_HASH_URL "http://www.netsurf-browser.org/"
 
-	use = nsc_sntimet(op, 32, &val);
-	if (use == 0) {
-		fprintf(fp, "%i\n", (int)val);
-	} else {
-		fprintf(fp, "%.*s\n", use, op);
-	}
-	return NSERROR_OK;
-}
+/**
+ * URL database snapshot file header
+ *
+ * The header is followed by the bloom filter bit array, the host
+ * index sorted case-insensitively by host name, the URL entries of
+ * each host in turn and a table of NUL terminated strings. Strings
+ * are referenced by offset into the table, offset zero being the
+ * empty string. All values are stored in host byte order.
+ */
+struct urldb_snapshot_header {
+	char magic[8];		/**< URL_SNAPSHOT_MAGIC */
+	uint32_t version;	/**< URL_SNAPSHOT_VERSION */
+	uint32_t hash_check;	/**< Hash of URL_SNAPSHOT_HASH_URL */
+	uint32_t bloom_size;	/**< Size of bloom filter in bytes */
+	uint32_t bloom_items;	/**< Number of items in bloom filter */
+	uint32_t host_count;	/**< Number of entries in host index */
+	uint32_t url_count;	/**< Number of URL entries */
+	uint32_t strings_size;	/**< Size of string table in bytes */
+	uint32_t reserved;	/**< Zero */
+};
+
+/**
+ * URL database snapshot host index entry
+ */
+struct urldb_snapshot_host {
+	int64_t hsts_expires;	/**< HSTS policy expiry time */
+	uint32_t name;		/**< Host name string */
+	uint32_t hsts_include_sub_domains; /**< HSTS policy covers subdomains */
+	uint32_t first_url;	/**< Index of first URL entry of host */
+	uint32_t url_count;	/**< Number of URL entries of host */
+};
 
 /**
- * Write paths associated with a host
+ * URL database snapshot URL entry
+ */
+struct urldb_snapshot_url {
+	int64_t last_visit;	/**< Last visit time */
+	uint32_t hash;		/**< Hash of URL */
+	uint32_t scheme;	/**< Scheme string */
+	uint32_t path_query;	/**< Path and query string */
+	uint32_t title;		/**< Title string */
+	uint32_t port;		/**< Port number, zero for scheme default */
+	uint32_t visits;	/**< Number of visits */
+	uint32_t type;		/**< Content type */
+	uint32_t reserved;	/**< Zero */
+};
+
+/**
+ * Loaded URL database snapshot
  *
- * \param parent Root of (sub)tree to write
- * \param host Current host name
- * \param fp File to write to
- * \param path Current path string
- * \param path_alloc Allocated size of path
- * \param path_used Used size of path
- * \param expiry Expiry time of URLs
+ * The hosts of a snapshot are only added to the database the first
+ * time they are looked up. Once every host has been added the
+ * snapshot is released.
  */
-static void
-urldb_write_paths(const struct path_data *parent,
-		  const char *host,
-		  FILE *fp,
-		  char **path,
-		  int *path_alloc,
-		  int *path_used,
-		  time_t expiry)
-{
-	const struct path_data *p = parent;
-	int i;
+static struct {
+	const uint8_t *data;	/**< Snapshot file contents, or NULL */
+	size_t size;		/**< Size of snapshot file */
+	bool mapped;		/**< Contents are mapped rather than allocated */
+	const struct urldb_snapshot_host *hosts; /**< Host index */
+	uint32_t host_count;	/**< Number of entries in host index */
+	const struct urldb_snapshot_url *urls; /**< URL entries */
+	uint32_t url_count;	/**< Number of URL entries */
+	const char *strings;	/**< String table */
+	uint32_t strings_size;	/**< Size of string table */
+	bool *added;		/**< Hosts which have been added to database */
+	uint32_t remaining;	/**< Number of hosts not yet added */
+} url_snapshot;
+
+static void urldb_snapshot_add_host(const char *host);
 
-	do {
-		int seglen = p->segment != NULL ? strlen(p->segment) : 0;
-		int len = *path_used + seglen + 1;
-
-		if (*path_alloc < len) {
-			char *temp;
-			temp = realloc(*path,
-				       (len > 64) ? len : *path_alloc + 64);
-			if (!temp) {
-				return;
-			}
-			*path = temp;
-			*path_alloc = (len > 64) ? len : *path_alloc + 64;
-		}
 
-		if (p->segment != NULL) {
-			memcpy(*path + *path_used - 1, p->segment, seglen);
-		}
+/**
+ * Buffer a URL database snapshot section is built in
+ */
+struct urldb_snapshot_buffer {
+	uint8_t *data;		/**< Buffer contents */
+	size_t used;		/**< Amount of buffer in use */
+	size_t alloc;		/**< Allocated size of buffer */
+};
 
-		if (p->children != NULL) {
-			(*path)[*path_used + seglen - 1] = '/';
-			(*path)[*path_used + seglen] = '\0';
-		} else {
-			(*path)[*path_used + seglen - 1] = '\0';
-			len -= 1;
-		}
+/**
+ * Host to be written to a URL database snapshot
+ */
+struct urldb_snapshot_entry {
+	char *name;		/**< Host name */
+	const struct host_part *host; /**< Host in database, or NULL */
+	uint32_t index;		/**< Index of host in loaded snapshot */
+};
+
+/**
+ * URL database snapshot being written
+ */
+struct urldb_snapshot_writer {
+	struct urldb_snapshot_buffer hosts;	/**< Host index */
+	struct urldb_snapshot_buffer urls;	/**< URL entries */
+	struct urldb_snapshot_buffer strings;	/**< String table */
+	struct bloom_filter *bloom;	/**< Filter of written URLs */
+	time_t expiry;			/**< Expiry time of URLs */
+};
 
-		*path_used = len;
 
-		if (p->children != NULL) {
-			/* Drill down into children */
-			p = p->children;
-		} else {
-			/* leaf node */
-			if (p->persistent ||
-			    ((p->urld.last_visit > expiry) &&
-			     (p->urld.visits > 0))) {
-				fprintf(fp, "%s\n", lwc_string_data(p->scheme));
+/**
+ * Append data to a snapshot buffer
+ *
+ * \param buf Buffer to append to
+ * \param data Data to append
+ * \param len Length of data
+ * \return NSERROR_OK on success, NSERROR_NOMEM on memory exhaustion
+ */
+static nserror
+urldb_snapshot_buffer_add(struct urldb_snapshot_buffer *buf,
+			  const void *data,
+			  size_t len)
+{
+	if (buf->used + len > UINT32_MAX) {
+		/* offsets within the snapshot must fit in 32 bits */
+		return NSERROR_NOMEM;
+	}
 
-				if (p->port) {
-					fprintf(fp,"%d\n", p->port);
-				} else {
-					fprintf(fp, "\n");
-				}
+	if (buf->alloc < buf->used + len) {
+		size_t alloc = buf->alloc ? buf->alloc : 4096;
+		uint8_t *temp;
 
-				fprintf(fp, "%s\n", *path);
+		while (alloc < buf->used + len)
+			alloc *= 2;
 
-				/** \todo handle fragments? */
+		temp = realloc(buf->data, alloc);
+		if (temp == NULL) {
+			return NSERROR_NOMEM;
+		}
+		buf->data = temp;
+		buf->alloc = alloc;
+	}
 
-				/* number of visits */
-				fprintf(fp, "%i\n", p->urld.visits);
+	memcpy(buf->data + buf->used, data, len);
+	buf->used += len;
 
-				/* time entry was last used */
-				urldb_write_timet(fp, p->urld.last_visit);
+	return NSERROR_OK;
+}
 
-				/* entry type */
-				fprintf(fp, "%i\n", (int)p->urld.type);
 
-				fprintf(fp, "\n");
+/**
+ * Add a string to the string table of a snapshot being written
+ *
+ * \param w Snapshot writer
+ * \param str String to add, or NULL
+ * \param offset Updated with the offset of the string in the table
+ * \return NSERROR_OK on success, NSERROR_NOMEM on memory exhaustion
+ */
+static nserror
+urldb_snapshot_add_string(struct urldb_snapshot_writer *w,
+			  const char *str,
+			  uint32_t *offset)
+{
+	if (str == NULL || *str == '\0') {
+		*offset = 0;
+		return NSERROR_OK;
+	}
 
-				if (p->urld.title) {
-					uint8_t *s = (uint8_t *) p->urld.title;
+	*offset = w->strings.used;
 
-					for (i = 0; s[i] != '\0'; i++)
-						if (s[i] < 32)
-							s[i] = ' ';
-					for (--i; ((i > 0) && (s[i] == ' '));
-					     i--)
-						s[i] = '\0';
-					fprintf(fp, "%s\n", p->urld.title);
-				} else {
-					fprintf(fp, "\n");
-				}
-			}
+	return urldb_snapshot_buffer_add(&w->strings, str, strlen(str) + 1);
+}
 
-			/* Now, find next node to process. */
-			while (p != parent) {
-				int seglen = p->segment != NULL
-					? strlen(p->segment) : 0;
 
-				/* Remove our segment from the path */
-				*path_used -= seglen;
-				(*path)[*path_used - 1] = '\0';
+/**
+ * Add a URL entry to a snapshot being written
+ *
+ * \param w Snapshot writer
+ * \param su URL entry with string fields unset
+ * \param scheme URL scheme
+ * \param path_query URL path and query
+ * \param title URL title, or NULL
+ * \return NSERROR_OK on success, NSERROR_NOMEM on memory exhaustion
+ */
+static nserror
+urldb_snapshot_add_url_entry(struct urldb_snapshot_writer *w,
+			     struct urldb_snapshot_url *su,
+			     const char *scheme,
+			     const char *path_query,
+			     const char *title)
+{
+	nserror res;
 
-				if (p->next != NULL) {
-					/* Have a sibling, process that */
-					p = p->next;
-					break;
-				}
+	res = urldb_snapshot_add_string(w, scheme, &su->scheme);
+	if (res == NSERROR_OK) {
+		res = urldb_snapshot_add_string(w, path_query,
+						&su->path_query);
+	}
+	if (res == NSERROR_OK) {
+		res = urldb_snapshot_add_string(w, title, &su->title);
+	}
+	if (res == NSERROR_OK) {
+		res = urldb_snapshot_buffer_add(&w->urls, su, sizeof(*su));
+	}
+	if (res == NSERROR_OK) {
+		bloom_insert_hash(w->bloom, su->hash);
+	}
 
-				/* Going up, so remove '/' */
-				*path_used -= 1;
-				(*path)[*path_used - 1] = '\0';
+	return res;
+}
 
-				/* Ascend tree */
-				p = p->parent;
-			}
-		}
-	} while (p != parent);
+
+/**
+ * Get a string from the loaded snapshot
+ *
+ * \param offset Offset of string in string table
+ * \return The string, or the empty string if offset is out of range
+ */
+static const char *urldb_snapshot_string(uint32_t offset)
+{
+	if (offset >= url_snapshot.strings_size) {
+		return "";
+	}
+
+	/* the table is validated as being NUL terminated on load */
+	return url_snapshot.strings + offset;
 }
 
 
 /**
- * Count number of URLs associated with a host
+ * Write the URLs associated with a host to a snapshot
  *
+ * \param w Snapshot writer
  * \param root Root of path data tree
- * \param expiry Expiry time for URLs
- * \param count Pointer to count
+ * \return NSERROR_OK on success, or appropriate error otherwise
  */
-static void
-urldb_count_urls(const struct path_data *root,
-		 time_t expiry,
-		 unsigned int *count)
+static nserror
+urldb_snapshot_write_paths(struct urldb_snapshot_writer *w,
+			   const struct path_data *root)
 {
 	const struct path_data *p = root;
+	nserror res = NSERROR_OK;
 
 	do {
 		if (p->children != NULL) {
 			/* Drill down into children */
 			p = p->children;
 		} else {
-			/* No more children, increment count if required */
-			if (p->persistent ||
-			    ((p->urld.last_visit > expiry) &&
-			     (p->urld.visits > 0))) {
-				(*count)++;
+			/* leaf node */
+			if ((p->url != NULL) &&
+			    (p->persistent ||
+			     ((p->urld.last_visit > w->expiry) &&
+			      (p->urld.visits > 0)))) {
+				struct urldb_snapshot_url su;
+				char *path_query;
+				size_t len;
+
+				memset(&su, 0, sizeof(su));
+				su.last_visit = p->urld.last_visit;
+				su.hash = nsurl_hash(p->url);
+				su.port = p->port;
+				su.visits = p->urld.visits;
+				su.type = p->urld.type;
+
+				res = nsurl_get(p->url,
+						NSURL_PATH | NSURL_QUERY,
+						&path_query, &len);
+				if (res != NSERROR_OK) {
+					return res;
+				}
+
+				res = urldb_snapshot_add_url_entry(w, &su,
+						lwc_string_data(p->scheme),
+						path_query, p->urld.title);
+				free(path_query);
+				if (res != NSERROR_OK) {
+					return res;
+				}
 			}
 
 			/* Now, find next node to process. */
@@ -507,73 +633,269 @@ urldb_count_urls(const struct path_data *root,
 			}
 		}
 	} while (p != root);
+
+	return res;
 }
 
 
 /**
- * Save a search (sub)tree
+ * Write the URLs of a host which is still in the loaded snapshot
  *
- * \param parent root node of search tree to save.
- * \param fp File to write to
+ * \param w Snapshot writer
+ * \param sh Host index entry in loaded snapshot
+ * \return NSERROR_OK on success, or appropriate error otherwise
  */
-static void urldb_save_search_tree(struct search_node *parent, FILE *fp)
+static nserror
+urldb_snapshot_write_snapshot_urls(struct urldb_snapshot_writer *w,
+				   const struct urldb_snapshot_host *sh)
 {
-	char host[256];
-	const struct host_part *h;
-	unsigned int path_count = 0;
-	char *path, *p, *end;
-	int path_alloc = 64, path_used = 1;
-	time_t expiry, hsts_expiry = 0;
-	int hsts_include_subdomains = 0;
+	uint32_t i;
+	nserror res;
 
-	expiry = time(NULL) - ((60 * 60 * 24) * nsoption_int(expire_url));
+	if ((uint64_t)sh->first_url + sh->url_count > url_snapshot.url_count) {
+		/* corrupt entry */
+		return NSERROR_OK;
+	}
 
-	if (parent == &empty)
-		return;
+	for (i = 0; i < sh->url_count; i++) {
+		const struct urldb_snapshot_url *u;
+		struct urldb_snapshot_url su;
 
-	urldb_save_search_tree(parent->left, fp);
+		u = &url_snapshot.urls[sh->first_url + i];
+		if ((u->last_visit <= w->expiry) || (u->visits == 0)) {
+			continue;
+		}
 
-	path = malloc(path_alloc);
-	if (!path)
-		return;
+		su = *u;
+		res = urldb_snapshot_add_url_entry(w, &su,
+				urldb_snapshot_string(u->scheme),
+				urldb_snapshot_string(u->path_query),
+				urldb_snapshot_string(u->title));
+		if (res != NSERROR_OK) {
+			return res;
+		}
+	}
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Write a host to a snapshot
+ *
+ * \param w Snapshot writer
+ * \param entry Host to write
+ * \return NSERROR_OK on success, or appropriate error otherwise
+ */
+static nserror
+urldb_snapshot_write_host(struct urldb_snapshot_writer *w,
+			  const struct urldb_snapshot_entry *entry)
+{
+	struct urldb_snapshot_host sh;
+	time_t hsts_expiry = 0;
+	bool hsts_include_sub_domains = false;
+	nserror res;
+
+	memset(&sh, 0, sizeof(sh));
+	sh.first_url = w->urls.used / sizeof(struct urldb_snapshot_url);
+
+	if (entry->host != NULL) {
+		const struct host_part *h = entry->host;
+
+		if (h->hsts.expires > w->expiry) {
+			hsts_expiry = h->hsts.expires;
+			hsts_include_sub_domains = h->hsts.include_sub_domains;
+		}
+
+		res = urldb_snapshot_write_paths(w, &h->paths);
+	} else {
+		const struct urldb_snapshot_host *h;
+
+		h = &url_snapshot.hosts[entry->index];
+		if (h->hsts_expires > w->expiry) {
+			hsts_expiry = h->hsts_expires;
+			hsts_include_sub_domains =
+				h->hsts_include_sub_domains != 0;
+		}
+
+		res = urldb_snapshot_write_snapshot_urls(w, h);
+	}
+	if (res != NSERROR_OK) {
+		return res;
+	}
+
+	sh.url_count = (w->urls.used / sizeof(struct urldb_snapshot_url)) -
+		sh.first_url;
+	if (sh.url_count == 0 && hsts_expiry == 0) {
+		/* nothing worth keeping */
+		return NSERROR_OK;
+	}
+
+	sh.hsts_expires = hsts_expiry;
+	sh.hsts_include_sub_domains = hsts_include_sub_domains;
 
-	path[0] = '\0';
+	res = urldb_snapshot_add_string(w, entry->name, &sh.name);
+	if (res != NSERROR_OK) {
+		return res;
+	}
+
+	return urldb_snapshot_buffer_add(&w->hosts, &sh, sizeof(sh));
+}
+
+
+/**
+ * Collect the hosts of a search (sub)tree for writing to a snapshot
+ *
+ * \param parent root node of search tree to collect
+ * \param entries Buffer of hosts to append to
+ * \return NSERROR_OK on success, NSERROR_NOMEM on memory exhaustion
+ */
+static nserror
+urldb_snapshot_collect_tree(struct search_node *parent,
+			    struct urldb_snapshot_buffer *entries)
+{
+	char host[256];
+	const struct host_part *h;
+	struct urldb_snapshot_entry entry;
+	char *p, *end;
+	nserror res;
+
+	if (parent == &empty)
+		return NSERROR_OK;
+
+	res = urldb_snapshot_collect_tree(parent->left, entries);
+	if (res != NSERROR_OK)
+		return res;
 
+	host[0] = '\0';
 	for (h = parent->data, p = host, end = host + sizeof host;
 	     h && h != &db_root && p < end; h = h->parent) {
 		int written = snprintf(p, end - p, "%s%s", h->part,
 				       (h->parent && h->parent->parent) ? "." : "");
 		if (written < 0) {
-			free(path);
-			return;
+			return NSERROR_SAVE_FAILED;
 		}
 		p += written;
 	}
 
-	h = parent->data;
-	if (h && h->hsts.expires > expiry) {
-		hsts_expiry = h->hsts.expires;
-		hsts_include_subdomains = h->hsts.include_sub_domains;
+	entry.name = strdup(host);
+	entry.host = parent->data;
+	entry.index = 0;
+	if (entry.name == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	res = urldb_snapshot_buffer_add(entries, &entry, sizeof(entry));
+	if (res != NSERROR_OK) {
+		free(entry.name);
+		return res;
 	}
 
-	urldb_count_urls(&parent->data->paths, expiry, &path_count);
+	return urldb_snapshot_collect_tree(parent->right, entries);
+}
+
+
+/**
+ * Compare snapshot hosts by name, for qsort
+ *
+ * \param a first host
+ * \param b second host
+ * \return less than, equal to or greater than zero as a sorts before,
+ *         with or after b
+ */
+static int urldb_snapshot_entry_cmp(const void *a, const void *b)
+{
+	const struct urldb_snapshot_entry *ea = a;
+	const struct urldb_snapshot_entry *eb = b;
+
+	return strcasecmp(ea->name, eb->name);
+}
 
-	if (path_count > 0) {
-		fprintf(fp, "%s %i ", host, hsts_include_subdomains);
-		urldb_write_timet(fp, hsts_expiry);
-		fprintf(fp, "%i\n", path_count);
 
-		urldb_write_paths(&parent->data->paths, host, fp,
-				  &path, &path_alloc, &path_used, expiry);
-	} else if (hsts_expiry) {
-		fprintf(fp, "%s %i ", host, hsts_include_subdomains);
-		urldb_write_timet(fp, hsts_expiry);
-		fprintf(fp, "0\n");
+/**
+ * Compute the hash used to check snapshot compatibility
+ *
+ * \return hash of URL_SNAPSHOT_HASH_URL
+ */
+static uint32_t urldb_snapshot_hash_check(void)
+{
+	nsurl *url;
+	uint32_t hash = 0;
+
+	if (nsurl_create(URL_SNAPSHOT_HASH_URL, &url) == NSERROR_OK) {
+		hash = nsurl_hash(url);
+		nsurl_unref(url);
 	}
 
-	free(path);
+	return hash;
+}
 
-	urldb_save_search_tree(parent->right, fp);
+
+/**
+ * Write data to a file
+ *
+ * \param fp File to write to
+ * \param data Data to write
+ * \param len Length of data
+ * \return true on success, false on error
+ */
+static bool urldb_snapshot_fwrite(FILE *fp, const void *data, size_t len)
+{
+	return (len == 0) || (fwrite(data, 1, len, fp) == len);
+}
+
+
+/**
+ * Write a built snapshot to a file
+ *
+ * \param w Snapshot writer
+ * \param filename File to write to
+ * \return NSERROR_OK on success, or NSERROR_SAVE_FAILED on error
+ */
+static nserror
+urldb_snapshot_write(struct urldb_snapshot_writer *w, const char *filename)
+{
+	struct urldb_snapshot_header header;
+	const uint8_t *bloom;
+	size_t bloom_size;
+	FILE *fp;
+	bool ok;
+
+	bloom = bloom_data(w->bloom, &bloom_size);
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, URL_SNAPSHOT_MAGIC, sizeof(URL_SNAPSHOT_MAGIC));
+	header.version = URL_SNAPSHOT_VERSION;
+	header.hash_check = urldb_snapshot_hash_check();
+	header.bloom_size = bloom_size;
+	header.bloom_items = bloom_items(w->bloom);
+	header.host_count = w->hosts.used / sizeof(struct urldb_snapshot_host);
+	header.url_count = w->urls.used / sizeof(struct urldb_snapshot_url);
+	header.strings_size = w->strings.used;
+
+	fp = fopen(filename, "wb");
+	if (!fp) {
+		NSLOG(netsurf, INFO, "Failed to open file '%s' for writing",
+		      filename);
+		return NSERROR_SAVE_FAILED;
+	}
+
+	ok = urldb_snapshot_fwrite(fp, &header, sizeof(header)) &&
+		urldb_snapshot_fwrite(fp, bloom, bloom_size) &&
+		urldb_snapshot_fwrite(fp, w->hosts.data, w->hosts.used) &&
+		urldb_snapshot_fwrite(fp, w->urls.data, w->urls.used) &&
+		urldb_snapshot_fwrite(fp, w->strings.data, w->strings.used);
+
+	if (fclose(fp) != 0) {
+		ok = false;
+	}
+
+	if (!ok) {
+		NSLOG(netsurf, INFO, "Failed writing '%s'", filename);
+		return NSERROR_SAVE_FAILED;
+	}
+
+	return NSERROR_OK;
 }
 
 
@@ -1404,6 +1726,8 @@ static struct path_data *urldb_find_url(nsurl *url)
 		return NULL;
 	}
 
+	urldb_snapshot_add_host(host_str);
+
 	tree = urldb_get_search_tree(host_str);
 	h = urldb_search_find(tree, host_str);
 	if (!h) {
@@ -2250,6 +2574,471 @@ static struct host_part *urldb_add_host(const char *host)
 }
 
 
+/**
+ * Release the loaded URL database snapshot
+ */
+static void urldb_snapshot_release(void)
+{
+	if (url_snapshot.data == NULL) {
+		return;
+	}
+
+#ifdef HAVE_MMAP
+	if (url_snapshot.mapped) {
+		munmap((void *)url_snapshot.data, url_snapshot.size);
+	} else
+#endif
+	{
+		free((void *)url_snapshot.data);
+	}
+
+	free(url_snapshot.added);
+	memset(&url_snapshot, 0, sizeof(url_snapshot));
+}
+
+
+/**
+ * Add a URL entry of the loaded snapshot to the database
+ *
+ * \param h Host the URL belongs to
+ * \param host Name of host
+ * \param su URL entry to add
+ * \return NSERROR_OK on success, or appropriate error otherwise
+ */
+static nserror
+urldb_snapshot_add_url(struct host_part *h,
+		       const char *host,
+		       const struct urldb_snapshot_url *su)
+{
+	const char *scheme = urldb_snapshot_string(su->scheme);
+	const char *path = urldb_snapshot_string(su->path_query);
+	const char *title = urldb_snapshot_string(su->title);
+	struct path_data *p;
+	bool is_file = false;
+	nsurl *nsurl;
+	lwc_string *scheme_lwc, *fragment_lwc;
+	char *url, *path_query;
+	size_t len;
+	nserror res;
+
+	if (!strcasecmp(host, "localhost") && !strcasecmp(scheme, "file"))
+		is_file = true;
+
+	len = strlen(scheme) + strlen(host) + strlen(path) + 16;
+	url = malloc(len);
+	if (url == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	if (su->port) {
+		snprintf(url, len, "%s://%s:%u%s", scheme,
+			 (is_file ? "" : host), (unsigned int)su->port, path);
+	} else {
+		/* file URLs have no host */
+		snprintf(url, len, "%s://%s%s", scheme,
+			 (is_file ? "" : host), path);
+	}
+
+	res = nsurl_create(url, &nsurl);
+	if (res != NSERROR_OK) {
+		NSLOG(netsurf, INFO, "Failed inserting '%s'", url);
+		free(url);
+		return res;
+	}
+	free(url);
+
+	if (url_bloom != NULL) {
+		bloom_insert_hash(url_bloom, nsurl_hash(nsurl));
+	}
+
+	/* Copy and merge path/query strings */
+	res = nsurl_get(nsurl, NSURL_PATH | NSURL_QUERY, &path_query, &len);
+	if (res != NSERROR_OK) {
+		nsurl_unref(nsurl);
+		return res;
+	}
+
+	scheme_lwc = nsurl_get_component(nsurl, NSURL_SCHEME);
+	fragment_lwc = nsurl_get_component(nsurl, NSURL_FRAGMENT);
+	p = urldb_add_path(scheme_lwc, su->port, h, path_query,
+			   fragment_lwc, nsurl);
+	nsurl_unref(nsurl);
+	lwc_string_unref(scheme_lwc);
+	if (fragment_lwc != NULL)
+		lwc_string_unref(fragment_lwc);
+
+	if (!p) {
+		return NSERROR_NOMEM;
+	}
+
+	p->urld.visits = su->visits;
+	p->urld.last_visit = (time_t)su->last_visit;
+	p->urld.type = (content_type)su->type;
+
+	if (*title != '\0') {
+		free(p->urld.title);
+		p->urld.title = strdup(title);
+	}
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Add a host of the loaded snapshot to the database
+ *
+ * \param index Index of host in snapshot host index
+ * \return NSERROR_OK on success, or appropriate error otherwise
+ */
+static nserror urldb_snapshot_add(uint32_t index)
+{
+	const struct urldb_snapshot_host *sh = &url_snapshot.hosts[index];
+	const char *host;
+	struct host_part *h;
+	uint32_t i;
+	nserror res;
+
+	if (url_snapshot.added[index]) {
+		return NSERROR_OK;
+	}
+	url_snapshot.added[index] = true;
+	url_snapshot.remaining--;
+
+	host = urldb_snapshot_string(sh->name);
+	if ((*host == '\0') ||
+	    ((uint64_t)sh->first_url + sh->url_count >
+	     url_snapshot.url_count)) {
+		NSLOG(netsurf, INFO, "Corrupt host %u in URL snapshot", index);
+		return NSERROR_INVALID;
+	}
+
+	h = urldb_add_host(host);
+	if (!h) {
+		NSLOG(netsurf, INFO, "Failed adding host: '%s'", host);
+		return NSERROR_NOMEM;
+	}
+	h->hsts.expires = (time_t)sh->hsts_expires;
+	h->hsts.include_sub_domains = sh->hsts_include_sub_domains != 0;
+
+	for (i = 0; i < sh->url_count; i++) {
+		res = urldb_snapshot_add_url(h, host,
+				&url_snapshot.urls[sh->first_url + i]);
+		if (res == NSERROR_NOMEM) {
+			return res;
+		}
+	}
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Find a host in the loaded snapshot
+ *
+ * \param host Host name to find
+ * \param len Length of host name to compare, host is a prefix when
+ *            less than the whole name
+ * \return Index of the first host index entry not less than host
+ */
+static uint32_t urldb_snapshot_find(const char *host, size_t len)
+{
+	uint32_t lo = 0, hi = url_snapshot.host_count;
+
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		const char *name;
+
+		name = urldb_snapshot_string(url_snapshot.hosts[mid].name);
+		if (strncasecmp(name, host, len) < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+
+/**
+ * Add a host and the domains it is part of from the loaded snapshot
+ *
+ * The domains are added too as their HSTS policy may cover the host.
+ *
+ * \param host Host name
+ */
+static void urldb_snapshot_add_host(const char *host)
+{
+	const char *part = host;
+	uint32_t index;
+
+	if (url_snapshot.data == NULL) {
+		return;
+	}
+
+	while (part != NULL) {
+		index = urldb_snapshot_find(part, SIZE_MAX);
+		if ((index < url_snapshot.host_count) &&
+		    (strcasecmp(urldb_snapshot_string(
+				url_snapshot.hosts[index].name), part) == 0)) {
+			urldb_snapshot_add(index);
+		}
+
+		if (urldb__host_is_ip_address(host)) {
+			break;
+		}
+
+		part = strchr(part, '.');
+		if (part != NULL) {
+			part++;
+		}
+	}
+
+	if (url_snapshot.remaining == 0) {
+		urldb_snapshot_release();
+	}
+}
+
+
+/**
+ * Add every host starting with a prefix from the loaded snapshot
+ *
+ * \param prefix Start of host name
+ */
+static void urldb_snapshot_add_prefix(const char *prefix)
+{
+	size_t len = strlen(prefix);
+	uint32_t index;
+
+	if (url_snapshot.data == NULL) {
+		return;
+	}
+
+	for (index = urldb_snapshot_find(prefix, len);
+	     index < url_snapshot.host_count; index++) {
+		const char *name;
+
+		name = urldb_snapshot_string(url_snapshot.hosts[index].name);
+		if (strncasecmp(name, prefix, len) != 0) {
+			break;
+		}
+
+		urldb_snapshot_add(index);
+	}
+
+	if (url_snapshot.remaining == 0) {
+		urldb_snapshot_release();
+	}
+}
+
+
+/**
+ * Add every remaining host of the loaded snapshot to the database
+ */
+static void urldb_snapshot_add_all(void)
+{
+	uint32_t index;
+
+	if (url_snapshot.data == NULL) {
+		return;
+	}
+
+	for (index = 0; index < url_snapshot.host_count; index++) {
+		urldb_snapshot_add(index);
+	}
+
+	urldb_snapshot_release();
+}
+
+
+/**
+ * Read a URL database snapshot file into memory
+ *
+ * The file is mapped where possible, otherwise it is read into a
+ * heap allocation.
+ *
+ * \param filename Snapshot file
+ * \param data_out Updated with the file contents
+ * \param size_out Updated with the size of the file
+ * \param mapped_out Updated with whether the contents are mapped
+ * \return NSERROR_OK on success, or appropriate error otherwise
+ */
+static nserror
+urldb_snapshot_read(const char *filename,
+		    const uint8_t **data_out,
+		    size_t *size_out,
+		    bool *mapped_out)
+{
+#ifdef HAVE_MMAP
+	struct stat sb;
+	void *data;
+	int fd;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return NSERROR_NOT_FOUND;
+	}
+
+	if ((fstat(fd, &sb) != 0) ||
+	    (sb.st_size < (off_t)sizeof(struct urldb_snapshot_header))) {
+		close(fd);
+		return NSERROR_INVALID;
+	}
+
+	data = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		NSLOG(netsurf, INFO, "Unable to map '%s': %s",
+		      filename, strerror(errno));
+		return NSERROR_NOMEM;
+	}
+
+	*data_out = data;
+	*size_out = sb.st_size;
+	*mapped_out = true;
+#else
+	uint8_t *data;
+	long size;
+	FILE *fp;
+
+	fp = fopen(filename, "rb");
+	if (!fp) {
+		return NSERROR_NOT_FOUND;
+	}
+
+	if ((fseek(fp, 0, SEEK_END) != 0) ||
+	    ((size = ftell(fp)) < (long)sizeof(struct urldb_snapshot_header)) ||
+	    (fseek(fp, 0, SEEK_SET) != 0)) {
+		fclose(fp);
+		return NSERROR_INVALID;
+	}
+
+	data = malloc(size);
+	if (data == NULL) {
+		fclose(fp);
+		return NSERROR_NOMEM;
+	}
+
+	if (fread(data, 1, size, fp) != (size_t)size) {
+		free(data);
+		fclose(fp);
+		return NSERROR_INVALID;
+	}
+	fclose(fp);
+
+	*data_out = data;
+	*size_out = size;
+	*mapped_out = false;
+#endif
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Load a URL database snapshot
+ *
+ * Only the snapshot bloom filter is merged with the database
+ * here, hosts are added as they are looked up.
+ *
+ * \param filename Snapshot file
+ * \return NSERROR_OK on success, or appropriate error otherwise
+ */
+static nserror urldb_snapshot_load(const char *filename)
+{
+	const struct urldb_snapshot_header *header;
+	const uint8_t *data;
+	size_t size;
+	bool mapped;
+	uint64_t expected;
+	uint32_t i;
+	nserror res;
+
+	res = urldb_snapshot_read(filename, &data, &size, &mapped);
+	if (res != NSERROR_OK) {
+		return res;
+	}
+
+	/* add the hosts of any snapshot already loaded, releasing it */
+	urldb_snapshot_add_all();
+
+	url_snapshot.data = data;
+	url_snapshot.size = size;
+	url_snapshot.mapped = mapped;
+
+	header = (const struct urldb_snapshot_header *)data;
+	if (memcmp(header->magic, URL_SNAPSHOT_MAGIC,
+		   sizeof(header->magic)) != 0 ||
+	    header->version != URL_SNAPSHOT_VERSION) {
+		NSLOG(netsurf, INFO, "Unknown URL snapshot version.");
+		urldb_snapshot_release();
+		return NSERROR_INVALID;
+	}
+
+	expected = sizeof(*header) + (uint64_t)header->bloom_size +
+		(uint64_t)header->host_count *
+		sizeof(struct urldb_snapshot_host) +
+		(uint64_t)header->url_count *
+		sizeof(struct urldb_snapshot_url) +
+		header->strings_size;
+	if ((expected != size) ||
+	    ((header->bloom_size % sizeof(int64_t)) != 0) ||
+	    (header->strings_size == 0)) {
+		NSLOG(netsurf, INFO, "Corrupt URL snapshot.");
+		urldb_snapshot_release();
+		return NSERROR_INVALID;
+	}
+
+	url_snapshot.hosts = (const struct urldb_snapshot_host *)
+		(data + sizeof(*header) + header->bloom_size);
+	url_snapshot.host_count = header->host_count;
+	url_snapshot.urls = (const struct urldb_snapshot_url *)
+		(url_snapshot.hosts + header->host_count);
+	url_snapshot.url_count = header->url_count;
+	url_snapshot.strings = (const char *)
+		(url_snapshot.urls + header->url_count);
+	url_snapshot.strings_size = header->strings_size;
+
+	if (url_snapshot.strings[0] != '\0' ||
+	    url_snapshot.strings[url_snapshot.strings_size - 1] != '\0') {
+		NSLOG(netsurf, INFO, "Corrupt URL snapshot.");
+		urldb_snapshot_release();
+		return NSERROR_INVALID;
+	}
+
+	url_snapshot.remaining = url_snapshot.host_count;
+	url_snapshot.added = calloc(url_snapshot.host_count + 1,
+				    sizeof(bool));
+	if (url_snapshot.added == NULL) {
+		urldb_snapshot_release();
+		return NSERROR_NOMEM;
+	}
+
+	if (header->hash_check != urldb_snapshot_hash_check()) {
+		/* stored hashes are unusable, so add everything now */
+		NSLOG(netsurf, INFO, "URL snapshot hashes differ.");
+		urldb_snapshot_add_all();
+		return NSERROR_OK;
+	}
+
+	if ((url_bloom == NULL) ||
+	    !bloom_merge(url_bloom, data + sizeof(*header),
+			 header->bloom_size, header->bloom_items)) {
+		/* filter size changed, rebuild from the stored hashes */
+		for (i = 0; url_bloom != NULL && i < url_snapshot.url_count;
+		     i++) {
+			bloom_insert_hash(url_bloom, url_snapshot.urls[i].hash);
+		}
+	}
+
+	if (url_snapshot.remaining == 0) {
+		urldb_snapshot_release();
+	}
+
+	return NSERROR_OK;
+}
+
+
 /**
  * Insert a cookie into the database
  *
@@ -2271,6 +3060,7 @@ urldb_insert_cookie(struct cookie_internal_data *c,
 	assert(c);
 
 	if (c->domain[0] == '.') {
+		urldb_snapshot_add_host(c->domain + 1);
 		h = urldb_search_find(
 			urldb_get_search_tree(&(c->domain[1])),
 			c->domain + 1);
@@ -2288,6 +3078,7 @@ urldb_insert_cookie(struct cookie_internal_data *c,
 		assert(url != NULL);
 		assert(scheme != NULL);
 
+		urldb_snapshot_add_host(c->domain);
 		h = urldb_search_find(
 			urldb_get_search_tree(c->domain),
 			c->domain);
@@ -2874,6 +3665,9 @@ void urldb_destroy(void)
 		bloom_destroy(url_bloom);
 		url_bloom = NULL;
 	}
+
+	/* And any snapshot not yet added */
+	urldb_snapshot_release();
 }
 
 
@@ -2897,6 +3691,9 @@ nserror urldb_load(const char *filename)
 	if (url_bloom == NULL)
 		url_bloom = bloom_create(BLOOM_SIZE);
 
+	/* hosts of a previous snapshot must be in place before merging */
+	urldb_snapshot_add_all();
+
 	fp = fopen(filename, "r");
 	if (!fp) {
 		NSLOG(netsurf, INFO, "Failed to open file '%s' for reading",
@@ -2909,6 +3706,14 @@ nserror urldb_load(const char *filename)
 		return NSERROR_NEED_DATA;
 	}
 
+	if (strcmp(s, URL_SNAPSHOT_MAGIC) == 0) {
+		fclose(fp);
+		return urldb_snapshot_load(filename);
+	}
+
+	/* Text format database, which will be replaced by a snapshot
+	 * when next saved.
+	 */
 	version = atoi(s);
 	if (version < MIN_URL_FILE_VERSION) {
 		NSLOG(netsurf, INFO, "Unsupported URL file version.");
@@ -3098,28 +3903,117 @@ nserror urldb_load(const char *filename)
 /* exported interface documented in netsurf/url_db.h */
 nserror urldb_save(const char *filename)
 {
-	FILE *fp;
+	struct urldb_snapshot_writer w;
+	struct urldb_snapshot_buffer entries;
+	struct urldb_snapshot_entry *entry;
+	size_t count = 0, n;
+	char *temp_path;
+	nserror res = NSERROR_OK;
+	uint32_t index;
 	int i;
 
 	assert(filename);
 
-	fp = fopen(filename, "w");
-	if (!fp) {
-		NSLOG(netsurf, INFO, "Failed to open file '%s' for writing",
-		      filename);
-		return NSERROR_SAVE_FAILED;
+	memset(&w, 0, sizeof(w));
+	memset(&entries, 0, sizeof(entries));
+
+	w.expiry = time(NULL) - ((60 * 60 * 24) * nsoption_int(expire_url));
+	w.bloom = bloom_create(BLOOM_SIZE);
+	if (w.bloom == NULL) {
+		return NSERROR_NOMEM;
 	}
 
-	/* file format version number */
-	fprintf(fp, "%d\n", URL_FILE_VERSION);
+	/* string offset zero is the empty string */
+	res = urldb_snapshot_buffer_add(&w.strings, "", 1);
 
-	for (i = 0; i != NUM_SEARCH_TREES; i++) {
-		urldb_save_search_tree(search_trees[i], fp);
+	/* hosts in the database */
+	for (i = 0; res == NSERROR_OK && i != NUM_SEARCH_TREES; i++) {
+		res = urldb_snapshot_collect_tree(search_trees[i], &entries);
 	}
 
-	fclose(fp);
+	/* hosts which are still only in the loaded snapshot */
+	for (index = 0; res == NSERROR_OK &&
+		     index < url_snapshot.host_count; index++) {
+		struct urldb_snapshot_entry e;
 
-	return NSERROR_OK;
+		if (url_snapshot.added[index]) {
+			continue;
+		}
+
+		e.name = strdup(urldb_snapshot_string(
+				url_snapshot.hosts[index].name));
+		e.host = NULL;
+		e.index = index;
+		if (e.name == NULL) {
+			res = NSERROR_NOMEM;
+			break;
+		}
+
+		res = urldb_snapshot_buffer_add(&entries, &e, sizeof(e));
+		if (res != NSERROR_OK) {
+			free(e.name);
+		}
+	}
+
+	entry = (struct urldb_snapshot_entry *)entries.data;
+	count = entries.used / sizeof(*entry);
+
+	if (res == NSERROR_OK) {
+		/* the host index is binary searched when loaded */
+		if (count > 0) {
+			qsort(entry, count, sizeof(*entry),
+			      urldb_snapshot_entry_cmp);
+		}
+
+		for (n = 0; res == NSERROR_OK && n < count; n++) {
+			res = urldb_snapshot_write_host(&w, &entry[n]);
+		}
+	}
+
+	if (res == NSERROR_OK) {
+		/* Write to a temporary file and rename it into place so
+		 * the loaded snapshot, which may be mapped, stays intact.
+		 */
+		n = strlen(filename) + 4;
+		temp_path = malloc(n);
+		if (temp_path == NULL) {
+			res = NSERROR_NOMEM;
+		} else {
+			snprintf(temp_path, n, "%s-bk", filename);
+
+			res = urldb_snapshot_write(&w, temp_path);
+			if (res == NSERROR_OK &&
+			    rename(temp_path, filename) != 0) {
+				/* handle non-POSIX rename() implementations,
+				 * which fail if the file exists, by removing
+				 * the old file only when we have to */
+				(void)remove(filename);
+
+				if (rename(temp_path, filename) != 0) {
+					NSLOG(netsurf, INFO,
+					      "Error renaming URL file: %s.",
+					      strerror(errno));
+					res = NSERROR_SAVE_FAILED;
+				}
+			}
+			if (res != NSERROR_OK) {
+				(void)remove(temp_path);
+			}
+
+			free(temp_path);
+		}
+	}
+
+	for (n = 0; n < count; n++) {
+		free(entry[n].name);
+	}
+	free(entries.data);
+	free(w.hosts.data);
+	free(w.urls.data);
+	free(w.strings.data);
+	bloom_destroy(w.bloom);
+
+	return res;
 }
 
 
@@ -3205,6 +4099,7 @@ bool urldb_add_url(nsurl *url)
 	}
 
 	/* Get host entry */
+	urldb_snapshot_add_host(host_str);
 	h = urldb_add_host(host_str);
 
 	/* Get path entry */
@@ -3662,12 +4557,14 @@ urldb_iterate_partial(const char *prefix,
 		snprintf(host, sizeof host, "%.*s",
 			 (int) (slash - prefix), prefix);
 
+		urldb_snapshot_add_host(host);
 		h = urldb_search_find(tree, host);
 		if (!h) {
 			int len = slash - prefix;
 
 			if (len <= 3 || strncasecmp(host, "www.", 4) != 0) {
 				snprintf(buf, sizeof buf, "www.%s", host);
+				urldb_snapshot_add_host(buf);
 				h = urldb_search_find(
 					search_trees[ST_DN + 'w' - 'a'],
 					buf);
@@ -3687,12 +4584,14 @@ urldb_iterate_partial(const char *prefix,
 		int len = strlen(prefix);
 
 		/* looking for hosts */
+		urldb_snapshot_add_prefix(prefix);
 		if (!urldb_iterate_partial_host(tree, prefix, callback))
 			return;
 
 		if (len <= 3 || strncasecmp(prefix, "www.", 4) != 0) {
 			/* now look for www.prefix */
 			snprintf(buf, sizeof buf, "www.%s", prefix);
+			urldb_snapshot_add_prefix(buf);
 			if(!urldb_iterate_partial_host(
 				   search_trees[ST_DN + 'w' - 'a'],
 				   buf, callback))
@@ -3710,6 +4609,8 @@ urldb_iterate_entries(bool (*callback)(nsurl *url, const struct url_data *data))
 
 	assert(callback);
 
+	urldb_snapshot_add_all();
+
 	for (i = 0; i < NUM_SEARCH_TREES; i++) {
 		if (!urldb_iterate_entries_host(search_trees[i],
 						callback,
@@ -4487,6 +5388,8 @@ void urldb_dump(void)
 {
 	int i;
 
+	urldb_snapshot_add_all();
+
 	urldb_dump_hosts(&db_root);
 
 	for (i = 0; i != NUM_SEARCH_TREES; i++) {
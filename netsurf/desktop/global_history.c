@@ -36,6 +36,9 @@
 #define N_DAYS 28
 #define N_SEC_PER_DAY (60 * 60 * 24)
 
+/** Initial number of buckets in the URL index (must be a power of 2) */
+#define GH_INDEX_INITIAL_SIZE 256
+
 enum global_history_folders {
 	GH_TODAY = 0,
 	GH_YESTERDAY,
@@ -71,6 +74,14 @@ struct global_history_ctx {
 	time_t today;
 	int weekday;
 	bool built;
+
+	/**
+	 * URL index of the entries, chained through their index_next and
+	 * index_prev members.
+	 */
+	struct global_history_entry **index;
+	size_t index_size; /**< Number of buckets in the URL index */
+	size_t index_count; /**< Number of entries in the URL index */
 };
 struct global_history_ctx gh_ctx;
 
@@ -79,16 +90,111 @@ struct global_history_entry {
 
 	int slot;
 	nsurl *url;
+	uint32_t url_hash; /**< Hash of url used by the URL index */
 	time_t t;
 	treeview_node *entry;
 	struct global_history_entry *next;
 	struct global_history_entry *prev;
+	struct global_history_entry *index_next; /**< Next in URL index chain */
+	struct global_history_entry *index_prev; /**< Previous in URL index chain */
 
 	struct treeview_field_data data[N_FIELDS - 1];
 };
 struct global_history_entry *gh_list[N_DAYS];
 
 
+/**
+ * Double the number of buckets in the URL index
+ *
+ * If the larger table cannot be allocated the index continues to
+ * operate with longer chains.
+ */
+static void global_history_index_grow(void)
+{
+	struct global_history_entry **index;
+	struct global_history_entry *e, *next;
+	size_t size = gh_ctx.index_size * 2;
+	size_t bucket;
+	size_t i;
+
+	index = calloc(size, sizeof(struct global_history_entry *));
+	if (index == NULL) {
+		return;
+	}
+
+	for (i = 0; i < gh_ctx.index_size; i++) {
+		for (e = gh_ctx.index[i]; e != NULL; e = next) {
+			next = e->index_next;
+
+			bucket = e->url_hash & (size - 1);
+			e->index_prev = NULL;
+			e->index_next = index[bucket];
+			if (index[bucket] != NULL) {
+				index[bucket]->index_prev = e;
+			}
+			index[bucket] = e;
+		}
+	}
+
+	free(gh_ctx.index);
+	gh_ctx.index = index;
+	gh_ctx.index_size = size;
+}
+
+
+/**
+ * Add an entry to the URL index
+ *
+ * \param e The entry to add
+ */
+static void global_history_index_add(struct global_history_entry *e)
+{
+	size_t bucket;
+
+	if (gh_ctx.index_count >= gh_ctx.index_size) {
+		global_history_index_grow();
+	}
+
+	bucket = e->url_hash & (gh_ctx.index_size - 1);
+
+	e->index_prev = NULL;
+	e->index_next = gh_ctx.index[bucket];
+	if (e->index_next != NULL) {
+		e->index_next->index_prev = e;
+	}
+	gh_ctx.index[bucket] = e;
+
+	gh_ctx.index_count++;
+}
+
+
+/**
+ * Remove an entry from the URL index
+ *
+ * \param e The entry to remove
+ */
+static void global_history_index_remove(struct global_history_entry *e)
+{
+	size_t bucket;
+
+	if (e->index_prev == NULL) {
+		bucket = e->url_hash & (gh_ctx.index_size - 1);
+		gh_ctx.index[bucket] = e->index_next;
+	} else {
+		e->index_prev->index_next = e->index_next;
+	}
+
+	if (e->index_next != NULL) {
+		e->index_next->index_prev = e->index_prev;
+	}
+
+	e->index_prev = NULL;
+	e->index_next = NULL;
+
+	gh_ctx.index_count--;
+}
+
+
 /**
  * Find an entry in the global history
  *
@@ -97,21 +203,17 @@ struct global_history_entry *gh_list[N_DAYS];
  */
 static struct global_history_entry *global_history_find(nsurl *url)
 {
-	int i;
 	struct global_history_entry *e;
-
-	for (i = 0; i < N_DAYS; i++) {
-		e = gh_list[i];
-
-		while (e != NULL) {
-			if (nsurl_compare(e->url, url,
-					NSURL_COMPLETE) == true) {
-				/* Got a match */
-				return e;
-			}
-			e = e->next;
+	uint32_t hash = nsurl_hash(url);
+
+	for (e = gh_ctx.index[hash & (gh_ctx.index_size - 1)];
+	     e != NULL;
+	     e = e->index_next) {
+		if ((e->url_hash == hash) &&
+		    nsurl_compare(e->url, url, NSURL_COMPLETE) == true) {
+			/* Got a match */
+			return e;
 		}
-
 	}
 
 	/* No match found */
@@ -367,6 +469,7 @@ static nserror global_history_add_entry_internal(nsurl *url, int slot,
 	e->user_delete = false;
 	e->slot = slot;
 	e->url = nsurl_ref(url);
+	e->url_hash = nsurl_hash(url);
 	e->t = data->last_visit;
 	e->entry = NULL;
 	e->next = NULL;
@@ -376,7 +479,9 @@ static nserror global_history_add_entry_internal(nsurl *url, int slot,
 	if (err != NSERROR_OK) {
 		return err;
 	}
-	
+
+	global_history_index_add(e);
+
 	if (gh_list[slot] == NULL) {
 		/* list empty */
 		gh_list[slot] = e;
@@ -449,6 +554,8 @@ static void global_history_delete_entry_internal(
 		e->next->prev = e->prev;
 	}
 
+	global_history_index_remove(e);
+
 	if (e->user_delete) {
 		/* User requested delete, so delete from urldb too. */
 		urldb_reset_url_visit_data(e->url);
@@ -747,6 +854,16 @@ nserror global_history_init(struct core_window_callback_table *cw_t,
 		return err;
 	}
 
+	/* Create the URL index */
+	gh_ctx.index = calloc(GH_INDEX_INITIAL_SIZE,
+			sizeof(struct global_history_entry *));
+	if (gh_ctx.index == NULL) {
+		gh_ctx.tree = NULL;
+		return NSERROR_NOMEM;
+	}
+	gh_ctx.index_size = GH_INDEX_INITIAL_SIZE;
+	gh_ctx.index_count = 0;
+
 	/* Load the entries */
 	urldb_iterate_entries(global_history_add_entry);
 
@@ -808,6 +925,12 @@ nserror global_history_fini(void)
 	err = treeview_destroy(gh_ctx.tree);
 	gh_ctx.tree = NULL;
 
+	/* Destroying the treeview deleted the entries */
+	free(gh_ctx.index);
+	gh_ctx.index = NULL;
+	gh_ctx.index_size = 0;
+	gh_ctx.index_count = 0;
+
 	/* Free global history treeview entry fields */
 	for (i = 0; i < N_FIELDS; i++)
 		if (gh_ctx.fields[i].field != NULL)
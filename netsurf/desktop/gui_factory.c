@@ -530,6 +530,24 @@ static nserror verify_file_register(struct gui_file_table *gft)
 	return NSERROR_OK;
 }
 
+/**
+ * Default bitmap storage size derived from the buffer layout.
+ */
+static size_t gui_default_bitmap_get_storage_size(void *bitmap)
+{
+	return guit->bitmap->get_rowstride(bitmap) *
+		guit->bitmap->get_height(bitmap);
+}
+
+/**
+ * Default scaled bitmap cache statistics for front ends without one.
+ */
+static void
+gui_default_bitmap_get_scale_cache_stats(struct bitmap_scale_cache_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+}
+
 /**
  * verify bitmap table is valid
  *
@@ -584,6 +602,15 @@ static nserror verify_bitmap_register(struct gui_bitmap_table *gbt)
 		return NSERROR_BAD_PARAMETER;
 	}
 
+	/* optional operations */
+	if (gbt->get_storage_size == NULL) {
+		gbt->get_storage_size = gui_default_bitmap_get_storage_size;
+	}
+	if (gbt->get_scale_cache_stats == NULL) {
+		gbt->get_scale_cache_stats =
+			gui_default_bitmap_get_scale_cache_stats;
+	}
+
 	return NSERROR_OK;
 }
 
@@ -652,6 +679,10 @@ gui_default_present_cookies(const char *search_term)
 	return NSERROR_NOT_IMPLEMENTED;
 }
 
+static void gui_default_phase(const char *phase, bool start)
+{
+}
+
 /** verify misc table is valid */
 static nserror verify_misc_register(struct gui_misc_table *gmt)
 {
@@ -681,6 +712,9 @@ static nserror verify_misc_register(struct gui_misc_table *gmt)
 	if (gmt->present_cookies == NULL) {
 		gmt->present_cookies = gui_default_present_cookies;
 	}
+	if (gmt->phase == NULL) {
+		gmt->phase = gui_default_phase;
+	}
 	return NSERROR_OK;
 }
 
@@ -120,6 +120,9 @@ NSOPTION_BOOL(background_images, true)
 /** Whether to animate images */
 NSOPTION_BOOL(animate_images, true)
 
+/** Whether to rasterise SVG images into the image cache for redraw */
+NSOPTION_BOOL(rasterise_svg, false)
+
 /** Whether to execute javascript */
 NSOPTION_BOOL(enable_javascript, false)
 
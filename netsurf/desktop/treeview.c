@@ -136,6 +136,7 @@ struct treeview_node {
 
 	int height;	/**< Includes height of any descendants (pixels) */
 	int inset;	/**< Node's inset depending on tree depth (pixels) */
+	int row;	/**< Node's index in treeview's row cache, if in it */
 
 	treeview_node *parent; /**< parent node */
 	treeview_node *prev_sib; /**< previous sibling node */
@@ -226,6 +227,31 @@ struct treeview_search {
 };
 
 
+/**
+ * Treeview row cache entry
+ */
+struct treeview_row {
+	treeview_node *node;	/**< Node shown in row */
+	int y;			/**< Top of row, below search bar (pixels) */
+};
+
+
+/**
+ * Treeview row cache
+ *
+ * The rows of the nodes shown when not searching, which are those
+ * whose ancestors are all expanded, in display order. It is rebuilt
+ * when next needed after any change to the tree's layout.
+ */
+struct treeview_rows {
+	bool valid;			/**< Whether rows match the tree */
+	struct treeview_row *row;	/**< Array of rows */
+	int count;			/**< Number of rows */
+	int alloc;			/**< Number of rows allocated */
+	int height;			/**< Total height of rows (pixels) */
+};
+
+
 /**
  * The treeview context
  */
@@ -246,6 +272,8 @@ struct treeview {
 
 	struct treeview_search search; /**< Treeview search box */
 
+	struct treeview_rows rows; /**< Row cache */
+
 	const struct treeview_callback_table *callbacks; /**< For node events */
 
 	const struct core_window_callback_table *cw_t; /**< Window cb table */
@@ -525,6 +553,102 @@ static inline treeview_node * treeview_node_next(treeview_node *node, bool full)
 }
 
 
+/**
+ * Mark a treeview's row cache as needing to be rebuilt
+ *
+ * Must be called on any change to which nodes are shown, or to their
+ * heights.
+ *
+ * \param tree Treeview object to invalidate row cache of
+ */
+static inline void treeview__rows_invalidate(treeview *tree)
+{
+	tree->rows.valid = false;
+}
+
+
+/**
+ * Ensure a treeview's row cache matches the tree
+ *
+ * \param tree Treeview object to update row cache of
+ * \return true if the row cache is valid, false on memory exhaustion
+ */
+static bool treeview__rows_update(treeview *tree)
+{
+	struct treeview_rows *rows = &tree->rows;
+	treeview_node *n;
+	int count = 0;
+	int y = 0;
+
+	assert(tree->root != NULL);
+
+	if (rows->valid) {
+		return true;
+	}
+
+	n = treeview_node_next(tree->root, false);
+
+	while (n != NULL) {
+		if (count == rows->alloc) {
+			int alloc = (rows->alloc == 0) ? 64 : rows->alloc * 2;
+			struct treeview_row *row;
+
+			row = realloc(rows->row, alloc * sizeof(*row));
+			if (row == NULL) {
+				return false;
+			}
+			rows->row = row;
+			rows->alloc = alloc;
+		}
+
+		n->row = count;
+		rows->row[count].node = n;
+		rows->row[count].y = y;
+		count++;
+
+		y += (n->type == TREE_NODE_ENTRY) ?
+			n->height : tree_g.line_height;
+
+		n = treeview_node_next(n, false);
+	}
+
+	rows->count = count;
+	rows->height = y;
+	rows->valid = true;
+
+	return true;
+}
+
+
+/**
+ * Find the first row in a treeview's row cache whose bottom is at or
+ * below a y-position
+ *
+ * \param rows The valid row cache to search
+ * \param y y-position, below search bar
+ * \return index of the row, or rows->count if there is none
+ */
+static int treeview__rows_find(const struct treeview_rows *rows, int y)
+{
+	int lo = 0;
+	int hi = rows->count;
+
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		int bottom = (mid + 1 < rows->count) ?
+			rows->row[mid + 1].y : rows->height;
+
+		if (bottom >= y) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+
+	return lo;
+}
+
+
 /**
  * Find node at given y-position
  *
@@ -540,6 +664,20 @@ static treeview_node * treeview_y_node(treeview *tree, int target_y)
 	assert(tree != NULL);
 	assert(tree->root != NULL);
 
+	if (treeview__rows_update(tree)) {
+		const struct treeview_rows *rows = &tree->rows;
+		int i;
+
+		/* Row whose bottom is below target */
+		target_y -= y;
+		i = treeview__rows_find(rows, target_y + 1);
+		if (i == rows->count || target_y < rows->row[i].y) {
+			return NULL;
+		}
+
+		return rows->row[i].node;
+	}
+
 	n = treeview_node_next(tree->root, false);
 
 	while (n != NULL) {
@@ -564,7 +702,7 @@ static treeview_node * treeview_y_node(treeview *tree, int target_y)
  * \return node's y position
  */
 static int treeview_node_y(
-		const treeview *tree,
+		treeview *tree,
 		const treeview_node *node)
 {
 	treeview_node *n;
@@ -573,6 +711,19 @@ static int treeview_node_y(
 	assert(tree != NULL);
 	assert(tree->root != NULL);
 
+	if (treeview__rows_update(tree)) {
+		const struct treeview_rows *rows = &tree->rows;
+
+		if (node != NULL && node->row >= 0 &&
+		    node->row < rows->count &&
+		    rows->row[node->row].node == node) {
+			return y + rows->row[node->row].y;
+		}
+
+		/* Node is not shown */
+		return y + rows->height;
+	}
+
 	n = treeview_node_next(tree->root, false);
 
 	while (n != NULL && n != node) {
@@ -593,7 +744,7 @@ static int treeview_node_y(
  * \param[in] node  The treeview node to scroll to visibility.
  */
 static inline void treeview__cw_scroll_to_node(
-		const struct treeview *tree,
+		struct treeview *tree,
 		const struct treeview_node *node)
 {
 	struct rect r = {
@@ -617,7 +768,7 @@ static inline void treeview__cw_scroll_to_node(
  * \param[in] node  Node to redraw from.
  */
 static void treeview__redraw_from_node(
-		const treeview *tree,
+		treeview *tree,
 		const treeview_node *node)
 {
 	struct rect r = {
@@ -1080,6 +1231,7 @@ static nserror treeview_create_node_root(treeview_node **root)
 
 	n->height = 0;
 	n->inset = tree_g.window_padding - tree_g.step_width;
+	n->row = -1;
 
 	n->text.data = NULL;
 	n->text.len = 0;
@@ -1168,6 +1320,10 @@ treeview_insert_node(
 
 	assert(a->parent != NULL);
 
+	if (a->parent->flags & TV_NFLAGS_EXPANDED) {
+		treeview__rows_invalidate(tree);
+	}
+
 	a->inset = a->parent->inset + tree_g.step_width;
 	if (a->children != NULL) {
 		treeview_walk_internal(tree, a,
@@ -1225,6 +1381,7 @@ treeview_create_node_folder(treeview *tree,
 	n->type = TREE_NODE_FOLDER;
 
 	n->height = tree_g.line_height;
+	n->row = -1;
 
 	n->text.data = field->value;
 	n->text.len = field->value_len;
@@ -1421,6 +1578,7 @@ treeview_create_node_entry(treeview *tree,
 	n->type = TREE_NODE_ENTRY;
 
 	n->height = tree_g.line_height;
+	n->row = -1;
 
 	assert(fields != NULL);
 	assert(fields[0].field != NULL);
@@ -1711,6 +1869,8 @@ treeview_delete_node_walk_cb(treeview_node *n, void *ctx, bool *end)
 
 	assert(n->children == NULL);
 
+	treeview__rows_invalidate(nd->tree);
+
 	if (treeview_unlink_node(n))
 		nd->h_reduction += (n->type == TREE_NODE_ENTRY) ?
 			n->height : tree_g.line_height;
@@ -2057,6 +2217,12 @@ treeview_create(treeview **tree,
 		return error;
 	}
 
+	(*tree)->rows.valid = false;
+	(*tree)->rows.row = NULL;
+	(*tree)->rows.count = 0;
+	(*tree)->rows.alloc = 0;
+	(*tree)->rows.height = 0;
+
 	(*tree)->field_width = 0;
 	for (i = 0; i < n_fields; i++) {
 		struct treeview_field *f = &((*tree)->fields[i]);
@@ -2180,6 +2346,8 @@ nserror treeview_destroy(treeview *tree)
 	}
 	free(tree->fields);
 
+	free(tree->rows.row);
+
 	/* Free treeview */
 	free(tree);
 
@@ -2212,6 +2380,8 @@ treeview_node_expand_internal(treeview *tree, treeview_node *node)
 		return NSERROR_OK;
 	}
 
+	treeview__rows_invalidate(tree);
+
 	switch (node->type) {
 	case TREE_NODE_FOLDER:
 		child = node->children;
@@ -2340,6 +2510,7 @@ static nserror treeview_node_contract_cb(treeview_node *n, void *ctx, bool *end)
 		return NSERROR_OK;
 	}
 
+	treeview__rows_invalidate(data->tree);
 
 	switch (n->type) {
 	case TREE_NODE_FOLDER:
@@ -2596,6 +2767,25 @@ static void treeview_redraw_tree(
 		sel_max = tree->drag.prev.y;
 	}
 
+	if (treeview__rows_update(tree)) {
+		/* Start from the row before the first one in the clip
+		 * region, so the walk below steps straight onto it */
+		const struct treeview_rows *rows = &tree->rows;
+		int i = treeview__rows_find(rows, r->y0 - render_y);
+
+		if (i == rows->count) {
+			/* Whole tree is above clip region */
+			*render_y_in_out = render_y + rows->height;
+			return;
+		}
+
+		if (i > 0) {
+			node = rows->row[i - 1].node;
+			count = i;
+			render_y += rows->row[i].y;
+		}
+	}
+
 	while (node != NULL) {
 		struct treeview_node_entry *entry;
 		struct bitmap *furniture;
@@ -3242,6 +3432,8 @@ treeview_node_selection_walk_cb(treeview_node *n,
 				break;
 			}
 
+			treeview__rows_invalidate(sw->tree);
+
 			if (treeview_unlink_node(n))
 				h = n->height;
 
@@ -4900,6 +5092,22 @@ treeview_mouse_action(treeview *tree, browser_mouse_state mouse, int x, int y)
 			.search_height = search_height,
 		};
 
+		if (!tree->search.search && treeview__rows_update(tree)) {
+			/* Go straight to the row under the mouse */
+			const struct treeview_rows *rows = &tree->rows;
+			bool skip_children;
+			bool end;
+			int i;
+
+			i = treeview__rows_find(rows, y - search_height);
+			if (i < rows->count) {
+				ma.current_y += rows->row[i].y;
+				treeview_node_mouse_action_cb(rows->row[i].node,
+						&ma, &skip_children, &end);
+			}
+			return;
+		}
+
 		treeview_walk_internal(tree, tree->root,
 				TREEVIEW_WALK_MODE_DISPLAY, NULL,
 				treeview_node_mouse_action_cb, &ma);
@@ -24,12 +24,16 @@
 #include <inttypes.h>
 #include <sys/types.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <libnsfb.h>
 #include <libnsfb_plot.h>
+#include <libnsfb_plot_util.h>
 
 #include "utils/log.h"
 #include "utils/utils.h"
+#include "utils/nsoption.h"
 #include "netsurf/bitmap.h"
 #include "netsurf/plotters.h"
 #include "netsurf/content.h"
@@ -39,6 +43,188 @@
 #include "framebuffer/framebuffer.h"
 #include "framebuffer/bitmap.h"
 
+/** Bitmaps with fewer pixels than this are not worth storing compactly */
+#define FB_BITMAP_COMPACT_MIN 64
+
+/**
+ * framebuffer bitmap
+ *
+ * Decoders always write 32bpp pixels. When compact storage is enabled
+ * the pixels are converted to RGB565, with an alpha plane if the image
+ * is not opaque, the first time the bitmap is marked modified. If the
+ * buffer is requested again the pixels are expanded back to 32bpp and
+ * left that way, which keeps animations from being converted on every
+ * frame.
+ */
+struct bitmap {
+	nsfb_t *surface; /**< surface holding the bitmap pixels */
+	unsigned int modified; /**< number of times bitmap has been modified */
+};
+
+
+/**
+ * Check if a bitmap surface is held in a compact format.
+ */
+static inline bool bitmap_is_compact(enum nsfb_format_e format)
+{
+	return ((format == NSFB_FMT_RGB565) || (format == NSFB_FMT_RGB565A8));
+}
+
+
+/**
+ * Expand RGB565 pixels to 32bpp colours in place.
+ *
+ * Pixels are processed from the end so each colour is only written over
+ * RGB565 pixels which have already been expanded.
+ *
+ * \param ptr     Buffer holding the RGB565 pixels with room for the colours
+ * \param alpha   Alpha values of the pixels or NULL if opaque
+ * \param npixels The number of pixels
+ */
+static void
+bitmap_expand_pixels(uint8_t *ptr, const uint8_t *alpha, size_t npixels)
+{
+	nsfb_colour_t colour;
+	uint16_t pixel;
+	size_t idx = npixels;
+
+	while (idx-- > 0) {
+		memcpy(&pixel, ptr + (idx * sizeof(pixel)), sizeof(pixel));
+		colour = nsfb_plot_rgb565_to_colour(pixel);
+		if (alpha != NULL) {
+			colour = (colour & 0xffffff) |
+				((nsfb_colour_t)alpha[idx] << 24);
+		}
+		memcpy(ptr + (idx * sizeof(colour)), &colour, sizeof(colour));
+	}
+}
+
+
+/**
+ * Convert a compact bitmap back to 32bpp.
+ *
+ * \param bm The bitmap to expand.
+ * \return true on success else false if memory could not be allocated.
+ */
+static bool bitmap_expand(struct bitmap *bm)
+{
+	enum nsfb_format_e format;
+	int width, height;
+	int stride;
+	uint8_t *ptr;
+	uint8_t *alpha = NULL;
+	size_t npixels;
+
+	nsfb_get_geometry(bm->surface, &width, &height, &format);
+	if (!bitmap_is_compact(format)) {
+		return true;
+	}
+
+	npixels = (size_t)width * height;
+
+	if (format == NSFB_FMT_RGB565A8) {
+		/* the alpha plane is overwritten as the surface grows */
+		alpha = malloc(npixels);
+		if (alpha == NULL) {
+			return false;
+		}
+		nsfb_get_buffer(bm->surface, &ptr, &stride);
+		memcpy(alpha, ptr + (stride * height), npixels);
+	}
+
+	if (nsfb_set_geometry(bm->surface, 0, 0,
+			alpha != NULL ? NSFB_FMT_ABGR8888 :
+					NSFB_FMT_XBGR8888) == -1) {
+		free(alpha);
+		return false;
+	}
+
+	nsfb_get_buffer(bm->surface, &ptr, NULL);
+	bitmap_expand_pixels(ptr, alpha, npixels);
+
+	free(alpha);
+
+	return true;
+}
+
+
+/**
+ * Convert a 32bpp bitmap to compact storage.
+ *
+ * Bitmaps whose alpha values are all opaque are stored without an
+ * alpha plane. The bitmap is left unchanged if memory is short.
+ *
+ * \param bm The bitmap to compact.
+ */
+static void bitmap_compact(struct bitmap *bm)
+{
+	enum nsfb_format_e format;
+	int width, height;
+	uint8_t *ptr;
+	uint8_t *alpha = NULL;
+	nsfb_colour_t colour;
+	uint16_t pixel;
+	size_t npixels;
+	size_t idx;
+	int stride;
+
+	nsfb_get_geometry(bm->surface, &width, &height, &format);
+	npixels = (size_t)width * height;
+	if ((npixels < FB_BITMAP_COMPACT_MIN) || bitmap_is_compact(format)) {
+		return;
+	}
+
+	nsfb_get_buffer(bm->surface, &ptr, NULL);
+
+	if (format == NSFB_FMT_ABGR8888) {
+		/* keep the alpha values aside unless they are all opaque */
+		for (idx = 0; idx < npixels; idx++) {
+			memcpy(&colour, ptr + (idx * sizeof(colour)),
+			       sizeof(colour));
+			if ((colour & 0xff000000) != 0xff000000) {
+				break;
+			}
+		}
+
+		if (idx != npixels) {
+			alpha = malloc(npixels);
+			if (alpha == NULL) {
+				return;
+			}
+			for (idx = 0; idx < npixels; idx++) {
+				memcpy(&colour, ptr + (idx * sizeof(colour)),
+				       sizeof(colour));
+				alpha[idx] = colour >> 24;
+			}
+		}
+	}
+
+	/* each RGB565 pixel is written at or before the colour it is
+	 * converted from so the conversion can be done in place
+	 */
+	for (idx = 0; idx < npixels; idx++) {
+		memcpy(&colour, ptr + (idx * sizeof(colour)), sizeof(colour));
+		pixel = nsfb_plot_colour_to_rgb565(colour);
+		memcpy(ptr + (idx * sizeof(pixel)), &pixel, sizeof(pixel));
+	}
+
+	if (nsfb_set_geometry(bm->surface, 0, 0,
+			alpha != NULL ? NSFB_FMT_RGB565A8 :
+					NSFB_FMT_RGB565) == -1) {
+		/* surface could not be resized, restore the pixels */
+		bitmap_expand_pixels(ptr, alpha, npixels);
+		free(alpha);
+		return;
+	}
+
+	if (alpha != NULL) {
+		nsfb_get_buffer(bm->surface, &ptr, &stride);
+		memcpy(ptr + (stride * height), alpha, npixels);
+		free(alpha);
+	}
+}
+
+
 /**
  * Create a bitmap.
  *
@@ -49,21 +235,28 @@
  */
 static void *bitmap_create(int width, int height, enum gui_bitmap_flags flags)
 {
-	nsfb_t *bm;
+	struct bitmap *bm;
 
-	bm = nsfb_new(NSFB_SURFACE_RAM);
+	bm = calloc(1, sizeof(struct bitmap));
 	if (bm == NULL) {
 		return NULL;
 	}
 
+	bm->surface = nsfb_new(NSFB_SURFACE_RAM);
+	if (bm->surface == NULL) {
+		free(bm);
+		return NULL;
+	}
+
 	if ((flags & BITMAP_OPAQUE) == 0) {
-		nsfb_set_geometry(bm, width, height, NSFB_FMT_ABGR8888);
+		nsfb_set_geometry(bm->surface, width, height, NSFB_FMT_ABGR8888);
 	} else {
-		nsfb_set_geometry(bm, width, height, NSFB_FMT_XBGR8888);
+		nsfb_set_geometry(bm->surface, width, height, NSFB_FMT_XBGR8888);
 	}
 
-	if (nsfb_init(bm) == -1) {
-		nsfb_free(bm);
+	if (nsfb_init(bm->surface) == -1) {
+		nsfb_free(bm->surface);
+		free(bm);
 		return NULL;
 	}
 
@@ -82,12 +275,16 @@ static void *bitmap_create(int width, int height, enum gui_bitmap_flags flags)
  */
 static unsigned char *bitmap_get_buffer(void *bitmap)
 {
-	nsfb_t *bm = bitmap;
+	struct bitmap *bm = bitmap;
 	unsigned char *bmpptr;
 
 	assert(bm != NULL);
 
-	nsfb_get_buffer(bm, &bmpptr, NULL);
+	if (!bitmap_expand(bm)) {
+		return NULL;
+	}
+
+	nsfb_get_buffer(bm->surface, &bmpptr, NULL);
 
 	return bmpptr;
 }
@@ -101,12 +298,20 @@ static unsigned char *bitmap_get_buffer(void *bitmap)
  */
 static size_t bitmap_get_rowstride(void *bitmap)
 {
-	nsfb_t *bm = bitmap;
+	struct bitmap *bm = bitmap;
+	enum nsfb_format_e format;
 	int bmpstride;
+	int width;
 
 	assert(bm != NULL);
 
-	nsfb_get_buffer(bm, NULL, &bmpstride);
+	/* compact bitmaps are expanded when their buffer is requested */
+	nsfb_get_geometry(bm->surface, &width, NULL, &format);
+	if (bitmap_is_compact(format)) {
+		return width * sizeof(nsfb_colour_t);
+	}
+
+	nsfb_get_buffer(bm->surface, NULL, &bmpstride);
 
 	return bmpstride;
 }
@@ -119,11 +324,12 @@ static size_t bitmap_get_rowstride(void *bitmap)
  */
 static void bitmap_destroy(void *bitmap)
 {
-	nsfb_t *bm = bitmap;
+	struct bitmap *bm = bitmap;
 
 	assert(bm != NULL);
 
-	nsfb_free(bm);
+	nsfb_free(bm->surface);
+	free(bm);
 }
 
 
@@ -132,7 +338,23 @@ static void bitmap_destroy(void *bitmap)
  *
  * \param  bitmap  a bitmap, as returned by bitmap_create()
  */
-static void bitmap_modified(void *bitmap) {
+static void bitmap_modified(void *bitmap)
+{
+	struct bitmap *bm = bitmap;
+	uint8_t *ptr;
+
+	assert(bm != NULL);
+
+	bm->modified++;
+
+	/* scaled copies of the old pixels are no longer valid */
+	nsfb_get_buffer(bm->surface, &ptr, NULL);
+	nsfb_plot_scale_cache_invalidate(ptr);
+
+	/* only compact bitmaps which are not repeatedly redecoded */
+	if (nsoption_bool(fb_compact_bitmaps) && (bm->modified == 1)) {
+		bitmap_compact(bm);
+	}
 }
 
 /**
@@ -143,14 +365,33 @@ static void bitmap_modified(void *bitmap) {
  */
 static void bitmap_set_opaque(void *bitmap, bool opaque)
 {
-	nsfb_t *bm = bitmap;
+	struct bitmap *bm = bitmap;
+	enum nsfb_format_e format;
+	int width, height;
+	int stride;
+	uint8_t *ptr;
 
 	assert(bm != NULL);
 
-	if (opaque) {
-		nsfb_set_geometry(bm, 0, 0, NSFB_FMT_XBGR8888);
+	nsfb_get_geometry(bm->surface, &width, &height, &format);
+
+	if (format == NSFB_FMT_RGB565) {
+		if (!opaque &&
+		    (nsfb_set_geometry(bm->surface, 0, 0,
+				       NSFB_FMT_RGB565A8) == 0)) {
+			/* new alpha plane starts fully opaque */
+			nsfb_get_buffer(bm->surface, &ptr, &stride);
+			memset(ptr + (stride * height), 0xff,
+			       (size_t)width * height);
+		}
+	} else if (format == NSFB_FMT_RGB565A8) {
+		if (opaque) {
+			nsfb_set_geometry(bm->surface, 0, 0, NSFB_FMT_RGB565);
+		}
+	} else if (opaque) {
+		nsfb_set_geometry(bm->surface, 0, 0, NSFB_FMT_XBGR8888);
 	} else {
-		nsfb_set_geometry(bm, 0, 0, NSFB_FMT_ABGR8888);
+		nsfb_set_geometry(bm->surface, 0, 0, NSFB_FMT_ABGR8888);
 	}
 }
 
@@ -162,43 +403,79 @@ static void bitmap_set_opaque(void *bitmap, bool opaque)
  */
 bool framebuffer_bitmap_get_opaque(void *bitmap)
 {
-	nsfb_t *bm = bitmap;
+	struct bitmap *bm = bitmap;
 	enum nsfb_format_e format;
 
 	assert(bm != NULL);
 
-	nsfb_get_geometry(bm, NULL, NULL, &format);
+	nsfb_get_geometry(bm->surface, NULL, NULL, &format);
 
-	if (format == NSFB_FMT_ABGR8888)
+	if ((format == NSFB_FMT_ABGR8888) || (format == NSFB_FMT_RGB565A8))
 		return false;
 
 	return true;
 }
 
+/* exported interface documented in framebuffer/bitmap.h */
+struct nsfb_s *framebuffer_bitmap_get_surface(void *bitmap)
+{
+	struct bitmap *bm = bitmap;
+
+	assert(bm != NULL);
+
+	return bm->surface;
+}
+
 static int bitmap_get_width(void *bitmap)
 {
-	nsfb_t *bm = bitmap;
+	struct bitmap *bm = bitmap;
 	int width;
 
 	assert(bm != NULL);
 
-	nsfb_get_geometry(bm, &width, NULL, NULL);
+	nsfb_get_geometry(bm->surface, &width, NULL, NULL);
 
 	return(width);
 }
 
 static int bitmap_get_height(void *bitmap)
 {
-	nsfb_t *bm = bitmap;
+	struct bitmap *bm = bitmap;
 	int height;
 
 	assert(bm != NULL);
 
-	nsfb_get_geometry(bm, NULL, &height, NULL);
+	nsfb_get_geometry(bm->surface, NULL, &height, NULL);
 
 	return(height);
 }
 
+/**
+ * Find the memory used to store a bitmaps pixels.
+ *
+ * \param  bitmap  a bitmap, as returned by bitmap_create()
+ * \return number of bytes used by the pixels
+ */
+static size_t bitmap_get_storage_size(void *bitmap)
+{
+	struct bitmap *bm = bitmap;
+	enum nsfb_format_e format;
+	int width, height;
+	int stride;
+
+	assert(bm != NULL);
+
+	nsfb_get_geometry(bm->surface, &width, &height, &format);
+	nsfb_get_buffer(bm->surface, NULL, &stride);
+
+	if (format == NSFB_FMT_RGB565A8) {
+		/* alpha plane */
+		return ((size_t)stride * height) + ((size_t)width * height);
+	}
+
+	return (size_t)stride * height;
+}
+
 /**
  * Render content into a bitmap.
  *
@@ -210,12 +487,13 @@ static nserror
 bitmap_render(struct bitmap *bitmap,
 	      struct hlcache_handle *content)
 {
-	nsfb_t *tbm = (nsfb_t *)bitmap; /* target bitmap */
+	nsfb_t *tbm; /* target bitmap */
 	nsfb_t *bm; /* temporary bitmap */
 	nsfb_t *current; /* current main fb */
 	int width, height; /* target bitmap width height */
 	int cwidth, cheight;/* content width /height */
 	nsfb_bbox_t loc;
+	uint8_t *ptr;
 
 	struct redraw_context ctx = {
 		.interactive = false,
@@ -223,6 +501,12 @@ bitmap_render(struct bitmap *bitmap,
 		.plot = &fb_plotters
 	};
 
+	/* the thumbnail is plotted over the 32bpp pixels */
+	if (!bitmap_expand(bitmap)) {
+		return NSERROR_NOMEM;
+	}
+	tbm = bitmap->surface;
+
 	nsfb_get_geometry(tbm, &width, &height, NULL);
 
 	NSLOG(netsurf, INFO, "width %d, height %d", width, height);
@@ -266,9 +550,31 @@ bitmap_render(struct bitmap *bitmap,
 
 	nsfb_free(bm);
 
+	/* the thumbnail pixels have been replaced */
+	nsfb_get_buffer(tbm, &ptr, NULL);
+	nsfb_plot_scale_cache_invalidate(ptr);
+
 	return NSERROR_OK;
 }
 
+/**
+ * Get statistics of the libnsfb scaled bitmap cache.
+ *
+ * \param stats The statistics to fill in.
+ */
+static void bitmap_get_scale_cache_stats(struct bitmap_scale_cache_stats *stats)
+{
+	nsfb_plot_scale_cache_stats_t nsfb_stats;
+
+	nsfb_plot_scale_cache_stats(&nsfb_stats);
+
+	stats->hit_count = nsfb_stats.hits;
+	stats->miss_count = nsfb_stats.misses;
+	stats->count = nsfb_stats.count;
+	stats->size = nsfb_stats.size;
+	stats->limit = nsfb_stats.limit;
+}
+
 static struct gui_bitmap_table bitmap_table = {
 	.create = bitmap_create,
 	.destroy = bitmap_destroy,
@@ -280,6 +586,8 @@ static struct gui_bitmap_table bitmap_table = {
 	.get_height = bitmap_get_height,
 	.modified = bitmap_modified,
 	.render = bitmap_render,
+	.get_storage_size = bitmap_get_storage_size,
+	.get_scale_cache_stats = bitmap_get_scale_cache_stats,
 };
 
 struct gui_bitmap_table *framebuffer_bitmap_table = &bitmap_table;
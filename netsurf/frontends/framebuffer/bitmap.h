@@ -23,4 +23,15 @@ extern struct gui_bitmap_table *framebuffer_bitmap_table;
 
 bool framebuffer_bitmap_get_opaque(void *bitmap);
 
+/**
+ * Get the surface holding a bitmaps pixels.
+ *
+ * The surface may be in a compact format, see the fb_compact_bitmaps
+ * option.
+ *
+ * \param bitmap The bitmap to get the surface of.
+ * \return The surface.
+ */
+struct nsfb_s *framebuffer_bitmap_get_surface(void *bitmap);
+
 #endif /* NS_FB_BITMAP_H */
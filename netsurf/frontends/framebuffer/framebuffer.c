@@ -25,12 +25,14 @@
 
 #include <libnsfb.h>
 #include <libnsfb_plot.h>
+#include <libnsfb_plot_util.h>
 #include <libnsfb_event.h>
 #include <libnsfb_cursor.h>
 
 #include "utils/utils.h"
 #include "utils/log.h"
 #include "utils/utf8.h"
+#include "utils/nsoption.h"
 #include "netsurf/browser_window.h"
 #include "netsurf/plotters.h"
 #include "netsurf/bitmap.h"
@@ -318,7 +320,8 @@ framebuffer_plot_bitmap(const struct redraw_context *ctx,
 	int bmstride;
 	enum nsfb_format_e bmformat;
 	unsigned char *bmptr;
-	nsfb_t *bm = (nsfb_t *)bitmap;
+	nsfb_colour_t tlcolour; /* top left pixel colour */
+	nsfb_t *bm = framebuffer_bitmap_get_surface(bitmap);
 
 	/* x and y define coordinate of top left of of the initial explicitly
 	 * placed tile. The width and height are the image scaling and the
@@ -343,12 +346,22 @@ framebuffer_plot_bitmap(const struct redraw_context *ctx,
 	nsfb_get_geometry(bm, &bmwidth, &bmheight, &bmformat);
 	nsfb_get_buffer(bm, &bmptr, &bmstride);
 
+	if ((bmformat == NSFB_FMT_RGB565) || (bmformat == NSFB_FMT_RGB565A8)) {
+		tlcolour = nsfb_plot_rgb565_to_colour(*(uint16_t *)bmptr);
+		if (bmformat == NSFB_FMT_RGB565A8) {
+			tlcolour = (tlcolour & 0xffffff) |
+				((nsfb_colour_t)bmptr[bmstride * bmheight] << 24);
+		}
+	} else {
+		tlcolour = *(nsfb_colour_t *)bmptr;
+	}
+
 	/* Optimise tiled plots of 1x1 bitmaps by replacing with a flat fill
 	 * of the area.  Can only be done when image is fully opaque. */
 	if ((bmwidth == 1) && (bmheight == 1)) {
-		if ((*(nsfb_colour_t *)bmptr & 0xff000000) != 0) {
+		if ((tlcolour & 0xff000000) != 0) {
 			if (!nsfb_plot_rectangle_fill(nsfb, &clipbox,
-						      *(nsfb_colour_t *)bmptr)) {
+						      tlcolour)) {
 				return NSERROR_INVALID;
 			}
 			return NSERROR_OK;
@@ -363,7 +376,7 @@ framebuffer_plot_bitmap(const struct redraw_context *ctx,
 			/** TODO: Currently using top left pixel. Maybe centre
 			 *        pixel or average value would be better. */
 			if (!nsfb_plot_rectangle_fill(nsfb, &clipbox,
-						      *(nsfb_colour_t *)bmptr)) {
+						      tlcolour)) {
 				return NSERROR_INVALID;
 			}
 			return NSERROR_OK;
@@ -387,11 +400,21 @@ framebuffer_plot_bitmap(const struct redraw_context *ctx,
 	loc.y1 = loc.y0 + height;
 
 	/* plot tiling across and down to extents */
-	nsfb_plot_bitmap_tiles(nsfb, &loc,
+	if ((bmformat == NSFB_FMT_RGB565) || (bmformat == NSFB_FMT_RGB565A8)) {
+		nsfb_plot_bitmap565_tiles(nsfb, &loc,
+			repeat_x ? ((clipbox.x1 - x) + width  - 1) / width  : 1,
+			repeat_y ? ((clipbox.y1 - y) + height - 1) / height : 1,
+			(uint16_t *)bmptr,
+			(bmformat == NSFB_FMT_RGB565A8) ?
+				bmptr + (bmstride * bmheight) : NULL,
+			bmwidth, bmheight, bmstride * 8 / 16);
+	} else {
+		nsfb_plot_bitmap_tiles(nsfb, &loc,
 			repeat_x ? ((clipbox.x1 - x) + width  - 1) / width  : 1,
 			repeat_y ? ((clipbox.y1 - y) + height - 1) / height : 1,
 			(nsfb_colour_t *)bmptr, bmwidth, bmheight,
 			bmstride * 8 / 32, bmformat == NSFB_FMT_ABGR8888);
+	}
 
 	return NSERROR_OK;
 }
@@ -611,6 +634,10 @@ framebuffer_initialise(const char *fename, int width, int height, int bpp)
 	return NULL;
     }
 
+    /* bitmaps invalidate their scaled copies when they are modified */
+    nsfb_plot_scale_cache_set_limit(
+	    (size_t)nsoption_uint(fb_scaled_bitmap_cache) * 1024);
+
     return nsfb;
 
 }
@@ -638,6 +665,7 @@ void
 framebuffer_finalise(void)
 {
     nsfb_free(nsfb);
+    nsfb_plot_scale_cache_set_limit(0);
 }
 
 bool
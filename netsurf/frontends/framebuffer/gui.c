@@ -23,6 +23,7 @@
 #include <string.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <sys/select.h>
 #include <nsutils/time.h>
 
 #include <libnsfb.h>
@@ -34,6 +35,7 @@
 #include "utils/filepath.h"
 #include "utils/log.h"
 #include "utils/messages.h"
+#include "netsurf/inttypes.h"
 #include "netsurf/browser_window.h"
 #include "netsurf/keypress.h"
 #include "desktop/browser_history.h"
@@ -60,10 +62,19 @@
 
 #define NSFB_TOOLBAR_DEFAULT_LAYOUT "blfsrutc"
 
+/**
+ * Interval in ms between input backend polls while the main loop is
+ * waiting on fetch sockets.
+ */
+#define FB_INPUT_SLICE 10
+
 fbtk_widget_t *fbtk;
 
 static bool fb_complete = false;
 
+/** Time in ms the main loop has spent waiting for events. */
+static uint64_t fb_idle_ms = 0;
+
 struct gui_window *input_window = NULL;
 struct gui_window *search_current_window;
 struct gui_window *window_list = NULL;
@@ -597,6 +608,9 @@ static nserror set_defaults(struct nsoption_s *defaults)
 	nsoption_set_colour(sys_colour_WindowFrame, 0x00000000);
 	nsoption_set_colour(sys_colour_WindowText, 0x00000000);
 
+	/* the path plotter is not implemented so draw SVG as bitmaps */
+	nsoption_set_bool(rasterise_svg, true);
+
 	return NSERROR_OK;
 }
 
@@ -612,10 +626,87 @@ static bool nslog_stream_configure(FILE *fptr)
 	return true;
 }
 
+/**
+ * Wait for the next event.
+ *
+ * Blocks until input is available, a fetch socket becomes ready or
+ * the timeout expires. The input backend has no way to wait on the
+ * fetchers file descriptors so while there are sockets to wait on
+ * the wait is split into slices which sleep in select() and then
+ * poll the input backend.
+ *
+ * \param event The event structure to fill.
+ * \param timeout The time in ms to wait, 0 to poll or -1 to wait forever.
+ */
+static void framebuffer_wait(nsfb_event_t *event, int timeout)
+{
+	fd_set read_fd_set, write_fd_set, exc_fd_set;
+	fd_set rd, wr, ex;
+	struct timeval tv;
+	uint64_t start;
+	uint64_t now;
+	int max_fd;
+	int slice;
+
+	/* clears fdset */
+	fetch_fdset(&read_fd_set, &write_fd_set, &exc_fd_set, &max_fd);
+
+	if ((max_fd < 0) || (timeout == 0)) {
+		/* no sockets to wait on so the input backend can block */
+		fbtk_event(fbtk, event, timeout);
+		return;
+	}
+
+	nsu_getmonotonic_ms(&start);
+
+	while (fb_complete != true) {
+		event->type = NSFB_EVENT_NONE;
+		fbtk_event(fbtk, event, 0);
+		if (event->type != NSFB_EVENT_NONE) {
+			/* input arrived */
+			break;
+		}
+
+		slice = FB_INPUT_SLICE;
+		if (timeout > 0) {
+			nsu_getmonotonic_ms(&now);
+			if ((now - start) >= (uint64_t)timeout) {
+				/* timer expired */
+				break;
+			}
+			if ((timeout - (int)(now - start)) < slice) {
+				slice = timeout - (int)(now - start);
+			}
+		}
+
+		tv.tv_sec = 0;
+		tv.tv_usec = slice * 1000;
+
+		/* select modifies the sets so wait on copies */
+		rd = read_fd_set;
+		wr = write_fd_set;
+		ex = exc_fd_set;
+
+		if (select(max_fd + 1, &rd, &wr, &ex, &tv) != 0) {
+			/* socket ready (or error) so fetchers need to run */
+			break;
+		}
+	}
+}
+
 static void framebuffer_run(void)
 {
+	nsfb_t *nsfb = fbtk_get_nsfb(fbtk);
 	nsfb_event_t event;
+	nsfb_update_stats_t stats;
+	unsigned int frames = 0;
 	int timeout; /* timeout in miliseconds */
+	int flush_wait = 0; /* time until pending display updates are sent */
+	uint64_t start;
+	uint64_t wait_start;
+	uint64_t now;
+
+	nsu_getmonotonic_ms(&start);
 
 	while (fb_complete != true) {
 		/* run the scheduler and discover how long to wait for
@@ -628,20 +719,46 @@ static void framebuffer_run(void)
 		 */
 		if (fbtk_get_redraw_pending(fbtk))
 			timeout = 0;
-	
-		// timeout = min(timeout,20);
-		timeout = 0;
 
-		// printf("TIMEOUT: %d\n",timeout);
+		/* wake in time to send display updates held back to
+		 * pace the frame rate
+		 */
+		if ((flush_wait > 0) && ((timeout < 0) || (timeout > flush_wait)))
+			timeout = flush_wait;
 
-		if (fbtk_event(fbtk, &event, timeout)) {
-			if ((event.type == NSFB_EVENT_CONTROL) &&
-			    (event.value.controlcode ==  NSFB_CONTROL_QUIT))
-				fb_complete = true;
-		}
+		nsu_getmonotonic_ms(&wait_start);
+
+		event.type = NSFB_EVENT_NONE;
+		framebuffer_wait(&event, timeout);
+
+		nsu_getmonotonic_ms(&now);
+		fb_idle_ms += now - wait_start;
+
+		if ((event.type == NSFB_EVENT_CONTROL) &&
+		    (event.value.controlcode ==  NSFB_CONTROL_QUIT))
+			fb_complete = true;
 
 		fbtk_redraw(fbtk);
+
+		/* send this frames updates to the display */
+		flush_wait = nsfb_flush(nsfb);
+
+		nsfb_get_update_stats(nsfb, &stats);
+		if (stats.frames != frames) {
+			frames = stats.frames;
+			NSLOG(netsurf, DEBUG,
+			      "frame %u: %u rectangles, %"PRIu64" pixels",
+			      stats.frames, stats.rects, stats.pixels);
+		}
 	}
+
+	nsu_getmonotonic_ms(&now);
+	NSLOG(netsurf, INFO, "main loop idle for %"PRIu64" of %"PRIu64"ms",
+	      fb_idle_ms, now - start);
+
+	nsfb_get_update_stats(nsfb, &stats);
+	NSLOG(netsurf, INFO, "%u frames sent to display, %"PRIu64" pixels",
+	      stats.frames, stats.total_pixels);
 }
 
 static void gui_quit(void)
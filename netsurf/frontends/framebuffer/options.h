@@ -42,6 +42,14 @@ NSOPTION_STRING(fb_toolbar_layout, NULL)
 /** enable on screen keyboard */
 NSOPTION_BOOL(fb_osk, false)
 
+/***** bitmap options *****/
+
+/** store decoded images as RGB565 with an alpha plane only if needed */
+NSOPTION_BOOL(fb_compact_bitmaps, false)
+/** size of cache of bitmaps scaled to their plotted size in kilobytes,
+ * zero to scale bitmaps every time they are plotted */
+NSOPTION_UINT(fb_scaled_bitmap_cache, 4096)
+
 /***** font options *****/
 
 /** render all fonts monochrome */
@@ -16,28 +16,238 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+/**
+ * \file
+ * Framebuffer scheduler implementation.
+ *
+ * Scheduled callbacks are held in a binary min-heap ordered by
+ * deadline so the next callback to run is always at the root. A
+ * hashmap indexed by the (callback, p) pair gives constant time
+ * lookup of an existing entry so removal and rescheduling do not
+ * need to search the heap.
+ */
+
 #include <time.h>
+#include <stdint.h>
 #include <stdlib.h>
 
+#include "utils/errors.h"
 #include "utils/sys_time.h"
 #include "utils/log.h"
+#include "utils/hashmap.h"
 
 #include "framebuffer/schedule.h"
 
-/* linked list of scheduled callbacks */
-static struct nscallback *schedule_list = NULL;
+/** Number of heap slots allocated at a time */
+#define SCHEDULE_HEAP_STEP 64
+
+/**
+ * key used to index scheduled callbacks.
+ */
+struct nscallback_key {
+	void (*callback)(void *p);
+	void *p;
+};
 
 /**
  * scheduled callback.
  */
 struct nscallback
 {
-        struct nscallback *next;
-	struct timeval tv;
+	struct timeval tv; /**< time the callback is due */
 	void (*callback)(void *p);
 	void *p;
+	unsigned int idx; /**< index of this entry in the heap */
+};
+
+/** heap of scheduled callbacks ordered by deadline */
+static struct nscallback **schedule_heap = NULL;
+
+/** number of callbacks in the heap */
+static unsigned int schedule_count = 0;
+
+/** number of allocated heap slots */
+static unsigned int schedule_alloc = 0;
+
+/** index of scheduled callbacks by callback and context */
+static hashmap_t *schedule_index = NULL;
+
+
+static void *schedule_key_clone(void *key)
+{
+	struct nscallback_key *clone;
+
+	clone = malloc(sizeof(struct nscallback_key));
+	if (clone != NULL) {
+		*clone = *(struct nscallback_key *)key;
+	}
+	return clone;
+}
+
+static void schedule_key_destroy(void *key)
+{
+	free(key);
+}
+
+static uint32_t schedule_key_hash(void *key)
+{
+	struct nscallback_key *k = key;
+	uint32_t hash;
+
+	/* pointers are at least word aligned so discard the low bits */
+	hash = (uint32_t)((uintptr_t)k->callback >> 2) * 2654435761u;
+	hash ^= (uint32_t)((uintptr_t)k->p >> 2) * 2246822519u;
+
+	return hash ^ (hash >> 15);
+}
+
+static bool schedule_key_eq(void *key1, void *key2)
+{
+	struct nscallback_key *k1 = key1;
+	struct nscallback_key *k2 = key2;
+
+	return (k1->callback == k2->callback) && (k1->p == k2->p);
+}
+
+static void *schedule_value_alloc(void *key)
+{
+	struct nscallback_key *k = key;
+	struct nscallback *nscb;
+
+	nscb = calloc(1, sizeof(struct nscallback));
+	if (nscb != NULL) {
+		nscb->callback = k->callback;
+		nscb->p = k->p;
+	}
+	return nscb;
+}
+
+static void schedule_value_destroy(void *value)
+{
+	free(value);
+}
+
+static hashmap_parameters_t schedule_index_parameters = {
+	.key_clone = schedule_key_clone,
+	.key_hash = schedule_key_hash,
+	.key_eq = schedule_key_eq,
+	.key_destroy = schedule_key_destroy,
+	.value_alloc = schedule_value_alloc,
+	.value_destroy = schedule_value_destroy,
 };
 
+
+/**
+ * Place a callback in a heap slot.
+ */
+static inline void heap_set(unsigned int idx, struct nscallback *nscb)
+{
+	schedule_heap[idx] = nscb;
+	nscb->idx = idx;
+}
+
+/**
+ * Move a heap entry towards the root until the heap is ordered.
+ */
+static void heap_sift_up(unsigned int idx)
+{
+	struct nscallback *nscb = schedule_heap[idx];
+	unsigned int parent;
+
+	while (idx > 0) {
+		parent = (idx - 1) / 2;
+		if (!timercmp(&schedule_heap[parent]->tv, &nscb->tv, >)) {
+			break;
+		}
+		heap_set(idx, schedule_heap[parent]);
+		idx = parent;
+	}
+	heap_set(idx, nscb);
+}
+
+/**
+ * Move a heap entry towards the leaves until the heap is ordered.
+ */
+static void heap_sift_down(unsigned int idx)
+{
+	struct nscallback *nscb = schedule_heap[idx];
+	unsigned int child;
+
+	while ((child = (idx * 2) + 1) < schedule_count) {
+		if (((child + 1) < schedule_count) &&
+		    timercmp(&schedule_heap[child]->tv,
+			     &schedule_heap[child + 1]->tv, >)) {
+			child++;
+		}
+		if (!timercmp(&nscb->tv, &schedule_heap[child]->tv, >)) {
+			break;
+		}
+		heap_set(idx, schedule_heap[child]);
+		idx = child;
+	}
+	heap_set(idx, nscb);
+}
+
+/**
+ * Restore heap ordering after an entries deadline has changed.
+ */
+static void heap_update(unsigned int idx)
+{
+	if ((idx > 0) &&
+	    timercmp(&schedule_heap[(idx - 1) / 2]->tv,
+		     &schedule_heap[idx]->tv, >)) {
+		heap_sift_up(idx);
+	} else {
+		heap_sift_down(idx);
+	}
+}
+
+/**
+ * Add a callback to the heap.
+ */
+static nserror heap_insert(struct nscallback *nscb)
+{
+	struct nscallback **heap;
+
+	if (schedule_count == schedule_alloc) {
+		heap = realloc(schedule_heap,
+			       (schedule_alloc + SCHEDULE_HEAP_STEP) *
+			       sizeof(struct nscallback *));
+		if (heap == NULL) {
+			return NSERROR_NOMEM;
+		}
+		schedule_heap = heap;
+		schedule_alloc += SCHEDULE_HEAP_STEP;
+	}
+
+	heap_set(schedule_count, nscb);
+	schedule_count++;
+	heap_sift_up(nscb->idx);
+
+	return NSERROR_OK;
+}
+
+/**
+ * Remove a callback from the heap and the index.
+ *
+ * The callback entry is freed.
+ */
+static void schedule_unlink(struct nscallback *nscb)
+{
+	struct nscallback_key key;
+	unsigned int idx = nscb->idx;
+
+	schedule_count--;
+	if (idx != schedule_count) {
+		heap_set(idx, schedule_heap[schedule_count]);
+		heap_update(idx);
+	}
+
+	key.callback = nscb->callback;
+	key.p = nscb->p;
+	hashmap_remove(schedule_index, &key);
+}
+
 /**
  * Unschedule a callback.
  *
@@ -48,45 +258,24 @@ struct nscallback
  */
 static nserror schedule_remove(void (*callback)(void *p), void *p)
 {
-        struct nscallback *cur_nscb;
-        struct nscallback *prev_nscb;
-        struct nscallback *unlnk_nscb;
+	struct nscallback_key key;
+	struct nscallback *nscb;
 
-	/* check there is something on the list to remove */
-        if (schedule_list == NULL) {
-                return NSERROR_OK;
+	/* check there is something scheduled to remove */
+	if (schedule_count == 0) {
+		return NSERROR_OK;
 	}
 
-	NSLOG(schedule, DEBUG, "removing %p, %p", callback, p);
-
-        cur_nscb = schedule_list;
-        prev_nscb = NULL;
-
-        while (cur_nscb != NULL) {
-                if ((cur_nscb->callback ==  callback) &&
-                    (cur_nscb->p ==  p)) {
-                        /* item to remove */
-
-                        NSLOG(schedule, DEBUG,
-			      "callback entry %p removing  %p(%p)",
-                             cur_nscb, cur_nscb->callback, cur_nscb->p);
+	key.callback = callback;
+	key.p = p;
 
-                        /* remove callback */
-                        unlnk_nscb = cur_nscb;
-                        cur_nscb = unlnk_nscb->next;
+	nscb = hashmap_lookup(schedule_index, &key);
+	if (nscb != NULL) {
+		NSLOG(schedule, DEBUG, "callback entry %p removing  %p(%p)",
+		      nscb, nscb->callback, nscb->p);
 
-                        if (prev_nscb == NULL) {
-                                schedule_list = cur_nscb;
-                        } else {
-                                prev_nscb->next = cur_nscb;
-                        }
-                        free (unlnk_nscb);
-                } else {
-                        /* move to next element */
-                        prev_nscb = cur_nscb;
-                        cur_nscb = prev_nscb->next;
-                }
-        }
+		schedule_unlink(nscb);
+	}
 
 	return NSERROR_OK;
 }
@@ -94,122 +283,120 @@ static nserror schedule_remove(void (*callback)(void *p), void *p)
 /* exported function documented in framebuffer/schedule.h */
 nserror framebuffer_schedule(int tival, void (*callback)(void *p), void *p)
 {
+	struct nscallback_key key;
 	struct nscallback *nscb;
 	struct timeval tv;
 	nserror ret;
 
-	/* ensure uniqueness of the callback and context */
-	ret = schedule_remove(callback, p);
-	if ((tival < 0) || (ret != NSERROR_OK)) {
-		return ret;
+	if (tival < 0) {
+		return schedule_remove(callback, p);
+	}
+
+	if (schedule_index == NULL) {
+		schedule_index = hashmap_create(&schedule_index_parameters);
+		if (schedule_index == NULL) {
+			return NSERROR_NOMEM;
+		}
 	}
 
 	NSLOG(schedule, DEBUG, "Adding %p(%p) in %d", callback, p, tival);
 
-        tv.tv_sec = tival / 1000; /* miliseconds to seconds */
-        tv.tv_usec = (tival % 1000) * 1000; /* remainder to microseconds */
+	tv.tv_sec = tival / 1000; /* miliseconds to seconds */
+	tv.tv_usec = (tival % 1000) * 1000; /* remainder to microseconds */
+
+	key.callback = callback;
+	key.p = p;
+
+	/* ensure uniqueness of the callback and context by moving an
+	 * existing entry to its new deadline.
+	 */
+	nscb = hashmap_lookup(schedule_index, &key);
+	if (nscb != NULL) {
+		gettimeofday(&nscb->tv, NULL);
+		timeradd(&nscb->tv, &tv, &nscb->tv);
+		heap_update(nscb->idx);
+		return NSERROR_OK;
+	}
 
-	nscb = calloc(1, sizeof(struct nscallback));
+	nscb = hashmap_insert(schedule_index, &key);
+	if (nscb == NULL) {
+		return NSERROR_NOMEM;
+	}
 
 	gettimeofday(&nscb->tv, NULL);
 	timeradd(&nscb->tv, &tv, &nscb->tv);
 
-	nscb->callback = callback;
-	nscb->p = p;
-
-        /* add to list front */
-        nscb->next = schedule_list;
-        schedule_list = nscb;
+	ret = heap_insert(nscb);
+	if (ret != NSERROR_OK) {
+		hashmap_remove(schedule_index, &key);
+	}
 
-	return NSERROR_OK;
+	return ret;
 }
 
 /* exported function documented in framebuffer/schedule.h */
 int schedule_run(void)
 {
 	struct timeval tv;
-	struct timeval nexttime;
 	struct timeval rettime;
-        struct nscallback *cur_nscb;
-        struct nscallback *prev_nscb;
-        struct nscallback *unlnk_nscb;
-
-        if (schedule_list == NULL)
-                return -1;
+	struct nscallback *nscb;
+	void (*callback)(void *p);
+	void *p;
 
-	/* reset enumeration to the start of the list */
-        cur_nscb = schedule_list;
-        prev_nscb = NULL;
-	nexttime = cur_nscb->tv;
+	if (schedule_count == 0)
+		return -1;
 
 	gettimeofday(&tv, NULL);
 
-        while (cur_nscb != NULL) {
-                if (timercmp(&tv, &cur_nscb->tv, >)) {
-                        /* scheduled time */
-
-                        /* remove callback */
-                        unlnk_nscb = cur_nscb;
-
-                        if (prev_nscb == NULL) {
-                                schedule_list = unlnk_nscb->next;
-                        } else {
-                                prev_nscb->next = unlnk_nscb->next;
-                        }
-
-                        unlnk_nscb->callback(unlnk_nscb->p);
-
-                        free(unlnk_nscb);
-
-                        /* need to deal with callback modifying the list. */
-			if (schedule_list == NULL)
-				return -1; /* no more callbacks scheduled */
-			
-                        /* reset enumeration to the start of the list */
-                        cur_nscb = schedule_list;
-                        prev_nscb = NULL;
-			nexttime = cur_nscb->tv;
-                } else {
-			/* if the time to the event is sooner than the
-			 * currently recorded soonest event record it 
-			 */
-			if (timercmp(&nexttime, &cur_nscb->tv, >)) {
-				nexttime = cur_nscb->tv;
-			}
-                        /* move to next element */
-                        prev_nscb = cur_nscb;
-                        cur_nscb = prev_nscb->next;
-                }
-        }
+	/* The root of the heap is always the next callback due. The
+	 * callbacks may alter the schedule so the root is re-examined
+	 * after each one.
+	 */
+	while (schedule_count > 0) {
+		nscb = schedule_heap[0];
+		if (!timercmp(&tv, &nscb->tv, >)) {
+			break;
+		}
+
+		callback = nscb->callback;
+		p = nscb->p;
+
+		/* remove callback before running it */
+		schedule_unlink(nscb);
+
+		callback(p);
+	}
+
+	if (schedule_count == 0)
+		return -1; /* no more callbacks scheduled */
 
 	/* make rettime relative to now */
-	timersub(&nexttime, &tv, &rettime);
+	timersub(&schedule_heap[0]->tv, &tv, &rettime);
 
 	NSLOG(schedule, DEBUG,
 	      "returning time to next event as %ldms",
-	      (rettime.tv_sec * 1000) + (rettime.tv_usec / 1000)); 
+	      (long)((rettime.tv_sec * 1000) + (rettime.tv_usec / 1000)));
 
 	/* return next event time in milliseconds (24days max wait) */
-        return (rettime.tv_sec * 1000) + (rettime.tv_usec / 1000);
+	return (rettime.tv_sec * 1000) + (rettime.tv_usec / 1000);
 }
 
 void list_schedule(void)
 {
 	struct timeval tv;
-        struct nscallback *cur_nscb;
+	struct nscallback *nscb;
+	unsigned int idx;
 
 	gettimeofday(&tv, NULL);
 
-        NSLOG(netsurf, INFO, "schedule list at %ld:%ld", tv.tv_sec,
-              tv.tv_usec);
-
-        cur_nscb = schedule_list;
+	NSLOG(netsurf, INFO, "schedule list at %ld:%ld",
+	      (long)tv.tv_sec, (long)tv.tv_usec);
 
-        while (cur_nscb != NULL) {
-                NSLOG(netsurf, INFO, "Schedule %p at %ld:%ld", cur_nscb,
-                      cur_nscb->tv.tv_sec, cur_nscb->tv.tv_usec);
-                cur_nscb = cur_nscb->next;
-        }
+	for (idx = 0; idx < schedule_count; idx++) {
+		nscb = schedule_heap[idx];
+		NSLOG(netsurf, INFO, "Schedule %p at %ld:%ld", nscb,
+		      (long)nscb->tv.tv_sec, (long)nscb->tv.tv_usec);
+	}
 }
 
 
@@ -25,6 +25,8 @@
 #include <string.h>
 #include <errno.h>
 #include <signal.h>
+#include <time.h>
+#include <sys/resource.h>
 
 #include "utils/config.h"
 #include "utils/sys_time.h"
@@ -227,6 +229,28 @@ static nserror gui_present_cookies(const char *search_term)
 	return NSERROR_OK;
 }
 
+/**
+ * Report the start or end of a document processing phase.
+ *
+ * The monotonic time in microseconds and the peak resident set size
+ * in kilobytes are reported so a benchmark driver can compute phase
+ * durations and memory use.
+ */
+static void monkey_phase(const char *phase, bool start)
+{
+	struct timespec ts;
+	struct rusage usage;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	getrusage(RUSAGE_SELF, &usage);
+
+	moutf(MOUT_GENERIC, "PHASE %s %s TIME %lld MAXRSS %ld",
+	      start ? "START" : "END",
+	      phase,
+	      ((long long)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000),
+	      usage.ru_maxrss);
+}
+
 static void quit_handler(int argc, char **argv)
 {
 	monkey_done = true;
@@ -272,6 +296,7 @@ static struct gui_misc_table monkey_misc_table = {
 	.launch_url = gui_launch_url,
 	.login = gui_401login_open,
 	.present_cookies = gui_present_cookies,
+	.phase = monkey_phase,
 };
 
 static void monkey_run(void)
@@ -316,6 +341,10 @@ static void monkey_run(void)
 		default:
 			NSLOG(netsurf, INFO, "Iterate non-blocking");
 			moutf(MOUT_GENERIC, "POLL TIMED %d", schedtm);
+			if (nsoption_bool(fake_clock)) {
+				/* do not wait for the next event in real time */
+				schedtm = 0;
+			}
 			tv.tv_sec = schedtm / 1000; /* miliseconds to seconds */
 			tv.tv_usec = (schedtm % 1000) * 1000; /* remainder to microseconds */
 			timeout = &tv;
@@ -334,6 +363,9 @@ static void monkey_run(void)
 			if (FD_ISSET(0, &read_fd_set)) {
 				monkey_process_command();
 			}
+		} else if (timeout != NULL) {
+			/* nothing became ready so move to the next event */
+			monkey_schedule_advance();
 		}
 	}
 }
@@ -21,12 +21,16 @@
 
 #include "utils/sys_time.h"
 #include "utils/log.h"
+#include "utils/nsoption.h"
 
 #include "monkey/schedule.h"
 
 /* linked list of scheduled callbacks */
 static struct nscallback *schedule_list = NULL;
 
+/* time seen by the scheduler when the fake clock is in use */
+static struct timeval schedule_fake_time;
+
 /**
  * scheduled callback.
  */
@@ -38,6 +42,28 @@ struct nscallback
 	void *p;
 };
 
+/**
+ * Get the current time as seen by the scheduler.
+ *
+ * When the fake_clock option is set the time only moves forward when
+ * monkey_schedule_advance() is called so timed callbacks run without
+ * waiting for them in real time.
+ *
+ * \param tv updated with the current time
+ */
+static void schedule_gettime(struct timeval *tv)
+{
+	if (!nsoption_bool(fake_clock)) {
+		gettimeofday(tv, NULL);
+		return;
+	}
+
+	if (!timerisset(&schedule_fake_time)) {
+		gettimeofday(&schedule_fake_time, NULL);
+	}
+	*tv = schedule_fake_time;
+}
+
 /**
  * Unschedule a callback.
  *
@@ -116,7 +142,7 @@ nserror monkey_schedule(int tival, void (*callback)(void *p), void *p)
 
 	nscb = calloc(1, sizeof(struct nscallback));
 
-	gettimeofday(&nscb->tv, NULL);
+	schedule_gettime(&nscb->tv);
 	timeradd(&nscb->tv, &tv, &nscb->tv);
 
 	nscb->callback = callback;
@@ -147,7 +173,7 @@ int monkey_schedule_run(void)
 	prev_nscb = NULL;
 	nexttime = cur_nscb->tv;
 
-	gettimeofday(&tv, NULL);
+	schedule_gettime(&tv);
 
 	while (cur_nscb != NULL) {
 		if (timercmp(&tv, &cur_nscb->tv, >)) {
@@ -197,12 +223,41 @@ int monkey_schedule_run(void)
 	return (rettime.tv_sec * 1000) + (rettime.tv_usec / 1000);
 }
 
+/* exported function documented in monkey/schedule.h */
+void monkey_schedule_advance(void)
+{
+	struct timeval one_us = { 0, 1 };
+	struct timeval nexttime;
+	struct nscallback *cur_nscb;
+
+	if ((!nsoption_bool(fake_clock)) || (schedule_list == NULL)) {
+		return;
+	}
+
+	nexttime = schedule_list->tv;
+	for (cur_nscb = schedule_list->next;
+	     cur_nscb != NULL;
+	     cur_nscb = cur_nscb->next) {
+		if (timercmp(&nexttime, &cur_nscb->tv, >)) {
+			nexttime = cur_nscb->tv;
+		}
+	}
+
+	/* callbacks are run once the time is strictly after their deadline */
+	if (timercmp(&nexttime, &schedule_fake_time, >)) {
+		timeradd(&nexttime, &one_us, &schedule_fake_time);
+	}
+
+	NSLOG(schedule, DEBUG, "fake clock advanced to %lld:%ld",
+	      (long long)schedule_fake_time.tv_sec, schedule_fake_time.tv_usec);
+}
+
 void monkey_schedule_list(void)
 {
 	struct timeval tv;
 	struct nscallback *cur_nscb;
 
-	gettimeofday(&tv, NULL);
+	schedule_gettime(&tv);
 
 	NSLOG(netsurf, INFO, "schedule list at %lld:%ld",
 	      (long long)tv.tv_sec, tv.tv_usec);
@@ -40,6 +40,13 @@ nserror monkey_schedule(int tival, void (*callback)(void *p), void *p);
  */
 int monkey_schedule_run(void);
 
+/**
+ * Advance the fake clock to the next scheduled event.
+ *
+ * Does nothing unless the fake_clock option is set.
+ */
+void monkey_schedule_advance(void);
+
 /**
  * Log a list of all scheduled callbacks.
  */
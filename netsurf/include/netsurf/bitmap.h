@@ -101,6 +101,15 @@ struct content;
 struct bitmap;
 struct hlcache_handle;
 
+/** Statistics of a front end cache of scaled bitmaps. */
+struct bitmap_scale_cache_stats {
+	unsigned int hit_count; /**< plots using a cached scaled bitmap */
+	unsigned int miss_count; /**< plots which scaled a bitmap to cache */
+	unsigned int count; /**< number of scaled bitmaps held */
+	size_t size; /**< memory used by scaled bitmaps */
+	size_t limit; /**< memory limit of the cache */
+};
+
 /**
  * Set client bitmap format.
  *
@@ -206,6 +215,28 @@ struct gui_bitmap_table {
 	 * \param content The content to render.
 	 */
 	nserror (*render)(struct bitmap *bitmap, struct hlcache_handle *content);
+
+	/**
+	 * Get the memory used to store a bitmaps pixels.
+	 *
+	 * Optional, if not set the size is taken to be the row stride
+	 * multiplied by the height.
+	 *
+	 * \param bitmap The bitmap
+	 * \return The number of bytes used to store the pixels.
+	 */
+	size_t (*get_storage_size)(void *bitmap);
+
+	/**
+	 * Get statistics of a cache of scaled bitmaps.
+	 *
+	 * Optional, for front ends which keep copies of bitmaps scaled
+	 * to the size they are plotted at. If not set all the values
+	 * are zero.
+	 *
+	 * \param stats The statistics to fill in.
+	 */
+	void (*get_scale_cache_stats)(struct bitmap_scale_cache_stats *stats);
 };
 
 #endif
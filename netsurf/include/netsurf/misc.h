@@ -25,6 +25,8 @@
 #ifndef NETSURF_MISC_H_
 #define NETSURF_MISC_H_
 
+#include <stdbool.h>
+
 struct form_control;
 struct gui_window;
 struct cert_chain;
@@ -124,6 +126,17 @@ struct gui_misc_table {
 	 * \return NSERROR_OK on success
 	 */
 	nserror (*present_cookies)(const char *search_term);
+
+	/**
+	 * Mark the start or end of a document processing phase.
+	 *
+	 * Allows a frontend to time the stages of a page load such as
+	 * box conversion, layout and redraw.
+	 *
+	 * \param phase The name of the processing phase.
+	 * \param start true at the start of the phase, false at its end.
+	 */
+	void (*phase)(const char *phase, bool start);
 };
 
 #endif
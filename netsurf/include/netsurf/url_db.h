@@ -44,13 +44,17 @@ struct url_data {
 /**
  * Import an URL database from file, replacing any existing database
  *
+ * The file may be a snapshot written by urldb_save(), whose hosts are
+ * only read when first looked up, or a database in the older text
+ * format, which is read in full.
+ *
  * \param filename Name of file containing data
  */
 nserror urldb_load(const char *filename);
 
 
 /**
- * Export the current database to file
+ * Export the current database to a snapshot file
  *
  * \param filename Name of file to export to
  */
@@ -113,6 +113,44 @@ START_TEST(bloom_insert_empty_str_test)
 }
 END_TEST
 
+/**
+ * merge test
+ *
+ * A filter rebuilt from the stored bit array of another finds the
+ * entries of both.
+ */
+START_TEST(bloom_merge_test)
+{
+	struct bloom_filter *a, *b;
+	const uint8_t *data;
+	size_t size;
+
+	a = bloom_create(BLOOM_SIZE);
+	ck_assert(a != NULL);
+	b = bloom_create(BLOOM_SIZE);
+	ck_assert(b != NULL);
+
+	bloom_insert_str(a, "NetSurf", 7);
+	bloom_insert_str(b, "Browser", 7);
+
+	data = bloom_data(a, &size);
+	ck_assert(size == BLOOM_SIZE);
+	ck_assert(bloom_merge(b, data, size, bloom_items(a)));
+
+	ck_assert(bloom_search_str(b, "NetSurf", 7));
+	ck_assert(bloom_search_str(b, "Browser", 7));
+	ck_assert(!bloom_search_str(b, "NotSurf", 7));
+	ck_assert(bloom_items(b) == 2);
+
+	/* arrays from filters of another size are rejected */
+	ck_assert(!bloom_merge(b, data, size / 2, 1));
+	ck_assert(bloom_items(b) == 2);
+
+	bloom_destroy(a);
+	bloom_destroy(b);
+}
+END_TEST
+
 
 /**
  * Basic API creation test case
@@ -125,6 +163,7 @@ static TCase *bloom_api_case_create(void)
 
 	tcase_add_test(tc, bloom_create_test);
 	tcase_add_test(tc, bloom_insert_empty_str_test);
+	tcase_add_test(tc, bloom_merge_test);
 
 	return tc;
 }
@@ -33,6 +33,8 @@
 #include <string.h>
 #include <check.h>
 #include <limits.h>
+#include <stdint.h>
+#include <time.h>
 
 #include <libwapcaplet/libwapcaplet.h>
 
@@ -477,7 +479,10 @@ START_TEST(chain_add_all_twice_remove_all_iterate)
 }
 END_TEST
 
-#define CHAIN_TEST_MALLOC_COUNT_MAX 60
+/* Two allocations (key clone and value) for each of the 24 inserts, the
+ * entries themselves are held in the table allocated at creation.
+ */
+#define CHAIN_TEST_MALLOC_COUNT_MAX 48
 
 START_TEST(chain_add_all_remove_all_alloc)
 {
@@ -541,6 +546,173 @@ static TCase *chain_case_create(void)
 	return tc;
 }
 
+/* Table growth and throughput tests
+ *
+ * These use integer keys with a cheap hash so the time measured is
+ * that of the hashmap itself.
+ */
+
+static void *
+int_key_clone(void *key)
+{
+	return key;
+}
+
+static void
+int_key_destroy(void *key)
+{
+}
+
+static uint32_t
+int_key_hash(void *key)
+{
+	uint32_t hash = (uint32_t)(uintptr_t)key * 2654435761u;
+	return hash ^ (hash >> 16);
+}
+
+static bool
+int_key_eq(void *key1, void *key2)
+{
+	return key1 == key2;
+}
+
+static void *
+int_value_alloc(void *key)
+{
+	return key;
+}
+
+static void
+int_value_destroy(void *value)
+{
+}
+
+static hashmap_parameters_t int_params = {
+	.key_clone = int_key_clone,
+	.key_hash = int_key_hash,
+	.key_eq = int_key_eq,
+	.key_destroy = int_key_destroy,
+	.value_alloc = int_value_alloc,
+	.value_destroy = int_value_destroy,
+};
+
+/** make a non NULL integer key */
+#define INT_KEY(n) ((void *)(uintptr_t)((n) + 1))
+
+#define GROW_TEST_ENTRIES 20000
+
+START_TEST(grow_insert_lookup_remove)
+{
+	hashmap_t *map;
+	size_t idx;
+	size_t check;
+
+	map = hashmap_create(&int_params);
+	ck_assert(map != NULL);
+
+	/* every entry remains reachable while the table is resized */
+	for (idx = 0; idx < GROW_TEST_ENTRIES; idx++) {
+		ck_assert(hashmap_insert(map, INT_KEY(idx)) == INT_KEY(idx));
+		ck_assert_int_eq(hashmap_count(map), idx + 1);
+		for (check = 0; check <= idx; check += 97) {
+			ck_assert(hashmap_lookup(map, INT_KEY(check)) ==
+				  INT_KEY(check));
+		}
+		ck_assert(hashmap_lookup(map, INT_KEY(idx + 1)) == NULL);
+	}
+
+	iteration_counter = 0;
+	iteration_stop = 0;
+	ck_assert(hashmap_iterate(map, hashmap_test_iterator_cb, &iteration_ctx) == false);
+	ck_assert_int_eq(iteration_counter, GROW_TEST_ENTRIES);
+
+	/* remove every other entry */
+	for (idx = 0; idx < GROW_TEST_ENTRIES; idx += 2) {
+		ck_assert(hashmap_remove(map, INT_KEY(idx)) == true);
+		ck_assert(hashmap_remove(map, INT_KEY(idx)) == false);
+	}
+	ck_assert_int_eq(hashmap_count(map), GROW_TEST_ENTRIES / 2);
+
+	for (idx = 0; idx < GROW_TEST_ENTRIES; idx++) {
+		if (idx & 1) {
+			ck_assert(hashmap_lookup(map, INT_KEY(idx)) ==
+				  INT_KEY(idx));
+		} else {
+			ck_assert(hashmap_lookup(map, INT_KEY(idx)) == NULL);
+		}
+	}
+
+	hashmap_destroy(map);
+}
+END_TEST
+
+/** entry counts the throughput benchmark is run at */
+static const size_t bench_entries[] = { 1000, 100000, 1000000 };
+
+static double
+bench_ms(clock_t start)
+{
+	return (double)(clock() - start) * 1000 / CLOCKS_PER_SEC;
+}
+
+START_TEST(throughput_bench)
+{
+	size_t entries = bench_entries[_i];
+	hashmap_t *map;
+	size_t idx;
+	clock_t start;
+	double insert_ms, hit_ms, miss_ms, remove_ms;
+
+	map = hashmap_create(&int_params);
+	ck_assert(map != NULL);
+
+	start = clock();
+	for (idx = 0; idx < entries; idx++) {
+		ck_assert(hashmap_insert(map, INT_KEY(idx)) != NULL);
+	}
+	insert_ms = bench_ms(start);
+
+	start = clock();
+	for (idx = 0; idx < entries; idx++) {
+		ck_assert(hashmap_lookup(map, INT_KEY(idx)) != NULL);
+	}
+	hit_ms = bench_ms(start);
+
+	start = clock();
+	for (idx = entries; idx < (entries * 2); idx++) {
+		ck_assert(hashmap_lookup(map, INT_KEY(idx)) == NULL);
+	}
+	miss_ms = bench_ms(start);
+
+	start = clock();
+	for (idx = 0; idx < entries; idx++) {
+		ck_assert(hashmap_remove(map, INT_KEY(idx)) == true);
+	}
+	remove_ms = bench_ms(start);
+
+	ck_assert_int_eq(hashmap_count(map), 0);
+	hashmap_destroy(map);
+
+	printf("%zu entries: insert %.2fms lookup hit %.2fms "
+	       "lookup miss %.2fms remove %.2fms\n",
+	       entries, insert_ms, hit_ms, miss_ms, remove_ms);
+}
+END_TEST
+
+static TCase *throughput_case_create(void)
+{
+	TCase *tc;
+	tc = tcase_create("Growth and throughput");
+
+	tcase_set_timeout(tc, 60);
+
+	tcase_add_test(tc, grow_insert_lookup_remove);
+	tcase_add_loop_test(tc, throughput_bench, 0,
+			    sizeof(bench_entries) / sizeof(bench_entries[0]));
+
+	return tc;
+}
+
 /*
  * hashmap test suite creation
  */
@@ -551,6 +723,7 @@ static Suite *hashmap_suite_create(void)
 
 	suite_add_tcase(s, basic_api_case_create());
 	suite_add_tcase(s, chain_case_create());
+	suite_add_tcase(s, throughput_case_create());
 
 	return s;
 }
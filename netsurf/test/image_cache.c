@@ -0,0 +1,519 @@
+/*
+ * Copyright 2026 NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Tests and lookup benchmark for the image cache.
+ *
+ * Bitmaps are replaced with stubs which record only their size.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <check.h>
+
+#include "utils/errors.h"
+#include "netsurf/bitmap.h"
+#include "netsurf/misc.h"
+#include "netsurf/content.h"
+#include "utils/nsurl.h"
+#include "content/llcache.h"
+#include "content/content_protected.h"
+#include "desktop/gui_table.h"
+#include "image/image_cache.h"
+#include "image/image.h"
+
+/** number of images the cache is populated with in the benchmark */
+#define BENCH_IMAGES 10000
+
+/** width and height of test images */
+#define IMAGE_SIZE 16
+
+/** storage used by a test image */
+#define IMAGE_BYTES (IMAGE_SIZE * IMAGE_SIZE * 4)
+
+/** background clean interval used by the tests */
+#define CLEAN_TIME 100
+
+/******************************************************************************
+ * Stubs for the interfaces the image cache uses                              *
+ ******************************************************************************/
+
+/** stub bitmap */
+struct bitmap {
+	int width;
+	int height;
+};
+
+/** count of bitmaps which currently exist */
+static int bitmap_count;
+
+static void *test_bitmap_create(int width, int height,
+				enum gui_bitmap_flags flags)
+{
+	struct bitmap *bitmap;
+
+	bitmap = malloc(sizeof(struct bitmap));
+	if (bitmap != NULL) {
+		bitmap->width = width;
+		bitmap->height = height;
+		bitmap_count++;
+	}
+	return bitmap;
+}
+
+static void test_bitmap_destroy(void *bitmap)
+{
+	bitmap_count--;
+	free(bitmap);
+}
+
+static bool test_bitmap_get_opaque(void *bitmap)
+{
+	return true;
+}
+
+static size_t test_bitmap_get_rowstride(void *bitmap)
+{
+	return IMAGE_SIZE * 4;
+}
+
+static int test_bitmap_get_width(void *bitmap)
+{
+	return ((struct bitmap *)bitmap)->width;
+}
+
+static int test_bitmap_get_height(void *bitmap)
+{
+	return ((struct bitmap *)bitmap)->height;
+}
+
+static size_t test_bitmap_get_storage_size(void *bitmap)
+{
+	struct bitmap *b = bitmap;
+	return b->width * b->height * 4;
+}
+
+static void
+test_bitmap_get_scale_cache_stats(struct bitmap_scale_cache_stats *stats)
+{
+	stats->hit_count = 3;
+	stats->miss_count = 1;
+	stats->count = 1;
+	stats->size = 4096;
+	stats->limit = 65536;
+}
+
+static struct gui_bitmap_table test_bitmap_table = {
+	.create = test_bitmap_create,
+	.destroy = test_bitmap_destroy,
+	.get_opaque = test_bitmap_get_opaque,
+	.get_rowstride = test_bitmap_get_rowstride,
+	.get_width = test_bitmap_get_width,
+	.get_height = test_bitmap_get_height,
+	.get_storage_size = test_bitmap_get_storage_size,
+	.get_scale_cache_stats = test_bitmap_get_scale_cache_stats,
+};
+
+/** scheduled background cache update */
+static void (*schedule_cb)(void *p);
+static void *schedule_cb_p;
+
+static nserror test_schedule(int t, void (*callback)(void *p), void *p)
+{
+	if (t < 0) {
+		schedule_cb = NULL;
+	} else {
+		schedule_cb = callback;
+		schedule_cb_p = p;
+	}
+	return NSERROR_OK;
+}
+
+static struct gui_misc_table test_misc_table = {
+	.schedule = test_schedule,
+};
+
+static struct netsurf_table test_table = {
+	.misc = &test_misc_table,
+	.bitmap = &test_bitmap_table,
+};
+
+struct netsurf_table *guit = &test_table;
+
+/* content/llcache.h */
+nsurl *llcache_handle_get_url(const llcache_handle *handle)
+{
+	return NULL;
+}
+
+/* image/image.h */
+bool image_bitmap_plot(struct bitmap *bitmap,
+		       struct content_redraw_data *data,
+		       const struct rect *clip,
+		       const struct redraw_context *ctx)
+{
+	return true;
+}
+
+/******************************************************************************
+ * Fixtures                                                                   *
+ ******************************************************************************/
+
+static struct content contents[BENCH_IMAGES];
+
+static struct bitmap *test_convert(struct content *c)
+{
+	return test_bitmap_create(c->width, c->height, BITMAP_OPAQUE);
+}
+
+static struct bitmap *test_convert_scaled(struct content *c)
+{
+	int width, height;
+
+	image_cache_decode_size(c, &width, &height);
+
+	return test_bitmap_create(width, height, BITMAP_OPAQUE);
+}
+
+static void image_cache_fixture_create(void)
+{
+	struct image_cache_parameters params = {
+		.bg_clean_time = CLEAN_TIME,
+		.limit = 8 * IMAGE_BYTES,
+		.hysteresis = 2 * IMAGE_BYTES,
+		.speculative_small = 0,
+	};
+	unsigned int idx;
+
+	ck_assert(image_cache_init(&params) == NSERROR_OK);
+	ck_assert(schedule_cb != NULL);
+
+	for (idx = 0; idx < BENCH_IMAGES; idx++) {
+		memset(&contents[idx], 0, sizeof(struct content));
+		contents[idx].width = IMAGE_SIZE;
+		contents[idx].height = IMAGE_SIZE;
+		contents[idx].size = IMAGE_BYTES;
+	}
+}
+
+static void image_cache_fixture_teardown(void)
+{
+	ck_assert(image_cache_fini() == NSERROR_OK);
+	ck_assert_int_eq(bitmap_count, 0);
+}
+
+/**
+ * run the background cache update
+ */
+static void background_update(void)
+{
+	schedule_cb(schedule_cb_p);
+}
+
+/**
+ * redraw an image through the cache at a size
+ */
+static bool redraw_at(unsigned int idx, int width, int height)
+{
+	struct content_redraw_data data = {
+		.width = width,
+		.height = height,
+	};
+
+	return image_cache_redraw(&contents[idx], &data, NULL, NULL);
+}
+
+/**
+ * redraw an image through the cache at its own size
+ */
+static bool redraw(unsigned int idx)
+{
+	return redraw_at(idx, IMAGE_SIZE, IMAGE_SIZE);
+}
+
+/******************************************************************************
+ * Tests                                                                      *
+ ******************************************************************************/
+
+START_TEST(image_cache_find_entry)
+{
+	struct bitmap *bitmap;
+
+	bitmap = test_convert(&contents[0]);
+	ck_assert(image_cache_add(&contents[0], bitmap,
+				  test_convert) == NSERROR_OK);
+	ck_assert(image_cache_add(&contents[1], NULL,
+				  test_convert) == NSERROR_OK);
+
+	ck_assert(image_cache_find_bitmap(&contents[0]) == bitmap);
+	ck_assert(image_cache_find_bitmap(&contents[1]) == NULL);
+	ck_assert(image_cache_find_bitmap(&contents[2]) == NULL);
+
+	/* a miss converts the content */
+	ck_assert(image_cache_get_bitmap(&contents[1]) != NULL);
+	ck_assert_int_eq(bitmap_count, 2);
+
+	ck_assert(image_cache_remove(&contents[0]) == NSERROR_OK);
+	ck_assert(image_cache_remove(&contents[0]) == NSERROR_NOT_FOUND);
+	ck_assert(image_cache_find_bitmap(&contents[1]) != NULL);
+	ck_assert_int_eq(bitmap_count, 1);
+}
+END_TEST
+
+START_TEST(image_cache_enumerate_entries)
+{
+	char buffer[64];
+	unsigned int idx;
+
+	for (idx = 0; idx < 100; idx++) {
+		ck_assert(image_cache_add(&contents[idx], NULL,
+					  test_convert) == NSERROR_OK);
+	}
+
+	for (idx = 0; idx < 100; idx++) {
+		ck_assert_int_gt(image_cache_snentryf(buffer, sizeof(buffer),
+						      idx, "%e"), 0);
+		ck_assert_int_eq(atoi(buffer), idx);
+	}
+	ck_assert_int_eq(image_cache_snentryf(buffer, sizeof(buffer),
+					      100, "%e"), -1);
+
+	/* enumeration restarts after entries change */
+	ck_assert(image_cache_remove(&contents[99]) == NSERROR_OK);
+	ck_assert_int_gt(image_cache_snentryf(buffer, sizeof(buffer),
+					      98, "%e"), 0);
+	ck_assert_int_eq(image_cache_snentryf(buffer, sizeof(buffer),
+					      99, "%e"), -1);
+}
+END_TEST
+
+START_TEST(image_cache_summary_scale_stats)
+{
+	char buffer[64];
+
+	image_cache_snsummaryf(buffer, sizeof(buffer),
+			       "%A/%B %pA%%/%pB%% %C %D %E");
+	ck_assert_str_eq(buffer, "3/1 75%/25% 1 4096 65536");
+}
+END_TEST
+
+START_TEST(image_cache_clean_lru)
+{
+	unsigned int idx;
+
+	for (idx = 0; idx < 12; idx++) {
+		ck_assert(image_cache_add(&contents[idx], NULL,
+					  test_convert) == NSERROR_OK);
+		ck_assert(redraw(idx));
+	}
+	ck_assert_int_eq(bitmap_count, 12);
+
+	/* age every bitmap beyond the clean time, then use the first two */
+	background_update();
+	background_update();
+	ck_assert(redraw(0));
+	ck_assert(redraw(1));
+	background_update();
+
+	/* least recently used are freed until within the hysteresis */
+	ck_assert_int_eq(bitmap_count, 6);
+	ck_assert(image_cache_find_bitmap(&contents[0]) != NULL);
+	ck_assert(image_cache_find_bitmap(&contents[1]) != NULL);
+	for (idx = 2; idx < 8; idx++) {
+		ck_assert(image_cache_find_bitmap(&contents[idx]) == NULL);
+	}
+	for (idx = 8; idx < 12; idx++) {
+		ck_assert(image_cache_find_bitmap(&contents[idx]) != NULL);
+	}
+
+	/* a freed bitmap is converted again when required */
+	ck_assert(redraw(2));
+	ck_assert_int_eq(bitmap_count, 7);
+}
+END_TEST
+
+START_TEST(image_cache_clean_keeps_recent)
+{
+	unsigned int idx;
+
+	for (idx = 0; idx < 12; idx++) {
+		ck_assert(image_cache_add(&contents[idx], NULL,
+					  test_convert) == NSERROR_OK);
+		ck_assert(redraw(idx));
+	}
+
+	/* bitmaps used within the clean time are kept over the limit */
+	background_update();
+	for (idx = 0; idx < 12; idx++) {
+		ck_assert(redraw(idx));
+	}
+	background_update();
+	ck_assert_int_eq(bitmap_count, 12);
+}
+END_TEST
+
+START_TEST(image_cache_scaled_convert)
+{
+	struct bitmap *bitmap;
+
+	ck_assert(image_cache_add_scalable(&contents[0],
+					   test_convert_scaled) == NSERROR_OK);
+
+	/* converted at the displayed size */
+	ck_assert(redraw_at(0, 4, 2));
+	bitmap = image_cache_find_bitmap(&contents[0]);
+	ck_assert(bitmap != NULL);
+	ck_assert_int_eq(bitmap->width, 4);
+	ck_assert_int_eq(bitmap->height, 2);
+
+	/* smaller redraws reuse the bitmap */
+	ck_assert(redraw_at(0, 2, 1));
+	ck_assert(image_cache_find_bitmap(&contents[0]) == bitmap);
+
+	/* larger redraws convert again limited to the content size */
+	ck_assert(redraw_at(0, 8, IMAGE_SIZE * 4));
+	bitmap = image_cache_find_bitmap(&contents[0]);
+	ck_assert_int_eq(bitmap->width, 8);
+	ck_assert_int_eq(bitmap->height, IMAGE_SIZE);
+	ck_assert_int_eq(bitmap_count, 1);
+
+	/* direct use of the bitmap requires the full size */
+	bitmap = image_cache_get_bitmap(&contents[0]);
+	ck_assert_int_eq(bitmap->width, IMAGE_SIZE);
+	ck_assert_int_eq(bitmap->height, IMAGE_SIZE);
+	ck_assert_int_eq(bitmap_count, 1);
+}
+END_TEST
+
+START_TEST(image_cache_vector_convert)
+{
+	struct bitmap *bitmap;
+
+	ck_assert(image_cache_add_vector(&contents[0],
+					 test_convert_scaled) == NSERROR_OK);
+
+	/* no speculative conversion as the size is not known */
+	ck_assert(image_cache_find_bitmap(&contents[0]) == NULL);
+
+	/* rasterised at the displayed size, even beyond the content size */
+	ck_assert(redraw_at(0, IMAGE_SIZE * 2, 3));
+	bitmap = image_cache_find_bitmap(&contents[0]);
+	ck_assert(bitmap != NULL);
+	ck_assert_int_eq(bitmap->width, IMAGE_SIZE * 2);
+	ck_assert_int_eq(bitmap->height, 3);
+
+	/* redraws at the same size reuse the bitmap */
+	ck_assert(redraw_at(0, IMAGE_SIZE * 2, 3));
+	ck_assert(image_cache_find_bitmap(&contents[0]) == bitmap);
+
+	/* direct use of the bitmap keeps the current raster */
+	ck_assert(image_cache_get_bitmap(&contents[0]) == bitmap);
+
+	/* any change of scale rasterises again */
+	ck_assert(redraw_at(0, 2, 1));
+	bitmap = image_cache_find_bitmap(&contents[0]);
+	ck_assert_int_eq(bitmap->width, 2);
+	ck_assert_int_eq(bitmap->height, 1);
+	ck_assert_int_eq(bitmap_count, 1);
+}
+END_TEST
+
+START_TEST(image_cache_redraw_bench)
+{
+	unsigned int idx;
+	clock_t start;
+	clock_t add_time;
+	clock_t redraw_time;
+
+	start = clock();
+	for (idx = 0; idx < BENCH_IMAGES; idx++) {
+		ck_assert(image_cache_add(&contents[idx], NULL,
+					  test_convert) == NSERROR_OK);
+	}
+	add_time = clock() - start;
+
+	start = clock();
+	for (idx = 0; idx < BENCH_IMAGES; idx++) {
+		ck_assert(redraw(idx));
+	}
+	for (idx = 0; idx < BENCH_IMAGES; idx++) {
+		ck_assert(redraw(idx));
+	}
+	redraw_time = clock() - start;
+
+	ck_assert_int_eq(bitmap_count, BENCH_IMAGES);
+
+	printf("%d images: add %.2fms redraw twice %.2fms\n",
+	       BENCH_IMAGES,
+	       (double)add_time * 1000 / CLOCKS_PER_SEC,
+	       (double)redraw_time * 1000 / CLOCKS_PER_SEC);
+}
+END_TEST
+
+static TCase *image_cache_case_create(void)
+{
+	TCase *tc;
+	tc = tcase_create("Cache");
+
+	tcase_add_checked_fixture(tc,
+				  image_cache_fixture_create,
+				  image_cache_fixture_teardown);
+
+	tcase_add_test(tc, image_cache_find_entry);
+	tcase_add_test(tc, image_cache_enumerate_entries);
+	tcase_add_test(tc, image_cache_summary_scale_stats);
+	tcase_add_test(tc, image_cache_clean_lru);
+	tcase_add_test(tc, image_cache_clean_keeps_recent);
+	tcase_add_test(tc, image_cache_scaled_convert);
+	tcase_add_test(tc, image_cache_vector_convert);
+	tcase_add_test(tc, image_cache_redraw_bench);
+
+	return tc;
+}
+
+/*
+ * image cache test suite creation
+ */
+static Suite *image_cache_suite_create(void)
+{
+	Suite *s;
+	s = suite_create("Image cache");
+
+	suite_add_tcase(s, image_cache_case_create());
+
+	return s;
+}
+
+int main(int argc, char **argv)
+{
+	int number_failed;
+	SRunner *sr;
+
+	sr = srunner_create(image_cache_suite_create());
+
+	srunner_run_all(sr, CK_ENV);
+
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -16,345 +16,438 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+/**
+ * \file
+ * Tests and lookup benchmark for the low level cache.
+ *
+ * The fetch layer is replaced with stubs which start fetches that
+ * never progress so objects remain in the cache while it is
+ * populated.
+ */
+
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <check.h>
+
+#include <libwapcaplet/libwapcaplet.h>
 
+#include "utils/errors.h"
+#include "utils/corestrings.h"
+#include "utils/nsoption.h"
+#include "utils/nsurl.h"
+#include "netsurf/misc.h"
+#include "netsurf/ssl_certs.h"
 #include "content/fetch.h"
+#include "content/urldb.h"
+#include "content/backing_store.h"
 #include "content/llcache.h"
-#include "utils/ring.h"
-#include "utils/nsurl.h"
-#include "utils/url.h"
-#include "utils/corestrings.h"
-#include "utils/utils.h"
+#include "desktop/gui_table.h"
+
+/** number of objects the cache is populated with in the benchmark */
+#define BENCH_OBJECTS 10000
 
 /******************************************************************************
- * Things that we'd reasonably expect to have to implement                    *
+ * Stubs for the interfaces the low level cache uses                          *
  ******************************************************************************/
 
-bool verbose_log;
-
-/* utils/utils.h */
-char *filename_from_path(char *path)
+/* utils/log.h */
+nserror nslog_set_filter_by_options(void)
 {
-	char *leafname;
+	return NSERROR_OK;
+}
 
-	leafname = strrchr(path, '/');
-	if (!leafname)
-		leafname = path;
-	else
-		leafname += 1;
+/** count of fetches started */
+static unsigned int fetch_count;
 
-	return strdup(leafname);
-}
+/** fake fetch handle handed back to the cache */
+static int fake_fetch;
+
+/** callback of the most recently started fetch */
+static fetch_callback fetch_cb;
+
+/** context of the most recently started fetch */
+static void *fetch_cb_p;
 
-/* utils/schedule.h */
-void schedule(int t, schedule_callback_fn cb, void *pw)
+/* content/fetch.h */
+nserror fetch_start(nsurl *url, nsurl *referer, fetch_callback callback,
+		    void *p, bool only_2xx, const char *post_urlenc,
+		    const struct fetch_multipart_data *post_multipart,
+		    bool verifiable, bool downgrade_tls,
+		    const char *headers[], struct fetch **fetch_out)
 {
+	fetch_count++;
+	fetch_cb = callback;
+	fetch_cb_p = p;
+	*fetch_out = (struct fetch *)&fake_fetch;
+	return NSERROR_OK;
 }
 
-/* utils/schedule.h */
-void schedule_remove(schedule_callback_fn cb, void *pw)
+/* content/fetch.h */
+void fetch_abort(struct fetch *f)
 {
 }
 
 /* content/fetch.h */
-const char *fetch_filetype(const char *unix_path)
+bool fetch_can_fetch(const nsurl *url)
 {
-	return NULL;
+	return true;
 }
 
 /* content/fetch.h */
-char *fetch_mimetype(const char *ro_path)
+long fetch_http_code(struct fetch *fetch)
 {
-	return NULL;
+	return 200;
 }
 
-/* utils/url.h */
-char *path_to_url(const char *path)
+/* content/fetch.h */
+void fetch_multipart_data_destroy(struct fetch_multipart_data *list)
 {
-	int urllen = strlen(path) + FILE_SCHEME_PREFIX_LEN + 1;
-	char *url = malloc(urllen);
-
-	if (url == NULL) {
-		return NULL;
-	}
-
-	if (*path == '/') {
-		path++; /* file: paths are already absolute */
-	} 
-
-	snprintf(url, urllen, "%s%s", FILE_SCHEME_PREFIX, path);
-
-	return url;
 }
 
-/* utils/url.h */
-char *url_to_path(const char *url)
+/* content/fetch.h */
+struct fetch_multipart_data *
+fetch_multipart_data_clone(const struct fetch_multipart_data *list)
 {
-	char *url_path;
-	char *path = NULL;
-
-	if (url_unescape(url, 0, NULL, &url_path) == NSERROR_OK) {
-		/* return the absolute path including leading / */
-		path = strdup(url_path + (FILE_SCHEME_PREFIX_LEN - 1));
-		free(url_path);
-	}
-
-	return path;
+	return NULL;
 }
 
-/******************************************************************************
- * Things that are absolutely not reasonable, and should disappear            *
- ******************************************************************************/
+/* netsurf/ssl_certs.h */
+nserror cert_chain_alloc(size_t depth, struct cert_chain **chain_out)
+{
+	return NSERROR_NOMEM;
+}
 
-#include "desktop/cookie_manager.h"
+/* netsurf/ssl_certs.h */
+nserror cert_chain_dup(const struct cert_chain *src, struct cert_chain **dst_out)
+{
+	return NSERROR_NOMEM;
+}
 
-/* desktop/cookie_manager.h -- used by urldb 
- *
- * URLdb should have a cookies update event + handler registration
- */
-bool cookie_manager_add(const struct cookie_data *data)
+/* netsurf/ssl_certs.h */
+nserror cert_chain_free(struct cert_chain *chain)
 {
-	return true;
+	return NSERROR_OK;
 }
 
-/* desktop/cookie_manager.h -- used by urldb 
- *
- * URLdb should have a cookies removal handler registration
- */
-void cookie_manager_remove(const struct cookie_data *data)
+/* netsurf/ssl_certs.h */
+size_t cert_chain_size(const struct cert_chain *chain)
 {
+	return 0;
 }
 
-/* image/bitmap.h -- used by urldb 
- *
- * URLdb shouldn't care about bitmaps. 
- * This is because the legacy RO thumbnail stuff was hacked in and must die.
- */
-void bitmap_destroy(void *bitmap)
+/* content/urldb.h */
+const char *urldb_get_auth_details(nsurl *url, const char *realm)
 {
+	return NULL;
 }
-/* image/image.h -- used by urldb 
- *
- * URLdb shouldn't care about bitmaps. 
- * This is because the legacy RO thumbnail stuff was hacked in and must die.
- */
-bool image_bitmap_plot(struct bitmap *bitmap, struct content_redraw_data *data, 
-		const struct rect *clip, const struct redraw_context *ctx)
+
+/* content/urldb.h */
+bool urldb_set_hsts_policy(struct nsurl *url, const char *header)
 {
 	return true;
 }
 
-/* content/fetchers/fetch_file.h -- used by fetcher core
- *
- * Simpler to stub this than haul in all the file fetcher's dependencies
- */
-void fetch_file_register(void)
+/* content/urldb.h */
+bool urldb_get_hsts_enabled(struct nsurl *url)
 {
+	return false;
 }
 
+static nserror test_schedule(int t, void (*callback)(void *p), void *p)
+{
+	return NSERROR_OK;
+}
 
-/******************************************************************************
- * test: protocol handler                                                     *
- ******************************************************************************/
+static struct gui_misc_table test_misc_table = {
+	.schedule = test_schedule,
+};
 
-typedef struct test_context {
-	struct fetch *parent;
+static struct netsurf_table test_table = {
+	.misc = &test_misc_table,
+};
 
-	bool aborted;
-	bool locked;
+struct netsurf_table *guit = &test_table;
 
-	struct test_context *r_prev;
-	struct test_context *r_next;
-} test_context;
+/******************************************************************************
+ * Fixtures                                                                   *
+ ******************************************************************************/
 
-static test_context *ring;
+static nsurl *urls[BENCH_OBJECTS];
+static llcache_handle *handles[BENCH_OBJECTS];
+static llcache_handle *handles2[BENCH_OBJECTS];
 
-bool test_initialise(lwc_string *scheme)
+static nserror event_handler(llcache_handle *handle,
+			     const llcache_event *event,
+			     void *pw)
 {
-	/* Nothing to do */
-	return true;
+	return NSERROR_OK;
 }
 
-bool test_can_fetch(const nsurl *url)
+static void llcache_fixture_create(void)
 {
-	/* Nothing to do */
-	return true;
-}
+	struct llcache_parameters params;
+	char url[64];
+	unsigned int idx;
 
-void test_finalise(lwc_string *scheme)
-{
-	/* Nothing to do */
-}
+	ck_assert(nsoption_init(NULL, NULL, NULL) == NSERROR_OK);
+	ck_assert(corestrings_init() == NSERROR_OK);
 
-void *test_setup_fetch(struct fetch *parent, nsurl *url, bool only_2xx,
-		bool downgrade_tls, const char *post_urlenc,
-		const struct fetch_multipart_data *post_multipart,
-		const char **headers)
-{
-	test_context *ctx = calloc(1, sizeof(test_context));
+	test_table.llcache = null_llcache_table;
 
-	if (ctx == NULL)
-		return NULL;
+	memset(&params, 0, sizeof(params));
+	params.limit = 1024 * 1024;
+	params.fetch_attempts = 2;
 
-	ctx->parent = parent;
+	ck_assert(llcache_initialise(&params) == NSERROR_OK);
 
-	RING_INSERT(ring, ctx);
+	for (idx = 0; idx < BENCH_OBJECTS; idx++) {
+		snprintf(url, sizeof(url),
+			 "http://www%u.example.com/images/%u.png",
+			 idx % 97, idx);
+		ck_assert(nsurl_create(url, &urls[idx]) == NSERROR_OK);
+	}
 
-	return ctx;
+	memset(handles, 0, sizeof(handles));
+	memset(handles2, 0, sizeof(handles2));
+	fetch_count = 0;
+	fetch_cb = NULL;
+	fetch_cb_p = NULL;
 }
 
-bool test_start_fetch(void *handle)
+static void llcache_fixture_teardown(void)
 {
-	/* Nothing to do */
-	return true;
+	unsigned int idx;
+
+	for (idx = 0; idx < BENCH_OBJECTS; idx++) {
+		if (handles[idx] != NULL) {
+			llcache_handle_release(handles[idx]);
+		}
+		if (handles2[idx] != NULL) {
+			llcache_handle_release(handles2[idx]);
+		}
+		nsurl_unref(urls[idx]);
+	}
+
+	llcache_finalise();
+
+	corestrings_fini();
+	nsoption_finalise(nsoptions, nsoptions_default);
 }
 
-void test_abort_fetch(void *handle)
-{
-	test_context *ctx = handle;
+/******************************************************************************
+ * Tests                                                                      *
+ ******************************************************************************/
 
-	ctx->aborted = true;
+START_TEST(llcache_retrieve_same_object)
+{
+	ck_assert(llcache_handle_retrieve(urls[0], 0, NULL, NULL,
+					  event_handler, NULL,
+					  &handles[0]) == NSERROR_OK);
+	ck_assert(llcache_handle_retrieve(urls[1], 0, NULL, NULL,
+					  event_handler, NULL,
+					  &handles[1]) == NSERROR_OK);
+	ck_assert(llcache_handle_retrieve(urls[0], 0, NULL, NULL,
+					  event_handler, NULL,
+					  &handles2[0]) == NSERROR_OK);
+
+	/* an in progress fetch is fresh so is shared */
+	ck_assert(llcache_handle_references_same_object(handles[0],
+							handles2[0]));
+	ck_assert(!llcache_handle_references_same_object(handles[0],
+							 handles[1]));
+	ck_assert_int_eq(fetch_count, 2);
 }
+END_TEST
 
-void test_free_fetch(void *handle)
+START_TEST(llcache_retrieve_bench)
 {
-	test_context *ctx = handle;
+	unsigned int idx;
+	clock_t start;
+	clock_t populate_time;
+	clock_t lookup_time;
+
+	start = clock();
+	for (idx = 0; idx < BENCH_OBJECTS; idx++) {
+		ck_assert(llcache_handle_retrieve(urls[idx], 0, NULL, NULL,
+						  event_handler, NULL,
+						  &handles[idx]) == NSERROR_OK);
+	}
+	populate_time = clock() - start;
 
-	RING_REMOVE(ring, ctx);
+	start = clock();
+	for (idx = 0; idx < BENCH_OBJECTS; idx++) {
+		ck_assert(llcache_handle_retrieve(urls[idx], 0, NULL, NULL,
+						  event_handler, NULL,
+						  &handles2[idx]) == NSERROR_OK);
+	}
+	lookup_time = clock() - start;
+
+	ck_assert_int_eq(fetch_count, BENCH_OBJECTS);
+	for (idx = 0; idx < BENCH_OBJECTS; idx++) {
+		ck_assert(llcache_handle_references_same_object(handles[idx],
+								handles2[idx]));
+	}
 
-	free(ctx);
+	printf("%d objects: populate %.2fms lookup %.2fms\n",
+	       BENCH_OBJECTS,
+	       (double)populate_time * 1000 / CLOCKS_PER_SEC,
+	       (double)lookup_time * 1000 / CLOCKS_PER_SEC);
 }
+END_TEST
 
-void test_process(test_context *ctx)
+/**
+ * deliver data to the most recently started fetch in pieces
+ */
+static void fetch_deliver(const uint8_t *data, size_t len, size_t piece)
 {
-	/** \todo Implement */
+	fetch_msg msg;
+	size_t sent;
+
+	for (sent = 0; sent < len; sent += piece) {
+		msg.type = FETCH_DATA;
+		msg.data.header_or_data.buf = data + sent;
+		msg.data.header_or_data.len =
+			(len - sent) < piece ? (len - sent) : piece;
+		fetch_cb(&msg, fetch_cb_p);
+	}
+
+	msg.type = FETCH_FINISHED;
+	fetch_cb(&msg, fetch_cb_p);
 }
 
-void test_poll(lwc_string *scheme)
+START_TEST(llcache_source_chunks)
 {
-	test_context *ctx, *next;
-
-	if (ring == NULL)
-		return;
+	const size_t source_len = 200 * 1024;
+	uint8_t *source;
+	const uint8_t *run;
+	const uint8_t *flat;
+	size_t offset;
+	size_t len;
+	size_t idx;
+	unsigned int runs = 0;
+
+	source = malloc(source_len);
+	ck_assert(source != NULL);
+	for (idx = 0; idx < source_len; idx++) {
+		source[idx] = (uint8_t)(idx * 31);
+	}
 
-	ctx = ring;
-	do {
-		next = ctx->r_next;
+	ck_assert(llcache_handle_retrieve(urls[0], 0, NULL, NULL,
+					  event_handler, NULL,
+					  &handles[0]) == NSERROR_OK);
+	ck_assert(fetch_cb != NULL);
+
+	fetch_deliver(source, source_len, 1000);
+
+	/* source is read in place as several runs */
+	for (offset = 0;
+	     (run = llcache_handle_read_source_data(handles[0],
+						    offset, &len)) != NULL;
+	     offset += len) {
+		ck_assert_int_gt(len, 0);
+		ck_assert(memcmp(run, source + offset, len) == 0);
+		runs++;
+	}
+	ck_assert_uint_eq(offset, source_len);
+	ck_assert_uint_gt(runs, 1);
 
-		if (ctx->locked)
-			continue;
+	/* contiguous access flattens the source */
+	flat = llcache_handle_get_source_data(handles[0], &len);
+	ck_assert(flat != NULL);
+	ck_assert_uint_eq(len, source_len);
+	ck_assert(memcmp(flat, source, source_len) == 0);
 
-		if (ctx->aborted == false) {
-			test_process(ctx);
-		}
+	run = llcache_handle_read_source_data(handles[0], 0, &len);
+	ck_assert(run == flat);
+	ck_assert_uint_eq(len, source_len);
 
-		fetch_remove_from_queues(ctx->parent);
-		fetch_free(ctx->parent);
-	} while ((ctx = next) != ring && ring != NULL);
+	free(source);
 }
+END_TEST
 
-/******************************************************************************
- * The actual test code                                                       *
- ******************************************************************************/
-
-nserror query_handler(const llcache_query *query, void *pw,
-		llcache_query_response cb, void *cbpw)
+START_TEST(llcache_source_adopt)
 {
-	/* I'm too lazy to actually implement this. It should queue the query, 
-	 * then deliver the response from main(). */
+	const size_t source_len = 200 * 1024;
+	uint8_t *source;
+	const uint8_t *run;
+	fetch_msg msg;
+	size_t len;
+	size_t idx;
+
+	source = malloc(source_len);
+	ck_assert(source != NULL);
+	for (idx = 0; idx < source_len; idx++) {
+		source[idx] = (uint8_t)(idx * 31);
+	}
 
-	return NSERROR_OK;
-}
+	ck_assert(llcache_handle_retrieve(urls[0], 0, NULL, NULL,
+					  event_handler, NULL,
+					  &handles[0]) == NSERROR_OK);
+	ck_assert(fetch_cb != NULL);
 
-nserror event_handler(llcache_handle *handle, 
-		const llcache_event *event, void *pw)
-{
-	static char *event_names[] = {
-		"HAD_HEADERS", "HAD_DATA", "DONE", "ERROR", "PROGRESS"
-	};
-	bool *done = pw;
+	/* the cache takes the buffer instead of copying it */
+	msg.type = FETCH_DATA_ADOPT;
+	msg.data.header_or_data.buf = source;
+	msg.data.header_or_data.len = source_len;
+	fetch_cb(&msg, fetch_cb_p);
 
-	if (event->type != LLCACHE_EVENT_PROGRESS)
-		fprintf(stdout, "%p : %s\n", handle, event_names[event->type]);
+	msg.type = FETCH_FINISHED;
+	fetch_cb(&msg, fetch_cb_p);
 
-	/* Inform main() that the fetch completed */
-	if (event->type == LLCACHE_EVENT_DONE)
-		*done = true;
+	run = llcache_handle_read_source_data(handles[0], 0, &len);
+	ck_assert(run == source);
+	ck_assert_uint_eq(len, source_len);
 
-	return NSERROR_OK;
+	run = llcache_handle_get_source_data(handles[0], &len);
+	ck_assert(run == source);
+	ck_assert_uint_eq(len, source_len);
 }
+END_TEST
 
-int main(int argc, char **argv)
+static TCase *llcache_case_create(void)
 {
-	nserror error;
-	llcache_handle *handle;
-	llcache_handle *handle2;
-	lwc_string *scheme;
-	nsurl *url;
-	bool done = false;
-
-	/* Initialise subsystems */
-	fetch_init();
-
-	if (lwc_intern_string("test", SLEN("test"), &scheme) != lwc_error_ok) {
-		fprintf(stderr, "Failed to intern \"test\"\n");
-		return 1;
-	}
+	TCase *tc;
+	tc = tcase_create("Retrieve");
 
-	fetch_add_fetcher(scheme, test_initialise, test_can_fetch,
-			test_setup_fetch, test_start_fetch, test_abort_fetch,
-			test_free_fetch, test_poll, test_finalise);
+	tcase_add_checked_fixture(tc,
+				  llcache_fixture_create,
+				  llcache_fixture_teardown);
 
-	/* Initialise low-level cache */
-	error = llcache_initialise(query_handler, NULL, 1024 * 1024);
-	if (error != NSERROR_OK) {
-		fprintf(stderr, "llcache_initialise: %d\n", error);
-		return 1;
-	}
+	tcase_add_test(tc, llcache_retrieve_same_object);
+	tcase_add_test(tc, llcache_retrieve_bench);
+	tcase_add_test(tc, llcache_source_chunks);
+	tcase_add_test(tc, llcache_source_adopt);
 
-	if (nsurl_create("http://www.netsurf-browser.org", &url) != NSERROR_OK) {
-		fprintf(stderr, "Failed creating url\n");
-		return 1;
-	}
+	return tc;
+}
 
-	/* Retrieve an URL from the low-level cache (may trigger fetch) */
-	error = llcache_handle_retrieve(url, 
-			LLCACHE_RETRIEVE_VERIFIABLE, NULL, NULL,
-			event_handler, &done, &handle);
-	if (error != NSERROR_OK) {
-		fprintf(stderr, "llcache_handle_retrieve: %d\n", error);
-		return 1;
-	}
+/*
+ * llcache test suite creation
+ */
+static Suite *llcache_suite_create(void)
+{
+	Suite *s;
+	s = suite_create("llcache");
 
-	/* Poll relevant components */
-	while (done == false) {
-		llcache_poll();
-	}
+	suite_add_tcase(s, llcache_case_create());
 
-	done = false;
-	error = llcache_handle_retrieve(url,
-			LLCACHE_RETRIEVE_VERIFIABLE, NULL, NULL,
-			event_handler, &done, &handle2);
-	if (error != NSERROR_OK) {
-		fprintf(stderr, "llcache_handle_retrieve: %d\n", error);
-		return 1;
-	}
+	return s;
+}
 
-	while (done == false) {
-		llcache_poll();
-	}
+int main(int argc, char **argv)
+{
+	int number_failed;
+	SRunner *sr;
 
-	fprintf(stdout, "%p, %p -> %d\n", handle, handle2,
-			llcache_handle_references_same_object(handle, handle2));
+	sr = srunner_create(llcache_suite_create());
 
-	/* Cleanup */
-	llcache_handle_release(handle2);
-	llcache_handle_release(handle);
+	srunner_run_all(sr, CK_ENV);
 
-	fetch_quit();
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
 
-	return 0;
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
-
@@ -0,0 +1,237 @@
+#!/usr/bin/python3
+#
+# Copyright 2026 NetSurf Browser Project
+#
+# This file is part of NetSurf, http://www.netsurf-browser.org/
+#
+# NetSurf is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; version 2 of the License.
+#
+# NetSurf is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""
+benchmarks full page loads of local files using monkey
+
+Each page in the corpus is loaded in a fresh monkey instance running
+with a fake clock so timed callbacks do not wait in real time. The
+document processing phases reported by the core are timed and the
+results, along with the peak resident set size, are written as JSON.
+
+The number of plotter calls made by a first full redraw, a repeated
+full redraw and a redraw of a narrow strip of the window is also
+recorded, to show the cost of each frame independent of timing.
+
+If a baseline result file is given the run fails when the median total
+time of any page exceeds the baseline by more than the allowed margin.
+"""
+
+# pylint: disable=locally-disabled, missing-docstring
+
+import os
+import sys
+import getopt
+import json
+import statistics
+
+from monkeyfarmer import Browser
+
+
+class BenchBrowser(Browser):
+    def __init__(self, *args, **kwargs):
+        self.phases = []
+        super(BenchBrowser, self).__init__(*args, **kwargs)
+
+    def handle_GENERIC(self, what, *args):
+        if what == 'PHASE':
+            # START|END <phase> TIME <usec> MAXRSS <kb>
+            self.phases.append((args[0], args[1], int(args[3]), int(args[5])))
+        else:
+            super(BenchBrowser, self).handle_GENERIC(what, *args)
+
+
+def print_usage():
+    print('Usage:')
+    print('  ' + sys.argv[0] + ' -m <path to monkey> -p <page or directory> '
+          '[-n <runs>] [-o <output file>] [-b <baseline file>] '
+          '[-t <allowed regression percent>] [-w <wrapper arguments>]')
+
+
+def parse_argv(argv):
+    args = {
+        "monkey": '',
+        "pages": [],
+        "runs": 5,
+        "output": None,
+        "baseline": None,
+        "threshold": 10.0,
+        "wrapper": None,
+    }
+    try:
+        opts, _ = getopt.getopt(argv, "hm:p:n:o:b:t:w:",
+                                ["monkey=", "pages=", "runs=", "output=",
+                                 "baseline=", "threshold=", "wrapper="])
+    except getopt.GetoptError:
+        print_usage()
+        sys.exit(2)
+    for opt, arg in opts:
+        if opt == '-h':
+            print_usage()
+            sys.exit()
+        elif opt in ("-m", "--monkey"):
+            args["monkey"] = arg
+        elif opt in ("-p", "--pages"):
+            args["pages"].append(arg)
+        elif opt in ("-n", "--runs"):
+            args["runs"] = int(arg)
+        elif opt in ("-o", "--output"):
+            args["output"] = arg
+        elif opt in ("-b", "--baseline"):
+            args["baseline"] = arg
+        elif opt in ("-t", "--threshold"):
+            args["threshold"] = float(arg)
+        elif opt in ("-w", "--wrapper"):
+            if args["wrapper"] is None:
+                args["wrapper"] = []
+            args["wrapper"].extend(arg.split())
+
+    if args["monkey"] == '' or len(args["pages"]) == 0:
+        print_usage()
+        sys.exit(2)
+
+    return args
+
+
+def find_pages(paths):
+    pages = []
+    for path in paths:
+        if os.path.isdir(path):
+            for name in sorted(os.listdir(path)):
+                if name.endswith(".html"):
+                    pages.append(os.path.abspath(os.path.join(path, name)))
+        else:
+            pages.append(os.path.abspath(path))
+    return pages
+
+
+def phase_durations(phases):
+    """
+    pair phase start and end marks, summing the time spent in each phase
+    """
+    durations = {}
+    started = {}
+    for (mark, name, usec, _) in phases:
+        if mark == "START":
+            started[name] = usec
+        elif name in started:
+            durations[name] = durations.get(name, 0) + usec - started.pop(name)
+    return durations
+
+
+# clip rectangle of the strip redraw
+STRIP = ["0", "0", "800", "32"]
+
+
+def run_page(args, page):
+    browser = BenchBrowser(
+        monkey_cmd=[args["monkey"], "--fake_clock", "1"],
+        quiet=True,
+        wrapper=args["wrapper"])
+    assert browser.started
+
+    win = browser.new_window()
+    win.load_page("file://" + page)
+    plots = {
+        "first": len(win.redraw()),
+        "repeat": len(win.redraw()),
+        "strip": len(win.redraw(coords=STRIP)),
+    }
+    win.kill()
+    win.wait_until_dead()
+
+    browser.quit_and_wait()
+
+    phases = browser.phases
+    if len(phases) == 0:
+        raise RuntimeError("no phases reported loading {}".format(page))
+
+    return {
+        "phases": phase_durations(phases),
+        "total": phases[-1][2] - phases[0][2],
+        "maxrss": max(p[3] for p in phases),
+        "plots": plots,
+    }
+
+
+def summarise(runs):
+    names = sorted(set(name for run in runs for name in run["phases"]))
+    return {
+        "phases": {name: statistics.median(
+            [run["phases"].get(name, 0) for run in runs]) for name in names},
+        "total": statistics.median([run["total"] for run in runs]),
+        "maxrss": max(run["maxrss"] for run in runs),
+        "plots": {frame: statistics.median(
+            [run["plots"][frame] for run in runs]) for frame in runs[0]["plots"]},
+    }
+
+
+def check_baseline(results, path, threshold):
+    with open(path, 'r') as stream:
+        baseline = json.load(stream)
+
+    limit = 1.0 + (threshold / 100.0)
+    regressed = []
+    for (page, result) in results["pages"].items():
+        base = baseline["pages"].get(page, None)
+        if base is None:
+            continue
+        if result["median"]["total"] > base["median"]["total"] * limit:
+            regressed.append(page)
+            print("REGRESSION: {} took {}us against a baseline of {}us".format(
+                page, result["median"]["total"], base["median"]["total"]))
+    return regressed
+
+
+def main(argv):
+    args = parse_argv(argv)
+    results = {
+        "runs": args["runs"],
+        "units": {"time": "us", "maxrss": "KiB", "plots": "calls"},
+        "pages": {},
+    }
+
+    for page in find_pages(args["pages"]):
+        runs = [run_page(args, page) for _ in range(args["runs"])]
+        summary = summarise(runs)
+        results["pages"][os.path.basename(page)] = {
+            "runs": runs,
+            "median": summary,
+        }
+        print("{}: total {}us maxrss {}KiB {} plots {}".format(
+            os.path.basename(page), summary["total"], summary["maxrss"],
+            " ".join("{} {}us".format(name, usec)
+                     for (name, usec) in summary["phases"].items()),
+            " ".join("{} {}".format(frame, count)
+                     for (frame, count) in summary["plots"].items())))
+
+    if args["output"] is None:
+        json.dump(results, sys.stdout, indent=2, sort_keys=True)
+        print()
+    else:
+        with open(args["output"], 'w') as stream:
+            json.dump(results, stream, indent=2, sort_keys=True)
+
+    if args["baseline"] is not None:
+        if len(check_baseline(results, args["baseline"], args["threshold"])) > 0:
+            sys.exit(1)
+
+
+# Some python weirdness to get to main().
+if __name__ == "__main__":
+    main(sys.argv[1:])
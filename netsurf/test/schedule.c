@@ -0,0 +1,232 @@
+/*
+ * Copyright 2026 NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Tests and microbenchmark for the framebuffer scheduler.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <check.h>
+
+#include "utils/errors.h"
+#include "framebuffer/schedule.h"
+
+/** number of timers used in the benchmark */
+#define BENCH_TIMERS 10000
+
+/** count of times each context has been called */
+static unsigned int calls[BENCH_TIMERS];
+
+/** order callbacks were made in */
+static unsigned int call_order[BENCH_TIMERS];
+static unsigned int call_count;
+
+static void counting_cb(void *p)
+{
+	unsigned int *count = p;
+	(*count)++;
+	call_order[call_count++] = count - calls;
+}
+
+static void other_cb(void *p)
+{
+	counting_cb(p);
+}
+
+/**
+ * run the scheduler until nothing remains or the time limit is hit
+ */
+static void run_all(int limit_ms)
+{
+	struct timespec ts = { 0, 1000000 };
+	int next;
+
+	while (((next = schedule_run()) != -1) && (limit_ms-- > 0)) {
+		nanosleep(&ts, NULL);
+	}
+}
+
+static void fixture_setup(void)
+{
+	memset(calls, 0, sizeof(calls));
+	call_count = 0;
+}
+
+static void fixture_teardown(void)
+{
+	unsigned int idx;
+
+	/* ensure nothing is left scheduled for the next test */
+	for (idx = 0; idx < BENCH_TIMERS; idx++) {
+		framebuffer_schedule(-1, counting_cb, &calls[idx]);
+		framebuffer_schedule(-1, other_cb, &calls[idx]);
+	}
+}
+
+
+START_TEST(schedule_empty)
+{
+	ck_assert_int_eq(schedule_run(), -1);
+}
+END_TEST
+
+START_TEST(schedule_order)
+{
+	ck_assert(framebuffer_schedule(30, counting_cb, &calls[2]) == NSERROR_OK);
+	ck_assert(framebuffer_schedule(10, counting_cb, &calls[0]) == NSERROR_OK);
+	ck_assert(framebuffer_schedule(20, counting_cb, &calls[1]) == NSERROR_OK);
+
+	ck_assert_int_gt(schedule_run(), 0);
+
+	usleep(40000);
+
+	ck_assert_int_eq(schedule_run(), -1);
+	ck_assert_int_eq(call_count, 3);
+	ck_assert_int_eq(call_order[0], 0);
+	ck_assert_int_eq(call_order[1], 1);
+	ck_assert_int_eq(call_order[2], 2);
+}
+END_TEST
+
+START_TEST(schedule_reschedule_unique)
+{
+	ck_assert(framebuffer_schedule(10, counting_cb, &calls[0]) == NSERROR_OK);
+	ck_assert(framebuffer_schedule(0, counting_cb, &calls[0]) == NSERROR_OK);
+	ck_assert(framebuffer_schedule(0, other_cb, &calls[0]) == NSERROR_OK);
+
+	run_all(100);
+
+	/* rescheduling replaces the entry, different callbacks do not */
+	ck_assert_int_eq(calls[0], 2);
+}
+END_TEST
+
+START_TEST(schedule_remove_entry)
+{
+	ck_assert(framebuffer_schedule(0, counting_cb, &calls[0]) == NSERROR_OK);
+	ck_assert(framebuffer_schedule(0, counting_cb, &calls[1]) == NSERROR_OK);
+	ck_assert(framebuffer_schedule(-1, counting_cb, &calls[0]) == NSERROR_OK);
+
+	run_all(100);
+
+	ck_assert_int_eq(calls[0], 0);
+	ck_assert_int_eq(calls[1], 1);
+}
+END_TEST
+
+START_TEST(schedule_bench)
+{
+	unsigned int idx;
+	clock_t start;
+	clock_t add_time;
+	clock_t resched_time;
+	clock_t remove_time;
+	clock_t run_time;
+
+	start = clock();
+	for (idx = 0; idx < BENCH_TIMERS; idx++) {
+		ck_assert(framebuffer_schedule((idx * 7919) % 50,
+					       counting_cb,
+					       &calls[idx]) == NSERROR_OK);
+	}
+	add_time = clock() - start;
+
+	start = clock();
+	for (idx = 0; idx < BENCH_TIMERS; idx++) {
+		framebuffer_schedule((idx * 104729) % 50,
+				     counting_cb,
+				     &calls[idx]);
+	}
+	resched_time = clock() - start;
+
+	start = clock();
+	for (idx = 0; idx < BENCH_TIMERS; idx += 2) {
+		framebuffer_schedule(-1, counting_cb, &calls[idx]);
+	}
+	remove_time = clock() - start;
+
+	usleep(60000);
+
+	start = clock();
+	ck_assert_int_eq(schedule_run(), -1);
+	run_time = clock() - start;
+
+	ck_assert_int_eq(call_count, BENCH_TIMERS / 2);
+	for (idx = 0; idx < BENCH_TIMERS; idx++) {
+		ck_assert_int_eq(calls[idx], idx & 1);
+	}
+
+	printf("%d timers: add %.2fms reschedule %.2fms "
+	       "remove half %.2fms run %.2fms\n",
+	       BENCH_TIMERS,
+	       (double)add_time * 1000 / CLOCKS_PER_SEC,
+	       (double)resched_time * 1000 / CLOCKS_PER_SEC,
+	       (double)remove_time * 1000 / CLOCKS_PER_SEC,
+	       (double)run_time * 1000 / CLOCKS_PER_SEC);
+}
+END_TEST
+
+static TCase *schedule_case_create(void)
+{
+	TCase *tc;
+	tc = tcase_create("Scheduler");
+
+	tcase_add_checked_fixture(tc, fixture_setup, fixture_teardown);
+
+	tcase_add_test(tc, schedule_empty);
+	tcase_add_test(tc, schedule_order);
+	tcase_add_test(tc, schedule_reschedule_unique);
+	tcase_add_test(tc, schedule_remove_entry);
+	tcase_add_test(tc, schedule_bench);
+
+	return tc;
+}
+
+/*
+ * scheduler test suite creation
+ */
+static Suite *schedule_suite_create(void)
+{
+	Suite *s;
+	s = suite_create("Schedule");
+
+	suite_add_tcase(s, schedule_case_create());
+
+	return s;
+}
+
+int main(int argc, char **argv)
+{
+	int number_failed;
+	SRunner *sr;
+
+	sr = srunner_create(schedule_suite_create());
+
+	srunner_run_all(sr, CK_ENV);
+
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
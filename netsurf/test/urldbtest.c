@@ -48,7 +48,7 @@
  */
 const char *test_urldb_path = "test/data/urldb";
 /**
- * url database used as output reference
+ * url database holding the entries of the input which are saved
  */
 const char *test_urldb_out_path = "test/data/urldb-out";
 
@@ -569,6 +569,14 @@ static TCase *urldb_add_get_case_create(void)
 	return tc;
 }
 
+/**
+ * url iterator callback which visits every entry
+ */
+static bool urldb_session_snapshot_cb(nsurl *url, const struct url_data *data)
+{
+	return true;
+}
+
 /**
  * Session basic test case
  *
@@ -581,6 +589,8 @@ START_TEST(urldb_session_test)
 {
 	nserror res;
 	char *outnam;
+	char *urlnam;
+	char *refnam;
 
 	/* writing output requires options initialising */
 	res = nsoption_init(NULL, NULL, NULL);
@@ -592,16 +602,11 @@ START_TEST(urldb_session_test)
 	urldb_load_cookies(test_cookies_path);
 
 	/* write database out */
-	outnam = testnam(NULL);
-	res = urldb_save(outnam);
+	urlnam = strdup(testnam(NULL));
+	ck_assert(urlnam != NULL);
+	res = urldb_save(urlnam);
 	ck_assert_int_eq(res, NSERROR_OK);
 
-	/* check the url database file written and the test file match */
-	ck_assert_int_eq(cmp(outnam, test_urldb_out_path), 0);
-
-	/* remove test output */
-	unlink(outnam);
-
 	/* write cookies out */
 	outnam = testnam(NULL);
 	urldb_save_cookies(outnam);
@@ -612,6 +617,94 @@ START_TEST(urldb_session_test)
 	/* remove test output */
 	unlink(outnam);
 
+	/* write out the reference database */
+	urldb_destroy();
+	res = urldb_load(test_urldb_out_path);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	refnam = strdup(testnam(NULL));
+	ck_assert(refnam != NULL);
+	res = urldb_save(refnam);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	/* check the url database file written and the reference match */
+	ck_assert_int_eq(cmp(urlnam, refnam), 0);
+
+	/* remove urldb test output */
+	unlink(urlnam);
+	unlink(refnam);
+	free(urlnam);
+	free(refnam);
+
+	/* finalise options */
+	res = nsoption_finalise(NULL, NULL);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+}
+END_TEST
+
+/**
+ * Session snapshot test case
+ *
+ * A saved database is loaded back, looked up and saved again unchanged
+ */
+START_TEST(urldb_session_snapshot_test)
+{
+	nserror res;
+	char *outnam;
+	char *snapnam;
+	nsurl *url;
+	const struct url_data *data;
+
+	/* writing output requires options initialising */
+	res = nsoption_init(NULL, NULL, NULL);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	res = urldb_load(test_urldb_path);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	snapnam = strdup(testnam(NULL));
+	ck_assert(snapnam != NULL);
+	res = urldb_save(snapnam);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	/* load the snapshot */
+	urldb_destroy();
+	res = urldb_load(snapnam);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	/* entries are found */
+	url = make_url("https://en.wikipedia.org/wiki/Main_Page");
+	data = urldb_get_url_data(url);
+	ck_assert(data != NULL);
+	ck_assert_str_eq(data->title, "Wikipedia, the free encyclopedia");
+	ck_assert_int_eq(data->visits, 1);
+	nsurl_unref(url);
+
+	url = make_url("https://en.wikipedia.org/wiki/Not_Visited");
+	ck_assert(urldb_get_url_data(url) == NULL);
+	nsurl_unref(url);
+
+	/* saving again, with one host added, gives the same snapshot */
+	outnam = strdup(testnam(NULL));
+	ck_assert(outnam != NULL);
+	res = urldb_save(outnam);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	ck_assert_int_eq(cmp(outnam, snapnam), 0);
+
+	/* and once every host is added */
+	urldb_iterate_entries(urldb_session_snapshot_cb);
+	res = urldb_save(outnam);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	ck_assert_int_eq(cmp(outnam, snapnam), 0);
+
+	unlink(outnam);
+	unlink(snapnam);
+	free(outnam);
+	free(snapnam);
+
 	/* finalise options */
 	res = nsoption_finalise(NULL, NULL);
 	ck_assert_int_eq(res, NSERROR_OK);
@@ -705,6 +798,7 @@ static TCase *urldb_session_case_create(void)
 				  urldb_teardown);
 
 	tcase_add_test(tc, urldb_session_test);
+	tcase_add_test(tc, urldb_session_snapshot_test);
 	tcase_add_test(tc, urldb_session_add_test);
 
 	return tc;
@@ -109,3 +109,24 @@ uint32_t bloom_items(struct bloom_filter *b)
 	return b->items;
 }
 
+
+const uint8_t *bloom_data(struct bloom_filter *b, size_t *size)
+{
+	*size = b->size;
+	return b->filter;
+}
+
+bool bloom_merge(struct bloom_filter *b, const uint8_t *data, size_t size,
+		uint32_t items)
+{
+	size_t i;
+
+	if (size != b->size)
+		return false;
+
+	for (i = 0; i < size; i++)
+		b->filter[i] |= data[i];
+	b->items += items;
+
+	return true;
+}
@@ -96,4 +96,28 @@ bool bloom_search_hash(struct bloom_filter *b, uint32_t hash);
  */
 uint32_t bloom_items(struct bloom_filter *b);
 
+/**
+ * Get the bit array of a bloom filter so it may be stored.
+ *
+ * \param b Bloom filter to examine
+ * \param size Updated with the size of the bit array in bytes
+ *
+ * \return Pointer to the bit array
+ */
+const uint8_t *bloom_data(struct bloom_filter *b, size_t *size);
+
+/**
+ * Add the contents of a stored bit array to a bloom filter.  The
+ * array must have come from bloom_data() on a filter of the same size.
+ *
+ * \param b Bloom filter to add to
+ * \param data Bit array to merge
+ * \param size Size of bit array in bytes
+ * \param items Number of items the array was built from
+ *
+ * \return True on success, false if the sizes do not match
+ */
+bool bloom_merge(struct bloom_filter *b, const uint8_t *data, size_t size,
+		uint32_t items);
+
 #endif
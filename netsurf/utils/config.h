@@ -138,10 +138,16 @@ char *realpath(const char *path, char *resolved_path);
 #endif
 
 #define HAVE_MMAP
-#if (defined(_WIN32) || defined(__riscos__) || defined(__HAIKU__) || defined(__BEOS__) || defined(__amigaos4__) || defined(__AMIGA__) || defined(__MINT__))
+#if (defined(_WIN32) || defined(__riscos__) || defined(__HAIKU__) || defined(__BEOS__) || defined(__amigaos4__) || defined(__AMIGA__) || defined(__MINT__) || defined(__3DS__))
 #undef HAVE_MMAP
 #endif
 
+/* POSIX threads */
+#define HAVE_PTHREADS
+#if (defined(_WIN32) || defined(__riscos__) || defined(__amigaos4__) || defined(__AMIGA__) || defined(__MINT__))
+#undef HAVE_PTHREADS
+#endif
+
 #define HAVE_SCANDIR
 #if (defined(_WIN32) ||				\
      defined(__serenity__))
@@ -16,27 +16,69 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+/**
+ * \file
+ * Generic hashmap implementation.
+ *
+ * Entries are held in an open addressed table using Robin Hood
+ * hashing. Each slot stores the key hash alongside the key so probing
+ * and resizing never rehash keys.
+ *
+ * When the table becomes too full a table of twice the size is
+ * allocated and entries are moved across a few slots at a time as the
+ * map is modified. While this happens lookups search both tables.
+ */
+
 #include <stdlib.h>
 #include <string.h>
 
 #include "utils/hashmap.h"
 
 /**
- * The default number of buckets in the hashmaps we create.
+ * The initial number of slots in the hashmaps we create.
  */
-#define DEFAULT_HASHMAP_BUCKETS (4091)
+#define HASHMAP_INITIAL_SLOTS (64)
 
 /**
- * Hashmaps have chains of entries in buckets.
+ * Number of old table slots migrated for each modification while
+ * the map is being resized.
+ */
+#define HASHMAP_MIGRATE_STEP (16)
+
+/**
+ * Hashmap slot.
  */
 typedef struct hashmap_entry_s {
-	struct hashmap_entry_s **prevptr;
-	struct hashmap_entry_s *next;
 	void *key;
 	void *value;
 	uint32_t key_hash;
+	/**
+	 * Distance of the entry from its home slot plus one, zero if
+	 * the slot is empty.
+	 */
+	uint32_t probe;
 } hashmap_entry_t;
 
+/**
+ * An open addressed table of entries
+ */
+typedef struct hashmap_table_s {
+	/**
+	 * The slots of the table
+	 */
+	hashmap_entry_t *slots;
+
+	/**
+	 * The number of slots in the table (a power of two)
+	 */
+	uint32_t size;
+
+	/**
+	 * The number of entries in the table
+	 */
+	size_t count;
+} hashmap_table_t;
+
 /**
  * The content of a hashmap
  */
@@ -45,16 +87,22 @@ struct hashmap_s {
 	 * The parameters to be used for this hashmap
 	 */
 	hashmap_parameters_t *params;
-	
+
 	/**
-	 * The buckets for the hash chains
+	 * The table entries are added to
 	 */
-	hashmap_entry_t **buckets;
-	
+	hashmap_table_t table;
+
+	/**
+	 * The table being migrated from while resizing, slots is NULL
+	 * when not resizing.
+	 */
+	hashmap_table_t old;
+
 	/**
-	 * The number of buckets in this map
+	 * The next slot of the old table to migrate
 	 */
-	uint32_t bucket_count;
+	uint32_t migrate_slot;
 
 	/**
 	 * The number of entries in this map
@@ -62,6 +110,225 @@ struct hashmap_s {
 	size_t entry_count;
 };
 
+
+/**
+ * Allocate the slots of a table
+ *
+ * \param table The table to initialise
+ * \param size The number of slots (a power of two)
+ * \return true on success, false if allocation failed
+ */
+static bool
+hashmap_table_init(hashmap_table_t *table, uint32_t size)
+{
+	table->slots = malloc(size * sizeof(hashmap_entry_t));
+	if (table->slots == NULL) {
+		return false;
+	}
+
+	memset(table->slots, 0, size * sizeof(hashmap_entry_t));
+	table->size = size;
+	table->count = 0;
+
+	return true;
+}
+
+/**
+ * Check if a table has reached its maximum load factor of 80%
+ */
+static inline bool
+hashmap_table_full(hashmap_table_t *table)
+{
+	return ((table->count + 1) * 5) > ((size_t)table->size * 4);
+}
+
+/**
+ * Find the slot holding a key in a table
+ *
+ * \param hashmap The hashmap the table belongs to
+ * \param table The table to search
+ * \param key The key to search for
+ * \param hash The hash of the key
+ * \return The slot holding the key or NULL if not present
+ */
+static hashmap_entry_t *
+hashmap_table_find(hashmap_t *hashmap,
+		   hashmap_table_t *table,
+		   void *key,
+		   uint32_t hash)
+{
+	uint32_t mask = table->size - 1;
+	uint32_t slot = hash & mask;
+	uint32_t probe = 1;
+	hashmap_entry_t *entry;
+
+	for (;;) {
+		entry = &table->slots[slot];
+
+		/* Robin Hood ordering means the key cannot be further on
+		 * once a slot is closer to its home than the key would be
+		 */
+		if (entry->probe < probe) {
+			return NULL;
+		}
+
+		if ((entry->key_hash == hash) &&
+		    hashmap->params->key_eq(key, entry->key)) {
+			return entry;
+		}
+
+		slot = (slot + 1) & mask;
+		probe++;
+	}
+}
+
+/**
+ * Place an entry in a table
+ *
+ * The table must have at least one empty slot.
+ *
+ * \param table The table to insert into
+ * \param insert The entry to insert, its probe value is ignored
+ */
+static void
+hashmap_table_insert(hashmap_table_t *table, hashmap_entry_t insert)
+{
+	uint32_t mask = table->size - 1;
+	uint32_t slot = insert.key_hash & mask;
+	hashmap_entry_t *entry;
+	hashmap_entry_t displaced;
+
+	insert.probe = 1;
+
+	for (;;) {
+		entry = &table->slots[slot];
+
+		if (entry->probe == 0) {
+			*entry = insert;
+			table->count++;
+			return;
+		}
+
+		/* take the slot from entries nearer their home */
+		if (entry->probe < insert.probe) {
+			displaced = *entry;
+			*entry = insert;
+			insert = displaced;
+		}
+
+		slot = (slot + 1) & mask;
+		insert.probe++;
+	}
+}
+
+/**
+ * Remove an entry from a table
+ *
+ * Following entries are shifted back so no tombstones are required.
+ *
+ * \param table The table to remove from
+ * \param entry The slot to empty
+ */
+static void
+hashmap_table_remove(hashmap_table_t *table, hashmap_entry_t *entry)
+{
+	uint32_t mask = table->size - 1;
+	uint32_t slot = entry - table->slots;
+	hashmap_entry_t *next;
+
+	for (;;) {
+		next = &table->slots[(slot + 1) & mask];
+		if (next->probe <= 1) {
+			break;
+		}
+		*entry = *next;
+		entry->probe--;
+		entry = next;
+		slot = (slot + 1) & mask;
+	}
+
+	entry->probe = 0;
+	table->count--;
+}
+
+/**
+ * Move entries from the old table to the current one
+ *
+ * Entries are removed from the old table so it remains correctly
+ * ordered and can still be searched.
+ *
+ * \param hashmap The hashmap being resized
+ * \param steps The number of old table slots to empty
+ */
+static void
+hashmap_migrate(hashmap_t *hashmap, uint32_t steps)
+{
+	hashmap_entry_t *entry;
+
+	while ((hashmap->old.slots != NULL) && (steps-- > 0)) {
+		entry = &hashmap->old.slots[hashmap->migrate_slot];
+
+		/* removal may shift another entry into this slot */
+		while (entry->probe != 0) {
+			hashmap_table_insert(&hashmap->table, *entry);
+			hashmap_table_remove(&hashmap->old, entry);
+		}
+
+		hashmap->migrate_slot++;
+		if ((hashmap->migrate_slot == hashmap->old.size) ||
+		    (hashmap->old.count == 0)) {
+			free(hashmap->old.slots);
+			hashmap->old.slots = NULL;
+		}
+	}
+}
+
+/**
+ * Ensure the current table has room for another entry
+ *
+ * \param hashmap The hashmap to make room in
+ * \return true if there is room, false if allocation failed
+ */
+static bool
+hashmap_reserve(hashmap_t *hashmap)
+{
+	hashmap_table_t table;
+
+	if (!hashmap_table_full(&hashmap->table)) {
+		return true;
+	}
+
+	/* the current table cannot be replaced until it is the only one */
+	hashmap_migrate(hashmap, UINT32_MAX);
+
+	if (!hashmap_table_init(&table, hashmap->table.size * 2)) {
+		/* carry on at a higher load while there is space */
+		return hashmap->table.count < (hashmap->table.size - 1);
+	}
+
+	hashmap->old = hashmap->table;
+	hashmap->table = table;
+	hashmap->migrate_slot = 0;
+
+	return true;
+}
+
+/**
+ * Find the slot holding a key in either table
+ */
+static hashmap_entry_t *
+hashmap_find(hashmap_t *hashmap, void *key, uint32_t hash)
+{
+	hashmap_entry_t *entry;
+
+	entry = hashmap_table_find(hashmap, &hashmap->table, key, hash);
+	if ((entry == NULL) && (hashmap->old.slots != NULL)) {
+		entry = hashmap_table_find(hashmap, &hashmap->old, key, hash);
+	}
+
+	return entry;
+}
+
 /* Exported function, documented in hashmap.h */
 hashmap_t *
 hashmap_create(hashmap_parameters_t *params)
@@ -72,39 +339,49 @@ hashmap_create(hashmap_parameters_t *params)
 	}
 
 	ret->params = params;
-	ret->bucket_count = DEFAULT_HASHMAP_BUCKETS;
 	ret->entry_count = 0;
-	ret->buckets = malloc(ret->bucket_count * sizeof(hashmap_entry_t *));
+	ret->old.slots = NULL;
+	ret->migrate_slot = 0;
 
-	if (ret->buckets == NULL) {
+	if (!hashmap_table_init(&ret->table, HASHMAP_INITIAL_SLOTS)) {
 		free(ret);
 		return NULL;
 	}
 
-	memset(ret->buckets, 0, ret->bucket_count * sizeof(hashmap_entry_t *));
-
 	return ret;
 }
 
-/* Exported function, documented in hashmap.h */
-void
-hashmap_destroy(hashmap_t *hashmap)
+/**
+ * Destroy the entries of a table and free its slots
+ */
+static void
+hashmap_table_destroy(hashmap_t *hashmap, hashmap_table_t *table)
 {
-	uint32_t bucket;
+	uint32_t slot;
 	hashmap_entry_t *entry;
 
-	for (bucket = 0; bucket < hashmap->bucket_count; bucket++) {
-		for (entry = hashmap->buckets[bucket];
-		     entry != NULL;) {
-			hashmap_entry_t *next = entry->next;
+	if (table->slots == NULL) {
+		return;
+	}
+
+	for (slot = 0; slot < table->size; slot++) {
+		entry = &table->slots[slot];
+		if (entry->probe != 0) {
 			hashmap->params->value_destroy(entry->value);
 			hashmap->params->key_destroy(entry->key);
-			free(entry);
-			entry = next;
 		}
 	}
 
-	free(hashmap->buckets);
+	free(table->slots);
+	table->slots = NULL;
+}
+
+/* Exported function, documented in hashmap.h */
+void
+hashmap_destroy(hashmap_t *hashmap)
+{
+	hashmap_table_destroy(hashmap, &hashmap->old);
+	hashmap_table_destroy(hashmap, &hashmap->table);
 	free(hashmap);
 }
 
@@ -113,17 +390,14 @@ void *
 hashmap_lookup(hashmap_t *hashmap, void *key)
 {
 	uint32_t hash = hashmap->params->key_hash(key);
-	hashmap_entry_t *entry = hashmap->buckets[hash % hashmap->bucket_count];
+	hashmap_entry_t *entry;
 
-	for(;entry != NULL; entry = entry->next) {
-		if (entry->key_hash == hash) {
-			if (hashmap->params->key_eq(key, entry->key)) {
-				return entry->value;
-			}
-		}
+	entry = hashmap_find(hashmap, key, hash);
+	if (entry == NULL) {
+		return NULL;
 	}
 
-	return NULL;
+	return entry->value;
 }
 
 /* Exported function, documented in hashmap.h */
@@ -131,74 +405,55 @@ void *
 hashmap_insert(hashmap_t *hashmap, void *key)
 {
 	uint32_t hash = hashmap->params->key_hash(key);
-	uint32_t bucket = hash % hashmap->bucket_count;
-	hashmap_entry_t *entry = hashmap->buckets[bucket];
+	hashmap_entry_t *entry;
+	hashmap_entry_t insert;
 	void *new_key, *new_value;
 
-	for(;entry != NULL; entry = entry->next) {
-		if (entry->key_hash == hash) {
-			if (hashmap->params->key_eq(key, entry->key)) {
-				/* This key is already here */
-				new_key = hashmap->params->key_clone(key);
-				if (new_key == NULL) {
-					/* Allocation failed */
-					return NULL;
-				}
-				new_value = hashmap->params->value_alloc(entry->key);
-				if (new_value == NULL) {
-					/* Allocation failed */
-					hashmap->params->key_destroy(new_key);
-					return NULL;
-				}
-				hashmap->params->value_destroy(entry->value);
-				hashmap->params->key_destroy(entry->key);
-				entry->value = new_value;
-				entry->key = new_key;
-				return entry->value;
-			}
+	hashmap_migrate(hashmap, HASHMAP_MIGRATE_STEP);
+
+	entry = hashmap_find(hashmap, key, hash);
+	if (entry != NULL) {
+		/* This key is already here */
+		new_key = hashmap->params->key_clone(key);
+		if (new_key == NULL) {
+			/* Allocation failed */
+			return NULL;
 		}
+		new_value = hashmap->params->value_alloc(entry->key);
+		if (new_value == NULL) {
+			/* Allocation failed */
+			hashmap->params->key_destroy(new_key);
+			return NULL;
+		}
+		hashmap->params->value_destroy(entry->value);
+		hashmap->params->key_destroy(entry->key);
+		entry->value = new_value;
+		entry->key = new_key;
+		return entry->value;
 	}
 
-	/* The key was not found in the map, so allocate a new entry */
-	entry = malloc(sizeof(*entry));
-
-	if (entry == NULL) {
+	/* The key was not found in the map, so create a new entry */
+	if (!hashmap_reserve(hashmap)) {
 		return NULL;
 	}
-	
-	memset(entry, 0, sizeof(*entry));
 
-	entry->key = hashmap->params->key_clone(key);
-	if (entry->key == NULL) {
-		goto err;
-	}
-	entry->key_hash = hash;
-
-	entry->value = hashmap->params->value_alloc(entry->key);
-	if (entry->value == NULL) {
-		goto err;
+	insert.key = hashmap->params->key_clone(key);
+	if (insert.key == NULL) {
+		return NULL;
 	}
+	insert.key_hash = hash;
 
-	entry->prevptr = &(hashmap->buckets[bucket]);
-	entry->next = hashmap->buckets[bucket];
-	if (entry->next != NULL) {
-		entry->next->prevptr = &entry->next;
+	insert.value = hashmap->params->value_alloc(insert.key);
+	if (insert.value == NULL) {
+		hashmap->params->key_destroy(insert.key);
+		return NULL;
 	}
 
-	hashmap->buckets[bucket] = entry;
+	hashmap_table_insert(&hashmap->table, insert);
 
 	hashmap->entry_count++;
 
-	return entry->value;
-
-err:
-	if (entry->value != NULL)
-		hashmap->params->value_destroy(entry->value);
-	if (entry->key != NULL)
-		hashmap->params->key_destroy(entry->key);
-	free(entry);
-
-	return NULL;
+	return insert.value;
 }
 
 /* Exported function, documented in hashmap.h */
@@ -206,23 +461,52 @@ bool
 hashmap_remove(hashmap_t *hashmap, void *key)
 {
 	uint32_t hash = hashmap->params->key_hash(key);
-	
-	hashmap_entry_t *entry = hashmap->buckets[hash % hashmap->bucket_count];
-
-	for(;entry != NULL; entry = entry->next) {
-		if (entry->key_hash == hash) {
-			if (hashmap->params->key_eq(key, entry->key)) {
-				hashmap->params->value_destroy(entry->value);
-				hashmap->params->key_destroy(entry->key);
-				if (entry->next != NULL) {
-					entry->next->prevptr = entry->prevptr;
-				}
-				*entry->prevptr = entry->next;
-				free(entry);
-				hashmap->entry_count--;
-				return true;
-			}
+	hashmap_entry_t *entry;
+	hashmap_table_t *table = &hashmap->table;
+
+	hashmap_migrate(hashmap, HASHMAP_MIGRATE_STEP);
+
+	entry = hashmap_table_find(hashmap, table, key, hash);
+	if ((entry == NULL) && (hashmap->old.slots != NULL)) {
+		table = &hashmap->old;
+		entry = hashmap_table_find(hashmap, table, key, hash);
+	}
+
+	if (entry == NULL) {
+		return false;
+	}
+
+	hashmap->params->value_destroy(entry->value);
+	hashmap->params->key_destroy(entry->key);
+	hashmap_table_remove(table, entry);
+	hashmap->entry_count--;
+
+	return true;
+}
+
+/**
+ * Iterate the entries of a table
+ */
+static bool
+hashmap_table_iterate(hashmap_table_t *table,
+		      hashmap_iteration_cb_t cb,
+		      void *ctx)
+{
+	uint32_t slot;
+	hashmap_entry_t *entry;
+
+	if (table->slots == NULL) {
+		return false;
+	}
+
+	for (slot = 0; slot < table->size; slot++) {
+		entry = &table->slots[slot];
+		if (entry->probe == 0) {
+			continue;
 		}
+		/* If the callback returns true, we early-exit */
+		if (cb(entry->key, entry->value, ctx))
+			return true;
 	}
 
 	return false;
@@ -232,19 +516,11 @@ hashmap_remove(hashmap_t *hashmap, void *key)
 bool
 hashmap_iterate(hashmap_t *hashmap, hashmap_iteration_cb_t cb, void *ctx)
 {
-	for (uint32_t bucket = 0;
-	     bucket < hashmap->bucket_count;
-	     bucket++) {
-		for (hashmap_entry_t *entry = hashmap->buckets[bucket];
-		     entry != NULL;
-		     entry = entry->next) {
-			/* If the callback returns true, we early-exit */
-			if (cb(entry->key, entry->value, ctx))
-				return true;
-		}
+	if (hashmap_table_iterate(&hashmap->old, cb, ctx)) {
+		return true;
 	}
 
-	return false;
+	return hashmap_table_iterate(&hashmap->table, cb, ctx);
 }
 
 /* Exported function, documented in hashmap.h */